@@ -21,19 +21,11 @@ MouseCameraController::MouseCameraController(ICamera* camera, EventHandler& even
       m_enabled(false),
       m_translate(false)
 {
-    using namespace std::placeholders;
-    
-    const event::MouseDownEventFunc mouse_down_func = std::bind(&MouseCameraController::OnMouseDown, this, _1);
-    const event::MouseUpEventFunc mouse_up_func = std::bind(&MouseCameraController::OnMouseUp, this, _1);
-    const event::MouseMotionEventFunc mouse_move_func = std::bind(&MouseCameraController::OnMouseMove, this, _1);
-    const event::MultiGestureEventFunc multi_gesture_func = std::bind(&MouseCameraController::OnMultiGesture, this, _1);
-    const event::MouseWheelEventFunc mouse_wheel_func = std::bind(&MouseCameraController::OnMouseWheel, this, _1);
-
-    m_mouse_down_token = m_event_handler.AddListener(mouse_down_func);
-    m_mouse_up_token = m_event_handler.AddListener(mouse_up_func);
-    m_mouse_move_token = m_event_handler.AddListener(mouse_move_func);
-    m_multi_gesture_token = m_event_handler.AddListener(multi_gesture_func);
-    m_mouse_wheel_token = m_event_handler.AddListener(mouse_wheel_func);
+    m_mouse_down_token = m_event_handler.AddListener(this, &MouseCameraController::OnMouseDown);
+    m_mouse_up_token = m_event_handler.AddListener(this, &MouseCameraController::OnMouseUp);
+    m_mouse_move_token = m_event_handler.AddListener(this, &MouseCameraController::OnMouseMove);
+    m_multi_gesture_token = m_event_handler.AddListener(this, &MouseCameraController::OnMultiGesture);
+    m_mouse_wheel_token = m_event_handler.AddListener(this, &MouseCameraController::OnMouseWheel);
 }
 
 MouseCameraController::~MouseCameraController()
@@ -40,19 +40,11 @@ Engine::Engine(System::IWindow* window, ICamera* camera, SystemContext* system_c
     , m_system_context(system_context)
     , m_event_handler(event_handler)
 {
-    using namespace std::placeholders;
-
-    const event::PauseEventFunc pause_func = std::bind(&Engine::OnPause, this, _1);
-    const event::QuitEventFunc quit_func = std::bind(&Engine::OnQuit, this, _1);
-    const event::ApplicationEventFunc app_func = std::bind(&Engine::OnApplication, this, _1);
-    const event::ActivatedEventFunc activated_func = std::bind(&Engine::OnActivated, this, _1);
-    const event::TimeScaleEventFunc time_scale_func = std::bind(&Engine::OnTimeScale, this, _1);
-
-    m_pause_token = m_event_handler->AddListener(pause_func);
-    m_quit_token = m_event_handler->AddListener(quit_func);
-    m_application_token = m_event_handler->AddListener(app_func);
-    m_activated_token = m_event_handler->AddListener(activated_func);
-    m_time_scale_token = m_event_handler->AddListener(time_scale_func);
+    m_pause_token = m_event_handler->AddListener(this, &Engine::OnPause);
+    m_quit_token = m_event_handler->AddListener(this, &Engine::OnQuit);
+    m_application_token = m_event_handler->AddListener(this, &Engine::OnApplication);
+    m_activated_token = m_event_handler->AddListener(this, &Engine::OnActivated);
+    m_time_scale_token = m_event_handler->AddListener(this, &Engine::OnTimeScale);
 }
 
 Engine::~Engine()
@@ -75,7 +67,7 @@ int Engine::Run(IZone* zone)
     };
 
     InputHandler input_handler(screen_to_world_func, m_event_handler);
-    UpdateContext update_context = { 0, 0, 0, 0.0f };
+    UpdateContext update_context = { 0, 0, 0, 0.0f, math::Quad(), 0.0f };
     Updater updater;
 
     zone->OnLoad(m_camera, &renderer);
@@ -111,8 +103,12 @@ int Engine::Run(IZone* zone)
         const math::Quad camera_quad(viewport.mA, viewport.mA + viewport.mB);
         renderer.SetViewport(camera_quad);
 
+        update_context.viewport = camera_quad;
+        update_context.world_per_pixel = (drawable_size_vec.x > 0.0f) ? math::Width(camera_quad) / drawable_size_vec.x : 0.0f;
+
         // Handle input events
         System::ProcessSystemEvents(&input_handler);
+        m_event_handler->DispatchQueuedEvents();
 
         audio::MixSounds();
 
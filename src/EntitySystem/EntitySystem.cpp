@@ -14,6 +14,7 @@
 #include <cassert>
 
 using namespace mono;
+using namespace hash::literals;
 
 EntitySystem::EntitySystem(
     uint32_t n_entities,
@@ -28,6 +29,7 @@ EntitySystem::EntitySystem(
     m_entity_uuids.resize(n_entities, 0);
     m_free_indices.resize(n_entities);
     m_debug_names.resize(n_entities);
+    m_debug_name_hashes.resize(n_entities, hash::Hash(""));
     m_release_callbacks.resize(n_entities);
 
     std::iota(m_free_indices.begin(), m_free_indices.end(), 0);
@@ -59,7 +61,7 @@ mono::Entity EntitySystem::CreateEntity(const char* name, uint32_t uuid_hash, co
 
 mono::Entity EntitySystem::CreateEntity(const char* entity_file)
 {
-    const uint32_t entity_hash = hash::Hash(entity_file);
+    const uint32_t entity_hash = hash::HashRegisterString(entity_file);
     const auto it = m_cached_entities.find(entity_hash);
     if(it == m_cached_entities.end())
         m_cached_entities[entity_hash] = m_load_func(entity_file);
@@ -68,7 +70,7 @@ mono::Entity EntitySystem::CreateEntity(const char* entity_file)
 
     mono::Entity* new_entity = AllocateEntity();
     m_entity_uuids[new_entity->id] = entity_data.entity_uuid;
-    SetName(new_entity->id, entity_data.entity_name);
+    SetName(new_entity->id, entity_data.entity_name.c_str());
     new_entity->properties = entity_data.entity_properties;
 
     for(const ComponentData& component : entity_data.entity_components)
@@ -181,8 +183,7 @@ void EntitySystem::SetEntityName(uint32_t entity_id, const char* name)
 
 const char* EntitySystem::GetEntityName(uint32_t entity_id) const
 {
-    const std::string& name = GetName(entity_id);
-    return name.c_str();
+    return GetName(entity_id);
 }
 
 uint32_t EntitySystem::GetEntityUuid(uint32_t entity_id) const
@@ -338,6 +339,7 @@ void EntitySystem::ReleaseEntity2(uint32_t entity_id)
 {
     m_entities[entity_id] = Entity();
     m_debug_names[entity_id].clear();
+    m_debug_name_hashes[entity_id] = hash::Hash("");
     
     ReleaseCallbacks& callbacks = m_release_callbacks[entity_id];
     for(auto& callback : callbacks)
@@ -381,28 +383,41 @@ bool EntitySystem::HasComponent(const mono::Entity* entity, uint32_t component_h
     return (std::find(entity_components.begin(), entity_components.end(), component_hash) != entity_components.end());
 }
 
-void EntitySystem::SetName(uint32_t entity_id, const std::string& name)
+void EntitySystem::SetName(uint32_t entity_id, const char* name)
 {
-    m_debug_names[entity_id] = name;
+    std::string& debug_name = m_debug_names[entity_id];
+    debug_name = name;
+    m_debug_name_hashes[entity_id] = hash::Hash(name);
+
+    // Assigning can move the string, point the entity at where it is now.
+    m_entities[entity_id].name = debug_name.c_str();
 }
 
-const std::string& EntitySystem::GetName(uint32_t entity_id) const
+const char* EntitySystem::GetName(uint32_t entity_id) const
 {
-    return m_debug_names[entity_id];
+    return m_debug_names[entity_id].c_str();
 }
 
 uint32_t EntitySystem::FindEntityByName(const char* name) const
 {
-    const auto it = std::find(m_debug_names.begin(), m_debug_names.end(), name);
-    if(it != m_debug_names.end())
-        return std::distance(m_debug_names.begin(), it);
+    const uint32_t name_hash = hash::Hash(name);
+    for(uint32_t entity_id = 0; entity_id < m_debug_name_hashes.size(); ++entity_id)
+    {
+        // Released entities keep the hash of the empty name, and two names can share a hash.
+        if(m_debug_name_hashes[entity_id] != name_hash || m_entities[entity_id].id == INVALID_ID)
+            continue;
+
+        if(m_debug_names[entity_id] == name)
+            return entity_id;
+    }
 
     return INVALID_ID;
 }
 
 uint32_t EntitySystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "entitysystem"_hash;
+    return system_id;
 }
 
 const char* EntitySystem::Name() const
@@ -80,8 +80,8 @@ namespace mono
 
         bool HasComponent(const mono::Entity* entity, uint32_t component_hash) const;
 
-        void SetName(uint32_t entity_id, const std::string& name);
-        const std::string& GetName(uint32_t entity_id) const;
+        void SetName(uint32_t entity_id, const char* name);
+        const char* GetName(uint32_t entity_id) const;
         uint32_t FindEntityByName(const char* name) const;
 
         template <typename T>
@@ -110,7 +110,10 @@ namespace mono
         std::vector<Entity> m_entities;
         std::vector<uint32_t> m_entity_uuids;
         std::vector<uint32_t> m_free_indices;
+        // Owned per entity, names are made at runtime and would fill the intern table. The hash is checked
+        // before the string when looking up a name.
         std::vector<std::string> m_debug_names;
+        std::vector<uint32_t> m_debug_name_hashes;
 
         using ReleaseCallbacks = std::array<ReleaseCallback, 8>;
         std::vector<ReleaseCallbacks> m_release_callbacks;
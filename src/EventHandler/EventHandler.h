@@ -2,103 +2,304 @@
 #pragma once
 
 #include "EventToken.h"
+#include "Util/Delegate.h"
 
-#include <typeinfo>
-#include <unordered_map>
 #include <functional>
 #include <vector>
-#include <algorithm>
-#include <any>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 namespace mono
 {
-    template<typename Event>
-    struct EventListeners
+    namespace detail
     {
-        using ListenerCallback = std::function<EventResult (const Event&)>;
+        inline uint32_t NextEventTypeIndex()
+        {
+            static std::atomic<uint32_t> next_index(0);
+            return next_index++;
+        }
 
-        std::vector<EventToken<Event>> m_tokens;
-        std::vector<ListenerCallback> m_callbacks;
+        //! A dense index for each event type, assigned the first time the type is used.
+        template <typename Event>
+        inline uint32_t EventTypeIndex()
+        {
+            static const uint32_t type_index = NextEventTypeIndex();
+            return type_index;
+        }
+    }
+
+    class IEventListeners
+    {
+    public:
+
+        virtual ~IEventListeners() = default;
+        virtual void DispatchQueuedEvents(uint32_t count) = 0;
+    };
+
+    template <typename Event>
+    class EventListeners : public IEventListeners
+    {
+    public:
 
-        inline EventToken<Event> AddListener(const ListenerCallback& callback, unsigned int new_token_id)
+        using ListenerCallback = Delegate<EventResult (const Event&)>;
+
+        EventToken<Event> AddListener(ListenerCallback&& callback)
         {
-            EventToken<Event> new_token;
-            new_token.m_id = new_token_id;
+            uint32_t id_index;
+            if(m_free_ids.empty())
+            {
+                id_index = m_id_to_index.size();
+                m_id_to_index.push_back(0);
+                m_id_generation.push_back(0);
+            }
+            else
+            {
+                id_index = m_free_ids.back();
+                m_free_ids.pop_back();
+            }
 
-            m_tokens.emplace_back(new_token);
-            m_callbacks.emplace_back(callback);
+            // Listeners added while dispatching wait until the dispatch is done, so the callbacks are not moved
+            // while one of them is running.
+            std::vector<ListenerCallback>& callbacks = (m_dispatch_depth > 0) ? m_added_callbacks : m_callbacks;
+            m_id_to_index[id_index] = m_callbacks.size() + m_added_callbacks.size();
+            m_callback_ids.push_back(id_index);
+            callbacks.push_back(std::move(callback));
 
+            EventToken<Event> new_token;
+            new_token.m_id = (m_id_generation[id_index] << ID_INDEX_BITS) | id_index;
             return new_token;
         }
 
-        inline void RemoveListener(const EventToken<Event>& token)
+        void RemoveListener(const EventToken<Event>& token)
         {
-            const auto it = std::find(m_tokens.begin(), m_tokens.end(), token);
-            if(it != m_tokens.end())
-            {
-                const size_t offset = std::distance(m_tokens.begin(), it);
+            const uint32_t id_index = token.m_id & ID_INDEX_MASK;
+            const uint32_t generation = token.m_id >> ID_INDEX_BITS;
+            if(id_index >= m_id_to_index.size() || m_id_generation[id_index] != generation)
+                return;
 
-                *it = m_tokens.back();
-                *(m_callbacks.begin() + offset) = m_callbacks.back();
+            const uint32_t index = m_id_to_index[id_index];
+            m_id_generation[id_index] = (generation + 1) & ID_GENERATION_MASK;
+            m_free_ids.push_back(id_index);
 
-                m_tokens.pop_back();
-                m_callbacks.pop_back();
+            if(m_dispatch_depth > 0)
+            {
+                // Cleared now and removed when the dispatch is done.
+                if(index < m_callbacks.size())
+                    m_callbacks[index].Reset();
+                else
+                    m_added_callbacks[index - m_callbacks.size()].Reset();
+                m_callback_ids[index] = INVALID_ID_INDEX;
+                m_has_removed = true;
+                return;
             }
+
+            RemoveAt(index);
         }
 
-        inline void DispatchEvent(const Event& event)
+        void DispatchEvent(const Event& event)
         {
-            for(const ListenerCallback& callback : m_callbacks)
+            ++m_dispatch_depth;
+
+            const size_t n_callbacks = m_callbacks.size();
+            for(size_t index = 0; index < n_callbacks; ++index)
             {
-                const EventResult result = callback(event);
-                if(result == EventResult::HANDLED)
+                const ListenerCallback& callback = m_callbacks[index];
+                if(callback && callback(event) == EventResult::HANDLED)
                     break;
             }
+
+            --m_dispatch_depth;
+            if(m_dispatch_depth == 0)
+                FinishDispatch();
+        }
+
+        void QueueEvent(const Event& event)
+        {
+            m_queued_events.push_back(event);
+        }
+
+        void DispatchQueuedEvents(uint32_t count) override
+        {
+            for(uint32_t index = 0; index < count; ++index)
+            {
+                // Copied, a listener can queue more events and grow the queue.
+                const Event event = m_queued_events[m_queue_read_index++];
+                DispatchEvent(event);
+            }
+
+            if(m_queue_read_index == m_queued_events.size())
+            {
+                m_queued_events.clear();
+                m_queue_read_index = 0;
+            }
+        }
+
+    private:
+
+        static constexpr uint32_t ID_INDEX_BITS = 20;
+        static constexpr uint32_t ID_INDEX_MASK = (1u << ID_INDEX_BITS) - 1;
+        static constexpr uint32_t ID_GENERATION_MASK = (1u << (32 - ID_INDEX_BITS)) - 1;
+        static constexpr uint32_t INVALID_ID_INDEX = ~0u;
+
+        void RemoveAt(uint32_t index)
+        {
+            const uint32_t last_index = m_callbacks.size() - 1;
+            if(index != last_index)
+            {
+                m_callbacks[index] = std::move(m_callbacks[last_index]);
+                m_callback_ids[index] = m_callback_ids[last_index];
+                if(m_callback_ids[index] != INVALID_ID_INDEX)
+                    m_id_to_index[m_callback_ids[index]] = index;
+            }
+
+            m_callbacks.pop_back();
+            m_callback_ids.pop_back();
         }
-    };    
-    
+
+        void FinishDispatch()
+        {
+            for(ListenerCallback& callback : m_added_callbacks)
+                m_callbacks.push_back(std::move(callback));
+            m_added_callbacks.clear();
+
+            if(m_has_removed)
+            {
+                for(uint32_t index = m_callbacks.size(); index > 0; --index)
+                {
+                    if(m_callback_ids[index - 1] == INVALID_ID_INDEX)
+                        RemoveAt(index - 1);
+                }
+
+                m_has_removed = false;
+            }
+        }
+
+        std::vector<ListenerCallback> m_callbacks;
+        std::vector<ListenerCallback> m_added_callbacks;
+
+        // A token is an index into m_id_to_index and a generation, so a token that has been removed does
+        // not remove the listener that reused its index.
+        std::vector<uint32_t> m_callback_ids;
+        std::vector<uint32_t> m_id_to_index;
+        std::vector<uint32_t> m_id_generation;
+        std::vector<uint32_t> m_free_ids;
+
+        uint32_t m_dispatch_depth = 0;
+        bool m_has_removed = false;
+
+        std::vector<Event> m_queued_events;
+        uint32_t m_queue_read_index = 0;
+    };
+
     class EventHandler
     {
-        unsigned int m_next_token_id = 0;
-        std::unordered_map<size_t, std::any> m_events;
-
     public:
-        
-        template<typename Event>
+
+        template <typename Event>
         inline EventToken<Event> AddListener(const std::function<mono::EventResult (const Event& event)>& listener)
         {
-            const size_t event_hash = typeid(Event).hash_code();
-            const auto it = m_events.find(event_hash);
-            if(it == m_events.end())
-                m_events[event_hash] = EventListeners<Event>();
-            
-            EventListeners<Event>& listeners = std::any_cast<EventListeners<Event>&>(m_events[event_hash]);
-            return listeners.AddListener(listener, m_next_token_id++);
+            return GetListeners<Event>()->AddListener(listener);
+        }
+
+        //! Calls object->method(event), without std::function and std::bind.
+        template <typename Event, typename T>
+        inline EventToken<Event> AddListener(T* object, mono::EventResult (T::*method)(const Event& event))
+        {
+            const auto listener = [object, method](const Event& event) {
+                return (object->*method)(event);
+            };
+            return GetListeners<Event>()->AddListener(listener);
+        }
+
+        //! For lambdas, AddListener<MouseDownEvent>([](const MouseDownEvent& event) { ... })
+        template <typename Event, typename Callable>
+        inline EventToken<Event> AddListener(Callable&& listener)
+        {
+            return GetListeners<Event>()->AddListener(std::forward<Callable>(listener));
         }
-        
-        template<typename Event>
+
+        template <typename Event>
         inline void RemoveListener(const EventToken<Event>& token)
         {
-            const size_t event_hash = typeid(Event).hash_code();
-            const auto it = m_events.find(event_hash);
-            if(it != m_events.end())
-            {
-                EventListeners<Event>& listeners = std::any_cast<EventListeners<Event>&>(it->second);
-                listeners.RemoveListener(token);
-            }
+            EventListeners<Event>* listeners = FindListeners<Event>();
+            if(listeners)
+                listeners->RemoveListener(token);
         }
-        
-        template<typename Event>
+
+        template <typename Event>
         inline void DispatchEvent(const Event& event)
         {
-            const size_t event_hash = typeid(Event).hash_code();
-            const auto it = m_events.find(event_hash);
-            if(it != m_events.end())
-            {
-                EventListeners<Event>& listeners = std::any_cast<EventListeners<Event>&>(it->second);
-                listeners.DispatchEvent(event);
-            }	
+            EventListeners<Event>* listeners = FindListeners<Event>();
+            if(listeners)
+                listeners->DispatchEvent(event);
         }
+
+        //! Stores the event until DispatchQueuedEvents, events are dispatched in the order they were queued.
+        template <typename Event>
+        inline void QueueEvent(const Event& event)
+        {
+            const uint32_t type_index = detail::EventTypeIndex<Event>();
+            GetListeners<Event>()->QueueEvent(event);
+
+            if(!m_queued_runs.empty() && m_queued_runs.back().type_index == type_index)
+                m_queued_runs.back().count++;
+            else
+                m_queued_runs.push_back({ type_index, 1 });
+        }
+
+        //! Dispatches the queued events, runs of the same event type are dispatched together. Events queued by
+        //! the listeners are dispatched on the next call.
+        inline void DispatchQueuedEvents()
+        {
+            if(m_dispatching_queued)
+                return;
+
+            m_dispatching_queued = true;
+            m_dispatching_runs.swap(m_queued_runs);
+
+            for(const QueuedRun& run : m_dispatching_runs)
+                m_listeners[run.type_index]->DispatchQueuedEvents(run.count);
+
+            m_dispatching_runs.clear();
+            m_dispatching_queued = false;
+        }
+
+    private:
+
+        template <typename Event>
+        inline EventListeners<Event>* FindListeners() const
+        {
+            const uint32_t type_index = detail::EventTypeIndex<Event>();
+            if(type_index < m_listeners.size())
+                return static_cast<EventListeners<Event>*>(m_listeners[type_index].get());
+
+            return nullptr;
+        }
+
+        template <typename Event>
+        inline EventListeners<Event>* GetListeners()
+        {
+            const uint32_t type_index = detail::EventTypeIndex<Event>();
+            if(type_index >= m_listeners.size())
+                m_listeners.resize(type_index + 1);
+
+            std::unique_ptr<IEventListeners>& listeners = m_listeners[type_index];
+            if(!listeners)
+                listeners = std::make_unique<EventListeners<Event>>();
+
+            return static_cast<EventListeners<Event>*>(listeners.get());
+        }
+
+        struct QueuedRun
+        {
+            uint32_t type_index;
+            uint32_t count;
+        };
+
+        std::vector<std::unique_ptr<IEventListeners>> m_listeners;
+        std::vector<QueuedRun> m_queued_runs;
+        std::vector<QueuedRun> m_dispatching_runs;
+        bool m_dispatching_queued = false;
     };
 }
-
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include "Math/Quad.h"
 #include <cstdint>
 
 namespace mono
@@ -11,6 +12,11 @@ namespace mono
         uint32_t frame_count;
         uint32_t delta_ms;
         float delta_s;
+
+        // The camera viewport in world units and the world size of a drawable pixel, set by the engine each
+        // frame. world_per_pixel is zero when there is no view.
+        math::Quad viewport;
+        float world_per_pixel;
     };
 
     class IUpdatable
@@ -16,25 +16,14 @@
 ImGuiInputHandler::ImGuiInputHandler(mono::EventHandler& event_handler)
     : m_eventHandler(event_handler)
 {
-    using namespace std::placeholders;
-
-    event::KeyDownEventFunc key_down = std::bind(&ImGuiInputHandler::OnKeyDown, this, _1);
-    event::KeyUpEventFunc key_up = std::bind(&ImGuiInputHandler::OnKeyUp, this, _1);
-    event::TextInputEventFunc text_input = std::bind(&ImGuiInputHandler::OnTextInput, this, _1);
-    event::MouseDownEventFunc mouse_down = std::bind(&ImGuiInputHandler::OnMouseDown, this, _1);
-    event::MouseUpEventFunc mouse_up = std::bind(&ImGuiInputHandler::OnMouseUp, this, _1);
-    event::MouseMotionEventFunc mouse_move = std::bind(&ImGuiInputHandler::OnMouseMove, this, _1);
-    event::MouseWheelEventFunc mouse_wheel = std::bind(&ImGuiInputHandler::OnMouseWheel, this, _1);
-    event::MultiGestureEventFunc multi_gesture = std::bind(&ImGuiInputHandler::OnMultiGesture, this, _1);
-
-    m_keyDownToken = m_eventHandler.AddListener(key_down);
-    m_keyUpToken = m_eventHandler.AddListener(key_up);
-    m_textInputToken = m_eventHandler.AddListener(text_input);
-    m_mouseDownToken = m_eventHandler.AddListener(mouse_down);
-    m_mouseUpToken = m_eventHandler.AddListener(mouse_up);
-    m_mouseMoveToken = m_eventHandler.AddListener(mouse_move);
-    m_mouseWheelToken = m_eventHandler.AddListener(mouse_wheel);
-    m_multiGestureToken = m_eventHandler.AddListener(multi_gesture);
+    m_keyDownToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnKeyDown);
+    m_keyUpToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnKeyUp);
+    m_textInputToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnTextInput);
+    m_mouseDownToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnMouseDown);
+    m_mouseUpToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnMouseUp);
+    m_mouseMoveToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnMouseMove);
+    m_mouseWheelToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnMouseWheel);
+    m_multiGestureToken = m_eventHandler.AddListener(this, &ImGuiInputHandler::OnMultiGesture);
 
     ImGuiIO& io = ImGui::GetIO();
     io.KeyMap[ImGuiKey_Tab] = System::KeycodeToNative(Keycode::TAB);
@@ -18,6 +18,18 @@
 
 using namespace mono;
 
+namespace
+{
+    // Motion, wheel, touch and gesture events are queued, they are dispatched first so that the listeners
+    // see the events in the order they happened.
+    template <typename Event>
+    void DispatchInOrder(EventHandler* event_handler, const Event& event)
+    {
+        event_handler->DispatchQueuedEvents();
+        event_handler->DispatchEvent(event);
+    }
+}
+
 InputHandler::InputHandler(const ScreenToWorldFunc& screen_to_world_func, EventHandler* event_handler)
     : m_screen_to_world_func(screen_to_world_func)
     , m_event_handler(event_handler)
@@ -26,7 +38,7 @@ InputHandler::InputHandler(const ScreenToWorldFunc& screen_to_world_func, EventH
 void InputHandler::OnKeyDown(Keycode key, bool ctrl, bool shift, bool alt, bool super)
 {
     const event::KeyDownEvent event(key, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnKeyUp(Keycode key, bool ctrl, bool shift, bool alt, bool super)
@@ -38,13 +50,13 @@ void InputHandler::OnKeyUp(Keycode key, bool ctrl, bool shift, bool alt, bool su
     }
 
     const event::KeyUpEvent event(key, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnTextInput(const char* text)
 {
     const event::TextInputEvent event(text);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnMouseDown(MouseButton button, int x, int y, bool ctrl, bool shift, bool alt, bool super)
@@ -53,7 +65,7 @@ void InputHandler::OnMouseDown(MouseButton button, int x, int y, bool ctrl, bool
     float world_y = y;
     m_screen_to_world_func(world_x, world_y);
     const event::MouseDownEvent event(button, x, y, world_x, world_y, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnMouseUp(MouseButton button, int x, int y, bool ctrl, bool shift, bool alt, bool super)
@@ -62,7 +74,7 @@ void InputHandler::OnMouseUp(MouseButton button, int x, int y, bool ctrl, bool s
     float world_y = y;
     m_screen_to_world_func(world_x, world_y);
     const event::MouseUpEvent event(button, x, y, world_x, world_y, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnMouseMotion(int x, int y, bool ctrl, bool shift, bool alt, bool super)
@@ -71,83 +83,83 @@ void InputHandler::OnMouseMotion(int x, int y, bool ctrl, bool shift, bool alt,
     float world_y = y;
     m_screen_to_world_func(world_x, world_y);
     const event::MouseMotionEvent event(x, y, world_x, world_y, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnMouseWheel(int x, int y, bool ctrl, bool shift, bool alt, bool super)
 {
     const event::MouseWheelEvent event(x, y, ctrl, shift, alt, super);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnTouchDown(int64_t touchId, float x, float y, float dx, float dy)
 {
     const event::TouchEvent event(event::TouchType::DOWN, touchId, x, y, dx, dy);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnTouchUp(int64_t touchId, float x, float y, float dx, float dy)
 {
     const event::TouchEvent event(event::TouchType::UP, touchId, x, y, dx, dy);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnTouchMotion(int64_t touchId, float x, float y, float dx, float dy)
 {
     const event::TouchEvent event(event::TouchType::MOTION, touchId, x, y, dx, dy);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnMultiGesture(float x, float y, float theta, float distance)
 {
     const event::MultiGestureEvent event(x, y, theta, distance);
-    m_event_handler->DispatchEvent(event);
+    m_event_handler->QueueEvent(event);
 }
 
 void InputHandler::OnControllerAdded(int controller_id)
 {
     const event::ControllerAddedEvent event(controller_id);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnControllerRemoved(int controller_id)
 {
     const event::ControllerRemovedEvent event(controller_id);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnAppTerminating()
 {
     constexpr event::ApplicationEvent event(event::ApplicationState::TERMINATING);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnEnterBackground()
 {
     constexpr event::ApplicationEvent event(event::ApplicationState::ENTER_BACKGROUND);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnEnterForeground()
 {
     constexpr event::ApplicationEvent event(event::ApplicationState::ENTER_FOREGROUND);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnQuit()
 {
     constexpr event::QuitEvent event;
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnSurfaceChanged(int width, int height)
 {
     const event::SurfaceChangedEvent event(width, height);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
 
 void InputHandler::OnActivated(bool gain)
 {
     const event::ActivatedEvent event(gain);
-    m_event_handler->DispatchEvent(event);
+    DispatchInOrder(m_event_handler, event);
 }
@@ -0,0 +1,133 @@
+
+#include "ParticleBudget.h"
+#include "Math/MathFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace mono;
+
+namespace
+{
+    float Area(const math::Quad& quad)
+    {
+        return std::max(math::Width(quad), 0.0f) * std::max(math::Height(quad), 0.0f);
+    }
+
+    // The part of the bounds that is inside the viewport, bounds without area are either in or out.
+    float OnScreenFraction(const math::Quad& viewport, const math::Quad& bounds)
+    {
+        const math::Quad overlap(
+            std::max(viewport.mA.x, bounds.mA.x),
+            std::max(viewport.mA.y, bounds.mA.y),
+            std::min(viewport.mB.x, bounds.mB.x),
+            std::min(viewport.mB.y, bounds.mB.y));
+
+        const bool overlaps = (overlap.mA.x <= overlap.mB.x && overlap.mA.y <= overlap.mB.y);
+        if(!overlaps)
+            return 0.0f;
+
+        const float bounds_area = Area(bounds);
+        if(bounds_area <= 0.0f)
+            return 1.0f;
+
+        return Area(overlap) / bounds_area;
+    }
+
+    float DistanceToBounds(const math::Vector& point, const math::Quad& bounds)
+    {
+        const float dx = std::max(std::max(bounds.mA.x - point.x, point.x - bounds.mB.x), 0.0f);
+        const float dy = std::max(std::max(bounds.mA.y - point.y, point.y - bounds.mB.y), 0.0f);
+        return std::sqrt(dx * dx + dy * dy);
+    }
+}
+
+ParticleBudget::ParticleBudget(uint32_t n_pools)
+    : m_has_view(false)
+    , m_pool_world_bounds(n_pools)
+    , m_has_pool_bounds(n_pools, false)
+    , m_frame_alive(0)
+    , m_frame_spawned(0)
+    , m_stats{}
+{ }
+
+void ParticleBudget::SetConfig(const ParticleBudgetConfig& config)
+{
+    m_config = config;
+}
+
+const ParticleBudgetConfig& ParticleBudget::GetConfig() const
+{
+    return m_config;
+}
+
+void ParticleBudget::SetView(const math::Quad& viewport)
+{
+    m_viewport = viewport;
+    m_has_view = true;
+}
+
+void ParticleBudget::SetPoolWorldBounds(uint32_t pool_id, const math::Quad& world_bounds)
+{
+    m_pool_world_bounds[pool_id] = world_bounds;
+    m_has_pool_bounds[pool_id] = true;
+}
+
+void ParticleBudget::ResetPool(uint32_t pool_id)
+{
+    m_has_pool_bounds[pool_id] = false;
+}
+
+float ParticleBudget::EmitRateScale(uint32_t pool_id) const
+{
+    if(m_config.min_emit_scale >= 1.0f || !m_has_view || !m_has_pool_bounds[pool_id])
+        return 1.0f;
+
+    const math::Quad& bounds = m_pool_world_bounds[pool_id];
+
+    float distance_scale = 1.0f;
+    if(m_config.lod_far_distance > m_config.lod_near_distance)
+    {
+        const float distance = DistanceToBounds(math::Center(m_viewport), bounds);
+        const float t = math::Scale01Clamped(distance, m_config.lod_near_distance, m_config.lod_far_distance);
+        distance_scale = 1.0f - t * (1.0f - m_config.min_emit_scale);
+    }
+
+    const float coverage_scale = OnScreenFraction(m_viewport, bounds);
+    return std::max(distance_scale * coverage_scale, m_config.min_emit_scale);
+}
+
+void ParticleBudget::BeginFrame(uint32_t alive_particles)
+{
+    m_frame_alive = alive_particles;
+    m_frame_spawned = 0;
+
+    m_stats.alive_particles = alive_particles;
+    m_stats.requested_spawns = 0;
+    m_stats.spawned_particles = 0;
+    m_stats.rejected_spawns = 0;
+}
+
+uint32_t ParticleBudget::RequestSpawns(uint32_t wanted)
+{
+    const uint32_t alive_left =
+        (m_frame_alive < m_config.max_alive_particles) ? m_config.max_alive_particles - m_frame_alive : 0;
+    const uint32_t spawns_left =
+        (m_frame_spawned < m_config.max_spawns_per_frame) ? m_config.max_spawns_per_frame - m_frame_spawned : 0;
+
+    const uint32_t granted = std::min(wanted, std::min(alive_left, spawns_left));
+
+    m_frame_alive += granted;
+    m_frame_spawned += granted;
+
+    m_stats.requested_spawns += wanted;
+    m_stats.spawned_particles += granted;
+    m_stats.rejected_spawns += (wanted - granted);
+
+    return granted;
+}
+
+const ParticleBudgetStats& ParticleBudget::GetStats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,73 @@
+
+#pragma once
+
+#include "Math/Quad.h"
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+namespace mono
+{
+    struct ParticleBudgetConfig
+    {
+        // Caps on the particles alive in all pools and the particles spawned in one update.
+        uint32_t max_alive_particles = std::numeric_limits<uint32_t>::max();
+        uint32_t max_spawns_per_frame = std::numeric_limits<uint32_t>::max();
+
+        // Emit rates are scaled down linearly from the near to the far distance from the camera, and by the
+        // part of the pool that is on screen. The scale never goes below min_emit_scale, the default of 1.0
+        // disables the scaling.
+        float lod_near_distance = 0.0f;
+        float lod_far_distance = 0.0f;
+        float min_emit_scale = 1.0f;
+    };
+
+    struct ParticleBudgetStats
+    {
+        uint32_t alive_particles;
+        uint32_t requested_spawns;
+        uint32_t spawned_particles;
+        uint32_t rejected_spawns;
+    };
+
+    class ParticleBudget
+    {
+    public:
+
+        ParticleBudget(uint32_t n_pools);
+
+        void SetConfig(const ParticleBudgetConfig& config);
+        const ParticleBudgetConfig& GetConfig() const;
+
+        //! Reported by the particle system each update, the viewport is in world units and the pool bounds are
+        //! the world bounds of the alive particles.
+        void SetView(const math::Quad& viewport);
+        void SetPoolWorldBounds(uint32_t pool_id, const math::Quad& world_bounds);
+        void ResetPool(uint32_t pool_id);
+
+        //! Multiplier for the emit rate of a pool, 1.0 until the world bounds of the pool has been reported.
+        float EmitRateScale(uint32_t pool_id) const;
+
+        //! Starts a new update with the particles alive in all pools.
+        void BeginFrame(uint32_t alive_particles);
+
+        //! Returns how many of the wanted particles that fit in the budget, and counts them as spawned.
+        uint32_t RequestSpawns(uint32_t wanted);
+
+        const ParticleBudgetStats& GetStats() const;
+
+    private:
+
+        ParticleBudgetConfig m_config;
+
+        bool m_has_view;
+        math::Quad m_viewport;
+        std::vector<math::Quad> m_pool_world_bounds;
+        std::vector<bool> m_has_pool_bounds;
+
+        uint32_t m_frame_alive;
+        uint32_t m_frame_spawned;
+        ParticleBudgetStats m_stats;
+    };
+}
@@ -11,6 +11,7 @@ namespace mono
     struct ParticlePoolComponent;
     struct ParticlePoolComponentView;
     struct ParticleEmitterComponent;
+    struct ParticleDrawerComponent;
 
     using ParticleGenerator = std::function<void (const math::Vector& position, ParticlePoolComponentView& component_view)>;
     using ParticleUpdater   = std::function<void (ParticlePoolComponentView& component_view, float delta_s)>;
@@ -4,15 +4,23 @@
 #include "Rendering/Texture/ITextureFactory.h"
 #include "Rendering/RenderSystem.h"
 #include "System/Hash.h"
+#include "System/System.h"
+#include "TransformSystem/TransformSystem.h"
+#include "Math/MathFunctions.h"
 #include "Util/Algorithm.h"
 #include "Util/Random.h"
 
 #include <cassert>
+#include <limits>
 
 using namespace mono;
+using namespace hash::literals;
 
 namespace
 {
+    constexpr float FLOAT_MAX = std::numeric_limits<float>::max();
+    constexpr math::Quad EMPTY_BOUNDS = math::Quad(FLOAT_MAX, FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX);
+
     void Swap(ParticlePoolComponent& pool_component, uint32_t first, uint32_t second)
     {
         std::swap(pool_component.position[first],           pool_component.position[second]);
@@ -100,12 +108,22 @@ void mono::DefaultUpdater(ParticlePoolComponentView& component_view, float delta
 }
 
 
-ParticleSystem::ParticleSystem(uint32_t count, uint32_t n_emitters)
-    : m_particle_pools(count)
+ParticleSystem::ParticleSystem(uint32_t count, uint32_t n_emitters, const mono::TransformSystem* transform_system)
+    : m_transform_system(transform_system)
+    , m_has_view(false)
+    , m_view(math::InfQuad)
+    , m_world_per_pixel(0.0f)
+    , m_particle_pools(count)
     , m_particle_drawers(count)
     , m_active_pools(count, false)
+    , m_visible_pools(count, true)
+    , m_particle_bounds(count, EMPTY_BOUNDS)
     , m_particle_emitters(n_emitters)
     , m_particle_pools_emitters(count)
+    , m_budget(count)
+    , m_sleeping_pools(0)
+    , m_simulated_particles(0)
+    , m_simulation_time_ms(0.0f)
 { }
 
 ParticleSystem::~ParticleSystem()
@@ -113,7 +131,8 @@ ParticleSystem::~ParticleSystem()
 
 uint32_t ParticleSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "ParticleSystem"_hash;
+    return system_id;
 }
 
 const char* ParticleSystem::Name() const
@@ -123,6 +142,22 @@ const char* ParticleSystem::Name() const
 
 void ParticleSystem::Update(const mono::UpdateContext& update_context)
 {
+    const uint64_t start_counter = System::GetPerformanceCounter();
+
+    if(update_context.world_per_pixel > 0.0f)
+        SetView(update_context.viewport, update_context.world_per_pixel);
+
+    uint32_t alive_particles = 0;
+    for(uint32_t pool_index = 0; pool_index < m_active_pools.size(); ++pool_index)
+    {
+        if(m_active_pools[pool_index])
+            alive_particles += m_particle_pools[pool_index].count_alive;
+    }
+
+    m_budget.BeginFrame(alive_particles);
+    m_sleeping_pools = 0;
+    m_simulated_particles = 0;
+
     for(uint32_t active_pool_index = 0; active_pool_index < m_active_pools.size(); ++active_pool_index)
     {
         const bool is_active = m_active_pools[active_pool_index];
@@ -130,32 +165,68 @@ void ParticleSystem::Update(const mono::UpdateContext& update_context)
             continue;
 
         ParticlePoolComponent& pool_component = m_particle_pools[active_pool_index];
-
         std::vector<ParticleEmitterComponent*>& pool_emitters = m_particle_pools_emitters[active_pool_index];
+
+        UpdatePoolVisibility(active_pool_index);
+
+        const bool sleeping = (pool_component.sleep_when_not_visible && !m_visible_pools[active_pool_index]);
+        if(sleeping)
+        {
+            // Rebuilt from the particles, that do not move while sleeping, and where the emitters are now. The
+            // pool wakes up when the emitters come on screen.
+            math::Quad bounds = m_particle_bounds[active_pool_index];
+            for(const ParticleEmitterComponent* emitter : pool_emitters)
+                bounds |= emitter->position;
+            pool_component.bounds = bounds;
+
+            ++m_sleeping_pools;
+            continue;
+        }
+
         for(ParticleEmitterComponent* emitter : pool_emitters)
             UpdateEmitter(emitter, pool_component, active_pool_index, update_context);
 
-        for(uint32_t index = 0; index < pool_component.count_alive; ++index)
+        math::Quad particle_bounds = EMPTY_BOUNDS;
+        float max_point_size = 0.0f;
+
+        // Update, kill and measure in one pass. A killed particle is replaced by the last alive one, which is
+        // then updated at the same index.
+        uint32_t index = 0;
+        while(index < pool_component.count_alive)
         {
             math::Vector& velocity = pool_component.velocity[index];
             velocity *= (1.0f - pool_component.particle_damping);
 
             ParticlePoolComponentView view = MakeViewFromPool(pool_component, index);
             pool_component.update_function(view, update_context.delta_s);
-        }
 
-        for(uint32_t index = 0; index < pool_component.count_alive; ++index)
-        {
             float& life = pool_component.life[index];
             life -= update_context.delta_s;
 
-            if(life <= 0 && pool_component.count_alive > 0)
+            if(life <= 0.0f)
             {
                 --pool_component.count_alive;
                 Swap(pool_component, index, pool_component.count_alive);
+                continue;
             }
+
+            particle_bounds |= pool_component.position[index];
+            max_point_size = std::max(max_point_size, pool_component.size[index]);
+            ++index;
         }
+
+        math::Quad bounds = particle_bounds;
+        for(const ParticleEmitterComponent* emitter : pool_emitters)
+            bounds |= emitter->position;
+
+        m_particle_bounds[active_pool_index] = particle_bounds;
+        pool_component.bounds = bounds;
+        pool_component.max_point_size = max_point_size;
+        m_simulated_particles += index;
     }
+
+    const uint64_t elapsed_counter = System::GetPerformanceCounter() - start_counter;
+    m_simulation_time_ms = float(elapsed_counter * 1000.0 / System::GetPerformanceFrequency());
 }
 
 void ParticleSystem::Sync()
@@ -177,22 +248,26 @@ void ParticleSystem::UpdateEmitter(ParticleEmitterComponent* emitter, ParticlePo
 
     emitter->elapsed_time += update_context.delta_s;
 
+    const float emit_rate = emitter->emit_rate * m_budget.EmitRateScale(pool_id);
+
     uint32_t new_particles = 0;
     if(emitter->type == EmitterType::BURST || emitter->type == EmitterType::BURST_REMOVE_ON_FINISH)
     {
-        new_particles = emitter->emit_rate * emitter->duration;
+        new_particles = emit_rate * emitter->duration;
     }
     else
     {
-        new_particles = static_cast<uint32_t>(update_context.delta_s * (emitter->emit_rate + emitter->carry_over));
+        new_particles = static_cast<uint32_t>(update_context.delta_s * (emit_rate + emitter->carry_over));
         if(new_particles == 0)
-            emitter->carry_over += emitter->emit_rate;
+            emitter->carry_over += emit_rate;
         else
             emitter->carry_over = 0.0f;
     }
 
     const uint32_t start_index = particle_pool.count_alive;
-    const uint32_t end_index = std::min(start_index + new_particles, particle_pool.pool_size -1);
+    const uint32_t pool_end_index = std::min(start_index + new_particles, particle_pool.pool_size -1);
+    const uint32_t pool_particles = (pool_end_index > start_index) ? pool_end_index - start_index : 0;
+    const uint32_t end_index = start_index + m_budget.RequestSpawns(pool_particles);
 
     for(uint32_t index = start_index; index < end_index; ++index)
     {
@@ -233,8 +308,14 @@ ParticlePoolComponent* ParticleSystem::AllocatePool(uint32_t id, uint32_t pool_s
     particle_pool.count_alive = 0;
     particle_pool.update_function = update_function;
     particle_pool.particle_damping = 0.0f;
+    particle_pool.bounds = EMPTY_BOUNDS;
+    particle_pool.max_point_size = 0.0f;
+    m_particle_bounds[id] = EMPTY_BOUNDS;
+    particle_pool.sleep_when_not_visible = false;
 
     m_active_pools[id] = true;
+    m_visible_pools[id] = true;
+    m_budget.ResetPool(id);
 
     return &particle_pool;
 }
@@ -276,6 +357,10 @@ void ParticleSystem::SetPoolData(
     particle_pool.count_alive = 0;
     particle_pool.update_function = update_function;
     particle_pool.particle_damping = particle_damping;
+    particle_pool.bounds = EMPTY_BOUNDS;
+    particle_pool.max_point_size = 0.0f;
+    m_particle_bounds[id] = EMPTY_BOUNDS;
+    m_budget.ResetPool(id);
 
     mono::ITexturePtr texture = mono::GetTextureFactory()->CreateTexture(texture_file);
     SetPoolDrawData(id, texture, blend_mode, transform_space);
@@ -387,5 +472,66 @@ ParticleSystemStats ParticleSystem::GetStats() const
     stats.active_pools = std::count(m_active_pools.begin(), m_active_pools.end(), true);
     stats.active_emitters = m_particle_emitters.Used();
 
+    const ParticleBudgetStats& budget_stats = m_budget.GetStats();
+    stats.sleeping_pools = m_sleeping_pools;
+    stats.alive_particles = budget_stats.alive_particles;
+    stats.simulated_particles = m_simulated_particles;
+    stats.spawned_particles = budget_stats.spawned_particles;
+    stats.rejected_spawns = budget_stats.rejected_spawns;
+    stats.simulation_time_ms = m_simulation_time_ms;
+
     return stats;
 }
+
+void ParticleSystem::SetView(const math::Quad& viewport, float world_per_pixel)
+{
+    m_has_view = true;
+    m_view = viewport;
+    m_world_per_pixel = world_per_pixel;
+    m_budget.SetView(viewport);
+}
+
+void ParticleSystem::UpdatePoolVisibility(uint32_t pool_id)
+{
+    if(!m_has_view)
+    {
+        m_visible_pools[pool_id] = true;
+        return;
+    }
+
+    const ParticlePoolComponent& pool = m_particle_pools[pool_id];
+    const math::Quad& bounds = pool.bounds;
+    const bool has_bounds = (bounds.mA.x <= bounds.mB.x && bounds.mA.y <= bounds.mB.y);
+    if(!has_bounds)
+    {
+        m_visible_pools[pool_id] = false;
+        return;
+    }
+
+    const bool local_space = (m_particle_drawers[pool_id].transform_space == ParticleTransformSpace::LOCAL);
+    math::Quad world_bounds = (local_space && m_transform_system) ?
+        math::Transform(m_transform_system->GetWorld(pool_id), bounds) : bounds;
+
+    // Point sizes are in pixels.
+    const float padding = pool.max_point_size * m_world_per_pixel / 2.0f;
+    world_bounds.mA -= math::Vector(padding, padding);
+    world_bounds.mB += math::Vector(padding, padding);
+
+    m_visible_pools[pool_id] = math::QuadOverlaps(m_view, world_bounds);
+    m_budget.SetPoolWorldBounds(pool_id, world_bounds);
+}
+
+bool ParticleSystem::IsPoolVisible(uint32_t pool_id) const
+{
+    return m_visible_pools[pool_id];
+}
+
+ParticleBudget& ParticleSystem::GetBudget()
+{
+    return m_budget;
+}
+
+const ParticleBudget& ParticleSystem::GetBudget() const
+{
+    return m_budget;
+}
@@ -1,14 +1,17 @@
 
 #pragma once
 
+#include "MonoFwd.h"
 #include "ParticleFwd.h"
 #include "IGameSystem.h"
+#include "ParticleBudget.h"
 #include "Rendering/BlendMode.h"
 #include "Rendering/Color.h"
 #include "Rendering/RenderFwd.h"
 #include "Rendering/Texture/ITextureFactory.h"
 #include "Math/Vector.h"
 #include "Math/Interval.h"
+#include "Math/Quad.h"
 #include "Util/ObjectPool.h"
 
 #include <vector>
@@ -96,6 +99,14 @@ namespace mono
 
         ParticleUpdater update_function;
         float particle_damping;
+
+        // Bounds of the alive particles and the emitters in the space of the pool, and the largest point size
+        // in pixels. Updated by the simulation.
+        math::Quad bounds;
+        float max_point_size;
+
+        // Skip the simulation while the pool is not on screen, for effects that has no effect on gameplay.
+        bool sleep_when_not_visible;
     };
 
     struct ParticlePoolComponentView
@@ -121,13 +132,22 @@ namespace mono
     {
         uint32_t active_pools;
         uint32_t active_emitters;
+
+        // From the last update
+        uint32_t sleeping_pools;
+        uint32_t alive_particles;
+        uint32_t simulated_particles;
+        uint32_t spawned_particles;
+        uint32_t rejected_spawns;
+        float simulation_time_ms;
     };
 
     class ParticleSystem : public mono::IGameSystem
     {
     public:
 
-        ParticleSystem(uint32_t count, uint32_t n_emitters);
+        //! @param transform_system Used to cull pools in local transform space, nullptr culls them in world space.
+        ParticleSystem(uint32_t count, uint32_t n_emitters, const mono::TransformSystem* transform_system = nullptr);
         ~ParticleSystem();
 
         uint32_t Id() const override;
@@ -187,14 +207,35 @@ namespace mono
 
         ParticleSystemStats GetStats() const;
 
+        //! Called by Update with the camera view in the update context, when it has one. The viewport is in world
+        //! units and world_per_pixel pads the bounds with the point sizes. Update culls the pools against it and
+        //! the budget scales the emit rates with it, pools that sleep when not visible are not simulated until
+        //! they are visible again. All pools are visible until a view is set.
+        void SetView(const math::Quad& viewport, float world_per_pixel);
+        bool IsPoolVisible(uint32_t pool_id) const;
+
+        //! Limits and scales the emitters of all pools.
+        ParticleBudget& GetBudget();
+        const ParticleBudget& GetBudget() const;
+
     private:
 
         void UpdateEmitter(
             ParticleEmitterComponent* emitter, ParticlePoolComponent& particle_pool, uint32_t pool_id, const mono::UpdateContext& update_context);
+        void UpdatePoolVisibility(uint32_t pool_id);
+
+        const mono::TransformSystem* m_transform_system;
+        bool m_has_view;
+        math::Quad m_view;
+        float m_world_per_pixel;
 
         std::vector<ParticlePoolComponent> m_particle_pools;
         std::vector<ParticleDrawerComponent> m_particle_drawers;
         std::vector<bool> m_active_pools;
+        std::vector<bool> m_visible_pools;
+
+        // The alive particles without the emitters, from the last update the pool was simulated.
+        std::vector<math::Quad> m_particle_bounds;
 
         mono::ObjectPool<ParticleEmitterComponent> m_particle_emitters;
         std::vector<std::vector<ParticleEmitterComponent*>> m_particle_pools_emitters;
@@ -206,5 +247,10 @@ namespace mono
         };
 
         std::vector<DeferredReleasEmitter> m_deferred_release_emitter;
+
+        ParticleBudget m_budget;
+        uint32_t m_sleeping_pools;
+        uint32_t m_simulated_particles;
+        float m_simulation_time_ms;
     };
 }
@@ -7,73 +7,106 @@
 #include "TransformSystem/TransformSystem.h"
 #include "Math/Quad.h"
 
-#include <iterator>
+#include <algorithm>
 
 using namespace mono;
 
+namespace
+{
+    // The vertex buffer is sized in floats, ParticlePointVertex is three floats wide.
+    constexpr uint32_t VERTEX_COMPONENTS = sizeof(ParticlePointVertex) / sizeof(float);
+    static_assert(sizeof(ParticlePointVertex) == VERTEX_COMPONENTS * sizeof(float));
+
+    constexpr uint32_t MIN_BUFFER_CAPACITY = 4096;
+}
+
 ParticleSystemDrawer::ParticleSystemDrawer(const mono::ParticleSystem* particle_system, const mono::TransformSystem* transform_system)
     : m_particle_system(particle_system)
     , m_transform_system(transform_system)
+    , m_buffer_capacity(0)
 { }
 
 ParticleSystemDrawer::~ParticleSystemDrawer()
 { }
 
-void ParticleSystemDrawer::Draw(mono::IRenderer& renderer) const
+void ParticleSystemDrawer::Prepare(const mono::IRenderer& renderer) const
 {
-    std::vector<uint32_t> active_particles;
+    m_vertices.clear();
+    m_pools_to_draw.clear();
+
+    // Point sizes are in pixels, pad the bounds with the largest one converted to world units.
+    const math::Quad& viewport = renderer.GetViewport();
+    const math::Vector& drawable_size = renderer.GetDrawableSize();
+    const float world_per_pixel = (drawable_size.x > 0.0f) ? math::Width(viewport) / drawable_size.x : 0.0f;
 
-    const auto callback = [this, &renderer, &active_particles](uint32_t pool_index, const ParticlePoolComponent& pool, const ParticleDrawerComponent& drawer)
+    const auto callback = [&, this](uint32_t pool_index, const ParticlePoolComponent& pool, const ParticleDrawerComponent& drawer)
     {
-        active_particles.push_back(pool_index);
+        const math::Quad& bounds = pool.bounds;
+        const bool has_bounds = (bounds.mA.x <= bounds.mB.x && bounds.mA.y <= bounds.mB.y);
 
-        auto it = m_render_data.find(pool_index);
-        if(it == m_render_data.end())
-        {
-            InternalRenderData new_render_data;
-            new_render_data.position_buffer = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 2, pool.pool_size, nullptr);
-            new_render_data.rotation_buffer = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 1, pool.pool_size, nullptr);
-            new_render_data.color_buffer = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 4, pool.pool_size, nullptr);
-            new_render_data.point_size_buffer = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 1, pool.pool_size, nullptr);
+        const math::Matrix& pool_transform =
+            (drawer.transform_space == ParticleTransformSpace::LOCAL) ? m_transform_system->GetWorld(pool_index) : math::Matrix();
 
-            it = m_render_data.insert(std::make_pair(pool_index, std::move(new_render_data))).first;
+        bool visible = false;
+        if(has_bounds)
+        {
+            math::Quad world_bounds = math::Transform(pool_transform, bounds);
+            const float padding = pool.max_point_size * world_per_pixel / 2.0f;
+            world_bounds.mA -= math::Vector(padding, padding);
+            world_bounds.mB += math::Vector(padding, padding);
+            visible = renderer.Cull(world_bounds);
         }
 
-        if(pool.count_alive == 0 || drawer.texture == nullptr)
+        if(!visible || pool.count_alive == 0 || drawer.texture == nullptr)
             return;
 
-        it->second.position_buffer->UpdateData(pool.position.data(), 0, pool.count_alive);
-        it->second.rotation_buffer->UpdateData(pool.rotation.data(), 0, pool.count_alive);
-        it->second.color_buffer->UpdateData(pool.color.data(), 0, pool.count_alive);
-        it->second.point_size_buffer->UpdateData(pool.size.data(), 0, pool.count_alive);
+        // Positions are stored normalized to the bounds of the pool, the model transform scales them back.
+        const math::Vector origin = math::Center(bounds);
+        const float extent = std::max(std::max(math::Width(bounds), math::Height(bounds)) / 2.0f, 0.001f);
+        const float inverse_extent = 1.0f / extent;
 
-        const math::Matrix& transform = (drawer.transform_space == ParticleTransformSpace::LOCAL) ? m_transform_system->GetWorld(pool_index) : math::Matrix();
-        const auto transform_scope = mono::MakeTransformScope(transform, &renderer);
+        const uint32_t vertex_offset = m_vertices.size();
+        m_vertices.resize(vertex_offset + pool.count_alive);
+        ParticlePointVertex* vertices = m_vertices.data() + vertex_offset;
 
-        renderer.DrawParticlePoints(
-            it->second.position_buffer.get(),
-            it->second.rotation_buffer.get(),
-            it->second.color_buffer.get(),
-            it->second.point_size_buffer.get(),
-            drawer.texture.get(),
-            drawer.blend_mode,
-            pool.count_alive);
+        for(uint32_t index = 0; index < pool.count_alive; ++index)
+        {
+            const math::Vector normalized_position = (pool.position[index] - origin) * inverse_extent;
+            vertices[index] = mono::MakeParticlePointVertex(normalized_position, pool.color[index], pool.size[index], pool.rotation[index]);
+        }
+
+        const math::Matrix normalized_transform =
+            math::CreateMatrixWithPositionRotationScale(origin, 0.0f, math::Vector(extent, extent));
+
+        m_pools_to_draw.push_back({ vertex_offset, pool.count_alive, &drawer, pool_transform * normalized_transform });
     };
 
     m_particle_system->ForEach(callback);
+}
+
+void ParticleSystemDrawer::Draw(mono::IRenderer& renderer) const
+{
+    if(m_vertices.empty())
+        return;
 
-    std::vector<uint32_t> diff_result;
-    std::set_difference(
-        m_last_active_particles.begin(),
-        m_last_active_particles.end(),
-        active_particles.begin(),
-        active_particles.end(),
-        std::back_inserter(diff_result));
+    if(m_vertices.size() > m_buffer_capacity)
+    {
+        m_buffer_capacity = std::max<uint32_t>(m_buffer_capacity * 2, m_vertices.size());
+        m_buffer_capacity = std::max(m_buffer_capacity, MIN_BUFFER_CAPACITY);
+        m_vertex_buffer =
+            mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, VERTEX_COMPONENTS, m_buffer_capacity, nullptr);
+    }
 
-    for(uint32_t id : diff_result)
-        m_render_data.erase(id);
+    m_vertex_buffer->UpdateData(m_vertices.data(), 0, m_vertices.size());
 
-    m_last_active_particles = active_particles;
+    for(const PoolDrawData& draw_data : m_pools_to_draw)
+    {
+        const ParticleDrawerComponent& drawer = *draw_data.drawer;
+        const auto transform_scope = mono::MakeTransformScope(draw_data.transform, &renderer);
+
+        renderer.DrawParticlePoints(
+            m_vertex_buffer.get(), draw_data.vertex_offset, drawer.texture.get(), drawer.blend_mode, draw_data.count);
+    }
 }
 
 math::Quad ParticleSystemDrawer::BoundingBox() const
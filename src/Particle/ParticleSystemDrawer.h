@@ -4,8 +4,10 @@
 #include "MonoFwd.h"
 #include "Rendering/IDrawable.h"
 #include "Rendering/RenderFwd.h"
+#include "ParticleFwd.h"
+#include "Math/Matrix.h"
+#include "Rendering/Pipeline/ParticlePointPipeline.h"
 
-#include <unordered_map>
 #include <vector>
 #include <cstdint>
 #include <memory>
@@ -19,22 +21,28 @@ namespace mono
         ParticleSystemDrawer(const mono::ParticleSystem* particle_system, const mono::TransformSystem* transform_system);
         ~ParticleSystemDrawer();
 
+        void Prepare(const mono::IRenderer& renderer) const override;
         void Draw(mono::IRenderer& renderer) const override;
         math::Quad BoundingBox() const override;
 
     private:
 
-        struct InternalRenderData
+        const mono::ParticleSystem* m_particle_system;
+        const mono::TransformSystem* m_transform_system;
+
+        struct PoolDrawData
         {
-            std::unique_ptr<IRenderBuffer> position_buffer;
-            std::unique_ptr<IRenderBuffer> rotation_buffer;
-            std::unique_ptr<IRenderBuffer> color_buffer;
-            std::unique_ptr<IRenderBuffer> point_size_buffer;
+            uint32_t vertex_offset;
+            uint32_t count;
+            const ParticleDrawerComponent* drawer;
+            math::Matrix transform;
         };
 
-        const mono::ParticleSystem* m_particle_system;
-        const mono::TransformSystem* m_transform_system;
-        mutable std::unordered_map<uint32_t, InternalRenderData> m_render_data;
-        mutable std::vector<uint32_t> m_last_active_particles;
+        // Built in Prepare, all pools are packed into one vertex stream that is uploaded once per frame.
+        mutable std::vector<ParticlePointVertex> m_vertices;
+        mutable std::vector<PoolDrawData> m_pools_to_draw;
+
+        mutable uint32_t m_buffer_capacity;
+        mutable std::unique_ptr<IRenderBuffer> m_vertex_buffer;
     };
 }
@@ -6,6 +6,7 @@
 #include "System/Hash.h"
 
 using namespace mono;
+using namespace hash::literals;
 
 PathSystem::PathSystem(uint32_t n, mono::TransformSystem* transform_system)
     : m_transform_system(transform_system)
@@ -38,7 +39,8 @@ const PathComponent* PathSystem::GetPath(uint32_t entity_id) const
 
 uint32_t PathSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "pathsystem"_hash;
+    return system_id;
 }
 
 const char* PathSystem::Name() const
@@ -7,15 +7,31 @@ using namespace cm;
 
 ConstraintImpl::ConstraintImpl()
     : m_constraint(nullptr)
+    , m_pool(ConstraintPool::NONE)
+    , m_pool_index(0)
 { }
 
 ConstraintImpl::ConstraintImpl(cpConstraint* constraint)
     : m_constraint(constraint)
+    , m_pool(ConstraintPool::NONE)
+    , m_pool_index(0)
 { }
 
-void ConstraintImpl::SetHandle(cpConstraint* constraint)
+void ConstraintImpl::SetHandle(cpConstraint* constraint, ConstraintPool pool, uint32_t pool_index)
 {
     m_constraint = constraint;
+    m_pool = pool;
+    m_pool_index = pool_index;
+}
+
+ConstraintPool ConstraintImpl::Pool() const
+{
+    return m_pool;
+}
+
+uint32_t ConstraintImpl::PoolIndex() const
+{
+    return m_pool_index;
 }
 
 void ConstraintImpl::SetMaxForce(float force) 
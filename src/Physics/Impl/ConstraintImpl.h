@@ -3,8 +3,18 @@
 
 #include "Physics/IConstraint.h"
 
+#include <cstdint>
+
 namespace cm
 {
+    //! The pool the chipmunk constraint is allocated from. NONE for constraints that are not from a pool.
+    enum class ConstraintPool : uint8_t
+    {
+        NONE,
+        SLIDE_JOINT,
+        DAMPED_SPRING
+    };
+
     class ConstraintImpl : public mono::IConstraint
     {
     public:
@@ -12,7 +22,9 @@ namespace cm
         ConstraintImpl();
         ConstraintImpl(cpConstraint* constraint);
 
-        void SetHandle(cpConstraint* constraint);
+        void SetHandle(cpConstraint* constraint, ConstraintPool pool, uint32_t pool_index);
+        ConstraintPool Pool() const;
+        uint32_t PoolIndex() const;
 
         void SetMaxForce(float force) override;
         float GetMaxForce() const override;
@@ -25,5 +37,7 @@ namespace cm
     private:
 
         cpConstraint* m_constraint;
+        ConstraintPool m_pool;
+        uint32_t m_pool_index;
     };    
 }
@@ -7,16 +7,32 @@ using namespace cm;
 ShapeImpl::ShapeImpl()
     : m_shape(nullptr)
     , m_inertia_value(0.0f)
+    , m_pool(ShapePool::NONE)
+    , m_pool_index(0)
 { }
 
 ShapeImpl::ShapeImpl(cpShape* shape, float inertia_value)
     : m_shape(shape)
     , m_inertia_value(inertia_value)
+    , m_pool(ShapePool::NONE)
+    , m_pool_index(0)
 { }
 
-void ShapeImpl::SetShapeHandle(cpShape* shape)
+void ShapeImpl::SetShapeHandle(cpShape* shape, ShapePool pool, uint32_t pool_index)
 {
     m_shape = shape;
+    m_pool = pool;
+    m_pool_index = pool_index;
+}
+
+ShapePool ShapeImpl::Pool() const
+{
+    return m_pool;
+}
+
+uint32_t ShapeImpl::PoolIndex() const
+{
+    return m_pool_index;
 }
 
 void ShapeImpl::SetElasticity(float value) 
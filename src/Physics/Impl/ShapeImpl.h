@@ -5,6 +5,16 @@
 
 namespace cm
 {
+    //! The pool the chipmunk shape is allocated from, boxes are polygons. NONE for shapes that are not from a
+    //! pool.
+    enum class ShapePool : uint8_t
+    {
+        NONE,
+        CIRCLE,
+        SEGMENT,
+        POLYGON
+    };
+
     class ShapeImpl : public mono::IShape
     {
     public:
@@ -12,7 +22,9 @@ namespace cm
         ShapeImpl();
         ShapeImpl(cpShape* shape, float inertia_value);
 
-        void SetShapeHandle(cpShape* shape);
+        void SetShapeHandle(cpShape* shape, ShapePool pool, uint32_t pool_index);
+        ShapePool Pool() const;
+        uint32_t PoolIndex() const;
         
         void SetElasticity(float value) override;
         void SetFriction(float value) override;
@@ -31,5 +43,7 @@ namespace cm
         
         cpShape* m_shape;
         float m_inertia_value;
+        ShapePool m_pool;
+        uint32_t m_pool_index;
     };    
 }
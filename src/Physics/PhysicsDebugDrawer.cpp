@@ -5,6 +5,7 @@
 #include "Math/Quad.h"
 #include "Rendering/Color.h"
 #include "Rendering/IRenderer.h"
+#include "Rendering/RenderBuffer/BufferFactory.h"
 
 #include "System/System.h"
 #include "EventHandler/EventHandler.h"
@@ -14,118 +15,229 @@
 
 #include "chipmunk/chipmunk.h"
 
+extern "C"
+{
+#include "chipmunk/chipmunk_private.h"
+}
+
+#include <algorithm>
+#include <limits>
+
 using namespace mono;
 
 namespace
 {
-    struct CircleData
-    {
-        mono::Color::RGBA fill_color;
-        mono::Color::RGBA outline_color;
-        math::Vector position;
-        float radius;
-    };
-
-    struct SegmentData
-    {
-        mono::Color::RGBA fill_color;
-        mono::Color::RGBA outline_color;
-        math::Vector start;
-        math::Vector end;
-    };
-
-    struct PolygonData
-    {
-        mono::Color::RGBA fill_color;
-        mono::Color::RGBA outline_color;
-        std::vector<math::Vector> vertices;
+    constexpr int CIRCLE_SEGMENTS = 16;
+    constexpr float DOT_SIZE_PIXELS = 4.0f;
+    constexpr float SEGMENT_WIDTH_PIXELS = 4.0f;
+    constexpr float SPRING_WIDTH_PIXELS = 6.0f;
+    constexpr float COLLISION_NORMAL_PIXELS = 8.0f;
+
+    // The triangle indices are 16 bit, triangles past this are not drawn.
+    constexpr uint32_t MAX_TRIANGLE_VERTICES = 65532;
+
+    constexpr cpVect SPRING_VERTICES[] = {
+        { 0.00f,  0.0f },
+        { 0.20f,  0.0f },
+        { 0.25f,  0.5f },
+        { 0.30f, -1.0f },
+        { 0.35f,  1.0f },
+        { 0.40f, -1.0f },
+        { 0.45f,  1.0f },
+        { 0.50f, -1.0f },
+        { 0.55f,  1.0f },
+        { 0.60f, -1.0f },
+        { 0.65f,  1.0f },
+        { 0.70f, -0.5f },
+        { 0.75f,  1.0f },
+        { 0.80f,  0.0f },
+        { 1.00f,  0.0f },
     };
 
-    struct DotData
+    struct TessellateContext
     {
-        mono::Color::RGBA color;
-        math::Vector position;
+        PhysicsDebugGeometry* geometry;
+        cpBB viewport_bb;
+        float pixel_size;
     };
 
-    struct DebugDrawCollection
+    void AddLine(PhysicsDebugGeometry& geometry, const cpVect& start, const cpVect& end, const mono::Color::RGBA& color)
     {
-        std::vector<CircleData> circles;
-        std::vector<math::Vector> segments;
-        std::vector<math::Vector> fat_segments;
-        std::vector<PolygonData> polygons;
-        std::vector<math::Vector> dots;
-    };
+        geometry.line_vertices.emplace_back(start.x, start.y);
+        geometry.line_vertices.emplace_back(end.x, end.y);
+        geometry.line_colors.push_back(color);
+        geometry.line_colors.push_back(color);
+    }
 
-    cpSpaceDebugColor ConvertColor(const mono::Color::RGBA& input)
+    void AddQuad(
+        PhysicsDebugGeometry& geometry, const cpVect& a, const cpVect& b, const cpVect& c, const cpVect& d, const mono::Color::RGBA& color)
     {
-        return { input.red, input.green, input.blue, input.alpha };
+        const cpVect vertices[] = { a, b, c, a, c, d };
+        for(const cpVect& vertex : vertices)
+        {
+            geometry.triangle_vertices.emplace_back(vertex.x, vertex.y);
+            geometry.triangle_colors.push_back(color);
+        }
     }
 
-    void DebugDrawCircle(cpVect pos, cpFloat angle, cpFloat radius, cpSpaceDebugColor outlineColor, cpSpaceDebugColor fillColor, cpDataPointer data)
+    void AddDot(PhysicsDebugGeometry& geometry, const cpVect& position, float half_size, const mono::Color::RGBA& color)
     {
-        CircleData circle_data;
-        circle_data.position = math::Vector(pos.x, pos.y);
-        circle_data.radius = radius;
-        circle_data.outline_color = mono::Color::RGBA(outlineColor.r, outlineColor.g, outlineColor.b, outlineColor.a);
-        circle_data.fill_color = mono::Color::RGBA(fillColor.r, fillColor.g, fillColor.b, fillColor.a);
-
-        DebugDrawCollection* debug_collection = static_cast<DebugDrawCollection*>(data);
-        debug_collection->circles.push_back(circle_data);
+        AddQuad(
+            geometry,
+            cpvadd(position, cpv(-half_size, -half_size)),
+            cpvadd(position, cpv(half_size, -half_size)),
+            cpvadd(position, cpv(half_size, half_size)),
+            cpvadd(position, cpv(-half_size, half_size)),
+            color);
     }
 
-    void DebugDrawSegment(cpVect a, cpVect b, cpSpaceDebugColor color, cpDataPointer data)
+    void AddFatSegment(PhysicsDebugGeometry& geometry, const cpVect& start, const cpVect& end, float half_width, const mono::Color::RGBA& color)
     {
-        //SegmentData segment_data;
-        //segment_data.start = math::Vector(a.x, a.y);
-        //segment_data.end = math::Vector(b.x, b.y);
-
-        DebugDrawCollection* debug_collection = static_cast<DebugDrawCollection*>(data);
-        debug_collection->segments.push_back(math::Vector(a.x, a.y));
-        debug_collection->segments.push_back(math::Vector(b.x, b.y));
+        const cpVect offset = cpvmult(cpvnormalize(cpvperp(cpvsub(end, start))), half_width);
+        AddQuad(geometry, cpvadd(start, offset), cpvadd(end, offset), cpvsub(end, offset), cpvsub(start, offset), color);
     }
 
-    void DebugDrawFatSegment(cpVect a, cpVect b, cpFloat radius, cpSpaceDebugColor outlineColor, cpSpaceDebugColor fillColor, cpDataPointer data)
+    void TessellateShape(cpShape* shape, void* data)
     {
-        //SegmentData segment_data;
-        //segment_data.start = math::Vector(a.x, a.y);
-        //segment_data.end = math::Vector(b.x, b.y);
+        const TessellateContext* context = static_cast<const TessellateContext*>(data);
+        PhysicsDebugGeometry& geometry = *context->geometry;
 
-        DebugDrawCollection* debug_collection = static_cast<DebugDrawCollection*>(data);
-        debug_collection->fat_segments.push_back(math::Vector(a.x, a.y));
-        debug_collection->fat_segments.push_back(math::Vector(b.x, b.y));
+        const bool is_static = (cpBodyGetType(shape->body) == CP_BODY_TYPE_STATIC);
+        const mono::Color::RGBA& color = is_static ? mono::Color::BLUE : mono::Color::RED;
+
+        switch(shape->klass->type)
+        {
+        case CP_CIRCLE_SHAPE:
+        {
+            const cpCircleShape* circle = (const cpCircleShape*)shape;
+            const cpVect rotation = cpvforangle(2.0 * CP_PI / CIRCLE_SEGMENTS);
+
+            cpVect offset = cpv(circle->r, 0.0);
+            for(int index = 0; index < CIRCLE_SEGMENTS; ++index)
+            {
+                const cpVect next_offset = cpvrotate(offset, rotation);
+                AddLine(geometry, cpvadd(circle->tc, offset), cpvadd(circle->tc, next_offset), color);
+                offset = next_offset;
+            }
+            break;
+        }
+        case CP_SEGMENT_SHAPE:
+        {
+            const cpSegmentShape* segment = (const cpSegmentShape*)shape;
+            const float half_width = std::max(float(segment->r), SEGMENT_WIDTH_PIXELS * context->pixel_size * 0.5f);
+            AddFatSegment(geometry, segment->ta, segment->tb, half_width, mono::Color::MAGENTA);
+            break;
+        }
+        case CP_POLY_SHAPE:
+        {
+            const cpPolyShape* polygon = (const cpPolyShape*)shape;
+            for(int index = 0; index < polygon->count; ++index)
+            {
+                const int next_index = (index + 1) % polygon->count;
+                AddLine(geometry, polygon->planes[index].v0, polygon->planes[next_index].v0, color);
+            }
+            break;
+        }
+        default:
+            break;
+        }
     }
 
-    void DebugDrawPolygon(int count, const cpVect *verts, cpFloat radius, cpSpaceDebugColor outlineColor, cpSpaceDebugColor fillColor, cpDataPointer data)
+    void TessellateConstraint(cpConstraint* constraint, void* data)
     {
-        PolygonData polygon_data;
+        const TessellateContext* context = static_cast<const TessellateContext*>(data);
+        PhysicsDebugGeometry& geometry = *context->geometry;
 
-        for(int index = 0; index < count; ++index)
+        cpVect anchor_a;
+        cpVect anchor_b;
+        bool draw_segment = false;
+        bool draw_spring = false;
+
+        if(cpConstraintIsPinJoint(constraint))
+        {
+            const cpPinJoint* joint = (const cpPinJoint*)constraint;
+            anchor_a = joint->anchorA;
+            anchor_b = joint->anchorB;
+            draw_segment = true;
+        }
+        else if(cpConstraintIsSlideJoint(constraint))
+        {
+            const cpSlideJoint* joint = (const cpSlideJoint*)constraint;
+            anchor_a = joint->anchorA;
+            anchor_b = joint->anchorB;
+            draw_segment = true;
+        }
+        else if(cpConstraintIsPivotJoint(constraint))
+        {
+            const cpPivotJoint* joint = (const cpPivotJoint*)constraint;
+            anchor_a = joint->anchorA;
+            anchor_b = joint->anchorB;
+        }
+        else if(cpConstraintIsDampedSpring(constraint))
         {
-            const cpVect& vertex = verts[index];
-            polygon_data.vertices.emplace_back(vertex.x, vertex.y);
+            const cpDampedSpring* spring = (const cpDampedSpring*)constraint;
+            anchor_a = spring->anchorA;
+            anchor_b = spring->anchorB;
+            draw_spring = true;
+        }
+        else
+        {
+            return;
         }
 
-        polygon_data.outline_color = mono::Color::RGBA(outlineColor.r, outlineColor.g, outlineColor.b, outlineColor.a);
-        polygon_data.fill_color = mono::Color::RGBA(fillColor.r, fillColor.g, fillColor.b, fillColor.a);
+        const cpVect a = cpTransformPoint(constraint->a->transform, anchor_a);
+        const cpVect b = cpTransformPoint(constraint->b->transform, anchor_b);
 
-        DebugDrawCollection* debug_collection = static_cast<DebugDrawCollection*>(data);
-        debug_collection->polygons.push_back(polygon_data);
-    }
+        const cpBB constraint_bb = cpBBNew(cpfmin(a.x, b.x), cpfmin(a.y, b.y), cpfmax(a.x, b.x), cpfmax(a.y, b.y));
+        if(!cpBBIntersects(context->viewport_bb, constraint_bb))
+            return;
 
-    void DebugDrawDot(cpFloat size, cpVect pos, cpSpaceDebugColor color, cpDataPointer data)
-    {
-        //DotData dot_data;
-        //dot_data.position = math::Vector(pos.x, pos.y);
-        //dot_data.color = mono::Color::RGBA(color.r, color.g, color.b, color.a)
+        const float dot_half_size = DOT_SIZE_PIXELS * context->pixel_size * 0.5f;
+        AddDot(geometry, a, dot_half_size, mono::Color::GREEN);
+        AddDot(geometry, b, dot_half_size, mono::Color::GREEN);
 
-        DebugDrawCollection* debug_collection = static_cast<DebugDrawCollection*>(data);
-        debug_collection->dots.push_back(math::Vector(pos.x, pos.y));
+        if(draw_segment)
+        {
+            AddLine(geometry, a, b, mono::Color::GREEN);
+        }
+        else if(draw_spring)
+        {
+            // The zig zag is stretched along the spring and is a fixed number of pixels wide.
+            const cpVect delta = cpvsub(b, a);
+            const cpVect side = cpvmult(cpvnormalize(cpvperp(delta)), SPRING_WIDTH_PIXELS * context->pixel_size);
+
+            cpVect previous = a;
+            for(const cpVect& vertex : SPRING_VERTICES)
+            {
+                const cpVect point = cpvadd(cpvadd(a, cpvmult(delta, vertex.x)), cpvmult(side, vertex.y));
+                AddLine(geometry, previous, point, mono::Color::GREEN);
+                previous = point;
+            }
+        }
     }
-    
-    cpSpaceDebugColor DebugDrawColorForShape(cpShape *shape, cpDataPointer data)
+
+    void TessellateCollisionPoints(const cpSpace* space, const TessellateContext& context)
     {
-        const cpBodyType body_type = cpBodyGetType(cpShapeGetBody(shape));
-        return (body_type == CP_BODY_TYPE_STATIC) ? ConvertColor(mono::Color::BLUE) : ConvertColor(mono::Color::RED);
+        PhysicsDebugGeometry& geometry = *context.geometry;
+        const float normal_length = COLLISION_NORMAL_PIXELS * context.pixel_size;
+
+        const cpArray* arbiters = space->arbiters;
+        for(int index = 0; index < arbiters->num; ++index)
+        {
+            const cpArbiter* arbiter = (const cpArbiter*)arbiters->arr[index];
+            const cpVect normal = cpvmult(arbiter->n, normal_length);
+
+            for(int contact_index = 0; contact_index < arbiter->count; ++contact_index)
+            {
+                const cpContact& contact = arbiter->contacts[contact_index];
+                const cpVect point_a = cpvadd(arbiter->body_a->p, contact.r1);
+                if(!cpBBContainsVect(context.viewport_bb, point_a))
+                    continue;
+
+                const cpVect point_b = cpvadd(arbiter->body_b->p, contact.r2);
+                AddLine(geometry, cpvsub(point_a, normal), cpvadd(point_b, normal), mono::Color::BLUE);
+            }
+        }
     }
 }
 
@@ -145,22 +257,15 @@ PhysicsDebugDrawer::PhysicsDebugDrawer(
     , m_event_handler(event_handler)
     , m_mouse_down(false)
     , m_shift_down(false)
+    , m_line_capacity(0)
+    , m_triangle_capacity(0)
 {
-    using namespace std::placeholders;
+    m_mouse_down_token = m_event_handler->AddListener(this, &PhysicsDebugDrawer::OnMouseDown);
+    m_mouse_up_token = m_event_handler->AddListener(this, &PhysicsDebugDrawer::OnMouseUp);
+    m_mouse_move_token = m_event_handler->AddListener(this, &PhysicsDebugDrawer::OnMouseMove);
 
-    event::MouseDownEventFunc mouse_down = std::bind(&PhysicsDebugDrawer::OnMouseDown, this, _1);
-    event::MouseUpEventFunc mouse_up = std::bind(&PhysicsDebugDrawer::OnMouseUp, this, _1);
-    event::MouseMotionEventFunc mouse_move = std::bind(&PhysicsDebugDrawer::OnMouseMove, this, _1);
-
-    event::KeyDownEventFunc key_down = std::bind(&PhysicsDebugDrawer::OnKeyDown, this, _1);
-    event::KeyUpEventFunc key_up = std::bind(&PhysicsDebugDrawer::OnKeyUp, this, _1);
-
-    m_mouse_down_token = m_event_handler->AddListener(mouse_down);
-    m_mouse_up_token = m_event_handler->AddListener(mouse_up);
-    m_mouse_move_token = m_event_handler->AddListener(mouse_move);
-
-    m_key_down_token = m_event_handler->AddListener(key_down);
-    m_key_up_token = m_event_handler->AddListener(key_up);
+    m_key_down_token = m_event_handler->AddListener(this, &PhysicsDebugDrawer::OnKeyDown);
+    m_key_up_token = m_event_handler->AddListener(this, &PhysicsDebugDrawer::OnKeyUp);
 
     m_click_timestamp = std::numeric_limits<uint32_t>::max();
 }
@@ -175,45 +280,85 @@ PhysicsDebugDrawer::~PhysicsDebugDrawer()
     m_event_handler->RemoveListener(m_key_up_token);
 }
 
-void PhysicsDebugDrawer::Draw(mono::IRenderer& renderer) const
+void mono::TessellatePhysicsDebugGeometry(
+    mono::PhysicsSpace* physics_space,
+    uint32_t debug_components,
+    const math::Quad& viewport,
+    float pixel_size,
+    PhysicsDebugGeometry& out_geometry)
 {
-    if(!m_enabled_drawing)
-        return;
+    out_geometry.line_vertices.clear();
+    out_geometry.line_colors.clear();
+    out_geometry.triangle_vertices.clear();
+    out_geometry.triangle_colors.clear();
 
-    DebugDrawCollection debug_collection;
+    const float left = std::min(viewport.mA.x, viewport.mB.x);
+    const float bottom = std::min(viewport.mA.y, viewport.mB.y);
+    const float right = std::max(viewport.mA.x, viewport.mB.x);
+    const float top = std::max(viewport.mA.y, viewport.mB.y);
 
-    mono::PhysicsSpace* physics_space = m_physics_system->GetSpace();
-    cpSpace* cm_space = physics_space->Handle();
+    cpSpace* space = physics_space->Handle();
+    const TessellateContext context = { &out_geometry, cpBBNew(left, bottom, right, top), pixel_size };
+
+    if(debug_components & PhysicsDebugComponents::DRAW_SHAPES)
+        cpSpaceBBQuery(space, context.viewport_bb, CP_SHAPE_FILTER_ALL, TessellateShape, (void*)&context);
+
+    if(debug_components & PhysicsDebugComponents::DRAW_CONSTRAINTS)
+        cpSpaceEachConstraint(space, TessellateConstraint, (void*)&context);
 
-    cpSpaceDebugDrawOptions options;
-    options.flags = cpSpaceDebugDrawFlags(m_debug_components);
-    options.shapeOutlineColor = ConvertColor(mono::Color::RED);
-    options.constraintColor = ConvertColor(mono::Color::GREEN);
-    options.collisionPointColor = ConvertColor(mono::Color::BLUE);
-    options.drawCircle = DebugDrawCircle;
-    options.drawSegment = DebugDrawSegment;
-    options.drawFatSegment = DebugDrawFatSegment;
-    options.drawPolygon = DebugDrawPolygon;
-    options.drawDot = DebugDrawDot;
-    options.colorForShape = DebugDrawColorForShape;
-    options.data = &debug_collection;
+    if(debug_components & PhysicsDebugComponents::DRAW_COLLISION_POINTS)
+        TessellateCollisionPoints(space, context);
+}
 
-    cpSpaceDebugDraw(cm_space, &options);
+void PhysicsDebugDrawer::Prepare(const mono::IRenderer& renderer) const
+{
+    if(!m_enabled_drawing)
+        return;
 
-    if(!debug_collection.dots.empty())
-        renderer.DrawPoints(debug_collection.dots, mono::Color::GREEN, 2.0f);
+    const math::Quad& viewport = renderer.GetViewport();
+    const float pixel_size = math::Width(viewport) / std::max(renderer.GetDrawableSize().x, 1.0f);
+    TessellatePhysicsDebugGeometry(m_physics_system->GetSpace(), m_debug_components, viewport, pixel_size, m_geometry);
+}
+
+void PhysicsDebugDrawer::Draw(mono::IRenderer& renderer) const
+{
+    if(!m_enabled_drawing)
+        return;
 
-    for(const CircleData& circle_data : debug_collection.circles)
-        renderer.DrawCircle(circle_data.position, circle_data.radius, 16, 1.0f, circle_data.fill_color);
+    const uint32_t n_line_vertices = m_geometry.line_vertices.size();
+    if(n_line_vertices > 0)
+    {
+        if(m_line_capacity < n_line_vertices)
+        {
+            m_line_capacity = std::max(n_line_vertices, m_line_capacity * 2);
+            m_line_vertices = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 2, m_line_capacity, nullptr);
+            m_line_colors = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 4, m_line_capacity, nullptr);
+        }
 
-    if(!debug_collection.segments.empty())
-        renderer.DrawLines(debug_collection.segments, mono::Color::MAGENTA, 1.0f);
+        m_line_vertices->UpdateData(m_geometry.line_vertices.data(), 0, n_line_vertices);
+        m_line_colors->UpdateData(m_geometry.line_colors.data(), 0, n_line_vertices);
+        renderer.DrawLines(m_line_vertices.get(), m_line_colors.get(), 0, n_line_vertices);
+    }
 
-    if(!debug_collection.fat_segments.empty())
-        renderer.DrawLines(debug_collection.fat_segments, mono::Color::MAGENTA, 4.0f);
+    const uint32_t n_triangle_vertices = std::min(uint32_t(m_geometry.triangle_vertices.size()), MAX_TRIANGLE_VERTICES);
+    if(n_triangle_vertices > 0)
+    {
+        if(m_triangle_capacity < n_triangle_vertices)
+        {
+            m_triangle_capacity = std::min(std::max(n_triangle_vertices, m_triangle_capacity * 2), MAX_TRIANGLE_VERTICES);
+            m_triangle_vertices = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 2, m_triangle_capacity, nullptr);
+            m_triangle_colors = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 4, m_triangle_capacity, nullptr);
+
+            std::vector<uint16_t> indices(m_triangle_capacity);
+            for(uint32_t index = 0; index < m_triangle_capacity; ++index)
+                indices[index] = index;
+            m_triangle_indices = mono::CreateElementBuffer(BufferType::STATIC, m_triangle_capacity, indices.data());
+        }
 
-    for(const PolygonData& polygon_data : debug_collection.polygons)
-        renderer.DrawClosedPolyline(polygon_data.vertices, polygon_data.fill_color, 2.0f);
+        m_triangle_vertices->UpdateData(m_geometry.triangle_vertices.data(), 0, n_triangle_vertices);
+        m_triangle_colors->UpdateData(m_geometry.triangle_colors.data(), 0, n_triangle_vertices);
+        renderer.DrawTrianges(m_triangle_vertices.get(), m_triangle_colors.get(), m_triangle_indices.get(), 0, n_triangle_vertices);
+    }
 
     if(m_click_timestamp != std::numeric_limits<uint32_t>::max())
     {
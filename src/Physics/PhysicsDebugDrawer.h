@@ -5,14 +5,18 @@
 #include "EventHandler/EventToken.h"
 
 #include "Rendering/IDrawable.h"
+#include "Rendering/RenderFwd.h"
+#include "Rendering/Color.h"
 #include "Math/Vector.h"
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace mono
 {
     class PhysicsSystem;
+    class PhysicsSpace;
     class EventHandler;
 
     enum PhysicsDebugComponents
@@ -52,6 +56,28 @@ namespace mono
         return "Unknown";
     }
 
+    //! Debug geometry in world coordinates, line_vertices are pairs of points and triangle_vertices are
+    //! triangles, with one color per vertex.
+    struct PhysicsDebugGeometry
+    {
+        std::vector<math::Vector> line_vertices;
+        std::vector<mono::Color::RGBA> line_colors;
+        std::vector<math::Vector> triangle_vertices;
+        std::vector<mono::Color::RGBA> triangle_colors;
+    };
+
+    //! Tessellates the debug components of the shapes, constraints and contacts that overlap the viewport into
+    //! out_geometry. The geometry is cleared first but keeps its memory. pixel_size is the size of a pixel in
+    //! world units, dots and thin segments are sized in pixels.
+    void TessellatePhysicsDebugGeometry(
+        mono::PhysicsSpace* physics_space,
+        uint32_t debug_components,
+        const math::Quad& viewport,
+        float pixel_size,
+        PhysicsDebugGeometry& out_geometry);
+
+    //! Draws the physics debug components in two draw calls, one for all lines and one for all triangles. The
+    //! geometry is built in Prepare and only for what is inside the viewport.
     class PhysicsDebugDrawer : public mono::IDrawable
     {
     public:
@@ -64,6 +90,7 @@ namespace mono
             mono::EventHandler* event_handler);
         ~PhysicsDebugDrawer();
 
+        void Prepare(const mono::IRenderer& renderer) const override;
         void Draw(mono::IRenderer& renderer) const override;
         math::Quad BoundingBox() const override;
 
@@ -97,5 +124,16 @@ namespace mono
 
         bool m_mouse_down;
         bool m_shift_down;
+
+        mutable PhysicsDebugGeometry m_geometry;
+
+        mutable uint32_t m_line_capacity;
+        mutable std::unique_ptr<IRenderBuffer> m_line_vertices;
+        mutable std::unique_ptr<IRenderBuffer> m_line_colors;
+
+        mutable uint32_t m_triangle_capacity;
+        mutable std::unique_ptr<IRenderBuffer> m_triangle_vertices;
+        mutable std::unique_ptr<IRenderBuffer> m_triangle_colors;
+        mutable std::unique_ptr<IElementBuffer> m_triangle_indices;
     };
 }
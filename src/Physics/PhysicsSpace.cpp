@@ -3,29 +3,199 @@
 #include "IBody.h"
 #include "IShape.h"
 #include "IConstraint.h"
+#include "RaycastBatch.h"
 #include "Impl/BodyImpl.h"
 #include "Physics/PhysicsSystem.h"
 #include "Math/Vector.h"
 #include "Math/Quad.h"
 #include "System/System.h"
+#include "Util/JobPool.h"
 
 #include "chipmunk/chipmunk.h"
+
+// chipmunk_private.h and cpHastySpace.h are not included by chipmunk.h and have no C linkage of their own.
+extern "C"
+{
 #include "chipmunk/chipmunk_private.h"
+#include "chipmunk/cpHastySpace.h"
+}
 
 #include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <vector>
 
 using namespace mono;
 
+namespace
+{
+    // Fewer dynamic shapes than this and the tree is fast enough.
+    constexpr uint32_t MIN_SHAPES_FOR_SPATIAL_HASH = 100;
+
+    // Standard deviation of the shape sizes over the mean size, above this too many shapes span several cells.
+    constexpr float MAX_SIZE_VARIATION = 0.5f;
+
+    // Static shapes are in a spatial hash too, long level segments cover a lot of cells.
+    constexpr uint32_t MAX_STATIC_CELLS_PER_SHAPE = 4;
+
+    // Chipmunk recommends about ten times as many cells as shapes.
+    constexpr uint32_t HASH_CELLS_PER_SHAPE = 10;
+    constexpr uint32_t MIN_HASH_CELLS = 1000;
+
+    cpVect ShapeVelocityFunc(cpShape* shape)
+    {
+        return shape->body->v;
+    }
+
+    void CollectShape(cpShape* shape, std::vector<cpShape*>* shapes)
+    {
+        shapes->push_back(shape);
+    }
+
+    // The shapes are inserted in the order they were added to the space, so the new indices only depend on the
+    // shapes and not on what the old indices have been through.
+    void CopySortedShapes(cpSpatialIndex* source, cpSpatialIndex* destination, std::vector<cpShape*>& shapes)
+    {
+        shapes.clear();
+        cpSpatialIndexEach(source, (cpSpatialIndexIteratorFunc)CollectShape, &shapes);
+
+        const auto hashid_less = [](const cpShape* first, const cpShape* second) {
+            return first->hashid < second->hashid;
+        };
+        std::sort(shapes.begin(), shapes.end(), hashid_less);
+
+        for(cpShape* shape : shapes)
+            cpSpatialIndexInsert(destination, shape, shape->hashid);
+    }
+
+    void ReplaceSpatialIndices(
+        cpSpace* space, cpSpatialIndex* static_shapes, cpSpatialIndex* dynamic_shapes, std::vector<cpShape*>& shapes)
+    {
+        CopySortedShapes(space->staticShapes, static_shapes, shapes);
+        CopySortedShapes(space->dynamicShapes, dynamic_shapes, shapes);
+
+        cpSpatialIndexFree(space->staticShapes);
+        cpSpatialIndexFree(space->dynamicShapes);
+
+        space->staticShapes = static_shapes;
+        space->dynamicShapes = dynamic_shapes;
+    }
+
+    struct ShapeSizes
+    {
+        uint32_t n_dynamic = 0;
+        double size_sum = 0.0;
+        double size_square_sum = 0.0;
+        std::vector<cpBB> static_bbs;
+    };
+
+    void SampleShapeSize(cpShape* shape, ShapeSizes* sizes)
+    {
+        const cpBB& bb = shape->bb;
+        if(cpBodyGetType(shape->body) == CP_BODY_TYPE_STATIC)
+        {
+            sizes->static_bbs.push_back(bb);
+            return;
+        }
+
+        const double size = std::max(bb.r - bb.l, bb.t - bb.b);
+        sizes->n_dynamic++;
+        sizes->size_sum += size;
+        sizes->size_square_sum += size * size;
+    }
+
+    // Batched queries are handed to the job pool in chunks, one query is too little work for a job.
+    constexpr uint32_t QUERIES_PER_JOB = 16;
+    constexpr uint32_t RAYS_PER_JOB = 32;
+
+    QueryResult MakeQueryResult(PhysicsSystem* physics_system, const cpShape* shape)
+    {
+        const cpBody* body = cpShapeGetBody(shape);
+        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
+        const cpShapeFilter filter = cpShapeGetFilter(shape);
+        return { physics_system->GetBody(body_id), filter.categories };
+    }
+
+    struct VisitorContext
+    {
+        PhysicsSystem* physics_system;
+        void (*visitor_func)(const QueryResult& result, void* context);
+        void* context;
+    };
+
+    struct ResultWriter
+    {
+        QueryResult* out_results;
+        uint32_t max_results;
+        uint32_t n_written;
+
+        inline void operator () (const QueryResult& result)
+        {
+            if(n_written < max_results)
+                out_results[n_written++] = result;
+        }
+    };
+
+    struct ShapeQueryContext
+    {
+        PhysicsSystem* physics_system;
+        ResultWriter writer;
+    };
+
+    cpCollisionID ShapeQuery(cpShape* query_shape, cpShape* shape, cpCollisionID id, ShapeQueryContext* context)
+    {
+        if(cpShapeFilterReject(query_shape->filter, shape->filter) || query_shape == shape)
+            return id;
+
+        const cpContactPointSet contact_set = cpShapesCollide(query_shape, shape);
+        if(contact_set.count > 0)
+            context->writer(MakeQueryResult(context->physics_system, shape));
+
+        return id;
+    }
+
+    // Same as cpSpaceShapeQuery but without locking the space, so queries can run on several threads as long as
+    // the indices are only read. The caller locks the space.
+    void QueryShapeIndices(cpSpace* space, cpShape* shape, ShapeQueryContext* context)
+    {
+        const cpBB bb = cpShapeUpdate(shape, shape->body->transform);
+        cpSpatialIndexQuery(space->dynamicShapes, shape, bb, (cpSpatialIndexQueryFunc)ShapeQuery, context);
+        cpSpatialIndexQuery(space->staticShapes, shape, bb, (cpSpatialIndexQueryFunc)ShapeQuery, context);
+    }
+}
+
 PhysicsSpace::PhysicsSpace(PhysicsSystem* physics_system)
-    : PhysicsSpace(physics_system, math::Vector(0.0f, 0.0f), 1.0f)
+    : PhysicsSpace(physics_system, PhysicsSystemInitParams())
 { }
 
 PhysicsSpace::PhysicsSpace(PhysicsSystem* physics_system, const math::Vector& gravity, float damping)
-    : m_physics_system(physics_system)
-    , m_space(cpSpaceNew())
+    : PhysicsSpace(physics_system, PhysicsSystemInitParams())
 {
     cpSpaceSetGravity(m_space, cpv(gravity.x, gravity.y));
     cpSpaceSetDamping(m_space, damping);
+}
+
+PhysicsSpace::PhysicsSpace(PhysicsSystem* physics_system, const PhysicsSystemInitParams& init_params)
+    : m_physics_system(physics_system)
+    , m_space(init_params.hasty_space ? cpHastySpaceNew() : cpSpaceNew())
+    , m_hasty_space(init_params.hasty_space)
+    , m_broadphase(PhysicsBroadphase::BB_TREE)
+    , m_spatial_hash_cell_size(init_params.spatial_hash_cell_size)
+    , m_spatial_hash_cells(init_params.spatial_hash_cells)
+    , m_buffer_collision_events(init_params.buffer_collision_events)
+    , m_stepping(false)
+{
+    cpSpaceSetIterations(m_space, init_params.n_solver_iterations);
+    cpSpaceSetSleepTimeThreshold(m_space, init_params.sleep_time_threshold);
+    cpSpaceSetIdleSpeedThreshold(m_space, init_params.idle_speed_threshold);
+
+    if(init_params.broadphase == PhysicsBroadphase::SPATIAL_HASH)
+        UseSpatialHash(init_params.spatial_hash_cell_size, init_params.spatial_hash_cells);
+
+    // The worker threads only run the impulse solver, the collision callbacks below are called from the
+    // thread that steps the space.
+    if(m_hasty_space)
+        cpHastySpaceSetThreads(m_space, init_params.n_solver_threads);
 
     const auto begin_func = [](cpArbiter* arb, cpSpace* space, cpDataPointer user_data) -> cpBool {
         PhysicsSpace* physics_space = static_cast<PhysicsSpace*>(user_data);
@@ -47,12 +217,27 @@ PhysicsSpace::PhysicsSpace(PhysicsSystem* physics_system, const math::Vector& gr
 
 PhysicsSpace::~PhysicsSpace()
 {
-    cpSpaceDestroy(m_space);
+    if(m_hasty_space)
+        cpHastySpaceFree(m_space);
+    else
+        cpSpaceFree(m_space);
 }
 
 void PhysicsSpace::Tick(uint32_t delta_ms)
 {
-    cpSpaceStep(m_space, float(delta_ms) / 1000.0f);
+    Step(float(delta_ms) / 1000.0f);
+}
+
+void PhysicsSpace::Step(float delta_s)
+{
+    m_stepping = true;
+
+    if(m_hasty_space)
+        cpHastySpaceStep(m_space, delta_s);
+    else
+        cpSpaceStep(m_space, delta_s);
+
+    m_stepping = false;
 }
 
 void PhysicsSpace::SetGravity(const math::Vector& gravity)
@@ -65,6 +250,93 @@ void PhysicsSpace::SetDamping(float damping)
     cpSpaceSetDamping(m_space, damping);
 }
 
+uint32_t PhysicsSpace::GetSolverThreads() const
+{
+    if(m_hasty_space)
+        return cpHastySpaceGetThreads(m_space);
+
+    return 1;
+}
+
+void PhysicsSpace::UseBBTree()
+{
+    cpSpatialIndex* static_shapes = cpBBTreeNew((cpSpatialIndexBBFunc)cpShapeGetBB, nullptr);
+    cpSpatialIndex* dynamic_shapes = cpBBTreeNew((cpSpatialIndexBBFunc)cpShapeGetBB, static_shapes);
+    cpBBTreeSetVelocityFunc(dynamic_shapes, (cpBBTreeVelocityFunc)ShapeVelocityFunc);
+
+    ReplaceSpatialIndices(m_space, static_shapes, dynamic_shapes, m_shapes_scratch);
+    m_broadphase = PhysicsBroadphase::BB_TREE;
+}
+
+void PhysicsSpace::UseSpatialHash(float cell_size, uint32_t n_cells)
+{
+    // Same as cpSpaceUseSpatialHash.
+    cpSpatialIndex* static_shapes = cpSpaceHashNew(cell_size, n_cells, (cpSpatialIndexBBFunc)cpShapeGetBB, nullptr);
+    cpSpatialIndex* dynamic_shapes = cpSpaceHashNew(cell_size, n_cells, (cpSpatialIndexBBFunc)cpShapeGetBB, static_shapes);
+
+    ReplaceSpatialIndices(m_space, static_shapes, dynamic_shapes, m_shapes_scratch);
+    m_broadphase = PhysicsBroadphase::SPATIAL_HASH;
+    m_spatial_hash_cell_size = cell_size;
+    m_spatial_hash_cells = n_cells;
+}
+
+void PhysicsSpace::RebuildSpatialIndices()
+{
+    if(m_broadphase == PhysicsBroadphase::SPATIAL_HASH)
+        UseSpatialHash(m_spatial_hash_cell_size, m_spatial_hash_cells);
+    else
+        UseBBTree();
+}
+
+PhysicsBroadphase PhysicsSpace::GetBroadphase() const
+{
+    return m_broadphase;
+}
+
+PhysicsBroadphase PhysicsSpace::TuneBroadphase()
+{
+    ShapeSizes sizes;
+    cpSpatialIndexEach(m_space->dynamicShapes, (cpSpatialIndexIteratorFunc)SampleShapeSize, &sizes);
+    cpSpatialIndexEach(m_space->staticShapes, (cpSpatialIndexIteratorFunc)SampleShapeSize, &sizes);
+
+    bool use_spatial_hash = false;
+    float cell_size = 0.0f;
+
+    if(sizes.n_dynamic >= MIN_SHAPES_FOR_SPATIAL_HASH)
+    {
+        const double mean_size = sizes.size_sum / sizes.n_dynamic;
+        const double variance = std::max(sizes.size_square_sum / sizes.n_dynamic - mean_size * mean_size, 0.0);
+        const double size_variation = std::sqrt(variance) / mean_size;
+
+        cell_size = mean_size;
+
+        uint64_t static_cells = 0;
+        for(const cpBB& bb : sizes.static_bbs)
+        {
+            const uint64_t cells_x = std::ceil((bb.r - bb.l) / cell_size);
+            const uint64_t cells_y = std::ceil((bb.t - bb.b) / cell_size);
+            static_cells += std::max(cells_x, uint64_t(1)) * std::max(cells_y, uint64_t(1));
+        }
+
+        const uint64_t max_static_cells = uint64_t(std::max(sizes.static_bbs.size(), size_t(1))) * MAX_STATIC_CELLS_PER_SHAPE;
+        use_spatial_hash = (mean_size > 0.0 && size_variation <= MAX_SIZE_VARIATION && static_cells <= max_static_cells);
+    }
+
+    if(use_spatial_hash)
+    {
+        const uint32_t n_cells = std::max(sizes.n_dynamic * HASH_CELLS_PER_SHAPE, MIN_HASH_CELLS);
+        UseSpatialHash(cell_size, n_cells);
+        System::Log("physics|Using spatial hash, %u shapes, cell size %.2f.", sizes.n_dynamic, cell_size);
+    }
+    else if(m_broadphase != PhysicsBroadphase::BB_TREE)
+    {
+        UseBBTree();
+        System::Log("physics|Using bounding box tree, %u shapes.", sizes.n_dynamic);
+    }
+
+    return m_broadphase;
+}
+
 void PhysicsSpace::Add(IBody* body)
 {
     if(body->GetType() != mono::BodyType::STATIC)
@@ -86,6 +358,54 @@ void PhysicsSpace::Remove(IBody* body)
     }
 }
 
+void PhysicsSpace::RemoveBodies(IBody* const* bodies, uint32_t count)
+{
+    cpAssertSpaceUnlocked(m_space);
+
+    // Sleeping bodies are not in the body arrays, they are woken up before any of them is marked so that the
+    // whole sleeping component is moved back.
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        cpBody* body = bodies[index]->Handle();
+        if(cpSpaceContainsBody(m_space, body))
+            cpBodyActivate(body);
+    }
+
+    uint32_t n_removed = 0;
+
+    for(uint32_t index = 0; index < count; ++index)
+    {
+        IBody* body = bodies[index];
+        if(cpSpaceContainsBody(m_space, body->Handle()))
+        {
+            body->Handle()->space = nullptr;
+            n_removed++;
+        }
+        else
+        {
+            const uint32_t body_id = PhysicsSystem::GetIdFromBody(body);
+            System::Log("physics|Trying to remove body that's not added to the space. [%u]", body_id);
+        }
+    }
+
+    if(n_removed == 0)
+        return;
+
+    const auto remove_marked_bodies = [this](cpArray* body_array) {
+        int n_kept = 0;
+        for(int index = 0; index < body_array->num; ++index)
+        {
+            cpBody* body = (cpBody*)body_array->arr[index];
+            if(body->space == m_space)
+                body_array->arr[n_kept++] = body;
+        }
+        body_array->num = n_kept;
+    };
+
+    remove_marked_bodies(m_space->dynamicBodies);
+    remove_marked_bodies(m_space->staticBodies);
+}
+
 void PhysicsSpace::Add(IShape* shape)
 {
     cpSpaceAddShape(m_space, shape->Handle());
@@ -108,72 +428,189 @@ void PhysicsSpace::Remove(IConstraint* constraint)
 
 QueryResult PhysicsSpace::QueryFirst(const math::Vector& start, const math::Vector& end, uint32_t category)
 {
-    QueryResult result = {};
-
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
     const cpShape* shape = cpSpaceSegmentQueryFirst(m_space, cpv(start.x, start.y), cpv(end.x, end.y), 1, shape_filter, nullptr);
     if(!shape)
-        return result;
+        return QueryResult();
+
+    return MakeQueryResult(m_physics_system, shape);
+}
 
-    const cpBody* body = cpShapeGetBody(shape);
-    const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
-    result.body = m_physics_system->GetBody(body_id);
+std::vector<QueryResult> PhysicsSpace::QueryAllInLIne(const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category)
+{
+    std::vector<QueryResult> found_bodies;
+    QueryAllInLIne(start, end, max_distance, category, [&found_bodies](const QueryResult& result) {
+        found_bodies.push_back(result);
+    });
+
+    return found_bodies;
+}
 
-    const cpShapeFilter filter = cpShapeGetFilter(shape);
-    result.collision_category = filter.categories;
+std::vector<QueryResult> PhysicsSpace::QueryBox(const math::Quad& world_bb, uint32_t category)
+{
+    std::vector<QueryResult> found_bodies;
+    QueryBox(world_bb, category, [&found_bodies](const QueryResult& result) {
+        found_bodies.push_back(result);
+    });
 
-    return result;
+    return found_bodies;
 }
 
-std::vector<QueryResult> PhysicsSpace::QueryAllInLIne(const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category)
+std::vector<QueryResult> PhysicsSpace::QueryRadius(const math::Vector& position, float radius, uint32_t category)
 {
-    struct QueryData
-    {
-        PhysicsSystem* physics_system;
-        std::vector<QueryResult> found_bodies;
-    };
+    std::vector<QueryResult> found_bodies;
+    QueryRadius(position, radius, category, [&found_bodies](const QueryResult& result) {
+        found_bodies.push_back(result);
+    });
 
-    QueryData query_data;
-    query_data.physics_system = m_physics_system;
+    return found_bodies;
+}
 
-    const cpSpaceSegmentQueryFunc query_func = [](cpShape* shape, cpVect point, cpVect normal, cpFloat alpha, void* data) {
+uint32_t PhysicsSpace::QueryAllInLIne(
+    const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category, QueryResult* out_results, uint32_t max_results)
+{
+    ResultWriter writer = { out_results, max_results, 0 };
+    QueryAllInLIne(start, end, max_distance, category, writer);
+    return writer.n_written;
+}
 
-        const cpBody* body = cpShapeGetBody(shape);
-        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
-        const cpShapeFilter filter = cpShapeGetFilter(shape);
+uint32_t PhysicsSpace::QueryBox(const math::Quad& world_bb, uint32_t category, QueryResult* out_results, uint32_t max_results)
+{
+    ResultWriter writer = { out_results, max_results, 0 };
+    QueryBox(world_bb, category, writer);
+    return writer.n_written;
+}
 
-        QueryData* query_data = (QueryData*)data;
- 
-        const QueryResult query_result = { query_data->physics_system->GetBody(body_id), filter.categories };
-        query_data->found_bodies.push_back(query_result);
-    };
+uint32_t PhysicsSpace::QueryRadius(const math::Vector& position, float radius, uint32_t category, QueryResult* out_results, uint32_t max_results)
+{
+    ResultWriter writer = { out_results, max_results, 0 };
+    QueryRadius(position, radius, category, writer);
+    return writer.n_written;
+}
 
+void PhysicsSpace::QueryRadiusBatch(
+    const math::Vector* positions,
+    const float* radii,
+    uint32_t count,
+    uint32_t category,
+    QueryResult* out_results,
+    uint32_t max_results_per_query,
+    uint32_t* out_counts,
+    JobPool* job_pool)
+{
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
-    cpSpaceSegmentQuery(m_space, cpv(start.x, start.y), cpv(end.x, end.y), 0.1f, shape_filter, query_func, &query_data);
 
-    return query_data.found_bodies;
+    const auto run_queries = [&](uint32_t first_query, uint32_t end_query) {
+        cpCircleShape circle_shape;
+
+        for(uint32_t index = first_query; index < end_query; ++index)
+        {
+            const math::Vector& position = positions[index];
+            cpCircleShapeInit(&circle_shape, m_space->staticBody, radii[index], cpv(position.x, position.y));
+            cpShapeSetFilter((cpShape*)&circle_shape, shape_filter);
+
+            ShapeQueryContext context = { m_physics_system, { out_results + index * max_results_per_query, max_results_per_query, 0 } };
+            QueryShapeIndices(m_space, (cpShape*)&circle_shape, &context);
+            out_counts[index] = context.writer.n_written;
+        }
+    };
+
+    // The indices are queried directly, the space is locked once for the whole batch.
+    cpSpaceLock(m_space);
+
+    const bool run_on_threads = (job_pool && job_pool->Threads() > 1 && m_broadphase == PhysicsBroadphase::BB_TREE);
+    if(run_on_threads)
+    {
+        const uint32_t n_jobs = (count + QUERIES_PER_JOB - 1) / QUERIES_PER_JOB;
+        const auto run_job = [&](uint32_t job_index, uint32_t thread_index) {
+            const uint32_t first_query = job_index * QUERIES_PER_JOB;
+            run_queries(first_query, std::min(first_query + QUERIES_PER_JOB, count));
+        };
+        job_pool->ParallelFor(n_jobs, run_job);
+    }
+    else
+    {
+        run_queries(0, count);
+    }
+
+    cpSpaceUnlock(m_space, cpTrue);
 }
 
-std::vector<QueryResult> PhysicsSpace::QueryBox(const math::Quad& world_bb, uint32_t category)
+void PhysicsSpace::Raycast(RaycastBatch& batch, JobPool* job_pool)
 {
-    struct QueryData
-    {
-        PhysicsSystem* physics_system;
-        std::vector<QueryResult> found_bodies;
+    const uint32_t n_rays = batch.Size();
+    batch.hit_bodies.resize(n_rays);
+    batch.hit_categories.resize(n_rays);
+    batch.hit_points.resize(n_rays);
+    batch.hit_normals.resize(n_rays);
+    batch.hit_fractions.resize(n_rays);
+
+    const auto cast_rays = [&](uint32_t first_ray, uint32_t end_ray) {
+        for(uint32_t order_index = first_ray; order_index < end_ray; ++order_index)
+        {
+            const uint32_t index = batch.cast_order[order_index];
+            const math::Vector& start = batch.starts[index];
+            const math::Vector& end = batch.ends[index];
+            const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, batch.categories[index]);
+
+            cpSegmentQueryInfo info;
+            const cpShape* shape = cpSpaceSegmentQueryFirst(m_space, cpv(start.x, start.y), cpv(end.x, end.y), batch.radius, shape_filter, &info);
+            if(shape)
+            {
+                const QueryResult result = MakeQueryResult(m_physics_system, shape);
+                batch.hit_bodies[index] = result.body;
+                batch.hit_categories[index] = result.collision_category;
+            }
+            else
+            {
+                batch.hit_bodies[index] = nullptr;
+                batch.hit_categories[index] = 0;
+            }
+
+            batch.hit_points[index] = math::Vector(info.point.x, info.point.y);
+            batch.hit_normals[index] = math::Vector(info.normal.x, info.normal.y);
+            batch.hit_fractions[index] = info.alpha;
+        }
     };
 
-    QueryData query_data;
-    query_data.physics_system = m_physics_system;
+    // cpSpaceSegmentQueryFirst only reads the tree, the spatial hash keeps query stamps in its cells.
+    const bool run_on_threads = (job_pool && job_pool->Threads() > 1 && m_broadphase == PhysicsBroadphase::BB_TREE);
+    if(run_on_threads)
+    {
+        const uint32_t n_jobs = (n_rays + RAYS_PER_JOB - 1) / RAYS_PER_JOB;
+        const auto run_job = [&](uint32_t job_index, uint32_t thread_index) {
+            const uint32_t first_ray = job_index * RAYS_PER_JOB;
+            cast_rays(first_ray, std::min(first_ray + RAYS_PER_JOB, n_rays));
+        };
+        job_pool->ParallelFor(n_jobs, run_job);
+    }
+    else
+    {
+        cast_rays(0, n_rays);
+    }
+}
 
-    const cpSpaceBBQueryFunc query_func = [](cpShape* shape, void* data) {
-        const cpBody* body = cpShapeGetBody(shape);
-        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
-        const cpShapeFilter filter = cpShapeGetFilter(shape);
+void PhysicsSpace::VisitAllInLine(
+    const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category, QueryVisitorFunc visitor_func, void* context)
+{
+    VisitorContext visitor_context = { m_physics_system, visitor_func, context };
 
-        QueryData* query_data = (QueryData*)data;
+    const cpSpaceSegmentQueryFunc query_func = [](cpShape* shape, cpVect point, cpVect normal, cpFloat alpha, void* data) {
+        const VisitorContext* visitor_context = (const VisitorContext*)data;
+        visitor_context->visitor_func(MakeQueryResult(visitor_context->physics_system, shape), visitor_context->context);
+    };
 
-        const QueryResult query_result = { query_data->physics_system->GetBody(body_id), filter.categories };
-        query_data->found_bodies.push_back(query_result);
+    const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
+    cpSpaceSegmentQuery(m_space, cpv(start.x, start.y), cpv(end.x, end.y), 0.1f, shape_filter, query_func, &visitor_context);
+}
+
+void PhysicsSpace::VisitBox(const math::Quad& world_bb, uint32_t category, QueryVisitorFunc visitor_func, void* context)
+{
+    VisitorContext visitor_context = { m_physics_system, visitor_func, context };
+
+    const cpSpaceBBQueryFunc query_func = [](cpShape* shape, void* data) {
+        const VisitorContext* visitor_context = (const VisitorContext*)data;
+        visitor_context->visitor_func(MakeQueryResult(visitor_context->physics_system, shape), visitor_context->context);
     };
 
     const float left = std::min(world_bb.mA.x, world_bb.mB.x);
@@ -183,20 +620,10 @@ std::vector<QueryResult> PhysicsSpace::QueryBox(const math::Quad& world_bb, uint
 
     const cpBB bounding_box = cpBBNew(left, bottom, right, top);
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
-    cpSpaceBBQuery(m_space, bounding_box, shape_filter, query_func, &query_data);
-
-    return query_data.found_bodies;
-
-/*
-/// Rectangle Query callback function type.
-typedef void (*cpSpaceBBQueryFunc)(cpShape *shape, void *data);
-/// Perform a fast rectangle query on the space calling @c func for each shape found.
-/// Only the shape's bounding boxes are checked for overlap, not their full shape.
-CP_EXPORT void cpSpaceBBQuery(cpSpace *space, cpBB bb, cpShapeFilter filter, cpSpaceBBQueryFunc func, void *data);
-*/
+    cpSpaceBBQuery(m_space, bounding_box, shape_filter, query_func, &visitor_context);
 }
 
-std::vector<QueryResult> PhysicsSpace::QueryRadius(const math::Vector& position, float radius, uint32_t category)
+void PhysicsSpace::VisitRadius(const math::Vector& position, float radius, uint32_t category, QueryVisitorFunc visitor_func, void* context)
 {
     cpCircleShape circle_shape;
     cpCircleShapeInit(&circle_shape, cpSpaceGetStaticBody(m_space), radius, cpv(position.x, position.y));
@@ -204,63 +631,48 @@ std::vector<QueryResult> PhysicsSpace::QueryRadius(const math::Vector& position,
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
     cpShapeSetFilter((cpShape*)&circle_shape, shape_filter);
 
-
-    struct QueryData
-    {
-        PhysicsSystem* physics_system;
-        std::vector<QueryResult> found_bodies;
-    };
-
-    QueryData query_data;
-    query_data.physics_system = m_physics_system;
+    VisitorContext visitor_context = { m_physics_system, visitor_func, context };
 
     const cpSpaceShapeQueryFunc query_func = [](cpShape* shape, cpContactPointSet* points, void* data) {
-        const cpBody* body = cpShapeGetBody(shape);
-        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
-        const cpShapeFilter filter = cpShapeGetFilter(shape);
-
-        QueryData* query_data = (QueryData*)data;
-        const QueryResult query_result = { query_data->physics_system->GetBody(body_id), filter.categories };
-        query_data->found_bodies.push_back(query_result);
+        const VisitorContext* visitor_context = (const VisitorContext*)data;
+        visitor_context->visitor_func(MakeQueryResult(visitor_context->physics_system, shape), visitor_context->context);
     };
 
-    cpSpaceShapeQuery(m_space, (cpShape*)&circle_shape, query_func, &query_data);
-
-    return query_data.found_bodies;
+    cpSpaceShapeQuery(m_space, (cpShape*)&circle_shape, query_func, &visitor_context);
 }
 
 QueryResult PhysicsSpace::QueryNearest(const math::Vector& point, float max_distance, uint32_t category)
 {
-    QueryResult result = {};
-
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
 
     cpPointQueryInfo info;
     const cpShape* shape = cpSpacePointQueryNearest(m_space, cpv(point.x, point.y), max_distance, shape_filter, &info);
     if(!shape)
-        return result;
+        return QueryResult();
 
-    const cpBody* cpbody = cpShapeGetBody(shape);
-    const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(cpbody));
-    result.body = m_physics_system->GetBody(body_id);
-    
-    const cpShapeFilter filter = cpShapeGetFilter(shape);
-    result.collision_category = filter.categories;
-
-    return result;
+    return MakeQueryResult(m_physics_system, shape);
 }
 
 QueryResult PhysicsSpace::QueryNearest(const math::Vector& point, float max_distance, uint32_t category, const QueryFilter& filter_func)
+{
+    const QueryFilterFunc std_function_filter = [](uint32_t entity_id, const math::Vector& point, void* context) -> bool {
+        return (*static_cast<QueryFilter*>(context))(entity_id, point);
+    };
+    return QueryNearestFiltered(point, max_distance, category, std_function_filter, (void*)&filter_func);
+}
+
+QueryResult PhysicsSpace::QueryNearestFiltered(
+    const math::Vector& point, float max_distance, uint32_t category, QueryFilterFunc filter_func, void* context)
 {
     struct UserData
     {
-        QueryFilter filter_func;
+        QueryFilterFunc filter_func;
+        void* context;
         float distance;
-        const cpBody* cp_body;
         const cpShape* cp_shape;
     };
 
-    UserData user_data = { filter_func, math::INF, nullptr, nullptr };
+    UserData user_data = { filter_func, context, math::INF, nullptr };
 
     const auto callback = [](cpShape* shape, cpVect point, cpFloat distance, cpVect gradient, void* data) {
         UserData* user_data = (UserData*)data;
@@ -271,29 +683,21 @@ QueryResult PhysicsSpace::QueryNearest(const math::Vector& point, float max_dist
         const cpBody* body = cpShapeGetBody(shape);
         const uint32_t entity_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(body));
 
-        const bool passed_user_filter = user_data->filter_func(entity_id, math::Vector(point.x, point.y));
+        const bool passed_user_filter = user_data->filter_func(entity_id, math::Vector(point.x, point.y), user_data->context);
         if(!passed_user_filter)
             return;
 
         user_data->distance = distance;
-        user_data->cp_body = body;
         user_data->cp_shape = shape;
     };
 
     const cpShapeFilter shape_filter = cpShapeFilterNew(CP_NO_GROUP, CP_ALL_CATEGORIES, category);
     cpSpacePointQuery(m_space, cpv(point.x, point.y), max_distance, shape_filter, callback, &user_data);
 
-    QueryResult result = {};
-    if(user_data.cp_body)
-    {
-        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(user_data.cp_body));
-        result.body = m_physics_system->GetBody(body_id);
-
-        const cpShapeFilter filter = cpShapeGetFilter(user_data.cp_shape);
-        result.collision_category = filter.categories;
-    }
+    if(!user_data.cp_shape)
+        return QueryResult();
 
-    return result;
+    return MakeQueryResult(m_physics_system, user_data.cp_shape);
 }
 
 bool PhysicsSpace::OnCollision(cpArbiter* arb)
@@ -326,6 +730,22 @@ bool PhysicsSpace::OnCollision(cpArbiter* arb)
         const cpVect normal_arb = cpArbiterGetNormal(arb);
         const math::Vector collision_normal(normal_arb.x, normal_arb.y);
 
+        if(m_buffer_collision_events)
+        {
+            const CollisionEvent first_event = {
+                CollisionEventType::BEGIN, filter1.categories, body_id_1, body_id_2, filter2.categories, collision_point, collision_normal };
+            const CollisionEvent second_event = {
+                CollisionEventType::BEGIN, filter2.categories, body_id_2, body_id_1, filter1.categories, collision_point, collision_normal };
+
+            // Only the sensor sees a contact with a sensor.
+            if(is_shape_1_sensor || !is_shape_2_sensor)
+                m_collision_events.push_back(first_event);
+            if(!is_shape_1_sensor)
+                m_collision_events.push_back(second_event);
+
+            return true;
+        }
+
         if(is_shape_1_sensor)
             return (first->OnCollideWith(second, collision_point, collision_normal, filter2.categories) != mono::CollisionResolve::IGNORE);
         else if(is_shape_2_sensor)
@@ -352,13 +772,94 @@ void PhysicsSpace::OnSeparation(cpArbiter* arb)
     IBody* first = m_physics_system->GetBody(body_id_1);
     IBody* second = m_physics_system->GetBody(body_id_2);
 
-    if(first && second)
+    if(!first || !second)
+        return;
+
+    // Shapes that are removed outside of a step separate right away, the bodies might be released before the
+    // next dispatch.
+    if(m_buffer_collision_events && m_stepping)
+    {
+        cpShape* shape1 = nullptr;
+        cpShape* shape2 = nullptr;
+        cpArbiterGetShapes(arb, &shape1, &shape2);
+
+        const uint32_t category_1 = cpShapeGetFilter(shape1).categories;
+        const uint32_t category_2 = cpShapeGetFilter(shape2).categories;
+
+        m_collision_events.push_back({ CollisionEventType::SEPARATE, category_1, body_id_1, body_id_2, category_2, math::ZeroVec, math::ZeroVec });
+        m_collision_events.push_back({ CollisionEventType::SEPARATE, category_2, body_id_2, body_id_1, category_1, math::ZeroVec, math::ZeroVec });
+        return;
+    }
+
+    first->OnSeparateFrom(second);
+    second->OnSeparateFrom(first);
+}
+
+void PhysicsSpace::SetBufferCollisionEvents(bool buffer_events)
+{
+    m_buffer_collision_events = buffer_events;
+}
+
+bool PhysicsSpace::IsBufferingCollisionEvents() const
+{
+    return m_buffer_collision_events;
+}
+
+void PhysicsSpace::ClearCollisionEvents()
+{
+    m_collision_events.clear();
+    m_sorted_collision_events.clear();
+}
+
+void PhysicsSpace::DispatchCollisionEvents()
+{
+    // The category in the upper half and the index in the lower, the events keep their order within a category.
+    const uint32_t n_events = m_collision_events.size();
+    m_collision_event_keys.resize(n_events);
+    for(uint32_t index = 0; index < n_events; ++index)
+        m_collision_event_keys[index] = (uint64_t(m_collision_events[index].category) << 32) | index;
+
+    std::sort(m_collision_event_keys.begin(), m_collision_event_keys.end());
+
+    m_sorted_collision_events.resize(n_events);
+    for(uint32_t index = 0; index < n_events; ++index)
+        m_sorted_collision_events[index] = m_collision_events[uint32_t(m_collision_event_keys[index])];
+
+    m_collision_events.clear();
+
+    for(const CollisionEvent& event : m_sorted_collision_events)
     {
-        first->OnSeparateFrom(second);
-        second->OnSeparateFrom(first);
+        IBody* body = m_physics_system->GetBody(event.body_id);
+        IBody* other = m_physics_system->GetBody(event.other_body_id);
+
+        if(event.type == CollisionEventType::BEGIN)
+            body->OnCollideWith(other, event.point, event.normal, event.other_category);
+        else
+            body->OnSeparateFrom(other);
     }
 }
 
+const std::vector<CollisionEvent>& PhysicsSpace::GetCollisionEvents() const
+{
+    return m_sorted_collision_events;
+}
+
+const CollisionEvent* PhysicsSpace::GetCollisionEvents(uint32_t category, uint32_t& out_count) const
+{
+    const auto category_less = [](const CollisionEvent& event, uint32_t category) {
+        return event.category < category;
+    };
+    const auto less_category = [](uint32_t category, const CollisionEvent& event) {
+        return category < event.category;
+    };
+
+    const auto begin = std::lower_bound(m_sorted_collision_events.begin(), m_sorted_collision_events.end(), category, category_less);
+    const auto end = std::upper_bound(begin, m_sorted_collision_events.end(), category, less_category);
+
+    out_count = std::distance(begin, end);
+    return m_sorted_collision_events.data() + std::distance(m_sorted_collision_events.begin(), begin);
+}
+
 IBody* PhysicsSpace::GetStaticBody()
 {
     return m_static_body.get();
@@ -3,9 +3,12 @@
 
 #include "PhysicsFwd.h"
 #include "Math/MathFwd.h"
+#include "Math/Vector.h"
 
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 struct cpSpace;
 struct cpArbiter;
@@ -19,25 +22,86 @@ namespace mono
 {
     using QueryFilter = const std::function<bool (uint32_t entity_id, const math::Vector& point)>;
 
+    class JobPool;
+    struct PhysicsSystemInitParams;
+    struct RaycastBatch;
+    enum class PhysicsBroadphase : int;
+
     struct QueryResult
     {
         mono::IBody* body;
         uint32_t collision_category;
     };
 
+    enum class CollisionEventType : int
+    {
+        BEGIN,
+        SEPARATE
+    };
+
+    //! A contact that began or ended during a step, seen from one of the two bodies. Point and normal are only
+    //! set for BEGIN.
+    struct CollisionEvent
+    {
+        CollisionEventType type;
+        uint32_t category;
+        uint32_t body_id;
+        uint32_t other_body_id;
+        uint32_t other_category;
+        math::Vector point;
+        math::Vector normal;
+    };
+
     class PhysicsSpace
     {
     public:
         
         PhysicsSpace(PhysicsSystem* physics_system);
         PhysicsSpace(PhysicsSystem* physics_system, const math::Vector& gravity, float damping);
+        PhysicsSpace(PhysicsSystem* physics_system, const PhysicsSystemInitParams& init_params);
         ~PhysicsSpace();
 
         void Tick(uint32_t delta);
+        void Step(float delta_s);
 
         void SetGravity(const math::Vector& gravity);
         void SetDamping(float damping);
+
+        //! The number of threads running the impulse solver, Chipmunk clamps the requested count.
+        uint32_t GetSolverThreads() const;
+
+        void UseBBTree();
+        void UseSpatialHash(float cell_size, uint32_t n_cells);
+        PhysicsBroadphase GetBroadphase() const;
+
+        //! Builds new spatial indices of the same kind, with the shapes inserted in the order they were added. The
+        //! order of the pairs found by the next step then only depends on where the shapes are.
+        void RebuildSpatialIndices();
+
+        //! Looks at the number and sizes of the shapes in the space and switches to the broadphase that suits
+        //! them, call it when a level has been loaded.
+        PhysicsBroadphase TuneBroadphase();
         
+        //! Buffered collision events are written to a buffer during the step, instead of calling the collision
+        //! handlers of the bodies in the middle of the step. The handlers are called by DispatchCollisionEvents.
+        //! A handler can not ignore a buffered contact, the solver has already used it.
+        void SetBufferCollisionEvents(bool buffer_events);
+        bool IsBufferingCollisionEvents() const;
+
+        void ClearCollisionEvents();
+
+        //! Groups the buffered events by category and calls the collision handlers of the bodies, the events
+        //! are kept until they are cleared.
+        void DispatchCollisionEvents();
+
+        //! The dispatched events, grouped by category.
+        const std::vector<CollisionEvent>& GetCollisionEvents() const;
+
+        //! The dispatched events seen from shapes with exactly this category. Categories are bit masks and the
+        //! events are grouped by the whole mask, so a shape with more than one category bit is only found with
+        //! all of its bits, not with one of them.
+        const CollisionEvent* GetCollisionEvents(uint32_t category, uint32_t& out_count) const;
+
         void Add(IBody* body);
         void Add(IShape* shape);
         void Add(IConstraint* constraint);
@@ -45,26 +109,115 @@ namespace mono
         void Remove(IBody* body);
         void Remove(IShape* shape);
         void Remove(IConstraint* constraint);
+
+        //! Removes count bodies, their shapes have to be removed already. The body arrays are compacted once
+        //! instead of searched once per body.
+        void RemoveBodies(IBody* const* bodies, uint32_t count);
         
         QueryResult QueryFirst(const math::Vector& start, const math::Vector& end, uint32_t category);
         QueryResult QueryNearest(const math::Vector& point, float max_distance, uint32_t category);
         QueryResult QueryNearest(const math::Vector& point, float max_distance, uint32_t category, const QueryFilter& filter_func);
 
+        //! Calls filter(entity_id, point) instead of going through a std::function, works with any callable.
+        template <typename Filter>
+        inline QueryResult QueryNearest(const math::Vector& point, float max_distance, uint32_t category, Filter&& filter)
+        {
+            using FilterType = std::remove_reference_t<Filter>;
+            const QueryFilterFunc filter_func = [](uint32_t entity_id, const math::Vector& point, void* context) -> bool {
+                return (*static_cast<FilterType*>(context))(entity_id, point);
+            };
+            return QueryNearestFiltered(point, max_distance, category, filter_func, (void*)&filter);
+        }
+
         std::vector<QueryResult> QueryAllInLIne(const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category);
         std::vector<QueryResult> QueryBox(const math::Quad& world_bb, uint32_t category);
         std::vector<QueryResult> QueryRadius(const math::Vector& position, float radius, uint32_t category);
 
+        //! Writes at most max_results into out_results and returns the number written, nothing is allocated.
+        uint32_t QueryAllInLIne(
+            const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category, QueryResult* out_results, uint32_t max_results);
+        uint32_t QueryBox(const math::Quad& world_bb, uint32_t category, QueryResult* out_results, uint32_t max_results);
+        uint32_t QueryRadius(const math::Vector& position, float radius, uint32_t category, QueryResult* out_results, uint32_t max_results);
+
+        //! Calls visitor(const QueryResult& result) for each shape found, the visitor is only used during the call.
+        template <typename Visitor>
+        inline void QueryAllInLIne(const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category, Visitor&& visitor)
+        {
+            VisitAllInLine(start, end, max_distance, category, MakeVisitorFunc<Visitor>(), (void*)&visitor);
+        }
+
+        template <typename Visitor>
+        inline void QueryBox(const math::Quad& world_bb, uint32_t category, Visitor&& visitor)
+        {
+            VisitBox(world_bb, category, MakeVisitorFunc<Visitor>(), (void*)&visitor);
+        }
+
+        template <typename Visitor>
+        inline void QueryRadius(const math::Vector& position, float radius, uint32_t category, Visitor&& visitor)
+        {
+            VisitRadius(position, radius, category, MakeVisitorFunc<Visitor>(), (void*)&visitor);
+        }
+
+        //! Runs count radius queries in one go. Query i writes at most max_results_per_query into
+        //! out_results + i * max_results_per_query and the number written into out_counts[i]. With a job pool the
+        //! queries are split over its threads, as long as the broadphase is the tree, the spatial hash can only
+        //! be queried from one thread at a time.
+        void QueryRadiusBatch(
+            const math::Vector* positions,
+            const float* radii,
+            uint32_t count,
+            uint32_t category,
+            QueryResult* out_results,
+            uint32_t max_results_per_query,
+            uint32_t* out_counts,
+            JobPool* job_pool = nullptr);
+
+        //! Casts the rays in the batch, in its cast order, and writes the first hit of each ray to the results of
+        //! the batch. Sensors are not hit. With a job pool the rays are split over its threads, as long as the
+        //! broadphase is the tree.
+        void Raycast(RaycastBatch& batch, JobPool* job_pool = nullptr);
+
         IBody* GetStaticBody();
 
         cpSpace* Handle();
         
     private:
 
+        using QueryVisitorFunc = void (*)(const QueryResult& result, void* context);
+        using QueryFilterFunc = bool (*)(uint32_t entity_id, const math::Vector& point, void* context);
+
+        template <typename Visitor>
+        static inline QueryVisitorFunc MakeVisitorFunc()
+        {
+            using VisitorType = std::remove_reference_t<Visitor>;
+            return [](const QueryResult& result, void* context) {
+                (*static_cast<VisitorType*>(context))(result);
+            };
+        }
+
+        void VisitAllInLine(
+            const math::Vector& start, const math::Vector& end, float max_distance, uint32_t category, QueryVisitorFunc visitor_func, void* context);
+        void VisitBox(const math::Quad& world_bb, uint32_t category, QueryVisitorFunc visitor_func, void* context);
+        void VisitRadius(const math::Vector& position, float radius, uint32_t category, QueryVisitorFunc visitor_func, void* context);
+        QueryResult QueryNearestFiltered(
+            const math::Vector& point, float max_distance, uint32_t category, QueryFilterFunc filter_func, void* context);
+
         bool OnCollision(cpArbiter* arb);
         void OnSeparation(cpArbiter* arb);
 
         PhysicsSystem* m_physics_system;
         cpSpace* m_space;
+        bool m_hasty_space;
+        PhysicsBroadphase m_broadphase;
+        float m_spatial_hash_cell_size;
+        uint32_t m_spatial_hash_cells;
+        std::vector<cpShape*> m_shapes_scratch;
+
+        bool m_buffer_collision_events;
+        bool m_stepping;
+        std::vector<CollisionEvent> m_collision_events;
+        std::vector<CollisionEvent> m_sorted_collision_events;
+        std::vector<uint64_t> m_collision_event_keys;
         std::unique_ptr<cm::BodyImpl> m_static_body;
     };
 }
@@ -13,21 +13,200 @@
 #include "System/System.h"
 
 #include "chipmunk/chipmunk.h"
+
+// chipmunk_private.h has no C linkage of its own.
+extern "C"
+{
 #include "chipmunk/chipmunk_private.h"
+}
 
 #include <vector>
 #include <algorithm>
 #include <numeric>
 #include <cstdio>
-#include <unordered_map>
+#include <cstring>
 #include <cassert>
 
 using namespace mono;
+using namespace hash::literals;
 
 static_assert(static_cast<int>(BodyType::DYNAMIC) == cpBodyType::CP_BODY_TYPE_DYNAMIC);
 static_assert(static_cast<int>(BodyType::KINEMATIC) == cpBodyType::CP_BODY_TYPE_KINEMATIC);
 static_assert(static_cast<int>(BodyType::STATIC) == cpBodyType::CP_BODY_TYPE_STATIC);
 
+// Snapshots store arbiters and contacts as they are and Restore writes their fields, both are pinned to the
+// layout in Chipmunk 7.0.3 with doubles on 64 bit. Go through ArbiterState and Restore when these fail.
+static_assert(CP_VERSION_MAJOR == 7 && CP_VERSION_MINOR == 0 && CP_VERSION_RELEASE == 3);
+static_assert(sizeof(void*) != 8 || !CP_USE_DOUBLES || sizeof(cpArbiter) == 176);
+static_assert(sizeof(void*) != 8 || !CP_USE_DOUBLES || sizeof(cpContact) == 96);
+
+namespace
+{
+    constexpr uint32_t SNAPSHOT_VERSION = 2;
+    constexpr uint32_t AWAKE = ~0u;
+
+    struct SnapshotHeader
+    {
+        uint32_t version;
+        uint32_t n_bodies;
+        uint32_t n_constraints;
+        uint32_t n_arbiters;
+        uint32_t accumulator_us;
+        cpFloat curr_dt;
+    };
+
+    // Everything the next step reads from a body, the rest is set up when the body is allocated.
+    struct BodyState
+    {
+        uint32_t body_id;
+        uint32_t n_shapes;
+        cpFloat m;
+        cpFloat m_inv;
+        cpFloat i;
+        cpFloat i_inv;
+        cpVect cog;
+        cpVect p;
+        cpVect v;
+        cpVect f;
+        cpFloat a;
+        cpFloat w;
+        cpFloat t;
+        cpTransform transform;
+        cpVect v_bias;
+        cpFloat w_bias;
+        cpFloat idle_time;
+
+        // The body id of the root of the sleeping component the body is in, AWAKE if the body is awake.
+        uint32_t sleeping_root;
+    };
+
+    // The shapes are stored as a body and the index of the shape on the body, the arbiter is stored as is and
+    // its pointers are fixed up on restore. Sleeping arbiters are the contacts of sleeping bodies, Chipmunk keeps
+    // them on the bodies instead of in the arbiter cache.
+    struct ArbiterState
+    {
+        uint32_t body_a;
+        uint32_t shape_a;
+        uint32_t body_b;
+        uint32_t shape_b;
+        uint32_t age;
+        uint32_t is_active;
+        uint32_t is_sleeping;
+        cpArbiter arbiter;
+        cpContact contacts[CP_MAX_CONTACTS_PER_ARBITER];
+    };
+
+    template <typename T>
+    void WriteValue(std::vector<uint8_t>& buffer, const T& value)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    void WriteBytes(std::vector<uint8_t>& buffer, const void* data, size_t size)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        std::memcpy(buffer.data() + offset, data, size);
+    }
+
+    struct SnapshotReader
+    {
+        const std::vector<uint8_t>& buffer;
+        size_t offset;
+
+        bool ReadBytes(void* out_data, size_t size)
+        {
+            if(offset + size > buffer.size())
+                return false;
+
+            std::memcpy(out_data, buffer.data() + offset, size);
+            offset += size;
+            return true;
+        }
+
+        template <typename T>
+        bool ReadValue(T& out_value)
+        {
+            return ReadBytes(&out_value, sizeof(T));
+        }
+    };
+
+    // The part of the constraint after cpConstraint holds the joint parameters and the accumulated impulses,
+    // only the constraint types the system creates are stored.
+    size_t ConstraintStateSize(const cpConstraint* constraint)
+    {
+        if(cpConstraintIsPivotJoint(constraint))
+            return sizeof(cpPivotJoint) - sizeof(cpConstraint);
+        else if(cpConstraintIsSlideJoint(constraint))
+            return sizeof(cpSlideJoint) - sizeof(cpConstraint);
+        else if(cpConstraintIsGearJoint(constraint))
+            return sizeof(cpGearJoint) - sizeof(cpConstraint);
+        else if(cpConstraintIsDampedSpring(constraint))
+            return sizeof(cpDampedSpring) - sizeof(cpConstraint);
+
+        return 0;
+    }
+
+    uint8_t* ConstraintState(cpConstraint* constraint)
+    {
+        return reinterpret_cast<uint8_t*>(constraint) + sizeof(cpConstraint);
+    }
+
+    bool PointerLess(const void* first, const void* second)
+    {
+        return std::less<const void*>()(first, second);
+    }
+
+    // Bodies and constraints are stepped in array order, which depends on when they were added and woken up.
+    void SortByAddress(cpArray* array)
+    {
+        std::sort(array->arr, array->arr + array->num, PointerLess);
+    }
+
+    cpBool ReleaseArbiter(cpArbiter* arbiter, cpSpace* space)
+    {
+        cpArbiterUnthread(arbiter);
+        arbiter->contacts = nullptr;
+        arbiter->count = 0;
+        cpArrayPush(space->pooledArbiters, arbiter);
+        return cpFalse;
+    }
+
+    // Same as cpSpaceArbiterSetTrans, without initializing the arbiter.
+    cpArbiter* PopPooledArbiter(cpSpace* space)
+    {
+        if(space->pooledArbiters->num == 0)
+        {
+            const int count = CP_BUFFER_BYTES / sizeof(cpArbiter);
+            cpArbiter* buffer = (cpArbiter*)cpcalloc(1, CP_BUFFER_BYTES);
+            cpArrayPush(space->allocatedBuffers, buffer);
+
+            for(int index = 0; index < count; ++index)
+                cpArrayPush(space->pooledArbiters, buffer + index);
+        }
+
+        return (cpArbiter*)cpArrayPop(space->pooledArbiters);
+    }
+
+    void* ExistingArbiter(const void* shape_pair, void* arbiter)
+    {
+        return arbiter;
+    }
+
+    // Same as cpBodyPushArbiter, which is not exported.
+    void PushArbiter(cpBody* body, cpArbiter* arbiter)
+    {
+        cpArbiter* next = body->arbiterList;
+        cpArbiterThreadForBody(arbiter, body)->next = next;
+        if(next)
+            cpArbiterThreadForBody(next, body)->prev = arbiter;
+
+        body->arbiterList = arbiter;
+    }
+}
+
 struct PhysicsSystem::Impl
 {
     Impl(const PhysicsSystemInitParams& init_params, PhysicsSystem* physics_system)
@@ -41,37 +220,284 @@ struct PhysicsSystem::Impl
         , damped_spring_pool(init_params.n_damped_springs)
         , shapes(init_params.n_circle_shapes + init_params.n_segment_shapes + init_params.n_polygon_shapes)
         , constraints(init_params.n_pivot_joints + init_params.n_gear_joints + init_params.n_damped_springs)
-        , space(physics_system)
+        , space(physics_system, init_params)
+        , fixed_step_us(init_params.fixed_time_step * 1000000.0f)
+        , max_substeps(std::max(init_params.max_substeps, 1u))
+        , accumulator_us(0)
+        , last_substeps(0)
+        , last_synced_transforms(0)
+        , sync_stamp(0)
+        , tune_broadphase(init_params.broadphase == PhysicsBroadphase::AUTO)
     { }
 
-    void ReleaseCircleShape(cpShape* shape)
+    struct BodyPose
+    {
+        math::Vector position;
+        float angle = 0.0f;
+    };
+
+    // Chipmunk keeps the awake bodies in the dynamic bodies array, sleeping and static bodies are not in it.
+    // Kinematic bodies that are not allocated by the system are skipped.
+    void CollectAwakeBodies(std::vector<uint32_t>& out_body_ids)
+    {
+        out_body_ids.clear();
+
+        const cpArray* dynamic_bodies = space.Handle()->dynamicBodies;
+        for(int index = 0; index < dynamic_bodies->num; ++index)
+        {
+            const cpBody* cp_body = static_cast<const cpBody*>(dynamic_bodies->arr[index]);
+            const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(cp_body));
+            if(body_id < bodies.size() && active_bodies[body_id] && bodies[body_id].Handle() == cp_body)
+                out_body_ids.push_back(body_id);
+        }
+    }
+
+    void StorePoses(const std::vector<uint32_t>& body_ids, std::vector<BodyPose>& out_poses) const
     {
-        circle_shape_pool.ReleasePoolData((cpCircleShape*)shape);
+        for(uint32_t body_id : body_ids)
+        {
+            const cm::BodyImpl& body = bodies[body_id];
+            out_poses[body_id] = { body.GetPosition(), body.GetAngle() };
+        }
     }
 
-    void ReleaseSegmentShape(cpShape* shape)
+    void SetPose(uint32_t body_id, const math::Vector& position, float angle)
     {
-        segment_shape_pool.ReleasePoolData((cpSegmentShape*)shape);
+        const BodyPose pose = { position, angle };
+        previous_poses[body_id] = pose;
+        current_poses[body_id] = pose;
+
+        // Not the same as any pose, the next sync writes the transform.
+        written_poses[body_id].angle = math::INF;
     }
 
-    void ReleasePolyShape(cpShape* shape)
+    // Called after stepping, updates the awake bodies and their poses. Bodies that went to sleep since the last
+    // sync are snapped to their final pose, after that they are skipped until they wake up.
+    void SyncAwakeBodies()
     {
-        poly_shape_pool.ReleasePoolData((cpPolyShape*)shape);
+        std::swap(awake_bodies, sleeping_candidates);
+        CollectAwakeBodies(awake_bodies);
+        StorePoses(awake_bodies, current_poses);
+
+        sync_stamp++;
+        for(uint32_t body_id : awake_bodies)
+            awake_stamps[body_id] = sync_stamp;
+
+        uint32_t n_fell_asleep = 0;
+        for(uint32_t body_id : sleeping_candidates)
+        {
+            if(awake_stamps[body_id] == sync_stamp || !active_bodies[body_id])
+                continue;
+
+            const cm::BodyImpl& body = bodies[body_id];
+            SetPose(body_id, body.GetPosition(), body.GetAngle());
+            sleeping_candidates[n_fell_asleep++] = body_id;
+        }
+
+        sleeping_candidates.resize(n_fell_asleep);
     }
 
-    void ReleasePivotJoint(cpConstraint* constraint)
+    void RemoveInactiveBodies(std::vector<uint32_t>& body_ids) const
     {
-        pivot_joint_pool.ReleasePoolData((cpPivotJoint*)constraint);
+        const auto is_inactive = [this](uint32_t body_id) {
+            return !active_bodies[body_id];
+        };
+        body_ids.erase(std::remove_if(body_ids.begin(), body_ids.end(), is_inactive), body_ids.end());
     }
 
-    void ReleaseSlideJoint(cpConstraint* constraint)
+    uint32_t WriteTransforms(const std::vector<uint32_t>& body_ids, float alpha, mono::TransformSystem* transform_system)
     {
-        slide_joint_pool.ReleasePoolData((cpSlideJoint*)constraint);
+        uint32_t n_written = 0;
+
+        for(uint32_t body_id : body_ids)
+        {
+            const BodyPose& previous = previous_poses[body_id];
+            const BodyPose& current = current_poses[body_id];
+
+            const math::Vector position = previous.position + (current.position - previous.position) * alpha;
+            const float angle = previous.angle + (current.angle - previous.angle) * alpha;
+
+            BodyPose& written = written_poses[body_id];
+            if(written.position.x == position.x && written.position.y == position.y && written.angle == angle)
+                continue;
+
+            written = { position, angle };
+
+            math::Matrix& transform = transform_system->GetTransform(body_id);
+            transform = math::CreateMatrixWithPositionRotation(position, angle);
+            transform_system->SetTransformState(body_id, TransformState::PHYSICS);
+
+            n_written++;
+        }
+
+        return n_written;
+    }
+
+    bool FindBodyId(const cpBody* cp_body, uint32_t& out_body_id) const
+    {
+        const uint32_t body_id = reinterpret_cast<uint64_t>(cpBodyGetUserData(cp_body));
+        if(body_id >= bodies.size() || !active_bodies[body_id] || bodies[body_id].Handle() != cp_body)
+            return false;
+
+        out_body_id = body_id;
+        return true;
     }
 
-    void ReleaseSpring(cpConstraint* constraint)
+    bool FindShape(const cpShape* shape, uint32_t& out_body_id, uint32_t& out_shape_index) const
     {
-        damped_spring_pool.ReleasePoolData((cpDampedSpring*)constraint);
+        if(!FindBodyId(shape->body, out_body_id))
+            return false;
+
+        const std::vector<cm::ShapeImpl*>& body_shapes = bodies_shapes[out_body_id];
+        for(uint32_t index = 0; index < body_shapes.size(); ++index)
+        {
+            if(body_shapes[index]->Handle() == shape)
+            {
+                out_shape_index = index;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    cpShape* GetShape(uint32_t body_id, uint32_t shape_index) const
+    {
+        return bodies_shapes[body_id][shape_index]->Handle();
+    }
+
+    // The constraints of the allocated bodies in body id order, each listed from the first of its bodies. The
+    // space only keeps the constraints of awake bodies, this order does not depend on which bodies sleep.
+    void CollectConstraints(std::vector<cpConstraint*>& out_constraints) const
+    {
+        out_constraints.clear();
+
+        for(uint32_t body_id = 0; body_id < bodies.size(); ++body_id)
+        {
+            if(!active_bodies[body_id])
+                continue;
+
+            cpBody* cp_body = bodies[body_id].Handle();
+            CP_BODY_FOREACH_CONSTRAINT(cp_body, constraint)
+            {
+                const cpBody* other_body = (constraint->a == cp_body) ? constraint->b : constraint->a;
+                uint32_t other_body_id;
+                if(FindBodyId(other_body, other_body_id) && other_body_id < body_id)
+                    continue;
+
+                out_constraints.push_back(constraint);
+            }
+        }
+    }
+
+    // The arbiters that sleeping bodies keep out of the arbiter cache, each from the body that owns it. Same
+    // rule as cpSpaceDeactivateBody.
+    void CollectSleepingArbiters(std::vector<cpArbiter*>& out_arbiters) const
+    {
+        out_arbiters.clear();
+
+        for(uint32_t body_id = 0; body_id < bodies.size(); ++body_id)
+        {
+            cpBody* cp_body = bodies[body_id].Handle();
+            if(!active_bodies[body_id] || !cpBodyIsSleeping(cp_body))
+                continue;
+
+            CP_BODY_FOREACH_ARBITER(cp_body, arbiter)
+            {
+                if(arbiter->body_a == cp_body || cpBodyGetType(arbiter->body_a) == CP_BODY_TYPE_STATIC)
+                    out_arbiters.push_back(arbiter);
+            }
+        }
+    }
+
+    // Arbiters with bodies that are not allocated by the system are left out.
+    bool WriteArbiter(
+        const cpArbiter* arbiter, cpTimestamp stamp, bool is_active, bool is_sleeping, std::vector<uint8_t>& out_buffer) const
+    {
+        ArbiterState arbiter_state = {};
+        const bool found_a = FindShape(arbiter->a, arbiter_state.body_a, arbiter_state.shape_a);
+        const bool found_b = FindShape(arbiter->b, arbiter_state.body_b, arbiter_state.shape_b);
+        if(!found_a || !found_b)
+            return false;
+
+        arbiter_state.age = stamp - arbiter->stamp;
+        arbiter_state.is_active = is_active;
+        arbiter_state.is_sleeping = is_sleeping;
+        arbiter_state.arbiter = *arbiter;
+        std::copy(arbiter->contacts, arbiter->contacts + arbiter->count, arbiter_state.contacts);
+
+        WriteValue(out_buffer, arbiter_state);
+        return true;
+    }
+
+    // Wakes the sleeping bodies and sorts the bodies and constraints. Together with UpdateShapes the next step
+    // then only depends on the state of the bodies, the contacts and the constraints, which is what a snapshot
+    // holds. Waking resets the idle times, the caller sets them.
+    void WakeAndSortBodies()
+    {
+        for(uint32_t body_id = 0; body_id < bodies.size(); ++body_id)
+        {
+            cpBody* cp_body = bodies[body_id].Handle();
+            if(active_bodies[body_id] && cpBodyIsSleeping(cp_body))
+                cpBodyActivate(cp_body);
+        }
+
+        cpSpace* cp_space = space.Handle();
+        SortByAddress(cp_space->dynamicBodies);
+        SortByAddress(cp_space->constraints);
+    }
+
+    // Bodies moved since the last step have shapes that are not up to date.
+    void UpdateShapes()
+    {
+        for(uint32_t body_id = 0; body_id < bodies.size(); ++body_id)
+        {
+            if(!active_bodies[body_id])
+                continue;
+
+            const cpTransform& transform = bodies[body_id].Handle()->transform;
+            for(cm::ShapeImpl* shape : bodies_shapes[body_id])
+                cpShapeUpdate(shape->Handle(), transform);
+        }
+
+        space.RebuildSpatialIndices();
+    }
+
+    void ReleaseShapeData(const cm::ShapeImpl* shape)
+    {
+        assert(shape->Pool() != cm::ShapePool::NONE);
+
+        switch(shape->Pool())
+        {
+        case cm::ShapePool::NONE:
+            break;
+        case cm::ShapePool::CIRCLE:
+            circle_shape_pool.ReleasePoolData(shape->PoolIndex());
+            break;
+        case cm::ShapePool::SEGMENT:
+            segment_shape_pool.ReleasePoolData(shape->PoolIndex());
+            break;
+        case cm::ShapePool::POLYGON:
+            poly_shape_pool.ReleasePoolData(shape->PoolIndex());
+            break;
+        }
+    }
+
+    void ReleaseConstraintData(const cm::ConstraintImpl* constraint)
+    {
+        assert(constraint->Pool() != cm::ConstraintPool::NONE);
+
+        switch(constraint->Pool())
+        {
+        case cm::ConstraintPool::NONE:
+            break;
+        case cm::ConstraintPool::SLIDE_JOINT:
+            slide_joint_pool.ReleasePoolData(constraint->PoolIndex());
+            break;
+        case cm::ConstraintPool::DAMPED_SPRING:
+            damped_spring_pool.ReleasePoolData(constraint->PoolIndex());
+            break;
+        }
     }
 
     mono::ObjectPool<cpBody> body_pool;
@@ -94,11 +520,35 @@ struct PhysicsSystem::Impl
 
     mono::PhysicsSpace space;
 
-    using ReleaseShapeFunc = void (Impl::*)(cpShape* handle);
-    std::unordered_map<cm::ShapeImpl*, ReleaseShapeFunc> m_shape_release_funcs;
+    // The accumulator is in microseconds so that the same total time gives the same number of steps, no matter
+    // how it is split in to frames.
+    const uint32_t fixed_step_us;
+    const uint32_t max_substeps;
+    uint32_t accumulator_us;
+    uint32_t last_substeps;
+    uint32_t last_synced_transforms;
 
-    using ReleaseConstraintFunc = void (Impl::*)(cpConstraint* handle);
-    std::unordered_map<IConstraint*, ReleaseConstraintFunc> m_constraint_release_funcs;
+    std::vector<BodyPose> previous_poses;
+    std::vector<BodyPose> current_poses;
+    std::vector<BodyPose> written_poses;
+
+    std::vector<uint32_t> awake_bodies;
+    std::vector<uint32_t> stepping_bodies;
+    std::vector<uint32_t> sleeping_candidates;
+    std::vector<uint32_t> awake_stamps;
+    uint32_t sync_stamp;
+
+    bool tune_broadphase;
+
+    std::vector<cpArbiter*> active_arbiters;
+    std::vector<cpArbiter*> sleeping_arbiters;
+    std::vector<cpConstraint*> snapshot_constraints;
+    std::vector<uint32_t> sleeping_roots;
+
+    // The restored arbiters point to these contacts until the next step gives them new ones.
+    std::vector<cpContact> restored_contacts;
+
+    std::vector<mono::IBody*> released_bodies;
 };
 
 PhysicsSystem::PhysicsSystem(const PhysicsSystemInitParams& init_params, mono::TransformSystem* transform_system)
@@ -114,6 +564,10 @@ PhysicsSystem::PhysicsSystem(const PhysicsSystemInitParams& init_params, mono::T
 
     m_impl->bodies_shapes.resize(init_params.n_bodies);
     m_impl->active_bodies.resize(init_params.n_bodies, false);
+    m_impl->previous_poses.resize(init_params.n_bodies);
+    m_impl->current_poses.resize(init_params.n_bodies);
+    m_impl->written_poses.resize(init_params.n_bodies);
+    m_impl->awake_stamps.resize(init_params.n_bodies, 0);
 
     System::Log(
         "Physics\n"
@@ -121,12 +575,14 @@ PhysicsSystem::PhysicsSystem(const PhysicsSystemInitParams& init_params, mono::T
         "\tbodies: %u\n"
         "\tshapes: circle %u, segment %u, polygon %u\n"
         "\tjoints: pivot %u, gear %u\n"
-        "\tsprings: damped %u",
+        "\tsprings: damped %u\n"
+        "\tsolver: %s, threads %u, iterations %u",
         cpVersionString,
         init_params.n_bodies,
         init_params.n_circle_shapes, init_params.n_segment_shapes, init_params.n_polygon_shapes,
         init_params.n_pivot_joints, init_params.n_gear_joints,
-        init_params.n_damped_springs);
+        init_params.n_damped_springs,
+        init_params.hasty_space ? "hasty" : "default", m_impl->space.GetSolverThreads(), init_params.n_solver_iterations);
 }
 
 PhysicsSystem::~PhysicsSystem()
@@ -168,28 +624,45 @@ mono::IBody* PhysicsSystem::AllocateBody(uint32_t id, const BodyComponent& body_
     m_impl->space.Add(&new_body);
     m_impl->active_bodies[id] = true;
 
+    m_impl->SetPose(id, new_body.GetPosition(), new_body.GetAngle());
+
     return &new_body;
 }
 
 void PhysicsSystem::ReleaseBody(uint32_t body_id)
 {
-    cm::BodyImpl& body = m_impl->bodies[body_id];
-    body.ClearCollisionHandlers();
+    ReleaseBodies(&body_id, 1);
+}
 
-    std::vector<cm::ShapeImpl*>& body_shapes = m_impl->bodies_shapes[body_id];
-    for(cm::ShapeImpl* shape : body_shapes)
+void PhysicsSystem::ReleaseBodies(const uint32_t* body_ids, uint32_t count)
+{
+    cpSpace* cp_space = m_impl->space.Handle();
+    m_impl->released_bodies.clear();
+
+    for(uint32_t index = 0; index < count; ++index)
     {
-        Impl::ReleaseShapeFunc release_func = m_impl->m_shape_release_funcs[shape];
-        (*m_impl.*release_func)(shape->Handle());
-        m_impl->m_shape_release_funcs.erase(shape);
+        const uint32_t body_id = body_ids[index];
+        cm::BodyImpl& body = m_impl->bodies[body_id];
+        body.ClearCollisionHandlers();
+
+        std::vector<cm::ShapeImpl*>& body_shapes = m_impl->bodies_shapes[body_id];
+        for(cm::ShapeImpl* shape : body_shapes)
+        {
+            cpSpaceRemoveShape(cp_space, shape->Handle());
+            m_impl->ReleaseShapeData(shape);
+            m_impl->shapes.ReleasePoolData(shape);
+        }
+        body_shapes.clear();
 
-        m_impl->space.Remove(shape);
-        m_impl->shapes.ReleasePoolData(shape);
+        m_impl->released_bodies.push_back(&body);
+        m_impl->active_bodies[body_id] = false;
     }
-    body_shapes.clear();
 
-    m_impl->space.Remove(&body);
-    m_impl->active_bodies[body_id] = false;
+    m_impl->space.RemoveBodies(m_impl->released_bodies.data(), m_impl->released_bodies.size());
+
+    // The synced body ids are written on frames without a step as well, drop the released ones.
+    m_impl->RemoveInactiveBodies(m_impl->awake_bodies);
+    m_impl->RemoveInactiveBodies(m_impl->sleeping_candidates);
 }
 
 mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const CircleComponent& params)
@@ -197,7 +670,8 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const CircleComponent& p
     const cpVect offset = cpv(params.offset.x, params.offset.y);
 
     mono::IBody& body = m_impl->bodies[body_id];
-    cpCircleShape* shape_data = m_impl->circle_shape_pool.GetPoolData();
+    uint32_t pool_index;
+    cpCircleShape* shape_data = m_impl->circle_shape_pool.GetPoolData(&pool_index);
     assert(shape_data != nullptr);
 
     cpCircleShapeInit(shape_data, body.Handle(), params.radius, offset);
@@ -205,13 +679,11 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const CircleComponent& p
     const float inertia_value = cpMomentForCircle(body.GetMass(), 0.0f, params.radius, offset);
 
     cm::ShapeImpl* shape_impl = m_impl->shapes.GetPoolData();
-    shape_impl->SetShapeHandle((cpShape*)shape_data);
+    shape_impl->SetShapeHandle((cpShape*)shape_data, cm::ShapePool::CIRCLE, pool_index);
     shape_impl->SetInertia(inertia_value);
     shape_impl->SetSensor(params.is_sensor);
     shape_impl->SetCollisionFilter(params.category, params.mask);
 
-    m_impl->m_shape_release_funcs[shape_impl] = &PhysicsSystem::Impl::ReleaseCircleShape;
-
     std::vector<cm::ShapeImpl*>& shapes_for_body = m_impl->bodies_shapes[body_id];
     shapes_for_body.push_back(shape_impl);
 
@@ -229,7 +701,8 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const CircleComponent& p
 mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const BoxComponent& box_params)
 {
     mono::IBody& body = m_impl->bodies[body_id];
-    cpPolyShape* shape_data = m_impl->poly_shape_pool.GetPoolData();
+    uint32_t pool_index;
+    cpPolyShape* shape_data = m_impl->poly_shape_pool.GetPoolData(&pool_index);
     assert(shape_data != nullptr);
 
     const float hw = box_params.size.x / 2.0f;
@@ -241,13 +714,11 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const BoxComponent& box_
     const float inertia_value = cpMomentForBox(body.GetMass(), box_params.size.x, box_params.size.y);
 
     cm::ShapeImpl* shape_impl = m_impl->shapes.GetPoolData();
-    shape_impl->SetShapeHandle((cpShape*)shape_data);
+    shape_impl->SetShapeHandle((cpShape*)shape_data, cm::ShapePool::POLYGON, pool_index);
     shape_impl->SetInertia(inertia_value);
     shape_impl->SetSensor(box_params.is_sensor);
     shape_impl->SetCollisionFilter(box_params.category, box_params.mask);
 
-    m_impl->m_shape_release_funcs[shape_impl] = &PhysicsSystem::Impl::ReleasePolyShape;
-
     m_impl->bodies_shapes[body_id].push_back(shape_impl);
     m_impl->space.Add(shape_impl);
 
@@ -260,7 +731,8 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const SegmentComponent&
     const cpVect end = cpv(segment_params.end.x, segment_params.end.y);
 
     mono::IBody& body = m_impl->bodies[body_id];
-    cpSegmentShape* shape_data = m_impl->segment_shape_pool.GetPoolData();
+    uint32_t pool_index;
+    cpSegmentShape* shape_data = m_impl->segment_shape_pool.GetPoolData(&pool_index);
     assert(shape_data != nullptr);
 
     cpSegmentShapeInit(shape_data, body.Handle(), start, end, segment_params.radius);
@@ -268,13 +740,11 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const SegmentComponent&
     const float inertia_value = cpMomentForSegment(body.GetMass(), start, end, segment_params.radius);
 
     cm::ShapeImpl* shape_impl = m_impl->shapes.GetPoolData();
-    shape_impl->SetShapeHandle((cpShape*)shape_data);
+    shape_impl->SetShapeHandle((cpShape*)shape_data, cm::ShapePool::SEGMENT, pool_index);
     shape_impl->SetInertia(inertia_value);
     shape_impl->SetSensor(segment_params.is_sensor);
     shape_impl->SetCollisionFilter(segment_params.category, segment_params.mask);
 
-    m_impl->m_shape_release_funcs[shape_impl] = &PhysicsSystem::Impl::ReleaseSegmentShape;
-
     m_impl->bodies_shapes[body_id].push_back(shape_impl);
     m_impl->space.Add(shape_impl);
 
@@ -295,7 +765,8 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const PolyComponent& pol
         std::reverse(vects.begin(), vects.end());
 
     mono::IBody& body = m_impl->bodies[body_id];
-    cpPolyShape* shape_data = m_impl->poly_shape_pool.GetPoolData();
+    uint32_t pool_index;
+    cpPolyShape* shape_data = m_impl->poly_shape_pool.GetPoolData(&pool_index);
     assert(shape_data != nullptr);
 
     cpPolyShapeInitRaw(shape_data, body.Handle(), (int)vects.size(), vects.data(), 0.1f);
@@ -303,13 +774,11 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const PolyComponent& pol
     const float inertia_value = cpMomentForPoly(body.GetMass(), (int)vects.size(), vects.data(), cpvzero, 1.0f);
 
     cm::ShapeImpl* shape_impl = m_impl->shapes.GetPoolData();
-    shape_impl->SetShapeHandle((cpShape*)shape_data);
+    shape_impl->SetShapeHandle((cpShape*)shape_data, cm::ShapePool::POLYGON, pool_index);
     shape_impl->SetInertia(inertia_value);
     shape_impl->SetSensor(poly_params.is_sensor);
     shape_impl->SetCollisionFilter(poly_params.category, poly_params.mask);
 
-    m_impl->m_shape_release_funcs[shape_impl] = &PhysicsSystem::Impl::ReleasePolyShape;
-
     m_impl->bodies_shapes[body_id].push_back(shape_impl);
     m_impl->space.Add(shape_impl);
 
@@ -318,7 +787,8 @@ mono::IShape* PhysicsSystem::AddShape(uint32_t body_id, const PolyComponent& pol
 
 uint32_t PhysicsSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "physicssystem"_hash;
+    return system_id;
 }
 
 const char* PhysicsSystem::Name() const
@@ -341,24 +811,74 @@ void PhysicsSystem::Update(const UpdateContext& update_context)
             mono::IBody& body = m_impl->bodies[index];
             body.SetPosition(math::GetPosition(transform));
             body.SetAngle(math::GetZRotation(transform));
+
+            // Moved by the client, nothing to interpolate from.
+            m_impl->SetPose(index, body.GetPosition(), body.GetAngle());
+            m_transform_system->SetTransformState(index, TransformState::PHYSICS);
         }
     }
 
-    m_impl->space.Tick(update_context.delta_ms);
+    if(m_impl->tune_broadphase && m_impl->shapes.Used() > 0)
+    {
+        m_impl->space.TuneBroadphase();
+        m_impl->tune_broadphase = false;
+    }
+
+    m_impl->space.ClearCollisionEvents();
 
-    for(size_t index = 0; index < m_impl->active_bodies.size(); ++index)
+    uint32_t n_steps = 1;
+    float alpha = 1.0f;
+
+    if(m_impl->fixed_step_us == 0)
     {
-        const bool is_active = m_impl->active_bodies[index];
-        if(!is_active)
-            continue;
+        m_impl->space.Tick(update_context.delta_ms);
+    }
+    else
+    {
+        m_impl->accumulator_us += update_context.delta_ms * 1000;
+
+        n_steps = m_impl->accumulator_us / m_impl->fixed_step_us;
+        if(n_steps > m_impl->max_substeps)
+        {
+            // Drop the time that does not fit, catching up would make the next frame even slower.
+            n_steps = m_impl->max_substeps;
+            m_impl->accumulator_us %= m_impl->fixed_step_us;
+        }
+        else
+        {
+            m_impl->accumulator_us -= n_steps * m_impl->fixed_step_us;
+        }
+
+        const float fixed_time_step = float(m_impl->fixed_step_us) / 1000000.0f;
+
+        for(uint32_t step = 0; step < n_steps; ++step)
+        {
+            if(step == n_steps - 1)
+            {
+                // Sleeping bodies have not moved since they were snapped, only the awake ones are stored.
+                m_impl->CollectAwakeBodies(m_impl->stepping_bodies);
+                m_impl->StorePoses(m_impl->stepping_bodies, m_impl->previous_poses);
+            }
+
+            m_impl->space.Step(fixed_time_step);
+        }
+
+        alpha = float(m_impl->accumulator_us) / float(m_impl->fixed_step_us);
+    }
 
-        mono::IBody& body = m_impl->bodies[index];
+    // Buffered collision events from all the substeps, the handlers see the bodies after the last step.
+    m_impl->space.DispatchCollisionEvents();
 
-        math::Matrix& transform = m_transform_system->GetTransform(index);
-        transform = math::CreateMatrixWithPositionRotation(body.GetPosition(), body.GetAngle());
+    m_impl->last_substeps = n_steps;
+    m_impl->last_synced_transforms = 0;
 
-        m_transform_system->SetTransformState(index, TransformState::PHYSICS);
+    if(n_steps > 0)
+    {
+        m_impl->SyncAwakeBodies();
+        m_impl->last_synced_transforms += m_impl->WriteTransforms(m_impl->sleeping_candidates, 1.0f, m_transform_system);
     }
+
+    m_impl->last_synced_transforms += m_impl->WriteTransforms(m_impl->awake_bodies, alpha, m_transform_system);
 }
 
 mono::IBody* PhysicsSystem::GetBody(uint32_t body_id)
@@ -393,6 +913,8 @@ void PhysicsSystem::PositionBody(uint32_t body_id, const math::Vector& position)
     mono::IBody* body = GetBody(body_id);
     body->SetPosition(position);
 
+    m_impl->SetPose(body_id, position, body->GetAngle());
+
     math::Matrix& transform = m_transform_system->GetTransform(body_id);
     math::Position(transform, position);
 }
@@ -416,7 +938,8 @@ void PhysicsSystem::ReleaseKinematicBody(mono::IBody* body)
 mono::IConstraint* PhysicsSystem::CreateSlideJoint(
     IBody* first, IBody* second, const math::Vector& anchor_first, const math::Vector& anchor_second, float min_length, float max_length)
 {
-    cpSlideJoint* slide_joint_data = m_impl->slide_joint_pool.GetPoolData();
+    uint32_t pool_index;
+    cpSlideJoint* slide_joint_data = m_impl->slide_joint_pool.GetPoolData(&pool_index);
     cpSlideJointInit(
         slide_joint_data,
         first->Handle(),
@@ -427,9 +950,8 @@ mono::IConstraint* PhysicsSystem::CreateSlideJoint(
         max_length);
 
     cm::ConstraintImpl* constraint_impl = m_impl->constraints.GetPoolData();
-    constraint_impl->SetHandle((cpConstraint*)slide_joint_data);
+    constraint_impl->SetHandle((cpConstraint*)slide_joint_data, cm::ConstraintPool::SLIDE_JOINT, pool_index);
 
-    m_impl->m_constraint_release_funcs[constraint_impl] = &PhysicsSystem::Impl::ReleaseSlideJoint;
     m_impl->space.Add(constraint_impl);
 
     return constraint_impl;
@@ -437,13 +959,13 @@ mono::IConstraint* PhysicsSystem::CreateSlideJoint(
 
 mono::IConstraint* PhysicsSystem::CreateSpring(IBody* first, IBody* second, float rest_length, float stiffness, float damping)
 {
-    cpDampedSpring* damped_spring_data = m_impl->damped_spring_pool.GetPoolData();
+    uint32_t pool_index;
+    cpDampedSpring* damped_spring_data = m_impl->damped_spring_pool.GetPoolData(&pool_index);
     cpDampedSpringInit(damped_spring_data, first->Handle(), second->Handle(), cpvzero, cpvzero, rest_length, stiffness, damping);
 
     cm::ConstraintImpl* constraint_impl = m_impl->constraints.GetPoolData();
-    constraint_impl->SetHandle((cpConstraint*)damped_spring_data);
+    constraint_impl->SetHandle((cpConstraint*)damped_spring_data, cm::ConstraintPool::DAMPED_SPRING, pool_index);
 
-    m_impl->m_constraint_release_funcs[constraint_impl] = &PhysicsSystem::Impl::ReleaseSpring;
     m_impl->space.Add(constraint_impl);
 
     return constraint_impl;
@@ -453,11 +975,312 @@ void PhysicsSystem::ReleaseConstraint(mono::IConstraint* constraint)
 {
     m_impl->space.Remove(constraint);
 
-    Impl::ReleaseConstraintFunc release_func = m_impl->m_constraint_release_funcs[constraint];
-    (*m_impl.*release_func)(constraint->Handle());
-    m_impl->m_constraint_release_funcs.erase(constraint);
+    const cm::ConstraintImpl* constraint_impl = static_cast<const cm::ConstraintImpl*>(constraint);
+    m_impl->ReleaseConstraintData(constraint_impl);
+    m_impl->constraints.ReleasePoolData(constraint_impl);
+}
+
+void PhysicsSystem::Snapshot(std::vector<uint8_t>& out_buffer) const
+{
+    cpSpace* cp_space = m_impl->space.Handle();
+    assert(!cpSpaceIsLocked(cp_space));
+
+    out_buffer.clear();
+
+    const size_t header_offset = out_buffer.size();
+    SnapshotHeader header = {};
+    header.version = SNAPSHOT_VERSION;
+    header.accumulator_us = m_impl->accumulator_us;
+    header.curr_dt = cp_space->curr_dt;
+    WriteValue(out_buffer, header);
+
+    for(uint32_t body_id = 0; body_id < m_impl->bodies.size(); ++body_id)
+    {
+        if(!m_impl->active_bodies[body_id])
+            continue;
+
+        const cpBody* cp_body = m_impl->bodies[body_id].Handle();
+
+        BodyState body_state;
+        body_state.body_id = body_id;
+        body_state.n_shapes = m_impl->bodies_shapes[body_id].size();
+        body_state.m = cp_body->m;
+        body_state.m_inv = cp_body->m_inv;
+        body_state.i = cp_body->i;
+        body_state.i_inv = cp_body->i_inv;
+        body_state.cog = cp_body->cog;
+        body_state.p = cp_body->p;
+        body_state.v = cp_body->v;
+        body_state.f = cp_body->f;
+        body_state.a = cp_body->a;
+        body_state.w = cp_body->w;
+        body_state.t = cp_body->t;
+        body_state.transform = cp_body->transform;
+        body_state.v_bias = cp_body->v_bias;
+        body_state.w_bias = cp_body->w_bias;
+        body_state.idle_time = cp_body->sleeping.idleTime;
+
+        body_state.sleeping_root = AWAKE;
+        if(cpBodyIsSleeping(cp_body))
+            m_impl->FindBodyId(cp_body->sleeping.root, body_state.sleeping_root);
+
+        WriteValue(out_buffer, body_state);
+
+        header.n_bodies++;
+    }
+
+    std::vector<cpConstraint*>& constraints = m_impl->snapshot_constraints;
+    m_impl->CollectConstraints(constraints);
+
+    for(cpConstraint* constraint : constraints)
+    {
+        const uint32_t state_size = ConstraintStateSize(constraint);
+        WriteValue(out_buffer, state_size);
+        WriteBytes(out_buffer, ConstraintState(constraint), state_size);
+    }
 
-    m_impl->constraints.ReleasePoolData((cm::ConstraintImpl*)constraint);
+    header.n_constraints = constraints.size();
+
+    // The arbiters from the last step, the next step resets them.
+    std::vector<cpArbiter*>& active_arbiters = m_impl->active_arbiters;
+    active_arbiters.assign((cpArbiter**)cp_space->arbiters->arr, (cpArbiter**)cp_space->arbiters->arr + cp_space->arbiters->num);
+    std::sort(active_arbiters.begin(), active_arbiters.end());
+
+    struct ArbiterContext
+    {
+        const PhysicsSystem::Impl* impl;
+        cpSpace* cp_space;
+        std::vector<uint8_t>* buffer;
+        uint32_t n_arbiters;
+    };
+
+    const auto write_arbiter = [](void* element, void* data) {
+        const cpArbiter* arbiter = static_cast<const cpArbiter*>(element);
+        ArbiterContext* context = static_cast<ArbiterContext*>(data);
+
+        const std::vector<cpArbiter*>& active_arbiters = context->impl->active_arbiters;
+        const bool is_active = std::binary_search(active_arbiters.begin(), active_arbiters.end(), arbiter);
+        if(context->impl->WriteArbiter(arbiter, context->cp_space->stamp, is_active, false, *context->buffer))
+            context->n_arbiters++;
+    };
+
+    ArbiterContext arbiter_context = { m_impl.get(), cp_space, &out_buffer, 0 };
+    cpHashSetEach(cp_space->cachedArbiters, write_arbiter, &arbiter_context);
+    header.n_arbiters = arbiter_context.n_arbiters;
+
+    m_impl->CollectSleepingArbiters(m_impl->sleeping_arbiters);
+    for(const cpArbiter* arbiter : m_impl->sleeping_arbiters)
+    {
+        if(m_impl->WriteArbiter(arbiter, cp_space->stamp, false, true, out_buffer))
+            header.n_arbiters++;
+    }
+
+    std::memcpy(out_buffer.data() + header_offset, &header, sizeof(header));
+}
+
+bool PhysicsSystem::Restore(const std::vector<uint8_t>& buffer)
+{
+    cpSpace* cp_space = m_impl->space.Handle();
+    assert(!cpSpaceIsLocked(cp_space));
+
+    // Everything is checked before anything is changed.
+    SnapshotReader reader = { buffer, 0 };
+
+    SnapshotHeader header;
+    if(!reader.ReadValue(header) || header.version != SNAPSHOT_VERSION)
+        return false;
+
+    const uint32_t n_active_bodies = std::count(m_impl->active_bodies.begin(), m_impl->active_bodies.end(), true);
+    if(header.n_bodies != n_active_bodies)
+        return false;
+
+    std::vector<uint32_t>& sleeping_roots = m_impl->sleeping_roots;
+    sleeping_roots.assign(m_impl->bodies.size(), AWAKE);
+
+    const size_t bodies_offset = reader.offset;
+    for(uint32_t index = 0; index < header.n_bodies; ++index)
+    {
+        BodyState body_state;
+        if(!reader.ReadValue(body_state))
+            return false;
+
+        if(body_state.body_id >= m_impl->bodies.size() || !m_impl->active_bodies[body_state.body_id])
+            return false;
+
+        if(body_state.n_shapes != m_impl->bodies_shapes[body_state.body_id].size())
+            return false;
+
+        sleeping_roots[body_state.body_id] = body_state.sleeping_root;
+    }
+
+    // Only dynamic bodies sleep, in components that have a sleeping root.
+    const bool sleeping_enabled = (cpSpaceGetSleepTimeThreshold(cp_space) < INFINITY);
+    for(uint32_t body_id = 0; body_id < sleeping_roots.size(); ++body_id)
+    {
+        const uint32_t root_id = sleeping_roots[body_id];
+        if(root_id == AWAKE)
+            continue;
+
+        const bool valid_sleeping =
+            sleeping_enabled && cpBodyGetType(m_impl->bodies[body_id].Handle()) == CP_BODY_TYPE_DYNAMIC &&
+            root_id < sleeping_roots.size() && sleeping_roots[root_id] == root_id;
+        if(!valid_sleeping)
+            return false;
+    }
+
+    std::vector<cpConstraint*>& constraints = m_impl->snapshot_constraints;
+    m_impl->CollectConstraints(constraints);
+    if(header.n_constraints != constraints.size())
+        return false;
+
+    const size_t constraints_offset = reader.offset;
+    for(cpConstraint* constraint : constraints)
+    {
+        uint32_t state_size;
+        if(!reader.ReadValue(state_size) || state_size != ConstraintStateSize(constraint))
+            return false;
+
+        reader.offset += state_size;
+    }
+
+    const auto is_sleeping_or_static = [this, &sleeping_roots](uint32_t body_id) {
+        return sleeping_roots[body_id] != AWAKE || cpBodyGetType(m_impl->bodies[body_id].Handle()) == CP_BODY_TYPE_STATIC;
+    };
+
+    const size_t arbiters_offset = reader.offset;
+    for(uint32_t index = 0; index < header.n_arbiters; ++index)
+    {
+        ArbiterState arbiter_state;
+        if(!reader.ReadValue(arbiter_state))
+            return false;
+
+        const bool valid_shapes =
+            arbiter_state.body_a < m_impl->bodies.size() && m_impl->active_bodies[arbiter_state.body_a] &&
+            arbiter_state.body_b < m_impl->bodies.size() && m_impl->active_bodies[arbiter_state.body_b] &&
+            arbiter_state.shape_a < m_impl->bodies_shapes[arbiter_state.body_a].size() &&
+            arbiter_state.shape_b < m_impl->bodies_shapes[arbiter_state.body_b].size();
+        if(!valid_shapes || arbiter_state.arbiter.count > CP_MAX_CONTACTS_PER_ARBITER)
+            return false;
+
+        // A sleeping arbiter is only touched by bodies that are put back to sleep.
+        const bool valid_sleeping =
+            !arbiter_state.is_sleeping ||
+            (!arbiter_state.is_active && is_sleeping_or_static(arbiter_state.body_a) && is_sleeping_or_static(arbiter_state.body_b));
+        if(!valid_sleeping)
+            return false;
+    }
+
+    // Restored from here on. The space is woken up and sorted, the snapshot is written over it and the sleeping
+    // components are put back to sleep, the same way for every restore.
+    m_impl->WakeAndSortBodies();
+
+    // The cached arbiters are thrown away and replaced by the ones in the snapshot.
+    cpHashSetFilter(cp_space->cachedArbiters, (cpHashSetFilterFunc)ReleaseArbiter, cp_space);
+    cp_space->arbiters->num = 0;
+
+    // All restored bodies are synced after the restore, the ones that sleep are dropped after the next step.
+    m_impl->awake_bodies.clear();
+    m_impl->sleeping_candidates.clear();
+
+    reader.offset = bodies_offset;
+    for(uint32_t index = 0; index < header.n_bodies; ++index)
+    {
+        BodyState body_state;
+        reader.ReadValue(body_state);
+
+        cpBody* cp_body = m_impl->bodies[body_state.body_id].Handle();
+        cp_body->m = body_state.m;
+        cp_body->m_inv = body_state.m_inv;
+        cp_body->i = body_state.i;
+        cp_body->i_inv = body_state.i_inv;
+        cp_body->cog = body_state.cog;
+        cp_body->p = body_state.p;
+        cp_body->v = body_state.v;
+        cp_body->f = body_state.f;
+        cp_body->a = body_state.a;
+        cp_body->w = body_state.w;
+        cp_body->t = body_state.t;
+        cp_body->transform = body_state.transform;
+        cp_body->v_bias = body_state.v_bias;
+        cp_body->w_bias = body_state.w_bias;
+        cp_body->sleeping.idleTime = body_state.idle_time;
+
+        const cm::BodyImpl& body = m_impl->bodies[body_state.body_id];
+        m_impl->SetPose(body_state.body_id, body.GetPosition(), body.GetAngle());
+        m_impl->awake_bodies.push_back(body_state.body_id);
+    }
+
+    reader.offset = constraints_offset;
+    for(cpConstraint* constraint : constraints)
+    {
+        uint32_t state_size;
+        reader.ReadValue(state_size);
+        reader.ReadBytes(ConstraintState(constraint), state_size);
+    }
+
+    std::vector<cpContact>& restored_contacts = m_impl->restored_contacts;
+    restored_contacts.resize(header.n_arbiters * CP_MAX_CONTACTS_PER_ARBITER);
+
+    reader.offset = arbiters_offset;
+    for(uint32_t index = 0; index < header.n_arbiters; ++index)
+    {
+        ArbiterState arbiter_state;
+        reader.ReadValue(arbiter_state);
+
+        cpShape* shape_a = m_impl->GetShape(arbiter_state.body_a, arbiter_state.shape_a);
+        cpShape* shape_b = m_impl->GetShape(arbiter_state.body_b, arbiter_state.shape_b);
+
+        cpArbiter* arbiter = PopPooledArbiter(cp_space);
+        *arbiter = arbiter_state.arbiter;
+        arbiter->a = shape_a;
+        arbiter->b = shape_b;
+        arbiter->body_a = shape_a->body;
+        arbiter->body_b = shape_b->body;
+        arbiter->thread_a.next = arbiter->thread_a.prev = nullptr;
+        arbiter->thread_b.next = arbiter->thread_b.prev = nullptr;
+        arbiter->stamp = cp_space->stamp - arbiter_state.age;
+
+        cpContact* contacts = restored_contacts.data() + index * CP_MAX_CONTACTS_PER_ARBITER;
+        std::copy(arbiter_state.contacts, arbiter_state.contacts + arbiter->count, contacts);
+        arbiter->contacts = (arbiter->count > 0) ? contacts : nullptr;
+
+        const cpShape* shape_pair[] = { shape_a, shape_b };
+        const cpHashValue arbiter_hash = CP_HASH_PAIR((cpHashValue)shape_a, (cpHashValue)shape_b);
+        cpHashSetInsert(cp_space->cachedArbiters, arbiter_hash, shape_pair, ExistingArbiter, arbiter);
+
+        if(arbiter_state.is_active)
+            cpArrayPush(cp_space->arbiters, arbiter);
+
+        // Putting the bodies to sleep takes the arbiter out of the cache and copies its contacts.
+        if(arbiter_state.is_sleeping)
+        {
+            PushArbiter(arbiter->body_a, arbiter);
+            PushArbiter(arbiter->body_b, arbiter);
+        }
+    }
+
+    // The roots first, the other bodies join their components. Going to sleep resets the idle time.
+    for(const bool roots : { true, false })
+    {
+        for(uint32_t body_id = 0; body_id < sleeping_roots.size(); ++body_id)
+        {
+            const uint32_t root_id = sleeping_roots[body_id];
+            if(root_id == AWAKE || (root_id == body_id) != roots)
+                continue;
+
+            cpBody* cp_body = m_impl->bodies[body_id].Handle();
+            const cpFloat idle_time = cp_body->sleeping.idleTime;
+            cpBodySleepWithGroup(cp_body, roots ? nullptr : m_impl->bodies[root_id].Handle());
+            cp_body->sleeping.idleTime = idle_time;
+        }
+    }
+
+    m_impl->UpdateShapes();
+
+    cp_space->curr_dt = header.curr_dt;
+    m_impl->accumulator_us = header.accumulator_us;
+
+    return true;
 }
 
 mono::PhysicsSpace* PhysicsSystem::GetSpace()
@@ -481,5 +1304,9 @@ mono::PhysicsSystemStats PhysicsSystem::GetStats() const
     stats.gear_joints = m_impl->gear_joint_pool.Used();
     stats.damped_springs = m_impl->damped_spring_pool.Used();
 
+    stats.substeps = m_impl->last_substeps;
+    stats.awake_bodies = m_impl->awake_bodies.size();
+    stats.synced_transforms = m_impl->last_synced_transforms;
+
     return stats;
 }
@@ -5,6 +5,7 @@
 #include "Math/Vector.h"
 #include "IGameSystem.h"
 
+#include <cmath>
 #include <memory>
 #include <vector>
 
@@ -15,6 +16,13 @@ namespace mono
     class IConstraint;
     class PhysicsSpace;
 
+    enum class PhysicsBroadphase : int
+    {
+        BB_TREE,
+        SPATIAL_HASH,
+        AUTO
+    };
+
     struct PhysicsSystemInitParams
     {
         uint32_t n_bodies = 100;
@@ -27,6 +35,37 @@ namespace mono
         uint32_t n_slide_joints = 100;
         uint32_t n_gear_joints = 100;
         uint32_t n_damped_springs = 100;
+
+        // A hasty space runs the impulse solver on more than one thread, Chipmunk uses at most two. Collision
+        // callbacks are still called on the thread that updates the physics system.
+        bool hasty_space = false;
+        uint32_t n_solver_threads = 1;
+        uint32_t n_solver_iterations = 10;
+
+        // A time step of zero steps the space once per frame with the frame time. Otherwise the space is
+        // stepped with the fixed time step, as many steps as the frame time allows, and what is left of the
+        // frame carries over to the next one. A frame that needs more than max_substeps steps only runs
+        // max_substeps of them and the rest of its time is dropped. The transforms are interpolated between
+        // the last two steps.
+        float fixed_time_step = 0.0f;
+        uint32_t max_substeps = 4;
+
+        // Bodies that move slower than the idle speed for the sleep time are put to sleep, their transforms
+        // are not synced until they wake up. An infinite sleep time never puts bodies to sleep, and an idle
+        // speed of zero lets Chipmunk estimate it from the gravity.
+        float sleep_time_threshold = INFINITY;
+        float idle_speed_threshold = 0.0f;
+
+        // The spatial hash is cheaper than the tree for many shapes of about the same size, the cell size should
+        // be about the size of a typical shape. AUTO picks one from the shapes on the first update, after the
+        // zone is loaded.
+        PhysicsBroadphase broadphase = PhysicsBroadphase::BB_TREE;
+        float spatial_hash_cell_size = 1.0f;
+        uint32_t spatial_hash_cells = 1000;
+
+        // Collision events are buffered during the step and the collision handlers are called after it, grouped
+        // by category. The handlers can not ignore a contact in this mode.
+        bool buffer_collision_events = false;
     };
 
     struct BodyComponent
@@ -117,6 +156,10 @@ namespace mono
         uint32_t pivot_joints;
         uint32_t gear_joints;
         uint32_t damped_springs;
+
+        uint32_t substeps;
+        uint32_t awake_bodies;
+        uint32_t synced_transforms;
     };
 
     class TransformSystem;
@@ -134,6 +177,9 @@ namespace mono
 
         mono::IBody* AllocateBody(uint32_t body_id, const BodyComponent& body_params);
         void ReleaseBody(uint32_t body_id);
+
+        //! Releases count bodies and their shapes, cheaper than releasing them one by one.
+        void ReleaseBodies(const uint32_t* body_ids, uint32_t count);
         mono::IBody* GetBody(uint32_t body_id);
 
         mono::IShape* AddShape(uint32_t body_id, const CircleComponent& circle_params);
@@ -152,6 +198,19 @@ namespace mono
         mono::IConstraint* CreateSpring(IBody* first, IBody* second, float rest_length, float stiffness, float damping);
         void ReleaseConstraint(mono::IConstraint* constraint);
 
+        //! Writes the state of the simulation to the buffer, the allocated bodies and which of them sleep, the
+        //! contacts between their shapes and their constraints. Bodies from CreateKinematicBody are not included.
+        //! The simulation is not changed. The buffer keeps its memory, so taking a snapshot every update does not
+        //! allocate once the buffer has grown.
+        void Snapshot(std::vector<uint8_t>& out_buffer) const;
+
+        //! Restores a snapshot from this system. Stepping after restoring a snapshot gives the same result every
+        //! time it is restored, as long as the space is not a hasty space. Restore sorts the bodies and rebuilds
+        //! the broadphase, so it can differ in the last bits from stepping on after the snapshot was taken. The
+        //! same bodies with the same shapes, and the same constraints, have to exist as when the snapshot was
+        //! taken, if not false is returned and nothing is changed.
+        bool Restore(const std::vector<uint8_t>& buffer);
+
         mono::PhysicsSpace* GetSpace();
         PhysicsSystemStats GetStats() const;
 
@@ -0,0 +1,114 @@
+
+#include "RaycastBatch.h"
+#include "Math/MathFunctions.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace mono;
+
+namespace
+{
+    // Spreads the lower 16 bits so there is a zero bit between each of them.
+    uint32_t SpreadBits(uint32_t value)
+    {
+        value &= 0x0000ffff;
+        value = (value | (value << 8)) & 0x00ff00ff;
+        value = (value | (value << 4)) & 0x0f0f0f0f;
+        value = (value | (value << 2)) & 0x33333333;
+        value = (value | (value << 1)) & 0x55555555;
+        return value;
+    }
+
+    uint32_t MortonCode(uint32_t x, uint32_t y)
+    {
+        return SpreadBits(x) | (SpreadBits(y) << 1);
+    }
+}
+
+void RaycastBatch::Clear()
+{
+    starts.clear();
+    ends.clear();
+    categories.clear();
+
+    hit_bodies.clear();
+    hit_categories.clear();
+    hit_points.clear();
+    hit_normals.clear();
+    hit_fractions.clear();
+
+    cast_order.clear();
+    sort_keys.clear();
+}
+
+void RaycastBatch::Reserve(uint32_t n_rays)
+{
+    starts.reserve(n_rays);
+    ends.reserve(n_rays);
+    categories.reserve(n_rays);
+
+    hit_bodies.reserve(n_rays);
+    hit_categories.reserve(n_rays);
+    hit_points.reserve(n_rays);
+    hit_normals.reserve(n_rays);
+    hit_fractions.reserve(n_rays);
+
+    cast_order.reserve(n_rays);
+    sort_keys.reserve(n_rays);
+}
+
+uint32_t RaycastBatch::AddRay(const math::Vector& start, const math::Vector& end, uint32_t category)
+{
+    const uint32_t index = starts.size();
+    starts.push_back(start);
+    ends.push_back(end);
+    categories.push_back(category);
+    cast_order.push_back(index);
+
+    return index;
+}
+
+uint32_t RaycastBatch::Size() const
+{
+    return starts.size();
+}
+
+void RaycastBatch::SortSpatially()
+{
+    const uint32_t n_rays = Size();
+    if(n_rays < 2)
+        return;
+
+    math::Vector min_point(math::INF, math::INF);
+    math::Vector max_point(-math::INF, -math::INF);
+
+    for(uint32_t index = 0; index < n_rays; ++index)
+    {
+        const math::Vector mid_point = (starts[index] + ends[index]) * 0.5f;
+        min_point.x = std::min(min_point.x, mid_point.x);
+        min_point.y = std::min(min_point.y, mid_point.y);
+        max_point.x = std::max(max_point.x, mid_point.x);
+        max_point.y = std::max(max_point.y, mid_point.y);
+    }
+
+    const float max_cell = std::numeric_limits<uint16_t>::max();
+    const float scale_x = (max_point.x > min_point.x) ? max_cell / (max_point.x - min_point.x) : 0.0f;
+    const float scale_y = (max_point.y > min_point.y) ? max_cell / (max_point.y - min_point.y) : 0.0f;
+
+    // The code in the upper half and the ray index in the lower, sorting the keys sorts the indices.
+    sort_keys.resize(n_rays);
+    for(uint32_t index = 0; index < n_rays; ++index)
+    {
+        const math::Vector mid_point = (starts[index] + ends[index]) * 0.5f;
+        const uint32_t cell_x = (mid_point.x - min_point.x) * scale_x;
+        const uint32_t cell_y = (mid_point.y - min_point.y) * scale_y;
+        sort_keys[index] = (uint64_t(MortonCode(cell_x, cell_y)) << 32) | index;
+    }
+
+    std::sort(sort_keys.begin(), sort_keys.end());
+
+    cast_order.resize(n_rays);
+    for(uint32_t index = 0; index < n_rays; ++index)
+        cast_order[index] = uint32_t(sort_keys[index]);
+}
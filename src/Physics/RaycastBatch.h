@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include "PhysicsFwd.h"
+#include "Math/Vector.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace mono
+{
+    //! Rays for PhysicsSpace::Raycast, kept as one array per field. Fill it with AddRay, cast it, and read the
+    //! results at the index AddRay returned. Clear keeps the memory so a batch can be reused every frame.
+    struct RaycastBatch
+    {
+        void Clear();
+        void Reserve(uint32_t n_rays);
+        uint32_t AddRay(const math::Vector& start, const math::Vector& end, uint32_t category);
+        uint32_t Size() const;
+
+        //! Orders the rays along a Z curve over their midpoints, rays close to each other are cast after each
+        //! other and visit the same parts of the broadphase.
+        void SortSpatially();
+
+        // Rays with a radius are swept circles.
+        float radius = 0.0f;
+
+        std::vector<math::Vector> starts;
+        std::vector<math::Vector> ends;
+        std::vector<uint32_t> categories;
+
+        // The first hit of each ray, hit_bodies is null if the ray did not hit anything. hit_fractions is where
+        // along the ray the hit is, from zero at the start to one at the end.
+        std::vector<mono::IBody*> hit_bodies;
+        std::vector<uint32_t> hit_categories;
+        std::vector<math::Vector> hit_points;
+        std::vector<math::Vector> hit_normals;
+        std::vector<float> hit_fractions;
+
+        // The order the rays are cast in.
+        std::vector<uint32_t> cast_order;
+        std::vector<uint64_t> sort_keys;
+    };
+}
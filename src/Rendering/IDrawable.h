@@ -12,6 +12,13 @@ namespace mono
     public:
     
         virtual ~IDrawable() = default;
+
+        //! Called for visible drawables before Draw, possibly on a worker thread and in parallel with other
+        //! drawables. Culling, collecting transforms and building draw lists goes here. Only state owned by the
+        //! drawable may be written and nothing may touch the gpu, buffers and textures are created in Draw.
+        virtual void Prepare(const mono::IRenderer& renderer) const { }
+
+        //! Called on the render thread, after Prepare, to submit the draw calls.
         virtual void Draw(mono::IRenderer& renderer) const = 0;
 
         // Bounding box in world coordiantes, axis aligned.
@@ -37,6 +37,15 @@ namespace mono
             const ITexture* texture,
             const mono::Color::RGBA& color) const = 0;
 
+        //! Draws a batch of text quads with per vertex colors, 'count' is the number of indices.
+        virtual void RenderText(
+            const IRenderBuffer* vertices,
+            const IRenderBuffer* uv,
+            const IRenderBuffer* colors,
+            const IElementBuffer* indices,
+            const ITexture* texture,
+            uint32_t count) const = 0;
+
         virtual void DrawSprite(
             const ISprite* sprite,
             const IRenderBuffer* vertices,
@@ -74,11 +83,10 @@ namespace mono
             bool blur,
             uint32_t count) = 0;
 
+        //! Draws 'count' ParticlePointVertex starting at 'vertex_offset' of an interleaved vertex buffer.
         virtual void DrawParticlePoints(
-            const IRenderBuffer* position,
-            const IRenderBuffer* rotation,
-            const IRenderBuffer* color,
-            const IRenderBuffer* point_size,
+            const IRenderBuffer* vertices,
+            uint32_t vertex_offset,
             const ITexture* texture,
             BlendMode blend_mode,
             uint32_t count) = 0;
@@ -110,7 +118,15 @@ namespace mono
             uint32_t offset,
             uint32_t count) const = 0;
 
-        virtual void AddLight(const math::Vector& world_position, float radius, const mono::Color::RGBA& shade) = 0;
+        //! Adds a light for this frame, the radius flickers with noise sampled at 'flicker_phase' advanced by
+        //! 'flicker_frequency' per second, 'flicker_percentage' of zero disables the flicker.
+        virtual void AddLight(
+            const math::Vector& world_position,
+            float radius,
+            const mono::Color::RGBA& shade,
+            float flicker_phase,
+            float flicker_frequency,
+            float flicker_percentage) = 0;
 
         virtual void SetClearColor(const mono::Color::RGBA& color) = 0;
         virtual void SetAmbientShade(const mono::Color::RGBA& ambient_shade) = 0;
@@ -130,6 +146,9 @@ namespace mono
         virtual const math::Quad& GetViewport() const = 0;
         virtual bool Cull(const math::Quad& world_bb) const = 0;
 
+        //! Size of the render target in pixels.
+        virtual const math::Vector& GetDrawableSize() const = 0;
+
         virtual uint32_t GetDeltaTimeMS() const = 0;
         virtual uint32_t GetTimestamp() const = 0;
     };
@@ -1,13 +1,16 @@
 
 #include "LightSystem.h"
 #include "System/Hash.h"
+#include "Util/Random.h"
 
 using namespace mono;
+using namespace hash::literals;
 
 LightSystem::LightSystem(uint32_t n_lights)
 {
     m_alive.resize(n_lights, false);
     m_lights.resize(n_lights);
+    m_flicker_phase.resize(n_lights, 0.0f);
 }
 
 void LightSystem::Allocate(uint32_t light_id)
@@ -21,6 +24,8 @@ void LightSystem::Allocate(uint32_t light_id)
     light.flicker = false;
     light.flicker_frequencey = 1.0f;
     light.flicker_percentage = 0.5f;
+
+    m_flicker_phase[light_id] = mono::Random(0.0f, 1000.0f);
 }
 
 bool LightSystem::IsAllocated(uint32_t light_id)
@@ -40,7 +45,8 @@ void LightSystem::Release(uint32_t light_id)
 
 uint32_t LightSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "lightsystem"_hash;
+    return system_id;
 }
 
 const char* LightSystem::Name() const
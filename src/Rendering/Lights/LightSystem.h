@@ -39,11 +39,15 @@ namespace mono
             for(uint32_t index = 0; index < m_alive.size(); ++index)
             {
                 if(m_alive[index])
-                    callable(m_lights[index], index);
+                    callable(m_lights[index], m_flicker_phase[index], index);
             }
         }
 
         std::vector<bool> m_alive;
         std::vector<LightComponent> m_lights;
+
+        //! Per light noise offset so that flickering lights are out of sync, the flicker itself is evaluated
+        //! when the lights are drawn.
+        std::vector<float> m_flicker_phase;
     };
 }
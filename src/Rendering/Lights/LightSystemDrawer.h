@@ -3,7 +3,6 @@
 
 #include "MonoFwd.h"
 #include "Rendering/IDrawable.h"
-#include <unordered_map>
 
 namespace mono
 {
@@ -18,7 +17,5 @@ namespace mono
 
         const LightSystem* m_light_system;
         const TransformSystem* m_transform_system;
-
-        mutable std::unordered_map<uint32_t, float> m_flicker_data;
     };
 }
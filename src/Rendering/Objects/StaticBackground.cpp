@@ -61,7 +61,9 @@ void StaticBackground::Load(const math::Vector& size, const char* texture_filena
 void StaticBackground::Load(const std::vector<math::Vector>& vertices, const char* texture_filename, uint32_t texture_mode_flags)
 {
     m_mode = TextureModeFlags(texture_mode_flags);
-    m_texture = mono::GetTextureFactory()->CreateTexture(texture_filename);
+    const mono::TextureSampler sampler =
+        (texture_mode_flags & TextureModeFlags::REPEAT) ? mono::TextureSampler::REPEAT : mono::TextureSampler::DEFAULT;
+    m_texture = mono::GetTextureFactory()->CreateTexture(texture_filename, sampler);
 
     math::Quad bounding_box = math::Quad(math::INF, math::INF, -math::INF, -math::INF);
     for(const math::Vector& vertex : vertices)
@@ -0,0 +1,226 @@
+
+#include "LightPipeline.h"
+#include "Impl/PipelineImpl.h"
+
+#include "Math/Matrix.h"
+#include "Rendering/RenderBuffer/IRenderBuffer.h"
+#include "Rendering/Texture/ITexture.h"
+#include "System/System.h"
+
+#include "sokol/sokol_gfx.h"
+
+#include <cstddef>
+
+namespace
+{
+    constexpr const char* vertex_source = R"(
+        #version 330
+
+        struct TimeInput
+        {
+            float total_time;
+            float delta_time;
+        };
+
+        struct TransformInput
+        {
+            mat4 projection;
+            mat4 view;
+            mat4 model;
+        };
+
+        uniform TimeInput time_input;
+        uniform TransformInput transform_input;
+
+        layout (location = 0) in vec2 vertex_corner;
+        layout (location = 1) in vec4 light_position_radius_phase;
+        layout (location = 2) in vec2 light_flicker;
+        layout (location = 3) in vec4 light_shade;
+
+        out vec2 v_texture_coord;
+        out vec4 v_shade;
+
+        float Hash(float value)
+        {
+            return fract(sin(value) * 43758.5453);
+        }
+
+        // Smooth value noise in the range [-1, 1]
+        float Noise(float value)
+        {
+            float integer_part = floor(value);
+            float fraction = fract(value);
+            float blend = fraction * fraction * (3.0 - 2.0 * fraction);
+            return mix(Hash(integer_part), Hash(integer_part + 1.0), blend) * 2.0 - 1.0;
+        }
+
+        void main()
+        {
+            vec2 light_position = light_position_radius_phase.xy;
+            float radius = light_position_radius_phase.z;
+            float phase = light_position_radius_phase.w;
+
+            float flicker = Noise(phase + time_input.total_time * light_flicker.x);
+            radius += radius * flicker * light_flicker.y;
+
+            gl_Position =
+                transform_input.projection *
+                transform_input.view *
+                transform_input.model *
+                vec4(light_position + vertex_corner * radius, 0.0, 1.0);
+
+            const vec2 madd = vec2(0.5, 0.5);
+            v_texture_coord = madd - vertex_corner * madd;
+            v_shade = light_shade;
+        }
+    )";
+
+    constexpr const char* fragment_source = R"(
+        #version 330
+
+        uniform sampler2D sampler;
+
+        in vec2 v_texture_coord;
+        in vec4 v_shade;
+        out vec4 frag_color;
+
+        void main()
+        {
+            frag_color = texture(sampler, v_texture_coord) * v_shade;
+        }
+    )";
+
+    constexpr int U_TIME_BLOCK = 0;
+    constexpr int U_TRANSFORM_BLOCK = 1;
+
+    constexpr int ATTR_CORNER = 0;
+    constexpr int ATTR_POSITION_RADIUS_PHASE = 1;
+    constexpr int ATTR_FLICKER = 2;
+    constexpr int ATTR_SHADE = 3;
+
+    constexpr int BUFFER_CORNERS = 0;
+    constexpr int BUFFER_INSTANCES = 1;
+}
+
+using namespace mono;
+
+mono::IPipelinePtr LightPipeline::MakePipeline()
+{
+    sg_shader_desc shader_desc = {};
+    shader_desc.vs.source = vertex_source;
+    shader_desc.attrs[ATTR_CORNER].name = "vertex_corner";
+    shader_desc.attrs[ATTR_POSITION_RADIUS_PHASE].name = "light_position_radius_phase";
+    shader_desc.attrs[ATTR_FLICKER].name = "light_flicker";
+    shader_desc.attrs[ATTR_SHADE].name = "light_shade";
+
+    shader_desc.vs.uniform_blocks[U_TIME_BLOCK].size = sizeof(float) * 2;
+    shader_desc.vs.uniform_blocks[U_TIME_BLOCK].uniforms[0].name = "time_input.total_time";
+    shader_desc.vs.uniform_blocks[U_TIME_BLOCK].uniforms[0].type = SG_UNIFORMTYPE_FLOAT;
+    shader_desc.vs.uniform_blocks[U_TIME_BLOCK].uniforms[1].name = "time_input.delta_time";
+    shader_desc.vs.uniform_blocks[U_TIME_BLOCK].uniforms[1].type = SG_UNIFORMTYPE_FLOAT;
+
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].size = sizeof(math::Matrix) * 3;
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[0].name = "transform_input.projection";
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[0].type = SG_UNIFORMTYPE_MAT4;
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[1].name = "transform_input.view";
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[1].type = SG_UNIFORMTYPE_MAT4;
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[2].name = "transform_input.model";
+    shader_desc.vs.uniform_blocks[U_TRANSFORM_BLOCK].uniforms[2].type = SG_UNIFORMTYPE_MAT4;
+
+    shader_desc.fs.source = fragment_source;
+
+    shader_desc.fs.images[0].name = "sampler";
+    shader_desc.fs.images[0].image_type = SG_IMAGETYPE_2D;
+    shader_desc.fs.images[0].sampler_type = SG_SAMPLERTYPE_FLOAT;
+
+    sg_shader shader_handle = sg_make_shader(&shader_desc);
+
+    const sg_resource_state shader_state = sg_query_shader_state(shader_handle);
+    if(shader_state != SG_RESOURCESTATE_VALID)
+        System::Log("Failed to create light shader.");
+
+    sg_pipeline_desc pipeline_desc = {};
+    pipeline_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+    pipeline_desc.index_type = SG_INDEXTYPE_UINT16;
+    pipeline_desc.shader = shader_handle;
+
+    pipeline_desc.layout.attrs[ATTR_CORNER].format = SG_VERTEXFORMAT_FLOAT2;
+    pipeline_desc.layout.attrs[ATTR_CORNER].buffer_index = BUFFER_CORNERS;
+
+    pipeline_desc.layout.buffers[BUFFER_INSTANCES].stride = sizeof(LightInstance);
+    pipeline_desc.layout.buffers[BUFFER_INSTANCES].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+
+    pipeline_desc.layout.attrs[ATTR_POSITION_RADIUS_PHASE].format = SG_VERTEXFORMAT_FLOAT4;
+    pipeline_desc.layout.attrs[ATTR_POSITION_RADIUS_PHASE].buffer_index = BUFFER_INSTANCES;
+    pipeline_desc.layout.attrs[ATTR_POSITION_RADIUS_PHASE].offset = offsetof(LightInstance, position);
+
+    pipeline_desc.layout.attrs[ATTR_FLICKER].format = SG_VERTEXFORMAT_FLOAT2;
+    pipeline_desc.layout.attrs[ATTR_FLICKER].buffer_index = BUFFER_INSTANCES;
+    pipeline_desc.layout.attrs[ATTR_FLICKER].offset = offsetof(LightInstance, flicker_frequency);
+
+    pipeline_desc.layout.attrs[ATTR_SHADE].format = SG_VERTEXFORMAT_FLOAT4;
+    pipeline_desc.layout.attrs[ATTR_SHADE].buffer_index = BUFFER_INSTANCES;
+    pipeline_desc.layout.attrs[ATTR_SHADE].offset = offsetof(LightInstance, shade);
+
+    pipeline_desc.colors[0].blend.enabled = true;
+    pipeline_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    pipeline_desc.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+
+    pipeline_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+
+    sg_pipeline pipeline_handle = sg_make_pipeline(pipeline_desc);
+    const sg_resource_state pipeline_state = sg_query_pipeline_state(pipeline_handle);
+    if(pipeline_state != SG_RESOURCESTATE_VALID)
+        System::Log("Failed to create light pipeline.");
+
+    return std::make_unique<PipelineImpl>(pipeline_handle, shader_handle);
+}
+
+void LightPipeline::Apply(
+    IPipeline* pipeline,
+    const IRenderBuffer* corners,
+    const IRenderBuffer* light_instances,
+    const IElementBuffer* indices,
+    const ITexture* light_mask_texture)
+{
+    pipeline->Apply();
+
+    sg_bindings bindings = {};
+    bindings.vertex_buffers[BUFFER_CORNERS].id = corners->Id();
+    bindings.vertex_buffers[BUFFER_INSTANCES].id = light_instances->Id();
+
+    bindings.index_buffer.id = indices->Id();
+    bindings.fs_images[0].id = light_mask_texture->Id();
+
+    sg_apply_bindings(&bindings);
+}
+
+void LightPipeline::SetTime(float total_time_s, float delta_time_s)
+{
+    struct TimeBlock
+    {
+        float total_time;
+        float delta_time;
+    } time_block;
+
+    time_block.total_time = total_time_s;
+    time_block.delta_time = delta_time_s;
+
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, U_TIME_BLOCK, { &time_block, sizeof(TimeBlock) });
+}
+
+void LightPipeline::SetTransforms(const math::Matrix& projection, const math::Matrix& view, const math::Matrix& model)
+{
+    struct TransformBlock
+    {
+        math::Matrix projection;
+        math::Matrix view;
+        math::Matrix model;
+    } transform_block;
+
+    transform_block.projection = projection;
+    transform_block.view = view;
+    transform_block.model = model;
+
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, U_TRANSFORM_BLOCK, { &transform_block, sizeof(TransformBlock) });
+}
@@ -0,0 +1,40 @@
+
+#pragma once
+
+#include "Math/MathFwd.h"
+#include "Math/Vector.h"
+#include "Rendering/Color.h"
+#include "Rendering/RenderFwd.h"
+#include "Rendering/Pipeline/IPipeline.h"
+
+namespace mono
+{
+    //! Per instance data of a light, the layout matches the instance buffer of the light pipeline.
+    struct LightInstance
+    {
+        math::Vector position;
+        float radius;
+        float flicker_phase;
+        float flicker_frequency;
+        float flicker_percentage;
+        mono::Color::RGBA shade;
+    };
+
+    //! Draws all lights with one instanced draw call, each instance is a quad scaled by the light radius.
+    //! Flicker is evaluated in the vertex shader from the total time and the per light phase.
+    class LightPipeline
+    {
+    public:
+
+        static mono::IPipelinePtr MakePipeline();
+        static void Apply(
+            IPipeline* pipeline,
+            const IRenderBuffer* corners,
+            const IRenderBuffer* light_instances,
+            const IElementBuffer* indices,
+            const ITexture* light_mask_texture);
+
+        static void SetTime(float total_time_s, float delta_time_s);
+        static void SetTransforms(const math::Matrix& projection, const math::Matrix& view, const math::Matrix& model);
+    };
+}
@@ -3,12 +3,18 @@
 #include "Impl/PipelineImpl.h"
 
 #include "Math/Matrix.h"
+#include "Math/Vector.h"
+#include "Rendering/Color.h"
 #include "Rendering/RenderBuffer/IRenderBuffer.h"
 #include "Rendering/Texture/ITexture.h"
 #include "System/System.h"
 
 #include "sokol/sokol_gfx.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
 namespace
 {
     constexpr const char* vertex_source = R"(
@@ -32,10 +38,13 @@ namespace
         //uniform TimeInput time_input;
         uniform TransformInput transform_input;
 
+        // Normalized vertex formats, see ParticlePointVertex
         layout (location = 0) in vec2 vertex_position;
-        layout (location = 1) in float vertex_rotation;
+        layout (location = 1) in vec2 vertex_size_rotation;
         layout (location = 2) in vec4 vertex_color;
-        layout (location = 3) in float point_size;
+
+        const float max_point_size = 1024.0;
+        const float full_turn = 6.28318530718;
 
         out vec4 color;
         out float rotation;
@@ -43,9 +52,9 @@ namespace
         void main()
         {
             gl_Position = transform_input.projection * transform_input.view * transform_input.model * vec4(vertex_position, 0.0, 1.0);
-            gl_PointSize = point_size;
+            gl_PointSize = vertex_size_rotation.x * max_point_size;
             color = vertex_color;
-            rotation = vertex_rotation;
+            rotation = vertex_size_rotation.y * full_turn;
         }
     )";
 
@@ -74,13 +83,38 @@ namespace
     constexpr int U_TRANSFORM_BLOCK = 0;
 
     constexpr int ATTR_POSITION = 0;
-    constexpr int ATTR_ROTATION = 1;
+    constexpr int ATTR_SIZE_ROTATION = 1;
     constexpr int ATTR_COLOR = 2;
-    constexpr int ATTR_POINT_SIZE = 3;
+
+    constexpr float FULL_TURN = 6.28318530718f;
+
+    template <typename T>
+    T Quantize(float value, float scale)
+    {
+        return T(std::lround(value * scale));
+    }
 }
 
 using namespace mono;
 
+mono::ParticlePointVertex mono::MakeParticlePointVertex(
+    const math::Vector& normalized_position, const mono::Color::RGBA& color, float point_size, float rotation)
+{
+    const float wrapped_rotation = rotation - FULL_TURN * std::floor(rotation / FULL_TURN);
+
+    ParticlePointVertex vertex;
+    vertex.position[0] = Quantize<int16_t>(std::clamp(normalized_position.x, -1.0f, 1.0f), 32767.0f);
+    vertex.position[1] = Quantize<int16_t>(std::clamp(normalized_position.y, -1.0f, 1.0f), 32767.0f);
+    vertex.color[0] = Quantize<uint8_t>(std::clamp(color.red, 0.0f, 1.0f), 255.0f);
+    vertex.color[1] = Quantize<uint8_t>(std::clamp(color.green, 0.0f, 1.0f), 255.0f);
+    vertex.color[2] = Quantize<uint8_t>(std::clamp(color.blue, 0.0f, 1.0f), 255.0f);
+    vertex.color[3] = Quantize<uint8_t>(std::clamp(color.alpha, 0.0f, 1.0f), 255.0f);
+    vertex.point_size = Quantize<uint16_t>(std::clamp(point_size / PARTICLE_MAX_POINT_SIZE, 0.0f, 1.0f), 65535.0f);
+    vertex.rotation = Quantize<uint16_t>(std::min(wrapped_rotation / FULL_TURN, 1.0f), 65535.0f);
+
+    return vertex;
+}
+
 mono::IPipelinePtr ParticlePointPipeline::MakePipeline(mono::BlendMode blend_mode)
 {
     sg_shader_desc shader_desc = {};
@@ -108,9 +142,8 @@ mono::IPipelinePtr ParticlePointPipeline::MakePipeline(mono::BlendMode blend_mod
     shader_desc.fs.images[0].sampler_type = SG_SAMPLERTYPE_FLOAT;
     
     shader_desc.attrs[ATTR_POSITION].name = "vertex_position";
-    shader_desc.attrs[ATTR_ROTATION].name = "vertex_rotation";
+    shader_desc.attrs[ATTR_SIZE_ROTATION].name = "vertex_size_rotation";
     shader_desc.attrs[ATTR_COLOR].name = "vertex_color";
-    shader_desc.attrs[ATTR_POINT_SIZE].name = "point_size";
 
     sg_shader shader_handle = sg_make_shader(&shader_desc);
 
@@ -122,17 +155,17 @@ mono::IPipelinePtr ParticlePointPipeline::MakePipeline(mono::BlendMode blend_mod
     pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
     pipeline_desc.shader = shader_handle;
 
-    pipeline_desc.layout.attrs[ATTR_POSITION].format = SG_VERTEXFORMAT_FLOAT2;
-    pipeline_desc.layout.attrs[ATTR_POSITION].buffer_index = ATTR_POSITION;
+    // One interleaved buffer, ParticlePointVertex
+    pipeline_desc.layout.buffers[0].stride = sizeof(ParticlePointVertex);
 
-    pipeline_desc.layout.attrs[ATTR_ROTATION].format = SG_VERTEXFORMAT_FLOAT;
-    pipeline_desc.layout.attrs[ATTR_ROTATION].buffer_index = ATTR_ROTATION;
+    pipeline_desc.layout.attrs[ATTR_POSITION].format = SG_VERTEXFORMAT_SHORT2N;
+    pipeline_desc.layout.attrs[ATTR_POSITION].offset = offsetof(ParticlePointVertex, position);
 
-    pipeline_desc.layout.attrs[ATTR_COLOR].format = SG_VERTEXFORMAT_FLOAT4;
-    pipeline_desc.layout.attrs[ATTR_COLOR].buffer_index = ATTR_COLOR;
+    pipeline_desc.layout.attrs[ATTR_COLOR].format = SG_VERTEXFORMAT_UBYTE4N;
+    pipeline_desc.layout.attrs[ATTR_COLOR].offset = offsetof(ParticlePointVertex, color);
 
-    pipeline_desc.layout.attrs[ATTR_POINT_SIZE].format = SG_VERTEXFORMAT_FLOAT;
-    pipeline_desc.layout.attrs[ATTR_POINT_SIZE].buffer_index = ATTR_POINT_SIZE;
+    pipeline_desc.layout.attrs[ATTR_SIZE_ROTATION].format = SG_VERTEXFORMAT_USHORT2N;
+    pipeline_desc.layout.attrs[ATTR_SIZE_ROTATION].offset = offsetof(ParticlePointVertex, point_size);
 
     //pipeline_desc.rasterizer.face_winding = SG_FACEWINDING_CCW;
 
@@ -153,21 +186,13 @@ mono::IPipelinePtr ParticlePointPipeline::MakePipeline(mono::BlendMode blend_mod
 }
 
 void ParticlePointPipeline::Apply(
-    IPipeline* pipeline,
-    const IRenderBuffer* position,
-    const IRenderBuffer* rotation,
-    const IRenderBuffer* color,
-    const IRenderBuffer* point_size,
-    const ITexture* texture)
+    IPipeline* pipeline, const IRenderBuffer* vertices, uint32_t vertex_byte_offset, const ITexture* texture)
 {
     pipeline->Apply();
 
     sg_bindings bindings = {};
-    bindings.vertex_buffers[ATTR_POSITION].id = position->Id();
-    bindings.vertex_buffers[ATTR_ROTATION].id = rotation->Id();
-    bindings.vertex_buffers[ATTR_COLOR].id = color->Id();
-    bindings.vertex_buffers[ATTR_POINT_SIZE].id = point_size->Id();
-
+    bindings.vertex_buffers[0].id = vertices->Id();
+    bindings.vertex_buffer_offsets[0] = vertex_byte_offset;
     bindings.fs_images[0].id = texture->Id();
 
     sg_apply_bindings(&bindings);
@@ -6,20 +6,33 @@
 #include "Rendering/Pipeline/IPipeline.h"
 #include "Rendering/BlendMode.h"
 
+#include <cstdint>
+
 namespace mono
 {
+    //! Largest point size that a ParticlePointVertex can hold, in pixels.
+    constexpr float PARTICLE_MAX_POINT_SIZE = 1024.0f;
+
+    //! Interleaved and quantized particle vertex, 12 bytes. The position is normalized to -1, 1 and scaled back
+    //! with the model transform, the rotation is normalized to a full turn.
+    struct ParticlePointVertex
+    {
+        int16_t position[2];
+        uint8_t color[4];
+        uint16_t point_size;
+        uint16_t rotation;
+    };
+
+    ParticlePointVertex MakeParticlePointVertex(
+        const math::Vector& normalized_position, const mono::Color::RGBA& color, float point_size, float rotation);
+
     class ParticlePointPipeline
     {
     public:
 
         static mono::IPipelinePtr MakePipeline(mono::BlendMode blend_mode);
         static void Apply(
-            IPipeline* pipeline,
-            const IRenderBuffer* position,
-            const IRenderBuffer* rotation,
-            const IRenderBuffer* color,
-            const IRenderBuffer* point_size,
-            const ITexture* texture);
+            IPipeline* pipeline, const IRenderBuffer* vertices, uint32_t vertex_byte_offset, const ITexture* texture);
 
         //static void SetTime(float total_time_s, float delta_time_s);
         static void SetTransforms(const math::Matrix& projection, const math::Matrix& view, const math::Matrix& model);
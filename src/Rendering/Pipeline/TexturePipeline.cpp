@@ -83,8 +83,17 @@ namespace
                 sampled_color = original_sample + (0.125 * (sample1 + sample2 + sample3 + sample4 + sample5 + sample6 + sample7 + sample8));
             }
 
-            if(is_alpha_texture != 0.0)
+            if(is_alpha_texture > 1.5)
+            {
+                // Signed distance field, the edge is at 0.5. Smooth it over about a pixel on screen.
+                float distance = sampled_color.r;
+                float edge_width = max(fwidth(distance) * 0.75, 0.001);
+                sampled_color = vec4(smoothstep(0.5 - edge_width, 0.5 + edge_width, distance));
+            }
+            else if(is_alpha_texture != 0.0)
+            {
                 sampled_color = vec4(sampled_color.r);
+            }
 
             frag_color = sampled_color * color_shade;
         }
@@ -166,8 +175,17 @@ namespace
                 sampled_color = original_sample + (0.125 * (sample1 + sample2 + sample3 + sample4 + sample5 + sample6 + sample7 + sample8));
             }
 
-            if(is_alpha_texture != 0.0)
+            if(is_alpha_texture > 1.5)
+            {
+                // Signed distance field, the edge is at 0.5. Smooth it over about a pixel on screen.
+                float distance = sampled_color.r;
+                float edge_width = max(fwidth(distance) * 0.75, 0.001);
+                sampled_color = vec4(smoothstep(0.5 - edge_width, 0.5 + edge_width, distance));
+            }
+            else if(is_alpha_texture != 0.0)
+            {
                 sampled_color = vec4(sampled_color.r);
+            }
 
             frag_color = sampled_color * v_vertex_color;
         }
@@ -559,6 +577,12 @@ void TexturePipeline::SetIsAlpha(bool is_alpha_texture)
     sg_apply_uniforms(SG_SHADERSTAGE_FS, U_IS_ALPHA_BLOCK, { &magic_value, sizeof(float) });
 }
 
+void TexturePipeline::SetIsDistanceField()
+{
+    const float magic_value = 2.0f;
+    sg_apply_uniforms(SG_SHADERSTAGE_FS, U_IS_ALPHA_BLOCK, { &magic_value, sizeof(float) });
+}
+
 void TexturePipeline::SetBlur(bool enable_blur)
 {
     const float magic_value = enable_blur ? 1.0f : 0.0f;
@@ -34,6 +34,10 @@ namespace mono
         static void SetTransforms(const math::Matrix& projection, const math::Matrix& view, const math::Matrix& model);
 
         static void SetIsAlpha(bool is_alpha_texture);
+
+        //! The texture is a single channel signed distance field, replaces SetIsAlpha.
+        static void SetIsDistanceField();
+
         static void SetBlur(bool enable_blur);
         static void SetShade(const mono::Color::RGBA& color);
     };
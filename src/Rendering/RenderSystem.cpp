@@ -14,12 +14,10 @@
     #define SOKOL_ASSERT(c) if(!(c)) __builtin_trap();
 #endif
 
-#define SOKOL_TRACE_HOOKS
-#define SOKOL_GLCORE33
-#define SOKOL_GFX_IMPL
-#define SOKOL_DEBUG
 #include "sokol/sokol_gfx.h"
 
+// Selects the imgui shaders, the sokol_gfx backend itself is compiled in third_party/sokol/sokol_gfx_impl.c.
+#define SOKOL_GLCORE33
 #define SOKOL_IMGUI_IMPL
 #define SOKOL_IMGUI_NO_SOKOL_APP
 #include "sokol/sokol_imgui.h"
@@ -33,6 +31,7 @@ namespace
     float g_pixels_per_meter = 1.0f;
     const char* g_light_mask_texture = nullptr;
     const char* g_sprite_shadow_texture = nullptr;
+    uint32_t g_draw_threads = 0;
     const System::IWindow* g_window = nullptr;
 
     const mono::ISpriteFactory* g_sprite_factory = nullptr;
@@ -102,10 +101,15 @@ void mono::InitializeRender(const RenderInitParams& init_params)
     g_pixels_per_meter = init_params.pixels_per_meter;
     g_light_mask_texture = init_params.light_mask_texture;
     g_sprite_shadow_texture = init_params.sprite_shadow_texture;
+    g_draw_threads = init_params.draw_threads;
     g_window = init_params.window;
 
     g_sprite_factory = new SpriteFactoryImpl(init_params.pixels_per_meter);
-    g_texture_factory = new TextureFactoryImpl();
+    g_texture_factory = new TextureFactoryImpl(
+        init_params.texture_loader_threads,
+        init_params.texture_upload_budget,
+        init_params.texture_cache_directory,
+        init_params.texture_sampler);
 
     // glEnable(GL_POINT_SMOOTH);
     // glEnable(GL_LINE_SMOOTH);
@@ -161,6 +165,11 @@ const char* mono::SpriteShadowTexture()
     return g_sprite_shadow_texture;
 }
 
+uint32_t mono::DrawThreads()
+{
+    return g_draw_threads;
+}
+
 void mono::LoadCustomTextureFactory(const ITextureFactory* texture_factory)
 {
     if(g_texture_factory)
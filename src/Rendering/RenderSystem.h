@@ -1,7 +1,9 @@
 
 #pragma once
 
+#include "Rendering/Texture/ITextureFactory.h"
 #include <stddef.h>
+#include <cstdint>
 
 namespace System
 {
@@ -16,6 +18,11 @@ namespace mono
         const char* light_mask_texture = nullptr;
         const char* sprite_shadow_texture = nullptr;
         const char* imgui_ini = nullptr;
+        uint32_t texture_loader_threads = 2;
+        uint32_t texture_upload_budget = 4 * 1024 * 1024; // Bytes per frame
+        const char* texture_cache_directory = nullptr;
+        TextureSampler texture_sampler = TextureSampler::NEAREST; // Mipmapped presets are opt in
+        uint32_t draw_threads = 2; // Worker threads that prepare drawables, zero prepares on the render thread
         System::IWindow* window = nullptr;
     };
 
@@ -27,6 +34,7 @@ namespace mono
 
     const char* LightMaskTexture();
     const char* SpriteShadowTexture();
+    uint32_t DrawThreads();
 
     void LoadCustomTextureFactory(const class ITextureFactory* texture_factory);
 
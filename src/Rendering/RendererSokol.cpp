@@ -13,6 +13,7 @@
 #include "Rendering/Pipeline/ScreenPipeline.h"
 #include "Rendering/Pipeline/SpritePipeline.h"
 #include "Rendering/Pipeline/FogPipeline.h"
+#include "Rendering/Pipeline/LightPipeline.h"
 
 #include "Rendering/RenderBuffer/BufferFactory.h"
 #include "Rendering/Texture/ITextureFactory.h"
@@ -20,10 +21,13 @@
 #include "Rendering/Sprite/SpriteProperties.h"
 
 #include "Text/TextFunctions.h"
+#include "Util/JobPool.h"
 
 #define SOKOL_IMGUI_NO_SOKOL_APP
 #include "sokol/sokol_imgui.h"
 
+#include <algorithm>
+
 using namespace mono;
 
 RendererSokol::RendererSokol()
@@ -32,7 +36,10 @@ RendererSokol::RendererSokol()
     , m_clear_color(0.7f, 0.7f, 0.7f)
     , m_ambient_shade(1.0f, 1.0f, 1.0f)
     , m_screen_fade_alpha(1.0f)
+    , m_text_layout_cache(1024)
 {
+    m_job_pool = std::make_unique<JobPool>(mono::DrawThreads());
+
     m_color_points_pipeline = mono::ColorPipeline::MakePointsPipeline();
     m_color_lines_pipeline = mono::ColorPipeline::MakeLinesPipeline();
     m_color_lines_indices_pipeline = mono::ColorPipeline::MakeLinesPipelineIndices();
@@ -49,6 +56,7 @@ RendererSokol::RendererSokol()
     m_sprite_pipeline = mono::SpritePipeline::MakePipeline();
     m_fog_pipeline = mono::FogPipeline::MakePipeline();
     m_screen_pipeline = mono::ScreenPipeline::MakePipeline();
+    m_light_pipeline = mono::LightPipeline::MakePipeline();
 
     constexpr math::Vector vertices[] = { {-1.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, -1.0f} };
     constexpr math::Vector uv_coordinates[] = { {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
@@ -58,6 +66,9 @@ RendererSokol::RendererSokol()
     m_screen_uv = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, std::size(uv_coordinates), uv_coordinates);
     m_screen_indices = CreateElementBuffer(BufferType::STATIC, std::size(indices), indices);
 
+    constexpr math::Vector light_corners[] = { {1.0f, 1.0f}, {1.0f, -1.0f}, {-1.0f, -1.0f}, {-1.0f, 1.0f} };
+    m_light_corners = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, std::size(light_corners), light_corners);
+
     const char* light_mask_texture = mono::LightMaskTexture();
     if(light_mask_texture)
         m_light_mask_texture = mono::GetTextureFactory()->CreateTexture(light_mask_texture);
@@ -132,54 +143,25 @@ void RendererSokol::DrawLights()
 
     if(m_light_mask_texture && !m_lights.empty())
     {
-        const uint32_t n_light_vertices = m_lights.size() * 4;
-        const uint32_t n_light_indices = m_lights.size() * 3 * 2;
-
-        std::vector<math::Vector> vertex_data;
-        vertex_data.reserve(n_light_vertices);
-
-        std::vector<math::Vector> uv_data;
-        uv_data.reserve(n_light_vertices);
-
-        std::vector<mono::Color::RGBA> color_data;
-        color_data.reserve(n_light_vertices);
-
-        std::vector<uint16_t> index_data;
-        index_data.reserve(n_light_indices);
+        const uint32_t n_lights = m_lights.size();
 
-        for(const LightData& light : m_lights)
+        // The instance buffer is kept between frames and only grows, a dynamic buffer can only be updated once
+        // per frame which is fine since all lights are drawn in one go.
+        if(!m_light_instances || m_light_instances->Size() < n_lights)
         {
-            const uint32_t index_offset = vertex_data.size();
-
-            vertex_data.push_back(light.position - math::Vector(-light.radius, -light.radius));
-            vertex_data.push_back(light.position - math::Vector(-light.radius,  light.radius));
-            vertex_data.push_back(light.position - math::Vector( light.radius,  light.radius));
-            vertex_data.push_back(light.position - math::Vector( light.radius, -light.radius));
-
-            uv_data.push_back(math::Vector(0.0f, 0.0f));
-            uv_data.push_back(math::Vector(0.0f, 1.0f));
-            uv_data.push_back(math::Vector(1.0f, 1.0f));
-            uv_data.push_back(math::Vector(1.0f, 0.0f));
-
-            color_data.push_back(light.shade);
-            color_data.push_back(light.shade);
-            color_data.push_back(light.shade);
-            color_data.push_back(light.shade);
-
-            index_data.push_back(index_offset + 0);
-            index_data.push_back(index_offset + 1);
-            index_data.push_back(index_offset + 2);
-            index_data.push_back(index_offset + 0);
-            index_data.push_back(index_offset + 2);
-            index_data.push_back(index_offset + 3);
+            const uint32_t buffer_size = std::max(n_lights, m_light_instances ? m_light_instances->Size() * 2 : 256u);
+            constexpr uint32_t components = sizeof(LightInstance) / sizeof(float);
+            m_light_instances = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, components, buffer_size, nullptr);
         }
 
-        const auto vertex_buffer = mono::CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, n_light_vertices, vertex_data.data());
-        const auto uv_buffer = mono::CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, n_light_vertices, uv_data.data());
-        const auto color_buffer = mono::CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 4, n_light_vertices, color_data.data());
-        const auto index_buffer = mono::CreateElementBuffer(BufferType::STATIC, n_light_indices, index_data.data());
+        m_light_instances->UpdateData(m_lights.data(), 0, n_lights);
 
-        DrawGeometry(vertex_buffer.get(), uv_buffer.get(), color_buffer.get(), index_buffer.get(), m_light_mask_texture.get(), false, index_buffer->Size());
+        LightPipeline::Apply(
+            m_light_pipeline.get(), m_light_corners.get(), m_light_instances.get(), m_screen_indices.get(), m_light_mask_texture.get());
+        LightPipeline::SetTime(float(m_timestamp) / 1000.0f, m_delta_time_s);
+        LightPipeline::SetTransforms(m_projection_stack.top(), m_view_stack.top(), m_model_stack.top());
+
+        sg_draw(0, m_screen_indices->Size(), n_lights);
     }
 
     sg_end_pass(); // End offscreen light render pass
@@ -202,6 +184,8 @@ void RendererSokol::PrepareDraw()
 
     m_model_stack.push(math::Matrix()); // Push identity
 
+    mono::GetTextureFactory()->UploadPendingTextures();
+
     MakeOrUpdateOffscreenPass(m_offscreen_color_pass);
     MakeOrUpdateOffscreenPass(m_offscreen_light_pass);
 
@@ -239,11 +223,11 @@ void RendererSokol::EndDraw()
 
     sg_draw(0, 6, 1);
 
-    for(const IDrawable* drawable : m_drawables[RenderPass::POST_LIGHTING])
+    const std::vector<const IDrawable*>& post_lighting_drawables = m_drawables[RenderPass::POST_LIGHTING];
+    for(uint32_t index = 0; index < post_lighting_drawables.size(); ++index)
     {
-        const bool visible = Cull(drawable->BoundingBox());
-        if(visible)
-            drawable->Draw(*this);
+        if(m_visible_post_lighting_drawables[index])
+            post_lighting_drawables[index]->Draw(*this);
     }
 
     simgui_render();
@@ -254,17 +238,70 @@ void RendererSokol::EndDraw()
     // Clear all the stuff once the frame has been drawn
     for(uint32_t index = 0; index < RenderPass::N_RENDER_PASS; ++index)
         m_drawables[index].clear();
+
+    // Release text buffers that has not been drawn for a while
+    constexpr uint32_t text_buffer_frames = 60;
+    for(auto it = m_text_buffers.begin(); it != m_text_buffers.end();)
+    {
+        if((m_frame_count - it->second.last_used_frame) > text_buffer_frames)
+        {
+            m_text_layout_cache.Release(it->second.run_id);
+            it = m_text_buffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    m_frame_count++;
 }
 
 void RendererSokol::DrawFrame()
 {
+    // The cached text buffers have texture coordinates into the old atlas.
+    if(mono::RebuildGlyphAtlasIfFull())
+    {
+        for(const auto& text_buffer_pair : m_text_buffers)
+            m_text_layout_cache.Release(text_buffer_pair.second.run_id);
+        m_text_buffers.clear();
+    }
+
     PrepareDraw();
 
-    for(const IDrawable* drawable : m_drawables[RenderPass::GENERAL])
+    const std::vector<const IDrawable*>& drawables = m_drawables[RenderPass::GENERAL];
+    m_visible_drawables.resize(drawables.size());
+
+    const auto prepare_drawable = [this, &drawables](uint32_t index, uint32_t thread_index) {
+        const IDrawable* drawable = drawables[index];
+        const bool visible = Cull(drawable->BoundingBox());
+        if(visible)
+            drawable->Prepare(*this);
+        m_visible_drawables[index] = visible;
+    };
+    m_job_pool->ParallelFor(drawables.size(), prepare_drawable);
+
+    const std::vector<const IDrawable*>& post_lighting_drawables = m_drawables[RenderPass::POST_LIGHTING];
+    m_visible_post_lighting_drawables.resize(post_lighting_drawables.size());
+
+    for(uint32_t index = 0; index < post_lighting_drawables.size(); ++index)
     {
+        const IDrawable* drawable = post_lighting_drawables[index];
         const bool visible = Cull(drawable->BoundingBox());
         if(visible)
-            drawable->Draw(*this);
+            drawable->Prepare(*this);
+        m_visible_post_lighting_drawables[index] = visible;
+    }
+
+    // All passes are prepared, glyphs rasterized while preparing are uploaded once before anything is drawn.
+    // Glyphs first used from Draw, by RenderText, are uploaded with the next frame.
+    mono::UploadGlyphAtlas();
+
+    // Submit in the order the drawables were added
+    for(uint32_t index = 0; index < drawables.size(); ++index)
+    {
+        if(m_visible_drawables[index])
+            drawables[index]->Draw(*this);
     }
 
     EndDraw();
@@ -288,13 +325,30 @@ void RendererSokol::RenderText(
     if(!texture)
         return;
 
-    const TextDefinition& def = mono::GenerateVertexDataFromString(font_id, text, center_flags);
+    const uint32_t run_id = m_text_layout_cache.Acquire(font_id, text, center_flags);
+
+    auto it = m_text_buffers.find(run_id);
+    if(it == m_text_buffers.end())
+    {
+        // The cached buffers keep the reference to the run until they are evicted.
+        const GlyphRun& run = m_text_layout_cache.Run(run_id);
+        const math::Vector* vertices = m_text_layout_cache.Vertices() + run.vertex_offset;
+        const math::Vector* uvs = m_text_layout_cache.UVs() + run.vertex_offset;
+
+        CachedTextBuffers cached_buffers;
+        cached_buffers.run_id = run_id;
+        cached_buffers.buffers = mono::BuildTextDrawBuffers(vertices, uvs, run.n_glyphs);
+        it = m_text_buffers.insert(std::make_pair(run_id, std::move(cached_buffers))).first;
+    }
+    else
+    {
+        m_text_layout_cache.Release(run_id);
+    }
 
-    auto vertices = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, def.vertices.size(), def.vertices.data());
-    auto uv = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, def.texcoords.size(), def.texcoords.data());
-    auto indices = CreateElementBuffer(BufferType::STATIC, def.indices.size(), def.indices.data());
+    it->second.last_used_frame = m_frame_count;
 
-    RenderText(vertices.get(), uv.get(), indices.get(), texture.get(), color);
+    const TextDrawBuffers& buffers = it->second.buffers;
+    RenderText(buffers.vertices.get(), buffers.uv.get(), buffers.indices.get(), texture.get(), color);
 }
 
 void RendererSokol::RenderText(
@@ -306,13 +360,29 @@ void RendererSokol::RenderText(
 {
     TexturePipeline::Apply(m_texture_pipeline.get(), vertices, uv, indices, texture);
     TexturePipeline::SetTransforms(m_projection_stack.top(), m_view_stack.top(), m_model_stack.top());
-    TexturePipeline::SetIsAlpha(true);
+    TexturePipeline::SetIsDistanceField();
     TexturePipeline::SetBlur(false);
     TexturePipeline::SetShade(color);
 
     sg_draw(0, indices->Size(), 1);
 }
 
+void RendererSokol::RenderText(
+    const IRenderBuffer* vertices,
+    const IRenderBuffer* uv,
+    const IRenderBuffer* colors,
+    const IElementBuffer* indices,
+    const ITexture* texture,
+    uint32_t count) const
+{
+    TexturePipeline::Apply(m_texture_pipeline_color.get(), vertices, uv, colors, indices, texture);
+    TexturePipeline::SetTransforms(m_projection_stack.top(), m_view_stack.top(), m_model_stack.top());
+    TexturePipeline::SetIsDistanceField();
+    TexturePipeline::SetBlur(false);
+
+    sg_draw(0, count, 1);
+}
+
 void RendererSokol::DrawSprite(
     const ISprite* sprite,
     const IRenderBuffer* vertices,
@@ -558,16 +628,14 @@ void RendererSokol::DrawGeometry(
 }
 
 void RendererSokol::DrawParticlePoints(
-    const IRenderBuffer* position,
-    const IRenderBuffer* rotation,
-    const IRenderBuffer* color,
-    const IRenderBuffer* point_size,
+    const IRenderBuffer* vertices,
+    uint32_t vertex_offset,
     const ITexture* texture,
     BlendMode blend_mode,
     uint32_t count)
 {
     mono::IPipeline* pipeline = (blend_mode == mono::BlendMode::ONE) ? m_particle_pipeline_one.get() : m_particle_pipeline_sa.get();
-    ParticlePointPipeline::Apply(pipeline, position, rotation, color, point_size, texture);
+    ParticlePointPipeline::Apply(pipeline, vertices, vertices->ByteOffsetToIndex(vertex_offset), texture);
     //ParticlePointPipeline::SetTime(float(m_timestamp) / 1000.0f, float(m_delta_time_ms) / 1000.0f);
     ParticlePointPipeline::SetTransforms(m_projection_stack.top(), m_view_stack.top(), m_model_stack.top());
 
@@ -657,9 +725,15 @@ void RendererSokol::DrawAnnotatedTrianges(
     sg_draw(offset, count, 1);
 }
 
-void RendererSokol::AddLight(const math::Vector& world_position, float radius, const mono::Color::RGBA& shade)
+void RendererSokol::AddLight(
+    const math::Vector& world_position,
+    float radius,
+    const mono::Color::RGBA& shade,
+    float flicker_phase,
+    float flicker_frequency,
+    float flicker_percentage)
 {
-    m_lights.push_back({ world_position, radius, shade });
+    m_lights.push_back({ world_position, radius, flicker_phase, flicker_frequency, flicker_percentage, shade });
 }
 
 void RendererSokol::SetClearColor(const mono::Color::RGBA& color)
@@ -722,6 +796,11 @@ bool RendererSokol::Cull(const math::Quad& world_bb) const
     return math::QuadOverlaps(m_viewport, world_bb);
 }
 
+const math::Vector& RendererSokol::GetDrawableSize() const
+{
+    return m_drawable_size;
+}
+
 uint32_t RendererSokol::GetDeltaTimeMS() const
 {
     return m_delta_time_ms;
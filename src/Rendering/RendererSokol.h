@@ -3,6 +3,9 @@
 
 #include "IRenderer.h"
 #include "Rendering/Texture/ITextureFactory.h"
+#include "Rendering/Pipeline/LightPipeline.h"
+#include "Rendering/Text/TextLayoutCache.h"
+#include "Rendering/Text/TextBufferFactory.h"
 
 #include "Color.h"
 #include "Math/Vector.h"
@@ -12,11 +15,14 @@
 #include <stack>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "sokol/sokol_gfx.h"
 
 namespace mono
 {
+    class JobPool;
+
     class RendererSokol : public mono::IRenderer
     {
     public:
@@ -44,6 +50,13 @@ namespace mono
             const IElementBuffer* indices,
             const ITexture* texture,
             const mono::Color::RGBA& color) const override;
+        void RenderText(
+            const IRenderBuffer* vertices,
+            const IRenderBuffer* uv,
+            const IRenderBuffer* colors,
+            const IElementBuffer* indices,
+            const ITexture* texture,
+            uint32_t count) const override;
 
         void DrawSprite(
             const ISprite* sprite,
@@ -83,10 +96,8 @@ namespace mono
             uint32_t count) override;
 
         void DrawParticlePoints(
-            const IRenderBuffer* position,
-            const IRenderBuffer* rotation,
-            const IRenderBuffer* color,
-            const IRenderBuffer* point_size,
+            const IRenderBuffer* vertices,
+            uint32_t vertex_offset,
             const ITexture* texture,
             BlendMode blend_mode,
             uint32_t count) override;
@@ -118,7 +129,13 @@ namespace mono
             uint32_t offset,
             uint32_t count) const override;
 
-        void AddLight(const math::Vector& world_position, float radius, const mono::Color::RGBA& shade) override;
+        void AddLight(
+            const math::Vector& world_position,
+            float radius,
+            const mono::Color::RGBA& shade,
+            float flicker_phase,
+            float flicker_frequency,
+            float flicker_percentage) override;
 
         void SetClearColor(const mono::Color::RGBA& color) override;
         void SetAmbientShade(const mono::Color::RGBA& ambient_shade) override;
@@ -137,6 +154,7 @@ namespace mono
 
         const math::Quad& GetViewport() const override;
         bool Cull(const math::Quad& world_bb) const override;
+        const math::Vector& GetDrawableSize() const override;
 
         uint32_t GetDeltaTimeMS() const override;
         uint32_t GetTimestamp() const override;
@@ -184,11 +202,15 @@ namespace mono
         std::unique_ptr<IPipeline> m_sprite_pipeline;
         std::unique_ptr<IPipeline> m_fog_pipeline;
         std::unique_ptr<IPipeline> m_screen_pipeline;
+        std::unique_ptr<IPipeline> m_light_pipeline;
 
         std::unique_ptr<IRenderBuffer> m_screen_vertices;
         std::unique_ptr<IRenderBuffer> m_screen_uv;
         std::unique_ptr<IElementBuffer> m_screen_indices;
 
+        std::unique_ptr<IRenderBuffer> m_light_corners;
+        std::unique_ptr<IRenderBuffer> m_light_instances;
+
         mono::ITexturePtr m_light_mask_texture;
 
         uint32_t m_delta_time_ms = 0;
@@ -197,13 +219,23 @@ namespace mono
 
         std::vector<const IDrawable*> m_drawables[RenderPass::N_RENDER_PASS];
 
-        struct LightData
+        // Written from the draw workers, so bytes and not a std::vector<bool>
+        std::vector<uint8_t> m_visible_drawables;
+        std::vector<uint8_t> m_visible_post_lighting_drawables;
+        std::unique_ptr<JobPool> m_job_pool;
+
+        std::vector<LightInstance> m_lights;
+
+        // Buffers for RenderText(font_id, text, ...), kept while the same text is drawn every frame.
+        struct CachedTextBuffers
         {
-            math::Vector position;
-            float radius;
-            mono::Color::RGBA shade;
+            uint32_t run_id;
+            uint32_t last_used_frame;
+            TextDrawBuffers buffers;
         };
 
-        std::vector<LightData> m_lights;
+        uint32_t m_frame_count = 0;
+        mutable TextLayoutCache m_text_layout_cache;
+        mutable std::unordered_map<uint32_t, CachedTextBuffers> m_text_buffers;
     };
 }
@@ -19,25 +19,6 @@
 
 using namespace mono;
 
-namespace
-{
-    struct SpriteTransformPair
-    {
-        uint32_t entity_id;
-        math::Matrix transform;
-        math::Quad world_bb;
-        mono::ISprite* sprite;
-        int layer;
-    };
-
-    struct ShadowDrawData
-    {
-        uint32_t entity_id;
-        math::Matrix transform;
-        mono::ISprite* sprite;
-    };
-}
-
 SpriteBatchDrawer::SpriteBatchDrawer(const mono::TransformSystem* transform_system, mono::SpriteSystem* sprite_system)
     : m_transform_system(transform_system)
     , m_sprite_system(sprite_system)
@@ -72,13 +53,10 @@ void SpriteBatchDrawer::ReloadSpriteData(uint32_t sprite_hash)
     m_sprite_buffers.erase(sprite_hash);
 }
 
-void SpriteBatchDrawer::Draw(mono::IRenderer& renderer) const
+void SpriteBatchDrawer::Prepare(const mono::IRenderer& renderer) const
 {
-    std::vector<SpriteTransformPair> sprites_to_draw;
-    std::vector<ShadowDrawData> shadows_to_draw;
-
-    sprites_to_draw.reserve(128);
-    shadows_to_draw.reserve(128);
+    m_sprites_to_draw.clear();
+    m_shadows_to_draw.clear();
 
     const auto collect_sprites = [&, this](mono::ISprite* sprite, int layer, uint32_t id)
     {
@@ -90,16 +68,11 @@ void SpriteBatchDrawer::Draw(mono::IRenderer& renderer) const
 
         if(renderer.Cull(world_bounds))
         {
-            const uint32_t sprite_hash = sprite->GetSpriteHash();
-            auto it = m_sprite_buffers.find(sprite_hash);
-            if(it == m_sprite_buffers.end())
-                m_sprite_buffers[sprite_hash] = BuildSpriteDrawBuffers(sprite->GetSpriteData());
-
             const float sort_offset = m_sprite_system->GetSpriteSortOffset(id);
             math::Quad world_bounds_offseted = world_bounds;
             world_bounds_offseted.mA.y += sort_offset;
 
-            sprites_to_draw.push_back({ id, transform, world_bounds_offseted, sprite, layer });
+            m_sprites_to_draw.push_back({ id, transform, world_bounds_offseted, sprite, layer });
         }
 
         const bool has_shadow = (sprite->GetProperties() & mono::SpriteProperty::SHADOW);
@@ -111,35 +84,13 @@ void SpriteBatchDrawer::Draw(mono::IRenderer& renderer) const
 
             const bool is_shadow_visible = renderer.Cull(shadow_bb);
             if(is_shadow_visible)
-            {
-                bool need_update = false;
-
-                auto shadow_it = m_shadow_buffers.find(id);
-                if(shadow_it != m_shadow_buffers.end())
-                {
-                    auto shadow_cached_it = m_shadow_data_cache.find(id);
-                    need_update = 
-                        (shadow_cached_it->second.offset != shadow_offset) || (shadow_cached_it->second.radius != shadow_radius);
-                }
-                else
-                {
-                    need_update = true;
-                }
-
-                if(need_update)
-                {
-                    m_shadow_data_cache[id] = { shadow_offset, shadow_radius };
-                    m_shadow_buffers[id] = BuildSpriteShadowBuffers(shadow_offset, shadow_radius);
-                }
-
-                shadows_to_draw.push_back({ id, transform, sprite });
-            }
+                m_shadows_to_draw.push_back({ id, transform, shadow_offset, shadow_radius });
         }
     };
 
     m_sprite_system->ForEachSprite(collect_sprites);
 
-    const auto sort_on_y_and_layer = [](const SpriteTransformPair& first, const SpriteTransformPair& second)
+    const auto sort_on_y_and_layer = [](const SpriteDrawData& first, const SpriteDrawData& second)
     {
         if(first.layer == second.layer)
             return math::Bottom(first.world_bb) > math::Bottom(second.world_bb);
@@ -147,43 +98,68 @@ void SpriteBatchDrawer::Draw(mono::IRenderer& renderer) const
         return first.layer < second.layer;
     };
 
-    std::sort(sprites_to_draw.begin(), sprites_to_draw.end(), sort_on_y_and_layer);
+    std::sort(m_sprites_to_draw.begin(), m_sprites_to_draw.end(), sort_on_y_and_layer);
+}
 
+void SpriteBatchDrawer::Draw(mono::IRenderer& renderer) const
+{
     if(m_shadow_texture)
     {
-        for(const ShadowDrawData& shadow_draw : shadows_to_draw)
+        for(const ShadowDrawData& shadow_draw : m_shadows_to_draw)
         {
-            const math::Matrix& world_transform = renderer.GetTransform() * shadow_draw.transform;
-            auto transform_scope = mono::MakeTransformScope(world_transform, &renderer);
+            bool need_update = false;
+
+            auto shadow_it = m_shadow_buffers.find(shadow_draw.entity_id);
+            if(shadow_it != m_shadow_buffers.end())
+            {
+                auto shadow_cached_it = m_shadow_data_cache.find(shadow_draw.entity_id);
+                need_update =
+                    (shadow_cached_it->second.offset != shadow_draw.offset) || (shadow_cached_it->second.radius != shadow_draw.radius);
+            }
+            else
+            {
+                need_update = true;
+            }
 
-            const auto it = m_shadow_buffers.find(shadow_draw.entity_id);
-            if(it != m_shadow_buffers.end())
+            if(need_update)
             {
-                const SpriteShadowBuffers& shadow_buffers = it->second;
-                renderer.DrawGeometry(
-                    shadow_buffers.vertices.get(),
-                    shadow_buffers.uv.get(),
-                    m_sprite_indices.get(),
-                    m_shadow_texture.get(),
-                    false,
-                    m_sprite_indices->Size());
+                m_shadow_data_cache[shadow_draw.entity_id] = { shadow_draw.offset, shadow_draw.radius };
+                shadow_it = m_shadow_buffers.insert_or_assign(
+                    shadow_draw.entity_id, BuildSpriteShadowBuffers(shadow_draw.offset, shadow_draw.radius)).first;
             }
+
+            const math::Matrix& world_transform = renderer.GetTransform() * shadow_draw.transform;
+            auto transform_scope = mono::MakeTransformScope(world_transform, &renderer);
+
+            const SpriteShadowBuffers& shadow_buffers = shadow_it->second;
+            renderer.DrawGeometry(
+                shadow_buffers.vertices.get(),
+                shadow_buffers.uv.get(),
+                m_sprite_indices.get(),
+                m_shadow_texture.get(),
+                false,
+                m_sprite_indices->Size());
         }
     }
 
-    for(const SpriteTransformPair& sprite_transform : sprites_to_draw)
+    for(const SpriteDrawData& sprite_transform : m_sprites_to_draw)
     {
+        mono::ISprite* sprite = sprite_transform.sprite;
+
+        const uint32_t sprite_hash = sprite->GetSpriteHash();
+        auto it = m_sprite_buffers.find(sprite_hash);
+        if(it == m_sprite_buffers.end())
+            it = m_sprite_buffers.insert_or_assign(sprite_hash, BuildSpriteDrawBuffers(sprite->GetSpriteData())).first;
+
         const math::Matrix& world_transform = renderer.GetTransform() * sprite_transform.transform;
         auto transform_scope = mono::MakeTransformScope(world_transform, &renderer);
 
-        mono::ISprite* sprite = sprite_transform.sprite;
-
-        const SpriteDrawBuffers& sprite_buffers = m_sprite_buffers[sprite->GetSpriteHash()];
+        const SpriteDrawBuffers& sprite_buffers = it->second;
         const int offset = sprite->GetCurrentFrameIndex() * sprite_buffers.vertices_per_sprite;
         mono::ITexture* texture = sprite->GetTexture();
 
         renderer.DrawSprite(
-            sprite_transform.sprite,
+            sprite,
             sprite_buffers.vertices.get(),
             sprite_buffers.offsets.get(),
             sprite_buffers.uv.get(),
@@ -5,6 +5,8 @@
 #include "Rendering/IDrawable.h"
 #include "SpriteBufferFactory.h"
 #include "Math/Vector.h"
+#include "Math/Matrix.h"
+#include "Math/Quad.h"
 #include "Rendering/Texture/ITextureFactory.h"
 
 #include <vector>
@@ -26,6 +28,7 @@ namespace mono
 
     private:
 
+        void Prepare(const mono::IRenderer& renderer) const override;
         void Draw(mono::IRenderer& renderer) const override;
         math::Quad BoundingBox() const override;
 
@@ -44,5 +47,26 @@ namespace mono
         };
         mutable std::unordered_map<uint32_t, ShadowData> m_shadow_data_cache;
         mutable std::unordered_map<uint32_t, SpriteShadowBuffers> m_shadow_buffers;
+
+        struct SpriteDrawData
+        {
+            uint32_t entity_id;
+            math::Matrix transform;
+            math::Quad world_bb;
+            mono::ISprite* sprite;
+            int layer;
+        };
+
+        struct ShadowDrawData
+        {
+            uint32_t entity_id;
+            math::Matrix transform;
+            math::Vector offset;
+            float radius;
+        };
+
+        // Built in Prepare, sorted in draw order
+        mutable std::vector<SpriteDrawData> m_sprites_to_draw;
+        mutable std::vector<ShadowDrawData> m_shadows_to_draw;
     };
 }
@@ -119,7 +119,7 @@ mono::ISpritePtr SpriteFactoryImpl::CreateSpriteFromRaw(const char* sprite_raw)
     }
 
     const mono::SpriteData& sprite_data = it->second;
-    mono::ITexturePtr texture = mono::GetTextureFactory()->CreateTexture(sprite_data.texture_file.c_str());
+    mono::ITexturePtr texture = mono::GetTextureFactory()->CreateTextureAsync(sprite_data.texture_file.c_str(), mono::TextureLoadPriority::NORMAL);
     return std::make_unique<mono::Sprite>(&sprite_data, texture);
 }
 
@@ -129,14 +129,14 @@ bool SpriteFactoryImpl::CreateSprite(mono::Sprite& sprite, const char* sprite_fi
     if(!sprite_data)
         return false;
 
-    mono::ITexturePtr texture = mono::GetTextureFactory()->CreateTexture(sprite_data->texture_file.c_str());
+    mono::ITexturePtr texture = mono::GetTextureFactory()->CreateTextureAsync(sprite_data->texture_file.c_str(), mono::TextureLoadPriority::NORMAL);
     sprite.Init(sprite_data, texture);
     return true;
 }
 
 const mono::SpriteData* SpriteFactoryImpl::GetSpriteDataForFile(const char* sprite_file) const
 {
-    const uint32_t sprite_filename_hash = hash::Hash(sprite_file);
+    const uint32_t sprite_filename_hash = hash::HashRegisterString(sprite_file);
 
     auto it = m_sprite_data_cache.find(sprite_filename_hash);
     if(it == m_sprite_data_cache.end())
@@ -10,6 +10,7 @@
 #include <cassert>
 
 using namespace mono;
+using namespace hash::literals;
 
 SpriteSystem::SpriteSystem(size_t n_sprites, mono::TransformSystem* transform_system)
     : m_transform_system(transform_system)
@@ -107,7 +108,8 @@ void SpriteSystem::SetSpriteEnabled(uint32_t sprite_id, bool enabled)
 
 uint32_t SpriteSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "spritesystem"_hash;
+    return system_id;
 }
 
 const char* SpriteSystem::Name() const
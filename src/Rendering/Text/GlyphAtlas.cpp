@@ -0,0 +1,97 @@
+
+#include "GlyphAtlas.h"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace mono;
+
+namespace
+{
+    // Keeps linear filtering from bleeding into the neighbours.
+    constexpr uint32_t PADDING = 1;
+}
+
+GlyphAtlas::GlyphAtlas(uint32_t width, uint32_t height)
+    : m_width(width)
+    , m_height(height)
+    , m_shelves_height(0)
+    , m_dirty(false)
+{
+    m_pixels.resize(width * height, 0);
+}
+
+bool GlyphAtlas::Allocate(uint32_t width, uint32_t height, uint32_t& out_x, uint32_t& out_y)
+{
+    const uint32_t padded_width = width + PADDING;
+    const uint32_t padded_height = height + PADDING;
+
+    // Best fit, the shelf that wastes the least height.
+    Shelf* best_shelf = nullptr;
+    for(Shelf& shelf : m_shelves)
+    {
+        const bool fits = (shelf.height >= padded_height && (shelf.used_width + padded_width) <= m_width);
+        if(fits && (!best_shelf || shelf.height < best_shelf->height))
+            best_shelf = &shelf;
+    }
+
+    if(!best_shelf)
+    {
+        if((m_shelves_height + padded_height) > m_height || padded_width > m_width)
+            return false;
+
+        best_shelf = &m_shelves.emplace_back();
+        best_shelf->y = m_shelves_height;
+        best_shelf->height = padded_height;
+        best_shelf->used_width = 0;
+
+        m_shelves_height += padded_height;
+    }
+
+    out_x = best_shelf->used_width;
+    out_y = best_shelf->y;
+    best_shelf->used_width += padded_width;
+
+    return true;
+}
+
+void GlyphAtlas::Write(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+    for(uint32_t row = 0; row < height; ++row)
+        std::memcpy(m_pixels.data() + (y + row) * m_width + x, pixels + row * width, width);
+
+    m_dirty = true;
+}
+
+void GlyphAtlas::Clear()
+{
+    m_shelves.clear();
+    m_shelves_height = 0;
+    std::fill(m_pixels.begin(), m_pixels.end(), 0);
+    m_dirty = true;
+}
+
+uint32_t GlyphAtlas::Width() const
+{
+    return m_width;
+}
+
+uint32_t GlyphAtlas::Height() const
+{
+    return m_height;
+}
+
+const uint8_t* GlyphAtlas::Pixels() const
+{
+    return m_pixels.data();
+}
+
+bool GlyphAtlas::IsDirty() const
+{
+    return m_dirty;
+}
+
+void GlyphAtlas::ClearDirty()
+{
+    m_dirty = false;
+}
@@ -0,0 +1,48 @@
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace mono
+{
+    //! Single channel atlas packed in shelves, rows as high as the tallest rectangle placed in them. Rectangles
+    //! are never removed one by one, the whole atlas is reset with Clear.
+    class GlyphAtlas
+    {
+    public:
+
+        GlyphAtlas(uint32_t width, uint32_t height);
+
+        //! Finds room for a width x height rectangle, returns false if the atlas is full.
+        bool Allocate(uint32_t width, uint32_t height, uint32_t& out_x, uint32_t& out_y);
+
+        //! Copies a tightly packed width x height block of pixels into the atlas.
+        void Write(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* pixels);
+        void Clear();
+
+        uint32_t Width() const;
+        uint32_t Height() const;
+        const uint8_t* Pixels() const;
+
+        //! True if pixels have been written since the last call to ClearDirty.
+        bool IsDirty() const;
+        void ClearDirty();
+
+    private:
+
+        struct Shelf
+        {
+            uint32_t y;
+            uint32_t height;
+            uint32_t used_width;
+        };
+
+        const uint32_t m_width;
+        const uint32_t m_height;
+        uint32_t m_shelves_height;
+        bool m_dirty;
+        std::vector<Shelf> m_shelves;
+        std::vector<uint8_t> m_pixels;
+    };
+}
@@ -2,7 +2,6 @@
 #include "TextBatchDrawer.h"
 #include "TextSystem.h"
 #include "TextFunctions.h"
-#include "TextBufferFactory.h"
 #include "TransformSystem/TransformSystem.h"
 
 #include "Math/Quad.h"
@@ -11,64 +10,166 @@
 #include "Rendering/IRenderer.h"
 #include "Rendering/RenderBuffer/IRenderBuffer.h"
 #include "Rendering/RenderBuffer/BufferFactory.h"
+#include "Rendering/Texture/ITexture.h"
+
+#include "System/Hash.h"
+
+#include <algorithm>
 
 using namespace mono;
 
+namespace
+{
+    constexpr uint32_t MAX_BATCH_GLYPHS = 65536 / 4;
+    const math::Vector SHADOW_OFFSET(0.1f, -0.05f);
+}
+
 TextBatchDrawer::TextBatchDrawer(mono::TextSystem* text_system, mono::TransformSystem* transform_system)
     : m_text_system(text_system)
     , m_transform_system(transform_system)
+    , m_frame(0)
+    , m_layout_cache(1024)
 {
-    m_draw_buffers.resize(500);
+    std::vector<uint16_t> indices(MAX_BATCH_GLYPHS * 6);
+    mono::GenerateGlyphIndices(MAX_BATCH_GLYPHS, indices.data());
+    m_quad_indices = mono::CreateElementBuffer(mono::BufferType::STATIC, indices.size(), indices.data());
 }
 
 TextBatchDrawer::~TextBatchDrawer()
 { }
 
-void TextBatchDrawer::Draw(mono::IRenderer& renderer) const
+void TextBatchDrawer::Prepare(const mono::IRenderer& renderer) const
 {
-    const auto draw_texts_func = [this, &renderer](mono::TextComponent& text, uint32_t index) {
-        
+    m_frame++;
+    m_layout_cache.Refresh();
+
+    for(AtlasBatch& batch : m_atlas_batches)
+    {
+        batch.vertices.clear();
+        batch.uv.clear();
+        batch.colors.clear();
+    }
+
+    const auto collect_texts_func = [this, &renderer](const mono::TextComponent& text, uint32_t index) {
+        if(text.text.empty())
+            return;
+
+        const ITexturePtr texture = mono::GetFontTexture(text.font_id);
+        if(!texture)
+            return;
+
         const math::Quad world_bb = m_transform_system->GetWorldBoundingBox(index);
-        if(renderer.Cull(world_bb))
+        if(!renderer.Cull(world_bb))
+            return;
+
+        if(index >= m_text_runs.size())
+            m_text_runs.resize(index + 1, { false, 0, 0, FontCentering::DEFAULT_CENTER, 0, 0 });
+
+        TextRunState& state = m_text_runs[index];
+        const uint32_t text_hash = hash::Hash(text.text.c_str(), text.text.size());
+
+        const bool needs_update =
+            !state.has_run ||
+            state.font_id != text.font_id ||
+            state.center_flags != text.center_flags ||
+            state.text_hash != text_hash;
+        if(needs_update)
         {
-            const math::Matrix& world_transform = m_transform_system->GetWorld(index);
-            auto transform_scope = mono::MakeTransformScope(world_transform, &renderer);
+            if(state.has_run)
+                m_layout_cache.Release(state.run_id);
+            else
+                m_referenced_texts.push_back(index);
+
+            state.has_run = true;
+            state.font_id = text.font_id;
+            state.center_flags = text.center_flags;
+            state.text_hash = text_hash;
+            state.run_id = m_layout_cache.Acquire(text.font_id, text.text.c_str(), text.center_flags);
+        }
 
-            const TextDrawBuffers* render_buffers = UpdateDrawBuffers(text, index);
-            const ITexturePtr texture = mono::GetFontTexture(text.font_id);
+        state.last_frame = m_frame;
 
-            if(text.text.empty())
-                return;
+        AtlasBatch& batch = FindOrAddBatch(texture);
+        const GlyphRun& run = m_layout_cache.Run(state.run_id);
+        const math::Matrix& world_transform = m_transform_system->GetWorld(index);
 
-            if(text.draw_shadow)
-            {
-                math::Matrix shadow_world_transform = world_transform;
-                const math::Vector shadow_offset(0.1f, -0.05f);
-                math::Translate(shadow_world_transform, shadow_offset);
+        if(text.draw_shadow)
+        {
+            math::Matrix shadow_world_transform = world_transform;
+            math::Translate(shadow_world_transform, SHADOW_OFFSET);
+
+            mono::Color::HSL hsl_color = mono::Color::ToHSL(text.tint);
+            hsl_color.lightness -= 0.3f;
 
-                auto shadow_transform_scope = mono::MakeTransformScope(shadow_world_transform, &renderer);
+            AppendRun(batch, run, shadow_world_transform, mono::Color::ToRGBA(hsl_color, text.tint.alpha));
+        }
+
+        AppendRun(batch, run, world_transform, text.tint);
+    };
 
-                mono::Color::HSL hsl_color = mono::Color::ToHSL(text.tint);
-                hsl_color.lightness -= 0.3f;
+    m_text_system->ForEach(collect_texts_func);
+
+    // Texts that are no longer visible, or gone, let go of their run so that it can be evicted.
+    for(auto it = m_referenced_texts.begin(); it != m_referenced_texts.end();)
+    {
+        TextRunState& state = m_text_runs[*it];
+        if(state.last_frame != m_frame)
+        {
+            m_layout_cache.Release(state.run_id);
+            state.has_run = false;
 
-                renderer.RenderText(
-                    render_buffers->vertices.get(),
-                    render_buffers->uv.get(),
-                    render_buffers->indices.get(),
-                    texture.get(),
-                    mono::Color::ToRGBA(hsl_color, text.tint.alpha));
+            *it = m_referenced_texts.back();
+            m_referenced_texts.pop_back();
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void TextBatchDrawer::Draw(mono::IRenderer& renderer) const
+{
+    for(AtlasBatch& batch : m_atlas_batches)
+    {
+        const uint32_t n_glyphs = batch.vertices.size() / 4;
+        if(n_glyphs == 0)
+            continue;
+
+        const uint32_t n_chunks = (n_glyphs + MAX_BATCH_GLYPHS - 1) / MAX_BATCH_GLYPHS;
+        if(batch.buffers.size() < n_chunks)
+            batch.buffers.resize(n_chunks);
+
+        for(uint32_t chunk = 0; chunk < n_chunks; ++chunk)
+        {
+            const uint32_t glyph_offset = chunk * MAX_BATCH_GLYPHS;
+            const uint32_t chunk_glyphs = std::min(n_glyphs - glyph_offset, MAX_BATCH_GLYPHS);
+            const uint32_t vertex_offset = glyph_offset * 4;
+            const uint32_t chunk_vertices = chunk_glyphs * 4;
+
+            BatchBuffers& buffers = batch.buffers[chunk];
+            if(!buffers.vertices || buffers.capacity < chunk_glyphs)
+            {
+                buffers.capacity = std::min(std::max(chunk_glyphs, buffers.capacity * 2), MAX_BATCH_GLYPHS);
+                const uint32_t capacity_vertices = buffers.capacity * 4;
+                buffers.vertices = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 2, capacity_vertices, nullptr);
+                buffers.uv = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 2, capacity_vertices, nullptr);
+                buffers.colors = mono::CreateRenderBuffer(BufferType::DYNAMIC, BufferData::FLOAT, 4, capacity_vertices, nullptr);
             }
 
+            buffers.vertices->UpdateData(batch.vertices.data() + vertex_offset, 0, chunk_vertices);
+            buffers.uv->UpdateData(batch.uv.data() + vertex_offset, 0, chunk_vertices);
+            buffers.colors->UpdateData(batch.colors.data() + vertex_offset, 0, chunk_vertices);
+
             renderer.RenderText(
-                render_buffers->vertices.get(),
-                render_buffers->uv.get(),
-                render_buffers->indices.get(),
-                texture.get(),
-                text.tint);
+                buffers.vertices.get(),
+                buffers.uv.get(),
+                buffers.colors.get(),
+                m_quad_indices.get(),
+                batch.texture.get(),
+                chunk_glyphs * 6);
         }
-    };
-
-    m_text_system->ForEach(draw_texts_func);
+    }
 }
 
 math::Quad TextBatchDrawer::BoundingBox() const
@@ -76,28 +177,29 @@ math::Quad TextBatchDrawer::BoundingBox() const
     return math::InfQuad;
 }
 
-const mono::TextDrawBuffers* TextBatchDrawer::UpdateDrawBuffers(const mono::TextComponent& text_component, uint32_t index) const
+TextBatchDrawer::AtlasBatch& TextBatchDrawer::FindOrAddBatch(const ITexturePtr& texture) const
 {
-    bool needs_update = true;
-
-    auto it = m_current_data.find(index);
-    if(it != m_current_data.end())
+    for(AtlasBatch& batch : m_atlas_batches)
     {
-        const mono::TextComponent& last_text_update = it->second;
-        needs_update =
-            last_text_update.font_id != text_component.font_id ||
-            last_text_update.center_flags != text_component.center_flags ||
-            last_text_update.text != text_component.text;
+        if(batch.texture == texture)
+            return batch;
     }
 
-    TextDrawBuffers& draw_buffers = m_draw_buffers[index];
+    AtlasBatch& batch = m_atlas_batches.emplace_back();
+    batch.texture = texture;
+    return batch;
+}
 
-    if(needs_update && !text_component.text.empty())
-    {
-        draw_buffers =
-            mono::BuildTextDrawBuffers(text_component.font_id, text_component.text.c_str(), text_component.center_flags);
-        m_current_data[index] = text_component;
-    }
+void TextBatchDrawer::AppendRun(
+    AtlasBatch& batch, const GlyphRun& run, const math::Matrix& transform, const mono::Color::RGBA& color) const
+{
+    const uint32_t n_vertices = run.n_glyphs * 4;
+    const math::Vector* vertices = m_layout_cache.Vertices() + run.vertex_offset;
+    const math::Vector* uvs = m_layout_cache.UVs() + run.vertex_offset;
+
+    for(uint32_t index = 0; index < n_vertices; ++index)
+        batch.vertices.push_back(math::Transform(transform, vertices[index]));
 
-    return &draw_buffers;
+    batch.uv.insert(batch.uv.end(), uvs, uvs + n_vertices);
+    batch.colors.insert(batch.colors.end(), n_vertices, color);
 }
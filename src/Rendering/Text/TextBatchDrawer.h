@@ -4,15 +4,21 @@
 #include "MonoFwd.h"
 #include "Rendering/IDrawable.h"
 #include "Rendering/RenderFwd.h"
+#include "Rendering/Color.h"
 #include "Rendering/Text/TextSystem.h"
+#include "Rendering/Text/TextLayoutCache.h"
+#include "Rendering/Texture/ITextureFactory.h"
+#include "Math/Vector.h"
+#include "Math/Matrix.h"
 
 #include <vector>
-#include <unordered_map>
+#include <memory>
 
 namespace mono
 {
-    struct TextDrawBuffers;
-
+    //! Draws all texts with one draw call per glyph atlas texture, all fonts share the same atlas. The glyph quads
+    //! of each string are laid out once and kept in a TextLayoutCache, each frame the visible texts are
+    //! transformed into a per atlas vertex batch.
     class TextBatchDrawer : public mono::IDrawable
     {
     public:
@@ -20,17 +26,54 @@ namespace mono
         TextBatchDrawer(mono::TextSystem* text_system, mono::TransformSystem* transform_system);
         ~TextBatchDrawer();
 
+        void Prepare(const mono::IRenderer& renderer) const override;
         void Draw(mono::IRenderer& renderer) const override;
         math::Quad BoundingBox() const override;
 
     private:
 
-        const TextDrawBuffers* UpdateDrawBuffers(const mono::TextComponent& text_component, uint32_t index) const;
+        struct AtlasBatch;
+        AtlasBatch& FindOrAddBatch(const ITexturePtr& texture) const;
+        void AppendRun(
+            AtlasBatch& batch, const GlyphRun& run, const math::Matrix& transform, const mono::Color::RGBA& color) const;
 
         mono::TextSystem* m_text_system;
         mono::TransformSystem* m_transform_system;
 
-        mutable std::vector<TextDrawBuffers> m_draw_buffers;
-        mutable std::unordered_map<uint32_t, mono::TextComponent> m_current_data;
+        struct TextRunState
+        {
+            bool has_run;
+            int font_id;
+            uint32_t text_hash;
+            mono::FontCentering center_flags;
+            uint32_t run_id;
+            uint32_t last_frame;
+        };
+
+        struct BatchBuffers
+        {
+            uint32_t capacity;
+            std::unique_ptr<IRenderBuffer> vertices;
+            std::unique_ptr<IRenderBuffer> uv;
+            std::unique_ptr<IRenderBuffer> colors;
+        };
+
+        struct AtlasBatch
+        {
+            ITexturePtr texture;
+            std::vector<math::Vector> vertices;
+            std::vector<math::Vector> uv;
+            std::vector<mono::Color::RGBA> colors;
+
+            // One set of buffers per MAX_BATCH_GLYPHS, the indices are 16 bit.
+            std::vector<BatchBuffers> buffers;
+        };
+
+        mutable uint32_t m_frame;
+        mutable TextLayoutCache m_layout_cache;
+        mutable std::vector<TextRunState> m_text_runs;
+        mutable std::vector<uint32_t> m_referenced_texts;
+        mutable std::vector<AtlasBatch> m_atlas_batches;
+        std::unique_ptr<IElementBuffer> m_quad_indices;
     };
 }
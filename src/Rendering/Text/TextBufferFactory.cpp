@@ -2,6 +2,9 @@
 #include "TextBufferFactory.h"
 #include "TextFunctions.h"
 #include "Rendering/RenderBuffer/BufferFactory.h"
+#include "Math/Vector.h"
+
+#include <vector>
 
 mono::TextDrawBuffers mono::BuildTextDrawBuffers(int font_id, const char* text, mono::FontCentering center_flags)
 {
@@ -14,3 +17,16 @@ mono::TextDrawBuffers mono::BuildTextDrawBuffers(int font_id, const char* text,
 
     return buffers;
 }
+
+mono::TextDrawBuffers mono::BuildTextDrawBuffers(const math::Vector* vertices, const math::Vector* uvs, uint32_t n_glyphs)
+{
+    std::vector<uint16_t> indices(n_glyphs * 6);
+    mono::GenerateGlyphIndices(n_glyphs, indices.data());
+
+    TextDrawBuffers buffers;
+    buffers.vertices = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, n_glyphs * 4, vertices);
+    buffers.uv = CreateRenderBuffer(BufferType::STATIC, BufferData::FLOAT, 2, n_glyphs * 4, uvs);
+    buffers.indices = CreateElementBuffer(BufferType::STATIC, indices.size(), indices.data());
+
+    return buffers;
+}
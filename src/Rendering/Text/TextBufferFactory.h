@@ -3,7 +3,9 @@
 
 #include "TextFlags.h"
 #include "Rendering/RenderFwd.h"
+#include "Math/MathFwd.h"
 #include <memory>
+#include <cstdint>
 
 namespace mono
 {
@@ -15,4 +17,7 @@ namespace mono
     };
 
     TextDrawBuffers BuildTextDrawBuffers(int font_id, const char* text, mono::FontCentering center_flags);
+
+    //! Builds buffers from already generated glyph quads, four vertices and uvs per glyph.
+    TextDrawBuffers BuildTextDrawBuffers(const math::Vector* vertices, const math::Vector* uvs, uint32_t n_glyphs);
 }
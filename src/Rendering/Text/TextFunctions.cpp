@@ -1,10 +1,14 @@
 
 #include "TextFunctions.h"
+#include "GlyphAtlas.h"
 #include "System/File.h"
+#include "System/Hash.h"
+#include "System/System.h"
 #include "Rendering/RenderSystem.h"
 #include "Rendering/Texture/ITexture.h"
 #include "Rendering/Texture/ITextureFactory.h"
 #include "Math/Vector.h"
+#include "Math/Quad.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb/stb_truetype.h"
@@ -12,88 +16,345 @@
 #include <cstring>
 #include <cstdio>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
 #include <cassert>
+#include <algorithm>
 
 namespace
 {
-    constexpr int g_base = 32;
-    constexpr int g_n_chars = 224;
-
-    struct CharData
+    constexpr uint32_t g_base = 32;
+    constexpr uint32_t g_n_ascii = 95;
+    constexpr uint32_t g_missing_codepoint = '?';
+    constexpr uint32_t g_replacement_codepoint = 0xFFFD;
+
+    // All glyphs are rasterized once as signed distance fields at this pixel height, the
+    // distance field scales to any font size.
+    constexpr float g_sdf_pixel_height = 32.0f;
+    constexpr int g_sdf_padding = 4;
+    constexpr unsigned char g_sdf_on_edge = 128;
+    constexpr float g_sdf_pixel_distance_scale = float(g_sdf_on_edge) / float(g_sdf_padding);
+
+    constexpr uint32_t g_atlas_size = 1024;
+
+    // In distance field pixels
+    struct GlyphData
     {
         float xadvance;
         float xoffset;
         float yoffset;
         float width;
         float height;
-        
+
         float texCoordX0;
         float texCoordY0;
         float texCoordX1;
         float texCoordY1;
     };
 
+    struct FontFace
+    {
+        std::vector<byte> data;
+        stbtt_fontinfo info;
+        float sdf_scale;
+
+        // Printable ascii is rasterized when the face is loaded and never changes, everything else is added
+        // on demand, guarded by g_glyph_mutex.
+        GlyphData ascii[g_n_ascii];
+        std::unordered_map<uint32_t, GlyphData> glyphs;
+    };
+
     struct FontData
     {
-        mono::ITexturePtr texture;
-        CharData chars[g_n_chars];
+        FontFace* face;
+        float metric_scale;
     };
 
+    // Faces are keyed on the hash of the font file, fonts of different sizes share glyphs.
+    std::unordered_map<uint32_t, std::unique_ptr<FontFace>> g_faces;
     std::unordered_map<int, FontData> g_fonts;
+
+    std::unique_ptr<mono::GlyphAtlas> g_atlas;
+    mono::ITexturePtr g_atlas_texture;
+    std::mutex g_glyph_mutex;
+
+    // Set when a glyph did not fit, the atlas is rebuilt with the glyphs in use at the next frame boundary. Until
+    // then the glyphs that did not fit are drawn as '?'.
+    bool g_atlas_full = false;
+    uint32_t g_atlas_generation = 0;
+
+    uint32_t DecodeUtf8(const char*& text, const char* text_end)
+    {
+        const unsigned char first = *text++;
+        if(first < 0x80)
+            return first;
+
+        uint32_t n_continuation = 0;
+        uint32_t codepoint = 0;
+        if((first & 0xE0) == 0xC0)
+        {
+            n_continuation = 1;
+            codepoint = first & 0x1F;
+        }
+        else if((first & 0xF0) == 0xE0)
+        {
+            n_continuation = 2;
+            codepoint = first & 0x0F;
+        }
+        else if((first & 0xF8) == 0xF0)
+        {
+            n_continuation = 3;
+            codepoint = first & 0x07;
+        }
+        else
+        {
+            return g_replacement_codepoint;
+        }
+
+        for(uint32_t index = 0; index < n_continuation; ++index)
+        {
+            if(text == text_end || (static_cast<unsigned char>(*text) & 0xC0) != 0x80)
+                return g_replacement_codepoint;
+
+            codepoint = (codepoint << 6) | (static_cast<unsigned char>(*text) & 0x3F);
+            ++text;
+        }
+
+        return codepoint;
+    }
+
+    // Must be called with g_glyph_mutex held.
+    bool RasterizeGlyph(FontFace& face, uint32_t codepoint, GlyphData& out_glyph)
+    {
+        int advance_width;
+        int left_side_bearing;
+        stbtt_GetCodepointHMetrics(&face.info, codepoint, &advance_width, &left_side_bearing);
+
+        out_glyph = {};
+        out_glyph.xadvance = advance_width * face.sdf_scale;
+
+        int width;
+        int height;
+        int xoffset;
+        int yoffset;
+        unsigned char* sdf_bitmap = stbtt_GetCodepointSDF(
+            &face.info,
+            face.sdf_scale,
+            codepoint,
+            g_sdf_padding,
+            g_sdf_on_edge,
+            g_sdf_pixel_distance_scale,
+            &width,
+            &height,
+            &xoffset,
+            &yoffset);
+
+        // Whitespace has no bitmap, only an advance.
+        if(!sdf_bitmap)
+            return true;
+
+        uint32_t atlas_x;
+        uint32_t atlas_y;
+        const bool allocated = g_atlas->Allocate(width, height, atlas_x, atlas_y);
+        if(allocated)
+            g_atlas->Write(atlas_x, atlas_y, width, height, sdf_bitmap);
+
+        stbtt_FreeSDF(sdf_bitmap, nullptr);
+
+        if(!allocated)
+        {
+            g_atlas_full = true;
+            return false;
+        }
+
+        const float tex_coord_x_multi = 1.0f / g_atlas->Width();
+        const float tex_coord_y_multi = 1.0f / g_atlas->Height();
+
+        out_glyph.width = width;
+        out_glyph.height = height;
+        out_glyph.xoffset = xoffset;
+        out_glyph.yoffset = yoffset + height;
+
+        // The atlas has origo in the upper left corner, thats why the y texture coordinate is flipped.
+        out_glyph.texCoordX0 = atlas_x * tex_coord_x_multi;
+        out_glyph.texCoordY0 = (atlas_y + height) * tex_coord_y_multi;
+        out_glyph.texCoordX1 = (atlas_x + width) * tex_coord_x_multi;
+        out_glyph.texCoordY1 = atlas_y * tex_coord_y_multi;
+
+        return true;
+    }
+
+    const GlyphData& FindGlyph(FontFace& face, uint32_t codepoint)
+    {
+        if(codepoint >= g_base && codepoint < (g_base + g_n_ascii))
+            return face.ascii[codepoint - g_base];
+
+        std::lock_guard<std::mutex> lock(g_glyph_mutex);
+
+        const auto it = face.glyphs.find(codepoint);
+        if(it != face.glyphs.end())
+            return it->second;
+
+        GlyphData glyph;
+        const bool has_glyph = (stbtt_FindGlyphIndex(&face.info, codepoint) != 0);
+        if(!has_glyph || !RasterizeGlyph(face, codepoint, glyph))
+            glyph = face.ascii[g_missing_codepoint - g_base];
+
+        return face.glyphs.emplace(codepoint, glyph).first->second;
+    }
+
+    // The visible part of the glyph quads that GenerateGlyphQuads writes for the text with the pen starting at
+    // origo, the distance field padding is not part of it.
+    math::Quad MeasureGlyphBounds(const FontData& font_data, const char* text, const char* text_end)
+    {
+        const float metric_scale = font_data.metric_scale;
+        const float padding = g_sdf_padding * metric_scale;
+
+        math::Quad bounds(math::INF, math::INF, -math::INF, -math::INF);
+        float pen_x = 0.0f;
+
+        while(text != text_end)
+        {
+            const uint32_t codepoint = DecodeUtf8(text, text_end);
+            const GlyphData& data = FindGlyph(*font_data.face, codepoint);
+
+            if(data.width > 0.0f)
+            {
+                const float x0 = pen_x + data.xoffset * metric_scale;
+                const float y0 = -data.yoffset * metric_scale;
+                const float x1 = x0 + data.width * metric_scale;
+                const float y1 = y0 + data.height * metric_scale;
+
+                bounds |= math::Vector(x0 + padding, y0 + padding);
+                bounds |= math::Vector(std::max(x1 - padding, x0 + padding), std::max(y1 - padding, y0 + padding));
+            }
+
+            pen_x += data.xadvance * metric_scale;
+        }
+
+        if(bounds.mA.x > bounds.mB.x)
+            return math::ZeroQuad;
+
+        return bounds;
+    }
+
+    FontFace* FindOrLoadFace(const unsigned char* data_bytes, int data_size)
+    {
+        const uint32_t face_hash = hash::Hash(reinterpret_cast<const char*>(data_bytes), data_size);
+        const auto it = g_faces.find(face_hash);
+        if(it != g_faces.end())
+            return it->second.get();
+
+        auto face = std::make_unique<FontFace>();
+        face->data.assign(data_bytes, data_bytes + data_size);
+
+        const int font_offset = stbtt_GetFontOffsetForIndex(face->data.data(), 0);
+        if(!stbtt_InitFont(&face->info, face->data.data(), font_offset))
+        {
+            System::Log("TextFunctions|Unable to read font data.");
+            return nullptr;
+        }
+
+        face->sdf_scale = stbtt_ScaleForPixelHeight(&face->info, g_sdf_pixel_height);
+
+        std::lock_guard<std::mutex> lock(g_glyph_mutex);
+
+        if(!g_atlas)
+            g_atlas = std::make_unique<mono::GlyphAtlas>(g_atlas_size, g_atlas_size);
+
+        for(uint32_t index = 0; index < g_n_ascii; ++index)
+            RasterizeGlyph(*face, g_base + index, face->ascii[index]);
+
+        FontFace* face_ptr = face.get();
+        g_faces[face_hash] = std::move(face);
+        return face_ptr;
+    }
 }
 
 void mono::LoadFont(int font_id, const char* font_file, float size, float scale)
 {
     file::FilePtr font = file::OpenBinaryFile(font_file);
-    
+
     const std::vector<byte> font_buffer = file::FileRead(font);
     LoadFontRaw(font_id, font_buffer.data(), font_buffer.size(), size, scale);
 }
 
 void mono::LoadFontRaw(int font_id, const unsigned char* data_bytes, int data_size, float size, float scale)
 {
-    constexpr int width = 512;
-    constexpr int height = 512;
-    constexpr float texCoordXMulti = 1.0f / width;
-    constexpr float texCoordYMulti = 1.0f / height;
-
-    byte bitmap_data[width * height];
-    stbtt_bakedchar char_data[g_n_chars];
-    
-    // The bitmap generated by this function has origo in the upper left corner,
-    // thats why a bit down the y texture coordinate is flipped.
-    stbtt_BakeFontBitmap(data_bytes, 0, size, bitmap_data, width, height, g_base, g_n_chars, char_data);
+    FontFace* face = FindOrLoadFace(data_bytes, data_size);
+    if(!face)
+        return;
+
+    if(!g_atlas_texture)
+        g_atlas_texture = mono::GetTextureFactory()->CreateDynamicTexture(g_atlas->Width(), g_atlas->Height(), 1);
 
     FontData font_data;
-    font_data.texture = mono::GetTextureFactory()->CreateTexture(bitmap_data, width, height, 1);
+    font_data.face = face;
+    font_data.metric_scale = (size / g_sdf_pixel_height) * scale;
+    g_fonts[font_id] = font_data;
+}
+
+void mono::UnloadFonts()
+{
+    std::lock_guard<std::mutex> lock(g_glyph_mutex);
+
+    g_fonts.clear();
+    g_faces.clear();
+    g_atlas_texture = nullptr;
+    g_atlas_full = false;
+
+    if(g_atlas)
+        g_atlas->Clear();
+}
+
+mono::ITexturePtr mono::GetFontTexture(int font_id)
+{
+    if(g_fonts.find(font_id) == g_fonts.end())
+        return nullptr;
+
+    return g_atlas_texture;
+}
+
+bool mono::RebuildGlyphAtlasIfFull()
+{
+    std::lock_guard<std::mutex> lock(g_glyph_mutex);
+
+    if(!g_atlas_full)
+        return false;
 
-    for(int index = 0; index < g_n_chars; ++index)
+    System::Log("TextFunctions|Glyph atlas is full, rebuilding it with the glyphs in use.");
+
+    g_atlas->Clear();
+    g_atlas_full = false;
+    g_atlas_generation++;
+
+    // Printable ascii goes back in right away, everything else is rasterized again the next time it is used.
+    for(auto& face_pair : g_faces)
     {
-        const stbtt_bakedchar& baked_char = char_data[index];
-        
-        CharData& data = font_data.chars[index];
-        data.width = (baked_char.x1 - baked_char.x0) * scale;
-        data.height = (baked_char.y1 - baked_char.y0) * scale;
-        data.xadvance = baked_char.xadvance * scale;
-        data.xoffset = baked_char.xoff * scale;
-        data.yoffset = (baked_char.yoff * scale) + data.height;
-        data.texCoordX0 = baked_char.x0 * texCoordXMulti;
-        data.texCoordY0 = baked_char.y1 * texCoordYMulti;
-        data.texCoordX1 = baked_char.x1 * texCoordXMulti;
-        data.texCoordY1 = baked_char.y0 * texCoordYMulti;
+        FontFace& face = *face_pair.second;
+        face.glyphs.clear();
+
+        for(uint32_t index = 0; index < g_n_ascii; ++index)
+            RasterizeGlyph(face, g_base + index, face.ascii[index]);
     }
 
-    g_fonts.insert(std::make_pair(font_id, font_data));
+    return true;
 }
 
-void mono::UnloadFonts()
+uint32_t mono::GlyphAtlasGeneration()
 {
-    g_fonts.clear();
+    return g_atlas_generation;
 }
 
-mono::ITexturePtr mono::GetFontTexture(int font_id)
+void mono::UploadGlyphAtlas()
 {
-    return g_fonts.find(font_id)->second.texture;
+    std::lock_guard<std::mutex> lock(g_glyph_mutex);
+
+    if(!g_atlas_texture || !g_atlas->IsDirty())
+        return;
+
+    mono::GetTextureFactory()->UpdateDynamicTexture(g_atlas_texture.get(), g_atlas->Pixels());
+    g_atlas->ClearDirty();
 }
 
 mono::TextDefinition mono::GenerateVertexDataFromString(int font_id, const char* text, FontCentering center_flags)
@@ -101,84 +362,95 @@ mono::TextDefinition mono::GenerateVertexDataFromString(int font_id, const char*
     const uint32_t text_length = std::strlen(text);
 
     mono::TextDefinition text_def;
-    text_def.vertices.reserve(text_length * 4);
-    text_def.texcoords.reserve(text_length * 4);
-    text_def.indices.reserve(text_length * 6);
+    text_def.vertices.resize(text_length * 4);
+    text_def.texcoords.resize(text_length * 4);
+
+    const uint32_t n_glyphs =
+        GenerateGlyphQuads(font_id, text, text_length, center_flags, text_def.vertices.data(), text_def.texcoords.data());
 
+    text_def.vertices.resize(n_glyphs * 4);
+    text_def.texcoords.resize(n_glyphs * 4);
+    text_def.indices.resize(n_glyphs * 6);
+    GenerateGlyphIndices(n_glyphs, text_def.indices.data());
+
+    return text_def;
+}
+
+uint32_t mono::GenerateGlyphQuads(
+    int font_id,
+    const char* text,
+    uint32_t text_length,
+    FontCentering center_flags,
+    math::Vector* out_vertices,
+    math::Vector* out_uvs)
+{
+    const FontData& font_data = g_fonts.find(font_id)->second;
+    const float metric_scale = font_data.metric_scale;
+
+    const char* text_end = text + text_length;
+
+    // Centered on the same bounds that MeasureString reports.
     math::Vector current_position = math::ZeroVec;
     if(center_flags != 0)
     {
-        const math::Vector half_size = MeasureString(font_id, text) / 2.0f;
+        const math::Vector center = math::Center(MeasureGlyphBounds(font_data, text, text_end));
         if(center_flags & FontCentering::HORIZONTAL)
-            current_position.x -= half_size.x;
+            current_position.x -= center.x;
         if(center_flags & FontCentering::VERTICAL)
-            current_position.y -= half_size.y;
+            current_position.y -= center.y;
     }
 
-    const FontData& font_data = g_fonts.find(font_id)->second;
+    uint32_t n_glyphs = 0;
 
-    for(uint32_t index = 0; index < text_length; ++index)
+    while(text != text_end)
     {
-        const char text_char = text[index];
-        const uint32_t char_index = static_cast<uint32_t>(text_char);
-
-        // For the correct char we need to add base to the index.
-        const uint32_t offset_index = char_index - g_base;
-        const CharData& data = font_data.chars[offset_index];
-
-        const float x0 = current_position.x + data.xoffset;
-        const float y0 = current_position.y - data.yoffset;
-        const float x1 = x0 + data.width;
-        const float y1 = y0 + data.height;
-
-        text_def.vertices.emplace_back(x0, y0);
-        text_def.vertices.emplace_back(x0, y1);
-        text_def.vertices.emplace_back(x1, y1);
-        text_def.vertices.emplace_back(x1, y0);
+        const uint32_t codepoint = DecodeUtf8(text, text_end);
+        const GlyphData& data = FindGlyph(*font_data.face, codepoint);
+
+        const float x0 = current_position.x + data.xoffset * metric_scale;
+        const float y0 = current_position.y - data.yoffset * metric_scale;
+        const float x1 = x0 + data.width * metric_scale;
+        const float y1 = y0 + data.height * metric_scale;
+
+        math::Vector* vertices = out_vertices + n_glyphs * 4;
+        vertices[0] = math::Vector(x0, y0);
+        vertices[1] = math::Vector(x0, y1);
+        vertices[2] = math::Vector(x1, y1);
+        vertices[3] = math::Vector(x1, y0);
+
+        math::Vector* uvs = out_uvs + n_glyphs * 4;
+        uvs[0] = math::Vector(data.texCoordX0, data.texCoordY0);
+        uvs[1] = math::Vector(data.texCoordX0, data.texCoordY1);
+        uvs[2] = math::Vector(data.texCoordX1, data.texCoordY1);
+        uvs[3] = math::Vector(data.texCoordX1, data.texCoordY0);
+
+        current_position.x += data.xadvance * metric_scale;
+        n_glyphs++;
+    }
 
-        text_def.texcoords.emplace_back(data.texCoordX0, data.texCoordY0);
-        text_def.texcoords.emplace_back(data.texCoordX0, data.texCoordY1);
-        text_def.texcoords.emplace_back(data.texCoordX1, data.texCoordY1);
-        text_def.texcoords.emplace_back(data.texCoordX1, data.texCoordY0);
+    return n_glyphs;
+}
 
+void mono::GenerateGlyphIndices(uint32_t n_glyphs, uint16_t* out_indices)
+{
+    for(uint32_t index = 0; index < n_glyphs; ++index)
+    {
         const uint16_t indices_base = index * 4;
+        uint16_t* indices = out_indices + index * 6;
 
-        text_def.indices.push_back(indices_base + 0);
-        text_def.indices.push_back(indices_base + 1);
-        text_def.indices.push_back(indices_base + 2);
-
-        text_def.indices.push_back(indices_base + 0);
-        text_def.indices.push_back(indices_base + 2);
-        text_def.indices.push_back(indices_base + 3);
+        indices[0] = indices_base + 0;
+        indices[1] = indices_base + 1;
+        indices[2] = indices_base + 2;
 
-        current_position.x += data.xadvance;
+        indices[3] = indices_base + 0;
+        indices[4] = indices_base + 2;
+        indices[5] = indices_base + 3;
     }
-
-    return text_def;
 }
 
 math::Vector mono::MeasureString(int font_id, const char* text)
 {
     const FontData& font_data = g_fonts.find(font_id)->second;
-    const uint32_t text_length = std::strlen(text);
-
-    math::Vector size;
-    
-    for(uint32_t index = 0; index < text_length; ++index)
-    {
-        const char text_char = text[index];
-        const uint32_t char_index = static_cast<uint32_t>(text_char);
-
-        // For the correct char we need to add base to the index.
-        const uint32_t offset_index = char_index - g_base;
-        const CharData& data = font_data.chars[offset_index];
-
-        if(index == text_length -1)
-            size.x += data.width;
-        else
-            size.x += data.xadvance;
-        size.y = std::max(data.height, size.y);
-    }
-
-    return size;
+    const math::Quad bounds = MeasureGlyphBounds(font_data, text, text + std::strlen(text));
+    return math::Vector(math::Width(bounds), math::Height(bounds));
 }
@@ -8,11 +8,12 @@
 
 namespace mono
 {
-    //! Loads a font
+    //! Loads a font, the glyphs are rasterized as signed distance fields into an atlas shared by all fonts.
+    //! Printable ascii is rasterized on load, any other character the first time it is used.
     //! @param font_id The id of the font that you specify
     //! @param font Font file to use
-    //! @param size Size of the font on the generated bitmap
-    //! @param scale Scale of font when drawing with opengl (small font sizes can produce bad quality)
+    //! @param size Pixel height of the font, sets the size of the glyphs together with scale
+    //! @param scale Scale of font when drawing with opengl
     void LoadFont(int font_id, const char* font_file, float size, float scale);
     void LoadFontRaw(int font_id, const unsigned char* data_bytes, int data_size, float size, float scale);
 
@@ -21,6 +22,33 @@ namespace mono
     //! Get the loaded font texture, might be nullptr if no texture is loaded.
     ITexturePtr GetFontTexture(int font_id);
 
+    //! Clears the glyph atlas if a glyph did not fit since the last call, and rasterizes printable ascii again.
+    //! Texture coordinates generated before a rebuild point into the old atlas, TextLayoutCache lays its runs out
+    //! again when GlyphAtlasGeneration changes. Should be called once per frame before any text is laid out.
+    //! Returns true if the atlas was rebuilt.
+    bool RebuildGlyphAtlasIfFull();
+
+    //! Incremented by each rebuild of the glyph atlas.
+    uint32_t GlyphAtlasGeneration();
+
+    //! Uploads glyphs rasterized since the last call, should be called on the render thread once per frame.
+    void UploadGlyphAtlas();
+
     TextDefinition GenerateVertexDataFromString(int font_id, const char* text, FontCentering center_flags);
+
+    //! Writes four vertices and four uv coordinates per character, the out arrays need room for 4 * text_length.
+    //! The text is utf-8, returns the number of glyphs written which is less than text_length for multi byte
+    //! characters.
+    uint32_t GenerateGlyphQuads(
+        int font_id,
+        const char* text,
+        uint32_t text_length,
+        FontCentering center_flags,
+        math::Vector* out_vertices,
+        math::Vector* out_uvs);
+
+    //! Writes the indices for 'n_glyphs' quads generated by GenerateGlyphQuads, six per glyph.
+    void GenerateGlyphIndices(uint32_t n_glyphs, uint16_t* out_indices);
+
     math::Vector MeasureString(int font_id, const char* text);
 }
@@ -0,0 +1,268 @@
+
+#include "TextLayoutCache.h"
+#include "TextFunctions.h"
+#include "System/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <limits>
+
+using namespace mono;
+
+namespace
+{
+    constexpr uint32_t VERTICES_PER_GLYPH = 4;
+
+    uint64_t MakeRunKey(int font_id, uint32_t text_hash, mono::FontCentering center_flags)
+    {
+        const uint32_t font_and_flags = (uint32_t(font_id) << 8) | uint32_t(center_flags);
+        return (uint64_t(font_and_flags) << 32) | text_hash;
+    }
+}
+
+TextLayoutCache::TextLayoutCache(uint32_t initial_glyph_capacity)
+    : m_tick(0)
+    , m_atlas_generation(mono::GlyphAtlasGeneration())
+{
+    Grow(initial_glyph_capacity);
+}
+
+uint32_t TextLayoutCache::Acquire(int font_id, const char* text, mono::FontCentering center_flags)
+{
+    const uint32_t text_length = std::strlen(text);
+    const uint64_t key = MakeRunKey(font_id, hash::Hash(text, text_length), center_flags);
+
+    Refresh();
+    m_tick++;
+
+    const auto range = m_run_lookup.equal_range(key);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        CachedRun& cached_run = m_runs[it->second];
+        if(cached_run.font_id == font_id && cached_run.center_flags == center_flags && cached_run.text == text)
+        {
+            cached_run.ref_count++;
+            cached_run.last_used = m_tick;
+            return it->second;
+        }
+    }
+
+    uint32_t vertex_offset = 0;
+    uint32_t n_glyphs = 0;
+    if(text_length > 0)
+    {
+        // Room for one glyph per byte, the part not used by multi byte characters is given back.
+        uint32_t glyph_offset = 0;
+        while(!AllocateGlyphs(text_length, glyph_offset))
+        {
+            if(!EvictLeastRecentlyUsed())
+                Grow(text_length);
+        }
+
+        vertex_offset = glyph_offset * VERTICES_PER_GLYPH;
+        n_glyphs = mono::GenerateGlyphQuads(
+            font_id, text, text_length, center_flags, m_vertices.data() + vertex_offset, m_uvs.data() + vertex_offset);
+        FreeGlyphs(glyph_offset + n_glyphs, text_length - n_glyphs);
+    }
+
+    uint32_t run_id;
+    if(m_free_run_ids.empty())
+    {
+        run_id = m_runs.size();
+        m_runs.emplace_back();
+    }
+    else
+    {
+        run_id = m_free_run_ids.back();
+        m_free_run_ids.pop_back();
+    }
+
+    CachedRun& cached_run = m_runs[run_id];
+    cached_run.run = { vertex_offset, n_glyphs };
+    cached_run.key = key;
+    cached_run.font_id = font_id;
+    cached_run.center_flags = center_flags;
+    cached_run.ref_count = 1;
+    cached_run.last_used = m_tick;
+    cached_run.text = text;
+
+    m_run_lookup.insert(std::make_pair(key, run_id));
+
+    return run_id;
+}
+
+void TextLayoutCache::Release(uint32_t run_id)
+{
+    CachedRun& cached_run = m_runs[run_id];
+    assert(cached_run.ref_count > 0);
+    cached_run.ref_count--;
+
+    if(cached_run.ref_count == 0 && cached_run.run.n_glyphs == 0)
+        RemoveRun(run_id);
+}
+
+void TextLayoutCache::Refresh()
+{
+    const uint32_t atlas_generation = mono::GlyphAtlasGeneration();
+    if(atlas_generation == m_atlas_generation)
+        return;
+
+    m_atlas_generation = atlas_generation;
+
+    // Unreferenced runs are dropped so that their glyphs are not rasterized again. The same string decodes to
+    // the same number of glyphs, so the other runs fit in their old place.
+    for(uint32_t run_id = 0; run_id < m_runs.size(); ++run_id)
+    {
+        CachedRun& cached_run = m_runs[run_id];
+        const GlyphRun& run = cached_run.run;
+        if(run.n_glyphs == 0)
+            continue;
+
+        if(cached_run.ref_count == 0)
+        {
+            FreeGlyphs(run.vertex_offset / VERTICES_PER_GLYPH, run.n_glyphs);
+            RemoveRun(run_id);
+            continue;
+        }
+
+        const uint32_t n_glyphs = mono::GenerateGlyphQuads(
+            cached_run.font_id,
+            cached_run.text.c_str(),
+            cached_run.text.size(),
+            cached_run.center_flags,
+            m_vertices.data() + run.vertex_offset,
+            m_uvs.data() + run.vertex_offset);
+        assert(n_glyphs == run.n_glyphs);
+        (void)n_glyphs;
+    }
+}
+
+const GlyphRun& TextLayoutCache::Run(uint32_t run_id) const
+{
+    return m_runs[run_id].run;
+}
+
+const math::Vector* TextLayoutCache::Vertices() const
+{
+    return m_vertices.data();
+}
+
+const math::Vector* TextLayoutCache::UVs() const
+{
+    return m_uvs.data();
+}
+
+uint32_t TextLayoutCache::CachedRuns() const
+{
+    return m_runs.size() - m_free_run_ids.size();
+}
+
+uint32_t TextLayoutCache::GlyphCapacity() const
+{
+    return m_vertices.size() / VERTICES_PER_GLYPH;
+}
+
+bool TextLayoutCache::AllocateGlyphs(uint32_t n_glyphs, uint32_t& out_offset)
+{
+    // First fit, the ranges are kept sorted on offset.
+    for(auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it)
+    {
+        if(it->n_glyphs < n_glyphs)
+            continue;
+
+        out_offset = it->offset;
+        it->offset += n_glyphs;
+        it->n_glyphs -= n_glyphs;
+        if(it->n_glyphs == 0)
+            m_free_ranges.erase(it);
+
+        return true;
+    }
+
+    return false;
+}
+
+void TextLayoutCache::FreeGlyphs(uint32_t offset, uint32_t n_glyphs)
+{
+    if(n_glyphs == 0)
+        return;
+
+    const auto find_func = [](const FreeRange& range, uint32_t offset) {
+        return range.offset < offset;
+    };
+    auto it = std::lower_bound(m_free_ranges.begin(), m_free_ranges.end(), offset, find_func);
+    it = m_free_ranges.insert(it, { offset, n_glyphs });
+
+    // Merge with the following and then the previous range.
+    const auto next_it = it + 1;
+    if(next_it != m_free_ranges.end() && (it->offset + it->n_glyphs) == next_it->offset)
+    {
+        it->n_glyphs += next_it->n_glyphs;
+        m_free_ranges.erase(next_it);
+    }
+
+    if(it != m_free_ranges.begin())
+    {
+        const auto previous_it = it - 1;
+        if((previous_it->offset + previous_it->n_glyphs) == it->offset)
+        {
+            previous_it->n_glyphs += it->n_glyphs;
+            m_free_ranges.erase(it);
+        }
+    }
+}
+
+bool TextLayoutCache::EvictLeastRecentlyUsed()
+{
+    uint32_t evict_id = m_runs.size();
+    uint32_t oldest = std::numeric_limits<uint32_t>::max();
+
+    for(uint32_t run_id = 0; run_id < m_runs.size(); ++run_id)
+    {
+        const CachedRun& cached_run = m_runs[run_id];
+        if(cached_run.ref_count == 0 && cached_run.run.n_glyphs > 0 && cached_run.last_used < oldest)
+        {
+            evict_id = run_id;
+            oldest = cached_run.last_used;
+        }
+    }
+
+    if(evict_id == m_runs.size())
+        return false;
+
+    const CachedRun& cached_run = m_runs[evict_id];
+    FreeGlyphs(cached_run.run.vertex_offset / VERTICES_PER_GLYPH, cached_run.run.n_glyphs);
+    RemoveRun(evict_id);
+
+    return true;
+}
+
+void TextLayoutCache::RemoveRun(uint32_t run_id)
+{
+    CachedRun& cached_run = m_runs[run_id];
+
+    const auto range = m_run_lookup.equal_range(cached_run.key);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        if(it->second == run_id)
+        {
+            m_run_lookup.erase(it);
+            break;
+        }
+    }
+
+    cached_run.run = { 0, 0 };
+    cached_run.text.clear();
+    m_free_run_ids.push_back(run_id);
+}
+
+void TextLayoutCache::Grow(uint32_t min_glyphs)
+{
+    const uint32_t old_capacity = GlyphCapacity();
+    const uint32_t new_capacity = std::max(old_capacity * 2, old_capacity + min_glyphs);
+
+    m_vertices.resize(new_capacity * VERTICES_PER_GLYPH);
+    m_uvs.resize(new_capacity * VERTICES_PER_GLYPH);
+    FreeGlyphs(old_capacity, new_capacity - old_capacity);
+}
@@ -0,0 +1,84 @@
+
+#pragma once
+
+#include "TextFlags.h"
+#include "Math/Vector.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+namespace mono
+{
+    //! A laid out string, four vertices per glyph in the arena of the cache, in text local space.
+    struct GlyphRun
+    {
+        uint32_t vertex_offset;
+        uint32_t n_glyphs;
+    };
+
+    //! Caches the glyph quads of strings keyed on font, string and centering. All runs share one vertex and
+    //! uv arena, runs are reference counted and unreferenced runs are evicted least recently used first when
+    //! the arena runs out of space. Runs without glyphs, like empty strings, are removed on their last release
+    //! since there is nothing to keep. Looking up a cached run does not allocate.
+    class TextLayoutCache
+    {
+    public:
+
+        TextLayoutCache(uint32_t initial_glyph_capacity);
+
+        //! Returns the id of the run for the string, it is laid out if not already cached. The run stays valid
+        //! until a matching Release.
+        uint32_t Acquire(int font_id, const char* text, mono::FontCentering center_flags);
+        void Release(uint32_t run_id);
+
+        //! Lays out the referenced runs again if the glyph atlas has been rebuilt since they were laid out, their
+        //! ids and vertex offsets stay the same. Unreferenced runs are evicted. Acquire does this as well, call it
+        //! once per frame before reading runs that are held on to.
+        void Refresh();
+
+        //! The arena pointers are valid until the next call to Acquire.
+        const GlyphRun& Run(uint32_t run_id) const;
+        const math::Vector* Vertices() const;
+        const math::Vector* UVs() const;
+
+        uint32_t CachedRuns() const;
+        uint32_t GlyphCapacity() const;
+
+    private:
+
+        struct CachedRun
+        {
+            GlyphRun run;
+            uint64_t key;
+            int font_id;
+            mono::FontCentering center_flags;
+            uint32_t ref_count;
+            uint32_t last_used;
+            std::string text;
+        };
+
+        struct FreeRange
+        {
+            uint32_t offset;
+            uint32_t n_glyphs;
+        };
+
+        bool AllocateGlyphs(uint32_t n_glyphs, uint32_t& out_offset);
+        void FreeGlyphs(uint32_t offset, uint32_t n_glyphs);
+        bool EvictLeastRecentlyUsed();
+        void RemoveRun(uint32_t run_id);
+        void Grow(uint32_t min_glyphs);
+
+        uint32_t m_tick;
+        uint32_t m_atlas_generation;
+        std::vector<math::Vector> m_vertices;
+        std::vector<math::Vector> m_uvs;
+        std::vector<FreeRange> m_free_ranges;
+
+        std::vector<CachedRun> m_runs;
+        std::vector<uint32_t> m_free_run_ids;
+        std::unordered_multimap<uint64_t, uint32_t> m_run_lookup;
+    };
+}
@@ -10,6 +10,7 @@
 #include "System/Hash.h"
 
 using namespace mono;
+using namespace hash::literals;
 
 TextSystem::TextSystem(uint32_t n, mono::TransformSystem* transform_system)
     : m_transform_system(transform_system)
@@ -38,7 +39,8 @@ void TextSystem::SetTextData(uint32_t id, const mono::TextComponent& text_data)
 
 uint32_t TextSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "textsystem"_hash;
+    return system_id;
 }
 
 const char* TextSystem::Name() const
@@ -9,6 +9,24 @@ namespace mono
 {
     using ITexturePtr = std::shared_ptr<class ITexture>;
 
+    enum class TextureLoadPriority
+    {
+        LOW,
+        NORMAL,
+        HIGH
+    };
+
+    enum class TextureSampler
+    {
+        DEFAULT,        // The factory default, RenderInitParams::texture_sampler
+        NEAREST,        // Nearest, no mips, repeat
+        NEAREST_MIPMAP, // Nearest magnification, mipmapped minification, repeat. Keeps pixel art sharp when zoomed in
+                        // and samples a smaller mip level when zoomed out
+        LINEAR,         // Linear, no mips, repeat
+        LINEAR_MIPMAP,  // Trilinear, clamp to edge, for sprite sheets
+        REPEAT          // Trilinear, repeat, for tiled backgrounds and terrain
+    };
+
     class ITextureFactory
     {
     public:
@@ -16,14 +34,30 @@ namespace mono
         virtual ~ITextureFactory() = default;
 
         //! Create a texture from disk, only PNG is supported at the moment
-        virtual ITexturePtr CreateTexture(const char* texture_name) const = 0;
+        virtual ITexturePtr CreateTexture(const char* texture_name, TextureSampler sampler = TextureSampler::DEFAULT) const = 0;
+
+        //! Create a texture from disk, the image is decoded on a worker thread and uploaded at a frame boundary.
+        //! Until then the returned texture is a placeholder with the correct size.
+        virtual ITexturePtr CreateTextureAsync(
+            const char* texture_name, TextureLoadPriority priority, TextureSampler sampler = TextureSampler::DEFAULT) const = 0;
+
+        //! Upload the textures that has finished decoding, should be called on the render thread once per frame.
+        virtual void UploadPendingTextures() const = 0;
 
         // 'cache_name' can be nullptr, then it will not be stored in the cache.
         virtual ITexturePtr CreateTextureFromData(const byte* data, int data_length, const char* cache_name) const = 0;
 
-        //! Create a texture from memory
-        virtual ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components) const = 0;
+        //! Create a texture from memory, the default sampler is nearest with repeat.
+        virtual ITexturePtr CreateTexture(
+            const byte* data, int width, int height, int color_components, TextureSampler sampler = TextureSampler::DEFAULT) const = 0;
 
         virtual ITexturePtr CreateFromNativeHandle(uint32_t native_handle) const = 0;
+
+        //! Create an empty texture with linear filtering that can be updated from the cpu, at most once per frame.
+        virtual ITexturePtr CreateDynamicTexture(int width, int height, int color_components) const = 0;
+
+        //! Replace the image of a texture created with CreateDynamicTexture, the data covers the whole texture.
+        //! Keep a cpu copy and call this at most once per frame and texture.
+        virtual void UpdateDynamicTexture(ITexture* texture, const byte* data) const = 0;
     };
 }
@@ -0,0 +1,78 @@
+
+#include "NoiseTexture.h"
+#include "Rendering/RenderSystem.h"
+#include "System/Hash.h"
+#include "Util/Noise.h"
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace mono;
+
+namespace
+{
+    // Each octave doubles the frequency so that every octave tiles with the texture.
+    constexpr float TILING_LACUNARITY = 2.0f;
+
+    std::unordered_map<uint32_t, std::weak_ptr<mono::ITexture>> g_noise_textures;
+
+    uint32_t HashParams(const NoiseTextureParams& params)
+    {
+        uint32_t gain_bits;
+        std::memcpy(&gain_bits, &params.gain, sizeof(float));
+
+        const uint32_t values[] = { params.size, params.cells, uint32_t(params.octaves), gain_bits };
+        return hash::Hash((const char*)values, sizeof(values));
+    }
+}
+
+mono::ITexturePtr mono::GetNoiseTexture(const NoiseTextureParams& params, JobPool* job_pool)
+{
+    const uint32_t params_hash = HashParams(params);
+
+    const auto it = g_noise_textures.find(params_hash);
+    if(it != g_noise_textures.end())
+    {
+        mono::ITexturePtr texture = it->second.lock();
+        if(texture)
+            return texture;
+    }
+
+    mono::NoiseGrid grid;
+    grid.step = math::Vector(float(params.cells) / float(params.size), float(params.cells) / float(params.size));
+    grid.width = params.size;
+    grid.height = params.size;
+    grid.wrap = params.cells;
+    grid.octaves = params.octaves;
+    grid.lacunarity = TILING_LACUNARITY;
+    grid.gain = params.gain;
+
+    std::vector<float> noise(params.size * params.size);
+    mono::Noise::PerlinGrid(grid, noise.data(), job_pool);
+
+    float total_amplitude = 0.0f;
+    float amplitude = 1.0f;
+    for(int octave = 0; octave < params.octaves; ++octave)
+    {
+        total_amplitude += amplitude;
+        amplitude *= params.gain;
+    }
+
+    const float scale = (total_amplitude > 0.0f) ? 0.5f / total_amplitude : 0.0f;
+
+    std::vector<byte> pixels(noise.size());
+    for(size_t index = 0; index < noise.size(); ++index)
+    {
+        const float value = std::clamp(noise[index] * scale + 0.5f, 0.0f, 1.0f);
+        pixels[index] = byte(value * 255.0f + 0.5f);
+    }
+
+    mono::ITexturePtr texture =
+        mono::GetTextureFactory()->CreateTexture(pixels.data(), params.size, params.size, 1, TextureSampler::REPEAT);
+    g_noise_textures[params_hash] = texture;
+
+    return texture;
+}
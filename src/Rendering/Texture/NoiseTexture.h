@@ -0,0 +1,22 @@
+
+#pragma once
+
+#include "ITextureFactory.h"
+#include <cstdint>
+
+namespace mono
+{
+    class JobPool;
+
+    struct NoiseTextureParams
+    {
+        uint32_t size = 256;    // Width and height in pixels
+        uint32_t cells = 8;     // Lattice cells across the texture, a power of two up to 256
+        int octaves = 4;
+        float gain = 0.5f;
+    };
+
+    //! Perlin fbm baked into a single channel texture that tiles, sampled linear with repeat. The noise is
+    //! mapped from [-1, 1] to [0, 1]. Textures are cached on the parameters and shared while they are in use.
+    mono::ITexturePtr GetNoiseTexture(const NoiseTextureParams& params, JobPool* job_pool = nullptr);
+}
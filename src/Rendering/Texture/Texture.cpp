@@ -5,35 +5,144 @@
 
 using namespace mono;
 
+namespace
+{
+    void ApplySampler(sg_image_desc& image_desc, TextureSampler sampler, uint32_t n_mips)
+    {
+        switch(sampler)
+        {
+        case TextureSampler::DEFAULT:
+        case TextureSampler::NEAREST:
+            image_desc.min_filter = SG_FILTER_NEAREST;
+            image_desc.mag_filter = SG_FILTER_NEAREST;
+            image_desc.wrap_u = SG_WRAP_REPEAT;
+            image_desc.wrap_v = SG_WRAP_REPEAT;
+            break;
+        case TextureSampler::NEAREST_MIPMAP:
+            image_desc.min_filter = (n_mips > 1) ? SG_FILTER_NEAREST_MIPMAP_LINEAR : SG_FILTER_NEAREST;
+            image_desc.mag_filter = SG_FILTER_NEAREST;
+            image_desc.wrap_u = SG_WRAP_REPEAT;
+            image_desc.wrap_v = SG_WRAP_REPEAT;
+            break;
+        case TextureSampler::LINEAR:
+            image_desc.min_filter = SG_FILTER_LINEAR;
+            image_desc.mag_filter = SG_FILTER_LINEAR;
+            image_desc.wrap_u = SG_WRAP_REPEAT;
+            image_desc.wrap_v = SG_WRAP_REPEAT;
+            break;
+        case TextureSampler::LINEAR_MIPMAP:
+            image_desc.min_filter = (n_mips > 1) ? SG_FILTER_LINEAR_MIPMAP_LINEAR : SG_FILTER_LINEAR;
+            image_desc.mag_filter = SG_FILTER_LINEAR;
+            image_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+            image_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+            break;
+        case TextureSampler::REPEAT:
+            image_desc.min_filter = (n_mips > 1) ? SG_FILTER_LINEAR_MIPMAP_LINEAR : SG_FILTER_LINEAR;
+            image_desc.mag_filter = SG_FILTER_LINEAR;
+            image_desc.wrap_u = SG_WRAP_REPEAT;
+            image_desc.wrap_v = SG_WRAP_REPEAT;
+            break;
+        }
+    }
+
+    // Only the uncompressed formats can be dynamic.
+    uint32_t BytesPerPixel(TextureFormat format)
+    {
+        switch(format)
+        {
+        case TextureFormat::R8:
+            return 1;
+        case TextureFormat::RG8:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+}
+
+sg_pixel_format mono::ToPixelFormat(TextureFormat format)
+{
+    switch(format)
+    {
+    case TextureFormat::R8:
+        return SG_PIXELFORMAT_R8;
+    case TextureFormat::RG8:
+        return SG_PIXELFORMAT_RG8;
+    case TextureFormat::RGBA8:
+        return SG_PIXELFORMAT_RGBA8;
+    case TextureFormat::BC1_RGBA:
+        return SG_PIXELFORMAT_BC1_RGBA;
+    case TextureFormat::BC3_RGBA:
+        return SG_PIXELFORMAT_BC3_RGBA;
+    case TextureFormat::ETC2_RGB8:
+        return SG_PIXELFORMAT_ETC2_RGB8;
+    case TextureFormat::ETC2_RGBA8:
+        return SG_PIXELFORMAT_ETC2_RGBA8;
+    case TextureFormat::N_FORMATS:
+        break;
+    }
+
+    return SG_PIXELFORMAT_NONE;
+}
+
+uint32_t mono::QuerySupportedTextureFormats()
+{
+    uint32_t supported_formats = 0;
+
+    for(uint32_t index = 0; index < uint32_t(TextureFormat::N_FORMATS); ++index)
+    {
+        const TextureFormat format = TextureFormat(index);
+        const sg_pixelformat_info info = sg_query_pixelformat(ToPixelFormat(format));
+        if(info.sample)
+            supported_formats |= TextureFormatBit(format);
+    }
+
+    return supported_formats;
+}
+
 TextureImpl::TextureImpl(
     uint32_t width, uint32_t height, uint32_t color_components, const unsigned char* image_data)
+    : m_pending(true)
+    , m_sampler(TextureSampler::NEAREST)
+    , m_dynamic_bytes(0)
+{
+    SetImageData(MakeTextureImage(width, height, color_components, image_data));
+}
+
+TextureImpl::TextureImpl(const TextureImageData& image, TextureSampler sampler)
+    : m_pending(true)
+    , m_sampler(sampler)
+    , m_dynamic_bytes(0)
+{
+    SetImageData(image);
+}
+
+TextureImpl::TextureImpl(uint32_t width, uint32_t height, TextureFormat format, TextureSampler sampler)
     : m_width(width)
     , m_height(height)
+    , m_pending(false)
+    , m_sampler(sampler)
+    , m_dynamic_bytes(width * height * BytesPerPixel(format))
 {
-    sg_pixel_format data_format = SG_PIXELFORMAT_R8;
-    if(color_components == 2)
-        data_format = SG_PIXELFORMAT_RG8;
-    //else if(color_components == 3)
-    //    data_format = SG_PIXELFORMAT_RGB8;
-    else if(color_components == 4)
-        data_format = SG_PIXELFORMAT_RGBA8;
-
     sg_image_desc image_desc = {};
     image_desc.width = width;
     image_desc.height = height;
-    image_desc.pixel_format = data_format;
-    image_desc.data.subimage[0][0].ptr = image_data;
-    image_desc.data.subimage[0][0].size = width * height * color_components * sizeof(unsigned char);
+    image_desc.pixel_format = ToPixelFormat(format);
+    image_desc.usage = SG_USAGE_DYNAMIC;
+    ApplySampler(image_desc, sampler, 1);
 
     m_handle = sg_make_image(&image_desc);
 
     const sg_resource_state state = sg_query_image_state(m_handle);
     if(state != SG_RESOURCESTATE_VALID)
-        System::Log("Failed to create texture.");
+        System::Log("Failed to create dynamic texture.");
 }
 
 TextureImpl::TextureImpl(sg_image image_handle)
     : m_handle(image_handle)
+    , m_pending(false)
+    , m_sampler(TextureSampler::DEFAULT)
+    , m_dynamic_bytes(0)
 {
     const sg_resource_state state = sg_query_image_state(m_handle);
     if(state != SG_RESOURCESTATE_VALID)
@@ -44,9 +153,64 @@ TextureImpl::TextureImpl(sg_image image_handle)
     m_height = info.height;
 }
 
+TextureImpl::TextureImpl(
+    uint32_t width, uint32_t height, sg_image placeholder_handle, TextureSampler sampler)
+    : m_width(width)
+    , m_height(height)
+    , m_handle(placeholder_handle)
+    , m_pending(true)
+    , m_sampler(sampler)
+    , m_dynamic_bytes(0)
+{ }
+
 TextureImpl::~TextureImpl()
 {
-    sg_destroy_image(m_handle);
+    if(!m_pending)
+        sg_destroy_image(m_handle);
+}
+
+void TextureImpl::SetImageData(const TextureImageData& image)
+{
+    sg_image_desc image_desc = {};
+    image_desc.width = image.width;
+    image_desc.height = image.height;
+    image_desc.pixel_format = ToPixelFormat(image.format);
+
+    // Only upload the mip chain if the sampler is going to use it.
+    const bool use_mips =
+        (m_sampler == TextureSampler::NEAREST_MIPMAP || m_sampler == TextureSampler::LINEAR_MIPMAP || m_sampler == TextureSampler::REPEAT);
+    const uint32_t n_mips = use_mips ? image.n_mips : 1;
+    image_desc.num_mipmaps = n_mips;
+
+    ApplySampler(image_desc, m_sampler, n_mips);
+
+    for(uint32_t index = 0; index < n_mips; ++index)
+    {
+        image_desc.data.subimage[0][index].ptr = image.mip_data[index];
+        image_desc.data.subimage[0][index].size = image.mip_size[index];
+    }
+
+    m_width = image.width;
+    m_height = image.height;
+    m_handle = sg_make_image(&image_desc);
+    m_pending = false;
+
+    const sg_resource_state state = sg_query_image_state(m_handle);
+    if(state != SG_RESOURCESTATE_VALID)
+        System::Log("Failed to create texture.");
+}
+
+void TextureImpl::UpdateImage(const unsigned char* image_data)
+{
+    sg_image_data data = {};
+    data.subimage[0][0].ptr = image_data;
+    data.subimage[0][0].size = m_dynamic_bytes;
+    sg_update_image(m_handle, &data);
+}
+
+bool TextureImpl::IsPending() const
+{
+    return m_pending;
 }
 
 uint32_t TextureImpl::Width() const
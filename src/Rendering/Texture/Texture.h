@@ -2,10 +2,17 @@
 #pragma once
 
 #include "ITexture.h"
+#include "ITextureFactory.h"
+#include "TextureCache.h"
 #include "sokol/sokol_gfx.h"
 
 namespace mono
 {
+    sg_pixel_format ToPixelFormat(TextureFormat format);
+
+    //! Bit mask of TextureFormatBit for the formats that the current backend can sample from.
+    uint32_t QuerySupportedTextureFormats();
+
     class TextureImpl : public ITexture
     {
     public:
@@ -15,9 +22,21 @@ namespace mono
             uint32_t height,
             uint32_t color_components,
             const unsigned char* image_data);
+        TextureImpl(const TextureImageData& image, TextureSampler sampler);
         TextureImpl(sg_image image_handle);
+
+        //! Creates an empty texture that is updated with UpdateImage.
+        TextureImpl(uint32_t width, uint32_t height, TextureFormat format, TextureSampler sampler);
+
+        //! Creates a pending texture that uses the placeholder image until SetImageData is called.
+        TextureImpl(uint32_t width, uint32_t height, sg_image placeholder_handle, TextureSampler sampler);
         ~TextureImpl();
 
+        void SetImageData(const TextureImageData& image);
+        //! Replaces the whole image of a dynamic texture, sokol allows this at most once per frame.
+        void UpdateImage(const unsigned char* image_data);
+        bool IsPending() const;
+
         uint32_t Width() const override;
         uint32_t Height() const override;
         uint32_t Id() const override;
@@ -25,6 +44,9 @@ namespace mono
         uint32_t m_width;
         uint32_t m_height;
         sg_image m_handle;
+        bool m_pending;
+        TextureSampler m_sampler;
+        uint32_t m_dynamic_bytes;
     };
 }
 
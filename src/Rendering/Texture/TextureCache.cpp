@@ -0,0 +1,436 @@
+
+#include "TextureCache.h"
+#include "System/File.h"
+#include "System/Hash.h"
+#include "System/System.h"
+
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MONO_MIPS_SSE2
+    #include <emmintrin.h>
+#endif
+
+using namespace mono;
+
+namespace
+{
+    constexpr uint32_t CACHE_MAGIC = 0x5845544d; // 'MTEX'
+    constexpr uint32_t CACHE_VERSION = 3;
+    constexpr uint32_t CACHE_DATA_ALIGNMENT = 16;
+
+    // The source path follows the header, the mip data comes after it.
+    struct TextureCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint32_t path_size;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t n_mips;
+        uint32_t mip_offset[mono::MAX_TEXTURE_MIPS];
+        uint32_t mip_size[mono::MAX_TEXTURE_MIPS];
+    };
+
+    std::filesystem::path MakeCacheFilename(const char* cache_directory, const mono::TextureCacheKey& key)
+    {
+        const uint32_t path_hash = hash::Hash(key.path.c_str(), key.path.size());
+
+        char filename[32] = { 0 };
+        std::snprintf(filename, std::size(filename), "%08x.mtex", path_hash);
+        return std::filesystem::path(cache_directory) / filename;
+    }
+
+    uint32_t AlignOffset(uint32_t offset)
+    {
+        return (offset + CACHE_DATA_ALIGNMENT - 1) & ~(CACHE_DATA_ALIGNMENT - 1);
+    }
+
+    uint32_t ComponentsForFormat(mono::TextureFormat format)
+    {
+        switch(format)
+        {
+        case mono::TextureFormat::R8:
+            return 1;
+        case mono::TextureFormat::RG8:
+            return 2;
+        case mono::TextureFormat::RGBA8:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    // Zero for an unknown format.
+    uint64_t MipSize(mono::TextureFormat format, uint32_t width, uint32_t height, uint32_t level)
+    {
+        const uint64_t mip_width = std::max(width >> level, 1u);
+        const uint64_t mip_height = std::max(height >> level, 1u);
+
+        const uint32_t components = ComponentsForFormat(format);
+        if(components > 0)
+            return mip_width * mip_height * components;
+
+        const uint64_t n_blocks = ((mip_width + 3) / 4) * ((mip_height + 3) / 4);
+
+        switch(format)
+        {
+        case mono::TextureFormat::BC1_RGBA:
+        case mono::TextureFormat::ETC2_RGB8:
+            return n_blocks * 8;
+        case mono::TextureFormat::BC3_RGBA:
+        case mono::TextureFormat::ETC2_RGBA8:
+            return n_blocks * 16;
+        default:
+            return 0;
+        }
+    }
+
+    void DownsampleBox(
+        const byte* source, uint32_t source_width, uint32_t source_height,
+        byte* target, uint32_t target_width, uint32_t target_height,
+        uint32_t components)
+    {
+        const uint32_t source_stride = source_width * components;
+
+        for(uint32_t y = 0; y < target_height; ++y)
+        {
+            const byte* row0 = source + std::min(y * 2 + 0, source_height - 1) * source_stride;
+            const byte* row1 = source + std::min(y * 2 + 1, source_height - 1) * source_stride;
+            byte* target_row = target + y * target_width * components;
+
+            uint32_t x = 0;
+
+#ifdef MONO_MIPS_SSE2
+            if(components == 4 && source_width > 1)
+            {
+                // Four target pixels at a time. The four source texels are summed in 16 bits and rounded as
+                // (sum + 2) / 4, the same as the scalar loop below, so both paths produce identical mips.
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i rounding = _mm_set1_epi16(2);
+
+                // Two target pixels from 16 bytes of each source row.
+                const auto sum_box = [zero](__m128i source0, __m128i source1) {
+                    const __m128i pixels_01 =
+                        _mm_add_epi16(_mm_unpacklo_epi8(source0, zero), _mm_unpacklo_epi8(source1, zero));
+                    const __m128i pixels_23 =
+                        _mm_add_epi16(_mm_unpackhi_epi8(source0, zero), _mm_unpackhi_epi8(source1, zero));
+                    return _mm_add_epi16(_mm_unpacklo_epi64(pixels_01, pixels_23), _mm_unpackhi_epi64(pixels_01, pixels_23));
+                };
+
+                for(; (x + 4) * 2 <= source_width; x += 4)
+                {
+                    const __m128i row0_lo = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+                    const __m128i row0_hi = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+                    const __m128i row1_lo = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+                    const __m128i row1_hi = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+                    const __m128i sum_lo = _mm_add_epi16(sum_box(row0_lo, row1_lo), rounding);
+                    const __m128i sum_hi = _mm_add_epi16(sum_box(row0_hi, row1_hi), rounding);
+
+                    const __m128i result = _mm_packus_epi16(_mm_srli_epi16(sum_lo, 2), _mm_srli_epi16(sum_hi, 2));
+                    _mm_storeu_si128((__m128i*)(target_row + x * 4), result);
+                }
+            }
+#endif
+
+            for(; x < target_width; ++x)
+            {
+                const uint32_t x0 = std::min(x * 2 + 0, source_width - 1) * components;
+                const uint32_t x1 = std::min(x * 2 + 1, source_width - 1) * components;
+
+                for(uint32_t component = 0; component < components; ++component)
+                {
+                    const uint32_t sum =
+                        row0[x0 + component] + row0[x1 + component] + row1[x0 + component] + row1[x1 + component];
+                    target_row[x * components + component] = (sum + 2) / 4;
+                }
+            }
+        }
+    }
+}
+
+mono::TextureImageData mono::MakeTextureImage(uint32_t width, uint32_t height, uint32_t color_components, const byte* data)
+{
+    mono::TextureImageData image;
+    image.width = width;
+    image.height = height;
+    image.n_mips = 1;
+
+    if(color_components == 3)
+    {
+        const uint32_t n_pixels = width * height;
+        byte* rgba_data = new byte[n_pixels * 4];
+
+        for(uint32_t index = 0; index < n_pixels; ++index)
+        {
+            rgba_data[index * 4 + 0] = data[index * 3 + 0];
+            rgba_data[index * 4 + 1] = data[index * 3 + 1];
+            rgba_data[index * 4 + 2] = data[index * 3 + 2];
+            rgba_data[index * 4 + 3] = 255;
+        }
+
+        image.storage = std::shared_ptr<byte>(rgba_data, std::default_delete<byte[]>());
+        image.mip_data[0] = rgba_data;
+        color_components = 4;
+    }
+    else
+    {
+        image.mip_data[0] = data;
+    }
+
+    image.mip_size[0] = width * height * color_components;
+
+    if(color_components == 1)
+        image.format = TextureFormat::R8;
+    else if(color_components == 2)
+        image.format = TextureFormat::RG8;
+    else
+        image.format = TextureFormat::RGBA8;
+
+    return image;
+}
+
+void mono::GenerateTextureMips(TextureImageData& image)
+{
+    const uint32_t components = ComponentsForFormat(image.format);
+    if(components == 0 || image.n_mips != 1)
+        return;
+
+    uint32_t n_mips = 1;
+    uint32_t total_size = image.mip_size[0];
+    uint32_t mip_width = image.width;
+    uint32_t mip_height = image.height;
+
+    while((mip_width > 1 || mip_height > 1) && n_mips < mono::MAX_TEXTURE_MIPS)
+    {
+        mip_width = std::max(mip_width / 2, 1u);
+        mip_height = std::max(mip_height / 2, 1u);
+        total_size += mip_width * mip_height * components;
+        n_mips++;
+    }
+
+    if(n_mips == 1)
+        return;
+
+    byte* mip_storage = new byte[total_size];
+    std::memcpy(mip_storage, image.mip_data[0], image.mip_size[0]);
+
+    mip_width = image.width;
+    mip_height = image.height;
+
+    byte* mip_data = mip_storage;
+    image.mip_data[0] = mip_data;
+
+    for(uint32_t index = 1; index < n_mips; ++index)
+    {
+        const uint32_t target_width = std::max(mip_width / 2, 1u);
+        const uint32_t target_height = std::max(mip_height / 2, 1u);
+        byte* target_data = mip_data + image.mip_size[index - 1];
+
+        DownsampleBox(mip_data, mip_width, mip_height, target_data, target_width, target_height, components);
+
+        image.mip_data[index] = target_data;
+        image.mip_size[index] = target_width * target_height * components;
+
+        mip_data = target_data;
+        mip_width = target_width;
+        mip_height = target_height;
+    }
+
+    image.n_mips = n_mips;
+    image.storage = std::shared_ptr<byte>(mip_storage, std::default_delete<byte[]>());
+}
+
+mono::TextureImageData mono::DecodeTextureImage(const byte* data, uint32_t data_size)
+{
+    int width;
+    int height;
+    int components;
+    byte* image_data = stbi_load_from_memory(data, data_size, &width, &height, &components, 0);
+    if(!image_data)
+        return mono::TextureImageData();
+
+    const std::shared_ptr<byte> decoded_storage(image_data, stbi_image_free);
+
+    mono::TextureImageData image = MakeTextureImage(width, height, components, image_data);
+    GenerateTextureMips(image);
+
+    if(!image.storage)
+        image.storage = decoded_storage;
+
+    return image;
+}
+
+bool mono::MakeTextureCacheKey(const char* filename, TextureCacheKey& out_key)
+{
+    std::error_code error;
+    const uint64_t source_size = std::filesystem::file_size(filename, error);
+    if(error)
+        return false;
+
+    const std::filesystem::file_time_type source_mtime = std::filesystem::last_write_time(filename, error);
+    if(error)
+        return false;
+
+    out_key.path = filename;
+    out_key.source_size = source_size;
+    out_key.source_mtime = source_mtime.time_since_epoch().count();
+    return true;
+}
+
+mono::TextureImageData mono::LoadTextureImage(const char* filename, const char* cache_directory, uint32_t supported_formats)
+{
+    TextureCacheKey key;
+    const bool use_cache = (cache_directory && MakeTextureCacheKey(filename, key));
+    if(use_cache)
+    {
+        const mono::TextureImageData image = ReadTextureCache(cache_directory, key, supported_formats);
+        if(image.IsValid())
+            return image;
+    }
+
+    const file::FilePtr file = file::OpenBinaryFile(filename);
+    if(!file)
+        return mono::TextureImageData();
+
+    const std::vector<byte> source_data = file::FileRead(file);
+    const mono::TextureImageData image = DecodeTextureImage(source_data.data(), source_data.size());
+    if(use_cache && image.IsValid())
+        WriteTextureCache(cache_directory, key, image);
+
+    return image;
+}
+
+mono::TextureImageData mono::ReadTextureCache(const char* cache_directory, const TextureCacheKey& key, uint32_t supported_formats)
+{
+    mono::TextureImageData image;
+
+    const std::filesystem::path cache_filename = MakeCacheFilename(cache_directory, key);
+    const std::string cache_filename_string = cache_filename.string();
+    const auto mapped_file = std::make_shared<file::MappedFile>(cache_filename_string.c_str());
+    if(!mapped_file->IsValid() || mapped_file->Size() < sizeof(TextureCacheHeader))
+        return image;
+
+    TextureCacheHeader header;
+    std::memcpy(&header, mapped_file->Data(), sizeof(TextureCacheHeader));
+
+    const bool valid_header =
+        header.magic == CACHE_MAGIC &&
+        header.version == CACHE_VERSION &&
+        header.source_size == key.source_size &&
+        header.source_mtime == key.source_mtime &&
+        header.path_size == key.path.size() &&
+        header.format < uint32_t(TextureFormat::N_FORMATS) &&
+        header.width > 0 &&
+        header.height > 0 &&
+        header.n_mips > 0 &&
+        header.n_mips <= mono::MAX_TEXTURE_MIPS;
+    if(!valid_header)
+        return image;
+
+    const uint64_t path_end = uint64_t(sizeof(TextureCacheHeader)) + header.path_size;
+    if(path_end > mapped_file->Size())
+        return image;
+
+    const bool same_path = std::memcmp(mapped_file->Data() + sizeof(TextureCacheHeader), key.path.data(), key.path.size()) == 0;
+    if(!same_path)
+        return image;
+
+    const bool format_supported = (supported_formats & TextureFormatBit(TextureFormat(header.format)));
+    if(!format_supported)
+        return image;
+
+    for(uint32_t index = 0; index < header.n_mips; ++index)
+    {
+        const uint64_t mip_end = uint64_t(header.mip_offset[index]) + header.mip_size[index];
+        if(header.mip_offset[index] < path_end || mip_end > mapped_file->Size())
+            return image;
+
+        const uint64_t expected_size = MipSize(TextureFormat(header.format), header.width, header.height, index);
+        if(header.mip_size[index] != expected_size)
+            return image;
+
+        image.mip_data[index] = mapped_file->Data() + header.mip_offset[index];
+        image.mip_size[index] = header.mip_size[index];
+    }
+
+    image.width = header.width;
+    image.height = header.height;
+    image.format = TextureFormat(header.format);
+    image.n_mips = header.n_mips;
+    image.storage = mapped_file;
+
+    return image;
+}
+
+bool mono::WriteTextureCache(const char* cache_directory, const TextureCacheKey& key, const TextureImageData& image)
+{
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory, error);
+
+    TextureCacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.source_size = key.source_size;
+    header.source_mtime = key.source_mtime;
+    header.path_size = key.path.size();
+    header.format = uint32_t(image.format);
+    header.width = image.width;
+    header.height = image.height;
+    header.n_mips = image.n_mips;
+
+    uint32_t offset = AlignOffset(sizeof(TextureCacheHeader) + header.path_size);
+    for(uint32_t index = 0; index < image.n_mips; ++index)
+    {
+        header.mip_offset[index] = offset;
+        header.mip_size[index] = image.mip_size[index];
+        offset = AlignOffset(offset + image.mip_size[index]);
+    }
+
+    // Write to a temporary file and rename it, so a reader never sees a half written cache file.
+    const std::filesystem::path cache_filename = MakeCacheFilename(cache_directory, key);
+    std::filesystem::path temp_filename = cache_filename;
+    temp_filename += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+    {
+        const std::string temp_filename_string = temp_filename.string();
+        const file::FilePtr file = file::CreateBinaryFile(temp_filename_string.c_str());
+        if(!file)
+            return false;
+
+        constexpr byte padding[CACHE_DATA_ALIGNMENT] = { 0 };
+
+        std::fwrite(&header, sizeof(TextureCacheHeader), 1, file.get());
+        std::fwrite(key.path.data(), 1, key.path.size(), file.get());
+        uint32_t written = sizeof(TextureCacheHeader) + header.path_size;
+
+        for(uint32_t index = 0; index < image.n_mips; ++index)
+        {
+            std::fwrite(padding, 1, header.mip_offset[index] - written, file.get());
+            std::fwrite(image.mip_data[index], 1, image.mip_size[index], file.get());
+            written = header.mip_offset[index] + image.mip_size[index];
+        }
+    }
+
+    std::filesystem::rename(temp_filename, cache_filename, error);
+    if(error)
+    {
+        System::Log("TextureCache|Unable to write cache file '%s'.", cache_filename.string().c_str());
+        std::filesystem::remove(temp_filename, error);
+        return false;
+    }
+
+    return true;
+}
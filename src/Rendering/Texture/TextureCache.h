@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+using byte = unsigned char;
+
+namespace mono
+{
+    enum class TextureFormat : uint32_t
+    {
+        R8,
+        RG8,
+        RGBA8,
+
+        // Block compressed payloads, only produced by offline tools
+        BC1_RGBA,
+        BC3_RGBA,
+        ETC2_RGB8,
+        ETC2_RGBA8,
+
+        N_FORMATS
+    };
+
+    constexpr uint32_t TextureFormatBit(TextureFormat format)
+    {
+        return 1u << uint32_t(format);
+    }
+
+    constexpr uint32_t UNCOMPRESSED_TEXTURE_FORMATS =
+        TextureFormatBit(TextureFormat::R8) | TextureFormatBit(TextureFormat::RG8) | TextureFormatBit(TextureFormat::RGBA8);
+
+    constexpr uint32_t MAX_TEXTURE_MIPS = 16;
+
+    //! Image data ready for upload, the pixels are either owned by a decoded buffer, a mapped cache file or
+    //! by the caller when storage is nullptr.
+    struct TextureImageData
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        TextureFormat format = TextureFormat::RGBA8;
+        uint32_t n_mips = 0;
+        const byte* mip_data[MAX_TEXTURE_MIPS] = {};
+        uint32_t mip_size[MAX_TEXTURE_MIPS] = {};
+        std::shared_ptr<const void> storage;
+
+        bool IsValid() const
+        {
+            return (n_mips > 0 && mip_data[0] != nullptr);
+        }
+
+        uint32_t Bytes() const
+        {
+            uint32_t bytes = 0;
+            for(uint32_t index = 0; index < n_mips; ++index)
+                bytes += mip_size[index];
+            return bytes;
+        }
+    };
+
+    //! Wraps raw pixels, three component images are expanded to RGBA, otherwise the data is referenced.
+    TextureImageData MakeTextureImage(uint32_t width, uint32_t height, uint32_t color_components, const byte* data);
+
+    //! Replaces the image with a copy that has a full mip chain, down to 1x1, built with a 2x2 box filter.
+    //! Only uncompressed images with a single level are touched.
+    void GenerateTextureMips(TextureImageData& image);
+
+    //! Decodes a PNG (or any other stb_image format) from memory, three component images are expanded to RGBA.
+    //! The returned image has a full mip chain.
+    TextureImageData DecodeTextureImage(const byte* data, uint32_t data_size);
+
+    //! Identifies a source file in the texture cache by its path, size and modification time, so that a cache
+    //! hit does not have to read the source file.
+    struct TextureCacheKey
+    {
+        std::string path;
+        uint64_t source_size = 0;
+        int64_t source_mtime = 0;
+    };
+
+    //! Returns false if the file can not be found.
+    bool MakeTextureCacheKey(const char* filename, TextureCacheKey& out_key);
+
+    //! Loads an image file, via the texture cache if 'cache_directory' is not nullptr. A cache entry is written
+    //! the first time the source file is decoded and is used as long as the source file is not changed.
+    //! @param supported_formats Bit mask of TextureFormatBit, cache entries in other formats are ignored.
+    TextureImageData LoadTextureImage(const char* filename, const char* cache_directory, uint32_t supported_formats);
+
+    TextureImageData ReadTextureCache(const char* cache_directory, const TextureCacheKey& key, uint32_t supported_formats);
+    bool WriteTextureCache(const char* cache_directory, const TextureCacheKey& key, const TextureImageData& image);
+}
@@ -1,6 +1,7 @@
 
 #include "TextureFactoryImpl.h"
 #include "Texture.h"
+#include "TextureLoader.h"
 #include "System/Hash.h"
 #include "System/System.h"
 
@@ -12,51 +13,178 @@
 
 using namespace mono;
 
-mono::ITexturePtr TextureFactoryImpl::CreateTexture(const char* texture_name) const
+namespace
+{
+    // The same file with different samplers needs different images, so the cache is keyed on the pair of
+    // name hash and sampler. The name hash is the high half and the sampler the low half, so two pairs can
+    // only map to the same key if they are equal.
+    uint64_t TextureKey(uint32_t name_hash, TextureSampler sampler)
+    {
+        return (uint64_t(name_hash) << 32) | uint64_t(sampler);
+    }
+}
+
+TextureFactoryImpl::TextureFactoryImpl(
+    uint32_t n_loader_threads,
+    uint32_t upload_budget_bytes,
+    const char* cache_directory,
+    TextureSampler default_sampler)
+    : m_n_loader_threads(n_loader_threads)
+    , m_upload_budget_bytes(upload_budget_bytes)
+    , m_cache_directory(cache_directory)
+    , m_supported_formats(mono::QuerySupportedTextureFormats())
+    , m_default_sampler(default_sampler == TextureSampler::DEFAULT ? TextureSampler::NEAREST : default_sampler)
+    , m_placeholder_image{}
+    , m_next_load_id(0)
+{ }
+
+TextureFactoryImpl::~TextureFactoryImpl()
+{
+    m_loader = nullptr;
+
+    if(m_placeholder_image.id != 0)
+        sg_destroy_image(m_placeholder_image);
+}
+
+mono::ITexturePtr TextureFactoryImpl::CreateTexture(const char* texture_name, TextureSampler sampler) const
 {
     if(strlen(texture_name) == 0)
         return nullptr;
 
-    const uint32_t texture_hash = hash::Hash(texture_name);
+    if(sampler == TextureSampler::DEFAULT)
+        sampler = m_default_sampler;
+
+    const uint64_t texture_key = TextureKey(hash::HashRegisterString(texture_name), sampler);
 
-    mono::ITexturePtr texture = GetTextureFromCache(texture_hash);
+    mono::ITexturePtr texture = GetTextureFromCache(texture_key);
     if(texture)
         return texture;
 
     System::Log("TextureFactory|Creating texture '%s'.", texture_name);
-    return CreateAndCacheTexture(texture_name, texture_hash);
+    return CreateAndCacheTexture(texture_name, texture_key, sampler);
+}
+
+mono::ITexturePtr TextureFactoryImpl::CreateTextureAsync(
+    const char* texture_name, TextureLoadPriority priority, TextureSampler sampler) const
+{
+    if(strlen(texture_name) == 0)
+        return nullptr;
+
+    if(sampler == TextureSampler::DEFAULT)
+        sampler = m_default_sampler;
+
+    const uint64_t texture_key = TextureKey(hash::HashRegisterString(texture_name), sampler);
+
+    mono::ITexturePtr texture = GetTextureFromCache(texture_key);
+    if(texture)
+        return texture;
+
+    // Only the header is read here, so that the placeholder can report the correct size.
+    int width;
+    int height;
+    int components;
+    const int result = stbi_info(texture_name, &width, &height, &components);
+    if(result == 0)
+    {
+        System::Log("TextureFactory|Unable to load '%s'", texture_name);
+        throw std::runtime_error("Unable to load image!");
+    }
+
+    if(!m_loader)
+    {
+        constexpr uint32_t placeholder_pixel = 0;
+
+        sg_image_desc image_desc = {};
+        image_desc.width = 1;
+        image_desc.height = 1;
+        image_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        image_desc.data.subimage[0][0].ptr = &placeholder_pixel;
+        image_desc.data.subimage[0][0].size = sizeof(placeholder_pixel);
+        m_placeholder_image = sg_make_image(&image_desc);
+
+        m_loader = std::make_unique<TextureLoader>(m_n_loader_threads, m_cache_directory, m_supported_formats);
+    }
+
+    System::Log("TextureFactory|Queueing texture '%s'.", texture_name);
+
+    const uint32_t load_id = m_next_load_id++;
+
+    const auto deleter = [this, texture_key, load_id](mono::TextureImpl* ptr) {
+        m_texture_storage.erase(texture_key);
+        m_pending_textures.erase(load_id);
+        delete ptr;
+    };
+
+    std::shared_ptr<mono::TextureImpl> pending_texture(new mono::TextureImpl(width, height, m_placeholder_image, sampler), deleter);
+    m_texture_storage[texture_key] = pending_texture;
+    m_pending_textures[load_id] = pending_texture;
+
+    m_loader->Enqueue(load_id, texture_name, priority);
+
+    return pending_texture;
+}
+
+void TextureFactoryImpl::UploadPendingTextures() const
+{
+    if(!m_loader)
+        return;
+
+    const auto upload_texture = [this](const DecodedImage& image) {
+        const auto it = m_pending_textures.find(image.id);
+        if(it == m_pending_textures.end())
+            return;
+
+        const std::shared_ptr<mono::TextureImpl> texture = it->second.lock();
+        m_pending_textures.erase(it);
+
+        if(!texture)
+            return;
+
+        if(!image.image.IsValid())
+        {
+            System::Log("TextureFactory|Unable to decode texture with load id '%u'", image.id);
+            return;
+        }
+
+        texture->SetImageData(image.image);
+    };
+
+    m_loader->ProcessDecoded(m_upload_budget_bytes, upload_texture);
 }
 
 mono::ITexturePtr TextureFactoryImpl::CreateTextureFromData(const byte* data, int data_length, const char* cache_name) const
 {
     if(cache_name)
     {
-        const uint32_t texture_hash = hash::Hash(cache_name);
+        const uint64_t texture_key = TextureKey(hash::Hash(cache_name), m_default_sampler);
 
-        mono::ITexturePtr texture = GetTextureFromCache(texture_hash);
+        mono::ITexturePtr texture = GetTextureFromCache(texture_key);
         if(texture)
             return texture;
 
-        return CreateAndCacheTexture(data, data_length, texture_hash);
+        return CreateAndCacheTexture(data, data_length, texture_key);
     }
     else
     {
-        int width;
-        int height;
-        int components;
-        std::unique_ptr<unsigned char> image_data(stbi_load_from_memory(data, data_length, &width, &height, &components, 0));
-        if(!image_data)
+        const mono::TextureImageData image = mono::DecodeTextureImage(data, data_length);
+        if(!image.IsValid())
         {
             System::Log("TextureFactory|Unable to load from data chunk.");
             throw std::runtime_error("Unable to load image!");
         }
 
-        return std::make_shared<mono::TextureImpl>(width, height, components, image_data.get());
-    }}
+        return std::make_shared<mono::TextureImpl>(image, m_default_sampler);
+    }
+}
 
-mono::ITexturePtr TextureFactoryImpl::CreateTexture(const byte* data, int width, int height, int color_components) const
+mono::ITexturePtr TextureFactoryImpl::CreateTexture(
+    const byte* data, int width, int height, int color_components, TextureSampler sampler) const
 {
-    return std::make_shared<TextureImpl>(width, height, color_components, data);
+    if(sampler == TextureSampler::DEFAULT)
+        return std::make_shared<TextureImpl>(width, height, color_components, data);
+
+    const TextureImageData image = MakeTextureImage(width, height, color_components, data);
+    return std::make_shared<TextureImpl>(image, sampler);
 }
 
 mono::ITexturePtr TextureFactoryImpl::CreateFromNativeHandle(uint32_t native_handle) const
@@ -66,9 +194,30 @@ mono::ITexturePtr TextureFactoryImpl::CreateFromNativeHandle(uint32_t native_han
     return std::make_shared<TextureImpl>(handle);
 }
 
-mono::ITexturePtr TextureFactoryImpl::GetTextureFromCache(uint32_t texture_hash) const
+mono::ITexturePtr TextureFactoryImpl::CreateDynamicTexture(int width, int height, int color_components) const
+{
+    TextureFormat format = TextureFormat::RGBA8;
+    if(color_components == 1)
+        format = TextureFormat::R8;
+    else if(color_components == 2)
+        format = TextureFormat::RG8;
+
+    return std::make_shared<TextureImpl>(width, height, format, TextureSampler::LINEAR_MIPMAP);
+}
+
+void TextureFactoryImpl::UpdateDynamicTexture(ITexture* texture, const byte* data) const
+{
+    static_cast<TextureImpl*>(texture)->UpdateImage(data);
+}
+
+uint32_t TextureFactoryImpl::QueuedTextures() const
 {
-    auto it = m_texture_storage.find(texture_hash);
+    return m_loader ? m_loader->Queued() : 0;
+}
+
+mono::ITexturePtr TextureFactoryImpl::GetTextureFromCache(uint64_t texture_key) const
+{
+    auto it = m_texture_storage.find(texture_key);
     if(it != m_texture_storage.end())
     {
         mono::ITexturePtr texture = it->second.lock();
@@ -79,48 +228,42 @@ mono::ITexturePtr TextureFactoryImpl::GetTextureFromCache(uint32_t texture_hash)
     return nullptr;
 }
 
-mono::ITexturePtr TextureFactoryImpl::CreateAndCacheTexture(const char* source_file, uint32_t texture_hash) const
+mono::ITexturePtr TextureFactoryImpl::CreateAndCacheTexture(const char* source_file, uint64_t texture_key, TextureSampler sampler) const
 {
-    int width;
-    int height;
-    int components;
-    std::unique_ptr<unsigned char> image_data(stbi_load(source_file, &width, &height, &components, 0));
-    if(!image_data)
+    const mono::TextureImageData image = mono::LoadTextureImage(source_file, m_cache_directory, m_supported_formats);
+    if(!image.IsValid())
     {
         System::Log("TextureFactory|Unable to load '%s'", source_file);
         throw std::runtime_error("Unable to load image!");
     }
 
-    const auto deleter = [this, texture_hash](mono::ITexture* ptr) {
-        m_texture_storage.erase(texture_hash);
+    const auto deleter = [this, texture_key](mono::ITexture* ptr) {
+        m_texture_storage.erase(texture_key);
         delete ptr;
     };
 
-    mono::ITexturePtr texture(new mono::TextureImpl(width, height, components, image_data.get()), deleter);
-    m_texture_storage[texture_hash] = texture;
+    mono::ITexturePtr texture(new mono::TextureImpl(image, sampler), deleter);
+    m_texture_storage[texture_key] = texture;
 
     return texture;
 }
 
-mono::ITexturePtr TextureFactoryImpl::CreateAndCacheTexture(const unsigned char* data, int data_length, uint32_t texture_hash) const
+mono::ITexturePtr TextureFactoryImpl::CreateAndCacheTexture(const unsigned char* data, int data_length, uint64_t texture_key) const
 {
-    int width;
-    int height;
-    int components;
-    std::unique_ptr<unsigned char> image_data(stbi_load_from_memory(data, data_length, &width, &height, &components, 0));
-    if(!image_data)
+    const mono::TextureImageData image = mono::DecodeTextureImage(data, data_length);
+    if(!image.IsValid())
     {
         System::Log("TextureFactory|Unable to load from data chunk");
         throw std::runtime_error("Unable to load image!");
     }
 
-    const auto deleter = [this, texture_hash](mono::ITexture* ptr) {
-        m_texture_storage.erase(texture_hash);
+    const auto deleter = [this, texture_key](mono::ITexture* ptr) {
+        m_texture_storage.erase(texture_key);
         delete ptr;
     };
 
-    mono::ITexturePtr texture(new mono::TextureImpl(width, height, components, image_data.get()), deleter);
-    m_texture_storage[texture_hash] = texture;
+    mono::ITexturePtr texture(new mono::TextureImpl(image, m_default_sampler), deleter);
+    m_texture_storage[texture_key] = texture;
 
     return texture;
 }
@@ -2,7 +2,10 @@
 #pragma once
 
 #include "ITextureFactory.h"
+#include "sokol/sokol_gfx.h"
+
 #include <unordered_map>
+#include <memory>
 #include <cstdint>
 
 namespace mono
@@ -11,18 +14,47 @@ namespace mono
     {
     public:
 
-        ITexturePtr CreateTexture(const char* texture_name) const override;
+        //! @param cache_directory Directory for the engine texture cache, nullptr disables the cache.
+        //! @param default_sampler Sampler used for TextureSampler::DEFAULT.
+        TextureFactoryImpl(
+            uint32_t n_loader_threads,
+            uint32_t upload_budget_bytes,
+            const char* cache_directory,
+            TextureSampler default_sampler);
+        ~TextureFactoryImpl();
+
+        ITexturePtr CreateTexture(const char* texture_name, TextureSampler sampler) const override;
+        ITexturePtr CreateTextureAsync(const char* texture_name, TextureLoadPriority priority, TextureSampler sampler) const override;
+        void UploadPendingTextures() const override;
         ITexturePtr CreateTextureFromData(const byte* data, int data_length, const char* cache_name) const override;
-        ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components) const override;
+        ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components, TextureSampler sampler) const override;
         ITexturePtr CreateFromNativeHandle(uint32_t native_handle) const override;
+        ITexturePtr CreateDynamicTexture(int width, int height, int color_components) const override;
+        void UpdateDynamicTexture(ITexture* texture, const byte* data) const override;
+
+        //! Number of textures from CreateTextureAsync that are queued for decoding or being decoded.
+        uint32_t QueuedTextures() const;
 
     private:
 
-        mono::ITexturePtr GetTextureFromCache(uint32_t texture_hash) const;
-        mono::ITexturePtr CreateAndCacheTexture(const char* source_file, uint32_t texture_hash) const;
-        mono::ITexturePtr CreateAndCacheTexture(const unsigned char* data, int data_length, uint32_t texture_hash) const;
+        mono::ITexturePtr GetTextureFromCache(uint64_t texture_key) const;
+        mono::ITexturePtr CreateAndCacheTexture(const char* source_file, uint64_t texture_key, TextureSampler sampler) const;
+        mono::ITexturePtr CreateAndCacheTexture(const unsigned char* data, int data_length, uint64_t texture_key) const;
+
+        // This is where all the weak pointers goes, that points to the allocated textures! Keyed on the pair
+        // of name hash and sampler.
+        mutable std::unordered_map<uint64_t, std::weak_ptr<mono::ITexture>> m_texture_storage;
+
+        // Textures that are waiting for the loader to decode them, keyed on load id.
+        mutable std::unordered_map<uint32_t, std::weak_ptr<class TextureImpl>> m_pending_textures;
 
-        // This is where all the weak pointers goes, that points to the allocated textures!
-        mutable std::unordered_map<uint32_t, std::weak_ptr<mono::ITexture>> m_texture_storage;
+        const uint32_t m_n_loader_threads;
+        const uint32_t m_upload_budget_bytes;
+        const char* m_cache_directory;
+        const uint32_t m_supported_formats;
+        const TextureSampler m_default_sampler;
+        mutable std::unique_ptr<class TextureLoader> m_loader;
+        mutable sg_image m_placeholder_image;
+        mutable uint32_t m_next_load_id;
     };
 }
@@ -0,0 +1,141 @@
+
+#include "TextureLoader.h"
+
+#include <algorithm>
+
+using namespace mono;
+
+namespace
+{
+    template <typename T>
+    bool PrioritySortFunc(const T& first, const T& second)
+    {
+        if(first.priority != second.priority)
+            return first.priority < second.priority;
+
+        return first.sequence > second.sequence;
+    }
+}
+
+TextureLoader::TextureLoader(uint32_t n_threads, const char* cache_directory, uint32_t supported_formats)
+    : m_cache_directory(cache_directory ? cache_directory : "")
+    , m_supported_formats(supported_formats)
+    , m_quit(false)
+    , m_sequence(0)
+    , m_in_flight(0)
+{
+    n_threads = std::max(n_threads, 1u);
+    for(uint32_t index = 0; index < n_threads; ++index)
+        m_threads.emplace_back(&TextureLoader::WorkerThread, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_request_condition.notify_all();
+
+    for(std::thread& thread : m_threads)
+        thread.join();
+}
+
+void TextureLoader::Enqueue(uint32_t id, const char* filename, TextureLoadPriority priority)
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        m_requests.push_back({ id, priority, m_sequence++, filename });
+        std::push_heap(m_requests.begin(), m_requests.end(), PrioritySortFunc<LoadRequest>);
+    }
+
+    m_request_condition.notify_one();
+}
+
+uint32_t TextureLoader::ProcessDecoded(uint32_t byte_budget, const DecodedCallback& callback)
+{
+    std::vector<DecodedImage> decoded_images;
+
+    {
+        std::scoped_lock lock(m_mutex);
+        if(m_decoded.empty())
+            return 0;
+
+        const auto sort_func = [](const DecodedImage& first, const DecodedImage& second) {
+            return first.priority > second.priority;
+        };
+        std::stable_sort(m_decoded.begin(), m_decoded.end(), sort_func);
+
+        uint32_t budget_bytes = 0;
+        uint32_t n_images = 0;
+
+        for(const DecodedImage& image : m_decoded)
+        {
+            if(n_images > 0 && (budget_bytes + image.Bytes()) > byte_budget)
+                break;
+
+            budget_bytes += image.Bytes();
+            n_images++;
+        }
+
+        decoded_images.assign(
+            std::make_move_iterator(m_decoded.begin()), std::make_move_iterator(m_decoded.begin() + n_images));
+        m_decoded.erase(m_decoded.begin(), m_decoded.begin() + n_images);
+    }
+
+    // Call the callback outside of the lock, it will most likely do a texture upload.
+    uint32_t processed_bytes = 0;
+    for(const DecodedImage& image : decoded_images)
+    {
+        callback(image);
+        processed_bytes += image.Bytes();
+    }
+
+    return processed_bytes;
+}
+
+uint32_t TextureLoader::Pending() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_requests.size() + m_in_flight + m_decoded.size();
+}
+
+uint32_t TextureLoader::Queued() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_requests.size() + m_in_flight;
+}
+
+void TextureLoader::WorkerThread()
+{
+    while(true)
+    {
+        LoadRequest request;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_request_condition.wait(lock, [this] { return m_quit || !m_requests.empty(); });
+            if(m_quit)
+                break;
+
+            std::pop_heap(m_requests.begin(), m_requests.end(), PrioritySortFunc<LoadRequest>);
+            request = std::move(m_requests.back());
+            m_requests.pop_back();
+            m_in_flight++;
+        }
+
+        const char* cache_directory = m_cache_directory.empty() ? nullptr : m_cache_directory.c_str();
+
+        DecodedImage image;
+        image.id = request.id;
+        image.priority = request.priority;
+        image.image = LoadTextureImage(request.filename.c_str(), cache_directory, m_supported_formats);
+
+        {
+            std::scoped_lock lock(m_mutex);
+            m_decoded.push_back(std::move(image));
+            m_in_flight--;
+        }
+    }
+}
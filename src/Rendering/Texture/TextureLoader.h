@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include "ITextureFactory.h"
+#include "TextureCache.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+namespace mono
+{
+    struct DecodedImage
+    {
+        uint32_t id;
+        TextureLoadPriority priority;
+        TextureImageData image;
+
+        uint32_t Bytes() const
+        {
+            return image.Bytes();
+        }
+    };
+
+    //! Decodes image files on worker threads, the decoded images are then handed back on the calling thread
+    //! via ProcessDecoded, typically once per frame on the render thread.
+    class TextureLoader
+    {
+    public:
+
+        //! @param cache_directory Directory of the texture cache, nullptr to always decode the source image.
+        //! @param supported_formats Bit mask of TextureFormatBit that the renderer can sample from.
+        TextureLoader(uint32_t n_threads, const char* cache_directory, uint32_t supported_formats);
+        ~TextureLoader();
+
+        void Enqueue(uint32_t id, const char* filename, TextureLoadPriority priority);
+
+        //! Hands decoded images to the callback in priority order, until the byte budget is used up. At least
+        //! one image is always processed so a single large image can not starve.
+        //! @return Number of bytes handed to the callback.
+        using DecodedCallback = std::function<void (const DecodedImage& image)>;
+        uint32_t ProcessDecoded(uint32_t byte_budget, const DecodedCallback& callback);
+
+        //! Number of images that are queued for decoding, being decoded or decoded but not yet processed.
+        uint32_t Pending() const;
+
+        //! Number of images that are queued for decoding or being decoded.
+        uint32_t Queued() const;
+
+    private:
+
+        void WorkerThread();
+
+        struct LoadRequest
+        {
+            uint32_t id;
+            TextureLoadPriority priority;
+            uint32_t sequence;
+            std::string filename;
+        };
+
+        const std::string m_cache_directory;
+        const uint32_t m_supported_formats;
+
+        bool m_quit;
+        uint32_t m_sequence;
+        uint32_t m_in_flight;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_request_condition;
+
+        std::vector<LoadRequest> m_requests;
+        std::vector<DecodedImage> m_decoded;
+        std::vector<std::thread> m_threads;
+    };
+}
@@ -32,21 +32,33 @@ RoadBatchDrawer::~RoadBatchDrawer()
     m_path_system->RemoveDirtyCallback(m_callback_id);
 }
 
-void RoadBatchDrawer::Draw(mono::IRenderer& renderer) const
+void RoadBatchDrawer::Prepare(const mono::IRenderer& renderer) const
 {
-    const auto collect_roads = [this, &renderer](uint32_t entity_id, const RoadComponent& component) {
-        auto it = m_cached_roads.find(entity_id);
+    m_roads_to_draw.clear();
 
-        if(it == m_cached_roads.end() || (it != m_cached_roads.end() && NeedsUpdate(it->second, component)))
-            it = m_cached_roads.insert_or_assign(entity_id, CacheRoadData(entity_id, component)).first;
+    const auto collect_roads = [this](uint32_t entity_id, const RoadComponent& component) {
+        m_roads_to_draw.push_back({ entity_id, &component, m_transform_system->GetWorld(entity_id) });
+    };
 
-        if(!it->second.texture || !it->second.buffers.vertices)
-            return;
+    m_road_system->ForEeach(collect_roads);
+}
 
-        const math::Matrix& world_transform = m_transform_system->GetWorld(entity_id);
-        const auto scope = mono::MakeTransformScope(world_transform, &renderer);
+void RoadBatchDrawer::Draw(mono::IRenderer& renderer) const
+{
+    for(const RoadDrawData& draw_data : m_roads_to_draw)
+    {
+        const RoadComponent& component = *draw_data.component;
+
+        auto it = m_cached_roads.find(draw_data.entity_id);
+        if(it == m_cached_roads.end() || NeedsUpdate(it->second, component))
+            it = m_cached_roads.insert_or_assign(draw_data.entity_id, CacheRoadData(draw_data.entity_id, component)).first;
 
         const CachedRoad& road = it->second;
+        if(!road.texture || !road.buffers.vertices)
+            continue;
+
+        const auto scope = mono::MakeTransformScope(draw_data.transform, &renderer);
+
         renderer.DrawAnnotatedTrianges(
             road.buffers.vertices.get(),
             road.buffers.anotations.get(),
@@ -55,9 +67,7 @@ void RoadBatchDrawer::Draw(mono::IRenderer& renderer) const
             mono::Color::WHITE,
             0,
             road.buffers.indices->Size());
-    };
-
-    m_road_system->ForEeach(collect_roads);
+    }
 }
 
 math::Quad RoadBatchDrawer::BoundingBox() const
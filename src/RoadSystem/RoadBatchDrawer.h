@@ -5,8 +5,10 @@
 #include "Rendering/IDrawable.h"
 #include "Rendering/Texture/ITextureFactory.h"
 #include "Paths/PathDrawBuffer.h"
+#include "Math/Matrix.h"
 
 #include <unordered_map>
+#include <vector>
 #include <string>
 
 namespace mono
@@ -23,6 +25,7 @@ namespace mono
 
     private:
 
+        void Prepare(const mono::IRenderer& renderer) const override;
         void Draw(mono::IRenderer& renderer) const override;
         math::Quad BoundingBox() const override;
 
@@ -44,5 +47,15 @@ namespace mono
         uint32_t m_callback_id;
 
         mutable std::unordered_map<uint32_t, CachedRoad> m_cached_roads;
+
+        struct RoadDrawData
+        {
+            uint32_t entity_id;
+            const RoadComponent* component;
+            math::Matrix transform;
+        };
+
+        // Built in Prepare
+        mutable std::vector<RoadDrawData> m_roads_to_draw;
     };
 }
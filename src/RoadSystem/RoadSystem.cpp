@@ -3,6 +3,7 @@
 #include "System/Hash.h"
 
 using namespace mono;
+using namespace hash::literals;
 
 RoadSystem::RoadSystem(uint32_t n)
 {
@@ -28,7 +29,8 @@ void RoadSystem::SetData(uint32_t entity_id, const RoadComponent& component)
 
 uint32_t RoadSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "roadsystem"_hash;
+    return system_id;
 }
 
 const char* RoadSystem::Name() const
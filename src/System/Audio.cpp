@@ -139,7 +139,7 @@ void audio::Shutdown()
 
 audio::ISoundPtr audio::CreateSound(const char* file_name, audio::SoundPlayback playback)
 {
-    const uint32_t sound_hash = hash::Hash(file_name);
+    const uint32_t sound_hash = hash::HashRegisterString(file_name);
     auto it = g_sound_repository.find(sound_hash);
     if(it != g_sound_repository.end())
     {
@@ -6,6 +6,16 @@
 #include <string_view>
 #include <filesystem>
 
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 namespace
 {
     file::FilePtr OpenFile(const char* file_name, const char* mode)
@@ -80,6 +90,82 @@ std::vector<byte> file::FileRead(const file::FilePtr& file)
     return bytes;
 }
 
+file::MappedFile::MappedFile(const char* file_name)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_native_handle(nullptr)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER file_size;
+    const bool got_size = GetFileSizeEx(file, &file_size);
+    const HANDLE mapping = got_size ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle(file);
+
+    if(!mapping)
+        return;
+
+    m_data = (const byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(m_data)
+    {
+        m_size = file_size.QuadPart;
+        m_native_handle = mapping;
+    }
+    else
+    {
+        CloseHandle(mapping);
+    }
+#else
+    const int file = open(file_name, O_RDONLY);
+    if(file < 0)
+        return;
+
+    struct stat file_stat;
+    if(fstat(file, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(data != MAP_FAILED)
+        {
+            m_data = (const byte*)data;
+            m_size = file_stat.st_size;
+        }
+    }
+
+    close(file);
+#endif
+}
+
+file::MappedFile::~MappedFile()
+{
+    if(!m_data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_native_handle);
+#else
+    munmap((void*)m_data, m_size);
+#endif
+}
+
+bool file::MappedFile::IsValid() const
+{
+    return (m_data != nullptr);
+}
+
+const byte* file::MappedFile::Data() const
+{
+    return m_data;
+}
+
+uint64_t file::MappedFile::Size() const
+{
+    return m_size;
+}
+
 bool file::Exists(const char* file_name)
 {
     return std::filesystem::exists(file_name);
@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <vector>
+#include <cstdio>
+#include <cstdint>
 
 using byte = unsigned char;
 
@@ -35,6 +37,28 @@ namespace file
     //! Read the file into a buffer
     std::vector<byte> FileRead(const FilePtr& file);
 
+    //! A read only memory mapping of a file, unmapped when destroyed
+    class MappedFile
+    {
+    public:
+
+        MappedFile(const char* file_name);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool IsValid() const;
+        const byte* Data() const;
+        uint64_t Size() const;
+
+    private:
+
+        const byte* m_data;
+        uint64_t m_size;
+        void* m_native_handle;
+    };
+
     bool Exists(const char* file_name);
     bool IsExtension(const char* file_name, const char* extension);
 }
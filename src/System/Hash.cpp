@@ -1,23 +1,184 @@
 
 #include "Hash.h"
-#include <unordered_map>
-#include <string>
+#include "System.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
 
 namespace
 {
-    std::unordered_map<uint32_t, std::string> g_hash_register;
+    constexpr uint32_t TABLE_CAPACITY = 1 << 16;
+    constexpr uint32_t TABLE_MASK = TABLE_CAPACITY - 1;
+    constexpr uint32_t MAX_USED_SLOTS = TABLE_CAPACITY / 4 * 3;
+    constexpr uint32_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> key;          // (hash << 1) | 1 when claimed, zero when empty.
+        std::atomic<const char*> string;    // Published when the string has been copied.
+    };
+
+    // Zero initialized, open addressing with linear probing. Slots are never removed.
+    Slot g_slots[TABLE_CAPACITY];
+    std::atomic<uint32_t> g_used_slots(0);
+
+    struct StringArena
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        uint32_t offset = ARENA_BLOCK_SIZE;
+    };
+
+    const char* CopyToArena(const char* string, size_t length)
+    {
+        static StringArena arena;
+        std::lock_guard<std::mutex> lock(arena.mutex);
+
+        const size_t size = length + 1;
+        char* copy = nullptr;
+
+        if(size > ARENA_BLOCK_SIZE)
+        {
+            copy = arena.blocks.emplace_back(new char[size]).get();
+        }
+        else
+        {
+            if(arena.offset + size > ARENA_BLOCK_SIZE)
+            {
+                arena.blocks.emplace_back(new char[ARENA_BLOCK_SIZE]);
+                arena.offset = 0;
+            }
+
+            copy = arena.blocks.back().get() + arena.offset;
+            arena.offset += size;
+        }
+
+        std::memcpy(copy, string, length);
+        copy[length] = '\0';
+        return copy;
+    }
+
+    uint64_t MakeKey(uint32_t hash_value)
+    {
+        return (uint64_t(hash_value) << 1) | 1;
+    }
+
+    // A claimed slot is published right after the copy, wait for it instead of reporting a miss.
+    const char* WaitForString(const Slot& slot)
+    {
+        const char* string = slot.string.load(std::memory_order_acquire);
+        while(string == nullptr)
+        {
+            std::this_thread::yield();
+            string = slot.string.load(std::memory_order_acquire);
+        }
+
+        return string;
+    }
+
+    const char* Find(uint32_t hash_value)
+    {
+        const uint64_t key = MakeKey(hash_value);
+
+        for(uint32_t probe = 0; probe < TABLE_CAPACITY; ++probe)
+        {
+            const Slot& slot = g_slots[(hash_value + probe) & TABLE_MASK];
+            const uint64_t slot_key = slot.key.load(std::memory_order_acquire);
+            if(slot_key == 0)
+                return nullptr;
+
+            if(slot_key == key)
+                return WaitForString(slot);
+        }
+
+        return nullptr;
+    }
+
+    // Returns the interned string, or nullptr if the table is full. Strings with the same hash get one slot
+    // each, the string is compared so that a collision never returns the other string.
+    const char* Insert(uint32_t hash_value, const char* string, size_t length)
+    {
+        const uint64_t key = MakeKey(hash_value);
+        const char* colliding_string = nullptr;
+
+        for(uint32_t probe = 0; probe < TABLE_CAPACITY; ++probe)
+        {
+            Slot& slot = g_slots[(hash_value + probe) & TABLE_MASK];
+            uint64_t slot_key = slot.key.load(std::memory_order_acquire);
+
+            if(slot_key == 0)
+            {
+                if(g_used_slots.load(std::memory_order_relaxed) >= MAX_USED_SLOTS)
+                    return nullptr;
+
+                if(slot.key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel))
+                {
+                    g_used_slots.fetch_add(1, std::memory_order_relaxed);
+                    const char* copy = CopyToArena(string, length);
+                    slot.string.store(copy, std::memory_order_release);
+
+                    // Interning still works, but the hash no longer identifies one string.
+                    if(colliding_string)
+                        System::Log("Hash|Collision, '%s' and '%s' has the same hash.", colliding_string, string);
+
+                    return copy;
+                }
+
+                // Lost the race for the slot, slot_key now holds the key of the winner.
+            }
+
+            if(slot_key == key)
+            {
+                const char* interned = WaitForString(slot);
+                if(std::strcmp(interned, string) == 0)
+                    return interned;
+
+                colliding_string = interned;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void LogTableFull()
+    {
+        static std::once_flag full_flag;
+        std::call_once(full_flag, []() { System::Log("Hash|String table is full, strings are no longer registered."); });
+    }
+}
+
+uint32_t hash::HashRegisterString(const char* string)
+{
+    const size_t length = std::strlen(string);
+    const uint32_t hash_value = hash::Hash(string, length);
+
+    // Only the hash is needed, a full table just means HashLookup will not find the string.
+    if(!Insert(hash_value, string, length))
+        LogTableFull();
+
+    return hash_value;
 }
 
-void hash::HashRegisterString(const char* string)
+const char* hash::InternString(const char* string)
 {
-    g_hash_register[hash::Hash(string)] = string;
+    const size_t length = std::strlen(string);
+    const char* interned = Insert(hash::Hash(string, length), string, length);
+    if(!interned)
+    {
+        LogTableFull();
+        throw std::runtime_error("String table is full!");
+    }
+
+    return interned;
 }
 
 const char* hash::HashLookup(uint32_t hash_value)
 {
-    const auto it = g_hash_register.find(hash_value);
-    if(it != g_hash_register.end())
-        return it->second.c_str();
-
-    return "unknown";
+    const char* string = Find(hash_value);
+    return string ? string : "unknown";
 }
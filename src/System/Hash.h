@@ -3,13 +3,14 @@
 
 #include <cstring>
 #include <cstdint>
+#include <string>
 
 namespace hash
 {
     //
     // This is the "FNV-1a alternate algorithm", taken from here: http://isthe.com/chongo/tech/comp/fnv/
     //
-    inline uint32_t Hash(const char* text, uint32_t length)
+    constexpr uint32_t Hash(const char* text, uint32_t length)
     {
         constexpr uint32_t offset_bias = 2166136261u;
         constexpr uint32_t FNV_prime = 16777619u;
@@ -22,12 +23,27 @@ namespace hash
         return hash;
     }
 
-    inline uint32_t Hash(const char* text)
+    constexpr uint32_t Hash(const char* text)
     {
-        const std::size_t length = std::strlen(text);
+        const std::size_t length = std::char_traits<char>::length(text);
         return Hash(text, length);
     }
 
-    void HashRegisterString(const char* string);
+    namespace literals
+    {
+        //! "TransformSystem"_hash, use it to initialize a constexpr value to make sure it is folded.
+        constexpr uint32_t operator "" _hash(const char* text, std::size_t length)
+        {
+            return Hash(text, length);
+        }
+    }
+
+    //! Interned strings are copied into an append only table that lives for the rest of the program, and can be
+    //! looked up from their hash. Lookups and registering a string that is already in the table does not lock,
+    //! the first registration of a string takes a short lock to copy it. Strings with colliding hashes are
+    //! interned separately and the collision is logged, HashLookup returns the first of them. When the table
+    //! is full HashRegisterString only returns the hash and InternString throws.
+    uint32_t HashRegisterString(const char* string);
+    const char* InternString(const char* string);
     const char* HashLookup(uint32_t hash_value);
 }
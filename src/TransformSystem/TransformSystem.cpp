@@ -5,6 +5,7 @@
 #include <cstdint>
 
 using namespace mono;
+using namespace hash::literals;
 
 namespace
 {
@@ -105,7 +106,8 @@ void TransformSystem::ResetTransformComponent(uint32_t id)
 
 uint32_t TransformSystem::Id() const
 {
-    return hash::Hash(Name());
+    constexpr uint32_t system_id = "transformsystem"_hash;
+    return system_id;
 }
 
 const char* TransformSystem::Name() const
@@ -5,6 +5,7 @@
 #include "Math/Matrix.h"
 #include "Math/Quad.h"
 #include <vector>
+#include <cstddef>
 
 namespace mono
 {
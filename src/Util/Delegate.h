@@ -0,0 +1,183 @@
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mono
+{
+    //! A callable like std::function, but callables that fit in the buffer are stored inline instead of
+    //! allocated. A lambda that captures a couple of pointers, or a member function and an object, fits.
+    template <typename Signature, std::size_t BufferSize = 48>
+    class Delegate;
+
+    template <typename R, typename ... Args, std::size_t BufferSize>
+    class Delegate<R (Args...), BufferSize>
+    {
+    public:
+
+        Delegate() = default;
+
+        Delegate(std::nullptr_t)
+        { }
+
+        template <typename Callable, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, Delegate>>>
+        Delegate(Callable&& callable)
+        {
+            Assign(std::forward<Callable>(callable));
+        }
+
+        Delegate(const Delegate& other)
+        {
+            CopyFrom(other);
+        }
+
+        Delegate(Delegate&& other) noexcept
+        {
+            MoveFrom(other);
+        }
+
+        ~Delegate()
+        {
+            Reset();
+        }
+
+        Delegate& operator = (const Delegate& other)
+        {
+            if(this != &other)
+            {
+                Reset();
+                CopyFrom(other);
+            }
+
+            return *this;
+        }
+
+        Delegate& operator = (Delegate&& other) noexcept
+        {
+            if(this != &other)
+            {
+                Reset();
+                MoveFrom(other);
+            }
+
+            return *this;
+        }
+
+        inline R operator () (Args... args) const
+        {
+            return m_invoke(const_cast<unsigned char*>(m_buffer), std::forward<Args>(args)...);
+        }
+
+        inline explicit operator bool () const
+        {
+            return m_invoke != nullptr;
+        }
+
+        void Reset()
+        {
+            if(m_manage)
+                m_manage(Operation::DESTROY, m_buffer, nullptr);
+
+            m_invoke = nullptr;
+            m_manage = nullptr;
+        }
+
+    private:
+
+        enum class Operation
+        {
+            COPY,
+            MOVE,
+            DESTROY
+        };
+
+        using InvokeFunc = R (*)(void* buffer, Args&&... args);
+        using ManageFunc = void (*)(Operation operation, void* destination, void* source);
+
+        template <typename Type>
+        static constexpr bool FITS_IN_BUFFER =
+            sizeof(Type) <= BufferSize &&
+            alignof(Type) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<Type>;
+
+        template <typename Callable>
+        void Assign(Callable&& callable)
+        {
+            using Type = std::decay_t<Callable>;
+
+            if constexpr(FITS_IN_BUFFER<Type>)
+            {
+                new (m_buffer) Type(std::forward<Callable>(callable));
+
+                m_invoke = [](void* buffer, Args&&... args) -> R {
+                    return (*static_cast<Type*>(buffer))(std::forward<Args>(args)...);
+                };
+                m_manage = [](Operation operation, void* destination, void* source) {
+                    switch(operation)
+                    {
+                    case Operation::COPY:
+                        new (destination) Type(*static_cast<const Type*>(source));
+                        break;
+                    case Operation::MOVE:
+                        new (destination) Type(std::move(*static_cast<Type*>(source)));
+                        static_cast<Type*>(source)->~Type();
+                        break;
+                    case Operation::DESTROY:
+                        static_cast<Type*>(destination)->~Type();
+                        break;
+                    }
+                };
+            }
+            else
+            {
+                *reinterpret_cast<Type**>(m_buffer) = new Type(std::forward<Callable>(callable));
+
+                m_invoke = [](void* buffer, Args&&... args) -> R {
+                    return (**static_cast<Type**>(buffer))(std::forward<Args>(args)...);
+                };
+                m_manage = [](Operation operation, void* destination, void* source) {
+                    switch(operation)
+                    {
+                    case Operation::COPY:
+                        *static_cast<Type**>(destination) = new Type(**static_cast<Type**>(source));
+                        break;
+                    case Operation::MOVE:
+                        *static_cast<Type**>(destination) = *static_cast<Type**>(source);
+                        break;
+                    case Operation::DESTROY:
+                        delete *static_cast<Type**>(destination);
+                        break;
+                    }
+                };
+            }
+        }
+
+        void CopyFrom(const Delegate& other)
+        {
+            if(other.m_manage)
+                other.m_manage(Operation::COPY, m_buffer, const_cast<unsigned char*>(other.m_buffer));
+
+            m_invoke = other.m_invoke;
+            m_manage = other.m_manage;
+        }
+
+        void MoveFrom(Delegate& other)
+        {
+            if(other.m_manage)
+                other.m_manage(Operation::MOVE, m_buffer, other.m_buffer);
+
+            m_invoke = other.m_invoke;
+            m_manage = other.m_manage;
+
+            other.m_invoke = nullptr;
+            other.m_manage = nullptr;
+        }
+
+        alignas(std::max_align_t) unsigned char m_buffer[BufferSize];
+        InvokeFunc m_invoke = nullptr;
+        ManageFunc m_manage = nullptr;
+    };
+}
@@ -0,0 +1,105 @@
+
+#include "JobPool.h"
+#include "Random.h"
+
+using namespace mono;
+
+JobPool::JobPool(uint32_t n_workers)
+    : m_quit(false)
+    , m_generation(0)
+    , m_active_workers(0)
+    , m_count(0)
+    , m_func(nullptr)
+    , m_next_index(0)
+{
+    for(uint32_t index = 0; index < n_workers; ++index)
+        m_threads.emplace_back(&JobPool::WorkerThread, this, index + 1);
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_work_condition.notify_all();
+
+    for(std::thread& thread : m_threads)
+        thread.join();
+}
+
+uint32_t JobPool::Threads() const
+{
+    return m_threads.size() + 1;
+}
+
+void JobPool::ParallelFor(uint32_t count, const ParallelForFunc& func)
+{
+    if(m_threads.empty() || count < 2)
+    {
+        for(uint32_t index = 0; index < count; ++index)
+            func(index, 0);
+        return;
+    }
+
+    {
+        std::scoped_lock lock(m_mutex);
+        m_func = &func;
+        m_count = count;
+        m_next_index = 0;
+        m_active_workers = m_threads.size();
+        m_generation++;
+    }
+
+    m_work_condition.notify_all();
+
+    RunJobs(0);
+
+    // Wait for all the workers, not only for the work to run out, so that no worker can still be holding on
+    // to 'func' when this function returns.
+    std::unique_lock lock(m_mutex);
+    m_done_condition.wait(lock, [this] { return m_active_workers == 0; });
+    m_func = nullptr;
+}
+
+void JobPool::WorkerThread(uint32_t thread_index)
+{
+    // The calling thread has index and stream zero, each worker draws from its own stream.
+    mono::SetThreadRandomStream(thread_index);
+
+    uint32_t last_generation = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_work_condition.wait(lock, [this, last_generation] { return m_quit || m_generation != last_generation; });
+            if(m_quit)
+                break;
+
+            last_generation = m_generation;
+        }
+
+        RunJobs(thread_index);
+
+        {
+            std::scoped_lock lock(m_mutex);
+            m_active_workers--;
+        }
+
+        m_done_condition.notify_one();
+    }
+}
+
+void JobPool::RunJobs(uint32_t thread_index)
+{
+    while(true)
+    {
+        const uint32_t index = m_next_index.fetch_add(1);
+        if(index >= m_count)
+            break;
+
+        (*m_func)(index, thread_index);
+    }
+}
@@ -0,0 +1,49 @@
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+namespace mono
+{
+    //! A fixed set of worker threads that splits loops over indices, the calling thread takes part in the work.
+    //! ParallelFor is not reentrant and should only be called from one thread at a time.
+    class JobPool
+    {
+    public:
+
+        //! @param n_workers Number of worker threads, zero runs everything on the calling thread.
+        JobPool(uint32_t n_workers);
+        ~JobPool();
+
+        //! Number of threads that take part in a ParallelFor, including the calling thread.
+        uint32_t Threads() const;
+
+        //! Calls func for every index in [0, count) and returns once all calls are done. The thread index is in
+        //! [0, Threads()) and can be used to pick per thread data, the calling thread always has index zero.
+        using ParallelForFunc = std::function<void (uint32_t index, uint32_t thread_index)>;
+        void ParallelFor(uint32_t count, const ParallelForFunc& func);
+
+    private:
+
+        void WorkerThread(uint32_t thread_index);
+        void RunJobs(uint32_t thread_index);
+
+        bool m_quit;
+        uint32_t m_generation;
+        uint32_t m_active_workers;
+        uint32_t m_count;
+        const ParallelForFunc* m_func;
+        std::atomic<uint32_t> m_next_index;
+
+        std::mutex m_mutex;
+        std::condition_variable m_work_condition;
+        std::condition_variable m_done_condition;
+        std::vector<std::thread> m_threads;
+    };
+}
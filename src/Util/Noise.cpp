@@ -1,11 +1,179 @@
 
 #include "Noise.h"
+#include "JobPool.h"
 
 #define STB_PERLIN_IMPLEMENTATION
 #include "stb/stb_perlin.h"
 
+#include <algorithm>
+#include <cassert>
+
 using namespace mono;
 
+namespace
+{
+    // The x and y of the stb gradients, z is always zero in these functions.
+    constexpr float GRADIENTS[12][2] = {
+        {  1,  1 }, { -1,  1 }, {  1, -1 }, { -1, -1 },
+        {  1,  0 }, { -1,  0 }, {  1,  0 }, { -1,  0 },
+        {  0,  1 }, {  0, -1 }, {  0,  1 }, {  0, -1 },
+    };
+
+    constexpr float FBM_LACUNARITY = 6.0f;
+    constexpr float FBM_GAIN = 0.5f;
+    constexpr int FBM_OCTAVES = 6;
+
+    constexpr uint32_t GRID_ROWS_PER_JOB = 16;
+
+    inline float Ease(float t)
+    {
+        return ((t * 6 - 15) * t + 10) * t * t * t;
+    }
+
+    inline float Lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    inline uint32_t WrapMask(uint32_t wrap)
+    {
+        return (wrap - 1) & 255;
+    }
+
+    // One octave of stb_perlin_noise3 at z = frequency. The z coordinate has no fraction so only the first z
+    // layer contributes, and the values are the same as the stb functions give.
+    struct Octave
+    {
+        float frequency;
+        float amplitude;
+        uint32_t mask;
+        uint32_t z0;
+        uint8_t seed;
+    };
+
+    Octave MakeOctave(int octave, float frequency, float amplitude, uint32_t wrap)
+    {
+        Octave result;
+        result.frequency = frequency;
+        result.amplitude = amplitude;
+        result.mask = WrapMask(wrap);
+        result.z0 = stb__perlin_fastfloor(1.0f * frequency) & 255;
+        result.seed = uint8_t(octave);
+        return result;
+    }
+
+    // The lattice row of a y coordinate, shared by all samples in a grid row.
+    struct LatticeRow
+    {
+        float y;
+        float v;
+        uint32_t y0;
+        uint32_t y1;
+    };
+
+    LatticeRow MakeLatticeRow(float y, const Octave& octave)
+    {
+        const int py = stb__perlin_fastfloor(y);
+
+        LatticeRow row;
+        row.y = y - py;
+        row.v = Ease(row.y);
+        row.y0 = py & octave.mask;
+        row.y1 = (py + 1) & octave.mask;
+        return row;
+    }
+
+    // The gradients of the four corners of a lattice cell.
+    struct LatticeCell
+    {
+        const float* g00;
+        const float* g01;
+        const float* g10;
+        const float* g11;
+    };
+
+    LatticeCell MakeLatticeCell(int px, const LatticeRow& row, const Octave& octave)
+    {
+        const uint32_t x0 = px & octave.mask;
+        const uint32_t x1 = (px + 1) & octave.mask;
+
+        const uint32_t r0 = stb__perlin_randtab[x0 + octave.seed];
+        const uint32_t r1 = stb__perlin_randtab[x1 + octave.seed];
+
+        LatticeCell cell;
+        cell.g00 = GRADIENTS[stb__perlin_randtab_grad_idx[stb__perlin_randtab[r0 + row.y0] + octave.z0]];
+        cell.g01 = GRADIENTS[stb__perlin_randtab_grad_idx[stb__perlin_randtab[r0 + row.y1] + octave.z0]];
+        cell.g10 = GRADIENTS[stb__perlin_randtab_grad_idx[stb__perlin_randtab[r1 + row.y0] + octave.z0]];
+        cell.g11 = GRADIENTS[stb__perlin_randtab_grad_idx[stb__perlin_randtab[r1 + row.y1] + octave.z0]];
+        return cell;
+    }
+
+    inline float EvaluateCell(const LatticeCell& cell, const LatticeRow& row, float x)
+    {
+        const float y = row.y;
+        const float n00 = cell.g00[0] * x + cell.g00[1] * y;
+        const float n01 = cell.g01[0] * x + cell.g01[1] * (y - 1);
+        const float n10 = cell.g10[0] * (x - 1) + cell.g10[1] * y;
+        const float n11 = cell.g11[0] * (x - 1) + cell.g11[1] * (y - 1);
+
+        const float n0 = Lerp(n00, n01, row.v);
+        const float n1 = Lerp(n10, n11, row.v);
+        return Lerp(n0, n1, Ease(x));
+    }
+
+    // Adds one octave for a row of samples. Neighbouring samples mostly fall in the same lattice cell, the
+    // table lookups are only done when the cell changes.
+    void AccumulateRow(const Octave& octave, float origin_x, float step_x, float y, uint32_t count, float* out_values)
+    {
+        const LatticeRow row = MakeLatticeRow(y * octave.frequency, octave);
+
+        int cell_x = 0;
+        LatticeCell cell = {};
+        bool has_cell = false;
+
+        for(uint32_t index = 0; index < count; ++index)
+        {
+            const float x = (origin_x + step_x * float(index)) * octave.frequency;
+            const int px = stb__perlin_fastfloor(x);
+            if(!has_cell || px != cell_x)
+            {
+                cell = MakeLatticeCell(px, row, octave);
+                cell_x = px;
+                has_cell = true;
+            }
+
+            out_values[index] += EvaluateCell(cell, row, x - px) * octave.amplitude;
+        }
+    }
+
+    void EvaluatePoints(const math::Vector* points, uint32_t count, int octaves, float* out_values)
+    {
+        std::fill(out_values, out_values + count, 0.0f);
+
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+
+        for(int octave_index = 0; octave_index < octaves; ++octave_index)
+        {
+            const Octave octave = MakeOctave(octave_index, frequency, amplitude, 0);
+
+            for(uint32_t index = 0; index < count; ++index)
+            {
+                const math::Vector& point = points[index];
+                const LatticeRow row = MakeLatticeRow(point.y * frequency, octave);
+
+                const float x = point.x * frequency;
+                const int px = stb__perlin_fastfloor(x);
+                const LatticeCell cell = MakeLatticeCell(px, row, octave);
+                out_values[index] += EvaluateCell(cell, row, x - px) * amplitude;
+            }
+
+            frequency *= FBM_LACUNARITY;
+            amplitude *= FBM_GAIN;
+        }
+    }
+}
+
 float Noise::Perlin(float x, float y)
 {
     return stb_perlin_noise3(x, y, 1.0f, 0, 0, 0);
@@ -13,8 +181,57 @@ float Noise::Perlin(float x, float y)
 
 float Noise::PerlinFbm(float x, float y)
 {
-    constexpr float lacunarity = 6.0f;
-    constexpr float gain = 0.5f;
-    constexpr int octaves = 6;
-    return stb_perlin_fbm_noise3(x, y, 1.0f, lacunarity, gain, octaves);
+    return stb_perlin_fbm_noise3(x, y, 1.0f, FBM_LACUNARITY, FBM_GAIN, FBM_OCTAVES);
+}
+
+void Noise::Perlin(const math::Vector* points, uint32_t count, float* out_values)
+{
+    EvaluatePoints(points, count, 1, out_values);
+}
+
+void Noise::PerlinFbm(const math::Vector* points, uint32_t count, float* out_values)
+{
+    EvaluatePoints(points, count, FBM_OCTAVES, out_values);
+}
+
+void Noise::PerlinGrid(const NoiseGrid& grid, float* out_values, JobPool* job_pool)
+{
+    assert(grid.wrap <= 256 && (grid.wrap & (grid.wrap - 1)) == 0);
+
+    const auto evaluate_rows = [&grid, out_values](uint32_t job_index, uint32_t thread_index) {
+        const uint32_t first_row = job_index * GRID_ROWS_PER_JOB;
+        const uint32_t last_row = std::min(first_row + GRID_ROWS_PER_JOB, grid.height);
+
+        float* rows_out = out_values + first_row * grid.width;
+        std::fill(rows_out, rows_out + (last_row - first_row) * grid.width, 0.0f);
+
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+
+        for(int octave_index = 0; octave_index < grid.octaves; ++octave_index)
+        {
+            const uint32_t wrap = (grid.wrap > 0) ? uint32_t(grid.wrap * frequency) : 0;
+            const Octave octave = MakeOctave(octave_index, frequency, amplitude, wrap);
+
+            for(uint32_t row = first_row; row < last_row; ++row)
+            {
+                const float y = grid.origin.y + grid.step.y * float(row);
+                AccumulateRow(octave, grid.origin.x, grid.step.x, y, grid.width, out_values + row * grid.width);
+            }
+
+            frequency *= grid.lacunarity;
+            amplitude *= grid.gain;
+        }
+    };
+
+    const uint32_t n_jobs = (grid.height + GRID_ROWS_PER_JOB - 1) / GRID_ROWS_PER_JOB;
+    if(job_pool)
+    {
+        job_pool->ParallelFor(n_jobs, evaluate_rows);
+    }
+    else
+    {
+        for(uint32_t job_index = 0; job_index < n_jobs; ++job_index)
+            evaluate_rows(job_index, 0);
+    }
 }
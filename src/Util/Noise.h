@@ -1,13 +1,44 @@
 
 #pragma once
 
+#include "Math/Vector.h"
+#include <cstdint>
+
 namespace mono
 {
+    class JobPool;
+
+    struct NoiseGrid
+    {
+        math::Vector origin;    // Noise coordinate of the first sample
+        math::Vector step;      // Noise coordinates between two samples
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // Lattice cells before the noise repeats, a power of two up to 256. Zero does not repeat. With more than
+        // one octave the lacunarity needs to be a power of two for the noise to tile.
+        uint32_t wrap = 0;
+
+        // One octave is the same as Noise::Perlin, six octaves with the default lacunarity and gain is the same
+        // as Noise::PerlinFbm.
+        int octaves = 1;
+        float lacunarity = 6.0f;
+        float gain = 0.5f;
+    };
+
     class Noise
     {
     public:
 
         static float Perlin(float x, float y);
         static float PerlinFbm(float x, float y);
+
+        //! Batch versions of Perlin and PerlinFbm, gives the same values as calling them for each point.
+        static void Perlin(const math::Vector* points, uint32_t count, float* out_values);
+        static void PerlinFbm(const math::Vector* points, uint32_t count, float* out_values);
+
+        //! Evaluates width * height samples row by row into out_values. The rows are split over the job pool
+        //! if there is one.
+        static void PerlinGrid(const NoiseGrid& grid, float* out_values, JobPool* job_pool = nullptr);
     };
 }
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <numeric>
 #include <cstdint>
+#include <cstddef>
 
 namespace mono
 {
@@ -37,15 +38,10 @@ namespace mono
 
         void ReleasePoolData(const T* data)
         {
-            for(size_t index = 0; index < m_data.size(); ++index)
-            {
-                T* other_data = &m_data[index];
-                if(data == other_data)
-                {
-                    ReleasePoolData(index);
-                    break;
-                }
-            }
+            // The data is never reallocated, the index is the offset into it.
+            const ptrdiff_t index = data - m_data.data();
+            if(index >= 0 && size_t(index) < m_data.size())
+                ReleasePoolData(uint32_t(index));
         }
 
         void ReleasePoolData(uint32_t index)
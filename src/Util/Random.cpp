@@ -1,21 +1,175 @@
 
 #include "Random.h"
-#include <random>
+
+#include <atomic>
+
+using namespace mono;
 
 namespace
 {
-    constexpr int seed = 666;
-    static std::default_random_engine engine(seed);
+    uint64_t SplitMix64(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint32_t RotateLeft(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    // The upper 23 bits centered in their interval, gives a float in the open range 0, 1.
+    inline float ToUnitFloat(uint32_t value)
+    {
+        return (float(value >> 9) + 0.5f) * (1.0f / 8388608.0f);
+    }
+
+    std::atomic<uint64_t> g_seed(DEFAULT_RANDOM_SEED);
+    std::atomic<uint32_t> g_generation(0);
+
+    struct ThreadRandom
+    {
+        mono::RandomGenerator generator;
+        uint64_t stream = 0;
+        uint32_t generation = ~0u;
+    };
+
+    thread_local ThreadRandom t_random;
+}
+
+RandomGenerator::RandomGenerator(uint64_t seed, uint64_t stream)
+{
+    Seed(seed, stream);
+}
+
+void RandomGenerator::Seed(uint64_t seed, uint64_t stream)
+{
+    uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ull);
+
+    for(uint32_t lane = 0; lane < LANES; ++lane)
+    {
+        const uint64_t first = SplitMix64(state);
+        const uint64_t second = SplitMix64(state);
+
+        m_s0[lane] = uint32_t(first);
+        m_s1[lane] = uint32_t(first >> 32);
+        m_s2[lane] = uint32_t(second);
+        m_s3[lane] = uint32_t(second >> 32);
+
+        // All zero is the one state xoshiro never leaves.
+        if((m_s0[lane] | m_s1[lane] | m_s2[lane] | m_s3[lane]) == 0)
+            m_s0[lane] = 1;
+    }
+}
+
+uint32_t RandomGenerator::Next()
+{
+    const uint32_t result = m_s0[0] + m_s3[0];
+    const uint32_t t = m_s1[0] << 9;
+
+    m_s2[0] ^= m_s0[0];
+    m_s3[0] ^= m_s1[0];
+    m_s1[0] ^= m_s2[0];
+    m_s0[0] ^= m_s3[0];
+    m_s2[0] ^= t;
+    m_s3[0] = RotateLeft(m_s3[0], 11);
+
+    return result;
+}
+
+float RandomGenerator::Range(float min, float max)
+{
+    return min + (max - min) * ToUnitFloat(Next());
+}
+
+int RandomGenerator::RangeInt(int min, int max)
+{
+    const uint64_t range = uint64_t(int64_t(max) - int64_t(min)) + 1;
+    return int(int64_t(min) + int64_t((uint64_t(Next()) * range) >> 32));
+}
+
+void RandomGenerator::FillUniform(float* values, uint32_t count, float min, float max)
+{
+    const float range = (max - min);
+
+    // Copied to locals so the compiler can keep the lanes in registers.
+    uint32_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+    for(uint32_t lane = 0; lane < LANES; ++lane)
+    {
+        s0[lane] = m_s0[lane];
+        s1[lane] = m_s1[lane];
+        s2[lane] = m_s2[lane];
+        s3[lane] = m_s3[lane];
+    }
+
+    uint32_t index = 0;
+    for(; index + LANES <= count; index += LANES)
+    {
+        for(uint32_t lane = 0; lane < LANES; ++lane)
+        {
+            const uint32_t result = s0[lane] + s3[lane];
+            const uint32_t t = s1[lane] << 9;
+
+            s2[lane] ^= s0[lane];
+            s3[lane] ^= s1[lane];
+            s1[lane] ^= s2[lane];
+            s0[lane] ^= s3[lane];
+            s2[lane] ^= t;
+            s3[lane] = RotateLeft(s3[lane], 11);
+
+            values[index + lane] = min + range * ToUnitFloat(result);
+        }
+    }
+
+    for(uint32_t lane = 0; lane < LANES; ++lane)
+    {
+        m_s0[lane] = s0[lane];
+        m_s1[lane] = s1[lane];
+        m_s2[lane] = s2[lane];
+        m_s3[lane] = s3[lane];
+    }
+
+    for(; index < count; ++index)
+        values[index] = Range(min, max);
+}
+
+RandomGenerator& mono::GetThreadRandom()
+{
+    const uint32_t generation = g_generation.load(std::memory_order_acquire);
+    if(t_random.generation != generation)
+    {
+        t_random.generator.Seed(g_seed.load(std::memory_order_relaxed), t_random.stream);
+        t_random.generation = generation;
+    }
+
+    return t_random.generator;
+}
+
+void mono::SeedRandom(uint64_t seed)
+{
+    g_seed.store(seed, std::memory_order_relaxed);
+    g_generation.fetch_add(1, std::memory_order_release);
+}
+
+void mono::SetThreadRandomStream(uint64_t stream)
+{
+    t_random.stream = stream;
+    t_random.generation = g_generation.load(std::memory_order_acquire) - 1;
 }
 
 float mono::Random(float min, float max)
 {
-    std::uniform_real_distribution<float> distribution(min, max);
-    return distribution(engine);
+    return GetThreadRandom().Range(min, max);
 }
 
 int mono::RandomInt(int min, int max)
 {
-    std::uniform_int_distribution<int> distribution(min, max);
-    return distribution(engine);
+    return GetThreadRandom().RangeInt(min, max);
+}
+
+void mono::FillUniform(float* values, uint32_t count, float min, float max)
+{
+    GetThreadRandom().FillUniform(values, count, min, max);
 }
@@ -1,13 +1,63 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace mono
 {
+    constexpr uint64_t DEFAULT_RANDOM_SEED = 666;
+
+    //! xoshiro128+ generator. The same seed and stream gives the same sequence on all platforms, streams with
+    //! different ids are independent. Not thread safe, give each thread or system its own generator.
+    class RandomGenerator
+    {
+    public:
+
+        RandomGenerator(uint64_t seed = DEFAULT_RANDOM_SEED, uint64_t stream = 0);
+        void Seed(uint64_t seed, uint64_t stream = 0);
+
+        uint32_t Next();
+
+        //! Float between min and max.
+        float Range(float min, float max);
+
+        //! Integer between min and max, inclusive.
+        int RangeInt(int min, int max);
+
+        //! Fills values with floats between min and max. Runs four generators side by side so the loop
+        //! vectorizes, the sequence is not the same as calling Range count times.
+        void FillUniform(float* values, uint32_t count, float min, float max);
+
+    private:
+
+        static constexpr uint32_t LANES = 4;
+
+        // State per lane, Next and Range use lane 0.
+        uint32_t m_s0[LANES];
+        uint32_t m_s1[LANES];
+        uint32_t m_s2[LANES];
+        uint32_t m_s3[LANES];
+    };
+
+    //! The generator of the calling thread, seeded with the global seed and the stream of the thread.
+    RandomGenerator& GetThreadRandom();
+
+    //! Reseeds the generators of all threads, for reproducible replays. Call it while no other thread is
+    //! drawing numbers, each thread restarts its stream the next time it draws a number.
+    void SeedRandom(uint64_t seed);
+
+    //! Picks the stream of the calling thread and restarts it. The stream is a stable id so that the
+    //! sequence does not depend on the order threads happen to draw their first number in. Threads that never
+    //! call this use stream zero, JobPool workers use their thread index.
+    void SetThreadRandomStream(uint64_t stream);
+
     //! Generates a random float between min and max
     float Random(float min = 0.0f, float max = 1.0f);
 
     int RandomInt(int min = 0, int max = 100);
 
+    void FillUniform(float* values, uint32_t count, float min, float max);
+
     // Specify the percentage for the outcome to be true, 100 means always true, 20 means 20% of the time its true.
     inline bool Chance(int percentage)
     {
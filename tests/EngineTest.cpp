@@ -130,17 +130,26 @@ namespace
     {
     public:
 
-        mono::ITexturePtr CreateTexture(const char* texture_name) const
+        mono::ITexturePtr CreateTexture(const char* texture_name, mono::TextureSampler sampler) const
         {
             return std::make_shared<NullTexture>();
         }
 
+        mono::ITexturePtr CreateTextureAsync(
+            const char* texture_name, mono::TextureLoadPriority priority, mono::TextureSampler sampler) const
+        {
+            return std::make_shared<NullTexture>();
+        }
+
+        void UploadPendingTextures() const
+        { }
+
         mono::ITexturePtr CreateTextureFromData(const byte* data, int data_length, const char* cache_name) const
         {
             return std::make_shared<NullTexture>();
         }
 
-        mono::ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components) const
+        mono::ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components, mono::TextureSampler sampler) const
         {
             return std::make_shared<NullTexture>();
         }
@@ -149,6 +158,14 @@ namespace
         {
             return std::make_shared<NullTexture>();
         }
+
+        mono::ITexturePtr CreateDynamicTexture(int width, int height, int color_components) const
+        {
+            return std::make_shared<NullTexture>();
+        }
+
+        void UpdateDynamicTexture(mono::ITexture* texture, const byte* data) const
+        { }
     };
 }
 
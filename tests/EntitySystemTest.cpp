@@ -0,0 +1,35 @@
+#include "EntitySystem/EntitySystem.h"
+#include "EntitySystem/Entity.h"
+#include "System/Hash.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+TEST(EntitySystemTest, FindEntityByName)
+{
+    mono::EntitySystem entity_system(8, nullptr, nullptr, nullptr);
+
+    // Two names with the same 32 bit hash.
+    const mono::Entity first = entity_system.CreateEntity("hash_collision_479599", {});
+    const mono::Entity second = entity_system.CreateEntity("hash_collision_662382", {});
+    ASSERT_EQ(hash::Hash(first.name), hash::Hash(second.name));
+
+    EXPECT_EQ(first.id, entity_system.FindEntityByName("hash_collision_479599"));
+    EXPECT_EQ(second.id, entity_system.FindEntityByName("hash_collision_662382"));
+
+    // Released entities have an empty name but are not found by it.
+    EXPECT_EQ(mono::INVALID_ID, entity_system.FindEntityByName(""));
+
+    entity_system.ReleaseEntity(first.id);
+    entity_system.Sync();
+    EXPECT_EQ(mono::INVALID_ID, entity_system.FindEntityByName("hash_collision_479599"));
+    EXPECT_EQ(second.id, entity_system.FindEntityByName("hash_collision_662382"));
+
+    // Runtime names are copied per entity, the caller does not have to keep them alive.
+    std::string name = "renamed_entity";
+    entity_system.SetEntityName(second.id, name.c_str());
+    name = "something else";
+    EXPECT_STREQ("renamed_entity", entity_system.GetEntityName(second.id));
+    EXPECT_STREQ("renamed_entity", entity_system.GetEntity(second.id)->name);
+    EXPECT_EQ(second.id, entity_system.FindEntityByName("renamed_entity"));
+}
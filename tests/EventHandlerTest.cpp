@@ -1,9 +1,11 @@
 
 #include "gtest/gtest.h"
 #include "EventHandler/EventHandler.h"
+#include "Util/Delegate.h"
 #include "System/System.h"
 
 #include <functional>
+#include <vector>
 #include <cstdint>
 
 using namespace std::placeholders;
@@ -131,3 +133,148 @@ TEST(EventHandlerTest, stress_test)
     std::printf("add: %u ms, dispatch: %u ms, remove: %u ms\n", add_listener_diff, dispatch_diff, remove_diff);
     std::printf("---------------------\n");
 }
+
+TEST(EventHandlerTest, MemberFunctionListener)
+{
+    TestClass object;
+
+    mono::EventHandler handler;
+    const mono::EventToken<TestEvent1> token = handler.AddListener(&object, &TestClass::OnEventFunc);
+
+    handler.DispatchEvent(TestEvent1());
+    EXPECT_TRUE(object.receivedEvent);
+
+    object.receivedEvent = false;
+    handler.RemoveListener(token);
+    handler.DispatchEvent(TestEvent1());
+    EXPECT_FALSE(object.receivedEvent);
+}
+
+TEST(EventHandlerTest, RemovedTokenDoesNotRemoveNewListener)
+{
+    mono::EventHandler handler;
+
+    int first_calls = 0;
+    int second_calls = 0;
+
+    const mono::EventToken<TestEvent1> first_token = handler.AddListener<TestEvent1>([&first_calls](const TestEvent1&) {
+        first_calls++;
+        return mono::EventResult::PASS_ON;
+    });
+    handler.RemoveListener(first_token);
+
+    handler.AddListener<TestEvent1>([&second_calls](const TestEvent1&) {
+        second_calls++;
+        return mono::EventResult::PASS_ON;
+    });
+
+    // The slot of the first token is reused by the second listener.
+    handler.RemoveListener(first_token);
+    handler.DispatchEvent(TestEvent1());
+
+    EXPECT_EQ(0, first_calls);
+    EXPECT_EQ(1, second_calls);
+}
+
+TEST(EventHandlerTest, AddAndRemoveDuringDispatch)
+{
+    mono::EventHandler handler;
+
+    int removed_calls = 0;
+    int added_calls = 0;
+    mono::EventToken<TestEvent1> removed_token;
+
+    const auto added_listener = [&added_calls](const TestEvent1&) {
+        added_calls++;
+        return mono::EventResult::PASS_ON;
+    };
+
+    handler.AddListener<TestEvent1>([&](const TestEvent1&) {
+        handler.RemoveListener(removed_token);
+        handler.AddListener<TestEvent1>(added_listener);
+        return mono::EventResult::PASS_ON;
+    });
+    removed_token = handler.AddListener<TestEvent1>([&removed_calls](const TestEvent1&) {
+        removed_calls++;
+        return mono::EventResult::PASS_ON;
+    });
+
+    handler.DispatchEvent(TestEvent1());
+    EXPECT_EQ(0, removed_calls);
+    EXPECT_EQ(0, added_calls);
+
+    handler.DispatchEvent(TestEvent1());
+    EXPECT_EQ(0, removed_calls);
+    EXPECT_EQ(1, added_calls);
+}
+
+TEST(EventHandlerTest, QueuedEventsKeepOrder)
+{
+    struct ValueEvent
+    {
+        int value;
+    };
+
+    mono::EventHandler handler;
+    std::vector<int> received;
+
+    handler.AddListener<ValueEvent>([&received](const ValueEvent& event) {
+        received.push_back(event.value);
+        return mono::EventResult::PASS_ON;
+    });
+    handler.AddListener<TestEvent1>([&received](const TestEvent1&) {
+        received.push_back(-1);
+        return mono::EventResult::PASS_ON;
+    });
+
+    handler.QueueEvent(ValueEvent{ 1 });
+    handler.QueueEvent(ValueEvent{ 2 });
+    handler.QueueEvent(TestEvent1());
+    handler.QueueEvent(ValueEvent{ 3 });
+    handler.QueueEvent(TestEvent2());
+
+    EXPECT_TRUE(received.empty());
+
+    handler.DispatchQueuedEvents();
+    const std::vector<int> expected = { 1, 2, -1, 3 };
+    EXPECT_EQ(expected, received);
+
+    received.clear();
+    handler.DispatchQueuedEvents();
+    EXPECT_TRUE(received.empty());
+}
+
+TEST(EventHandlerTest, DelegateStorage)
+{
+    using TestDelegate = mono::Delegate<int (int)>;
+
+    int offset = 10;
+    TestDelegate small = [&offset](int value) { return value + offset; };
+    EXPECT_EQ(15, small(5));
+
+    const std::vector<int> values = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    const auto large_callable = [values](int index) { return values[index]; };
+
+    struct LargeCallable
+    {
+        int operator () (int value) const
+        {
+            return value + padding[0];
+        }
+        int padding[32] = { 1 };
+    };
+
+    TestDelegate large = LargeCallable();
+    TestDelegate large_copy = large;
+    TestDelegate moved = std::move(large);
+
+    EXPECT_FALSE(large);
+    EXPECT_EQ(3, large_copy(2));
+    EXPECT_EQ(3, moved(2));
+
+    TestDelegate from_vector = large_callable;
+    TestDelegate from_vector_copy = from_vector;
+    from_vector.Reset();
+    EXPECT_FALSE(from_vector);
+    EXPECT_EQ(4, from_vector_copy(3));
+}
@@ -0,0 +1,56 @@
+
+#include "Rendering/Text/GlyphAtlas.h"
+#include "gtest/gtest.h"
+
+TEST(GlyphAtlasTest, PacksIntoShelves)
+{
+    mono::GlyphAtlas atlas(32, 32);
+    EXPECT_FALSE(atlas.IsDirty());
+
+    uint32_t x;
+    uint32_t y;
+
+    // One pixel of padding right and below each rectangle.
+    ASSERT_TRUE(atlas.Allocate(9, 9, x, y));
+    EXPECT_EQ(0u, x);
+    EXPECT_EQ(0u, y);
+
+    ASSERT_TRUE(atlas.Allocate(9, 5, x, y));
+    EXPECT_EQ(10u, x);
+    EXPECT_EQ(0u, y);
+
+    // Does not fit on the first shelf, opens a new one.
+    ASSERT_TRUE(atlas.Allocate(15, 5, x, y));
+    EXPECT_EQ(0u, x);
+    EXPECT_EQ(10u, y);
+
+    // Best fit picks the lower second shelf.
+    ASSERT_TRUE(atlas.Allocate(4, 4, x, y));
+    EXPECT_EQ(16u, x);
+    EXPECT_EQ(10u, y);
+
+    EXPECT_FALSE(atlas.Allocate(8, 20, x, y));
+    EXPECT_FALSE(atlas.Allocate(40, 2, x, y));
+}
+
+TEST(GlyphAtlasTest, WriteCopiesRowsAndMarksDirty)
+{
+    mono::GlyphAtlas atlas(4, 4);
+
+    const uint8_t pixels[] = { 1, 2, 3, 4 };
+    atlas.Write(1, 2, 2, 2, pixels);
+    EXPECT_TRUE(atlas.IsDirty());
+
+    EXPECT_EQ(1, atlas.Pixels()[2 * 4 + 1]);
+    EXPECT_EQ(2, atlas.Pixels()[2 * 4 + 2]);
+    EXPECT_EQ(3, atlas.Pixels()[3 * 4 + 1]);
+    EXPECT_EQ(4, atlas.Pixels()[3 * 4 + 2]);
+    EXPECT_EQ(0, atlas.Pixels()[0]);
+
+    atlas.ClearDirty();
+    EXPECT_FALSE(atlas.IsDirty());
+
+    atlas.Clear();
+    EXPECT_TRUE(atlas.IsDirty());
+    EXPECT_EQ(0, atlas.Pixels()[2 * 4 + 1]);
+}
@@ -2,6 +2,10 @@
 #include "System/Hash.h"
 #include "gtest/gtest.h"
 
+#include <string>
+#include <thread>
+#include <vector>
+
 TEST(HashTest, HashStringAndCompare)
 {
     constexpr const char* string_to_hash = "hello";
@@ -15,3 +19,76 @@ TEST(HashTest, HashStringAndCompare)
     EXPECT_NE(first_hash, third_hash);
 }
 
+
+TEST(HashTest, LiteralIsConstant)
+{
+    using namespace hash::literals;
+
+    constexpr uint32_t literal_hash = "transformsystem"_hash;
+    static_assert(literal_hash == hash::Hash("transformsystem"));
+    EXPECT_EQ(hash::Hash(std::string("transformsystem").c_str()), literal_hash);
+}
+
+TEST(HashTest, InternAndLookup)
+{
+    const std::string name = "entities/hash_test_entity.entity";
+
+    const char* interned = hash::InternString(name.c_str());
+    EXPECT_NE(name.c_str(), interned);
+    EXPECT_STREQ(name.c_str(), interned);
+    EXPECT_EQ(interned, hash::InternString("entities/hash_test_entity.entity"));
+
+    const uint32_t name_hash = hash::HashRegisterString(name.c_str());
+    EXPECT_EQ(hash::Hash(name.c_str()), name_hash);
+    EXPECT_EQ(interned, hash::HashLookup(name_hash));
+    EXPECT_STREQ("unknown", hash::HashLookup(hash::Hash("hash_test_never_registered")));
+}
+
+TEST(HashTest, InternFromManyThreads)
+{
+    constexpr uint32_t n_threads = 4;
+    constexpr uint32_t n_strings = 500;
+
+    std::vector<std::vector<const char*>> interned(n_threads);
+    std::vector<std::thread> threads;
+
+    for(uint32_t thread_index = 0; thread_index < n_threads; ++thread_index)
+    {
+        threads.emplace_back([thread_index, &interned]() {
+            for(uint32_t index = 0; index < n_strings; ++index)
+            {
+                const std::string string = "hash_test_" + std::to_string(index);
+                interned[thread_index].push_back(hash::InternString(string.c_str()));
+            }
+        });
+    }
+
+    for(std::thread& thread : threads)
+        thread.join();
+
+    for(uint32_t index = 0; index < n_strings; ++index)
+    {
+        const std::string string = "hash_test_" + std::to_string(index);
+        EXPECT_STREQ(string.c_str(), interned[0][index]);
+
+        for(uint32_t thread_index = 1; thread_index < n_threads; ++thread_index)
+            EXPECT_EQ(interned[0][index], interned[thread_index][index]);
+    }
+}
+
+TEST(HashTest, CollidingStringsAreInternedSeparately)
+{
+    // Two strings with the same 32 bit hash.
+    const std::string first = "hash_collision_479599";
+    const std::string second = "hash_collision_662382";
+    ASSERT_EQ(hash::Hash(first.c_str()), hash::Hash(second.c_str()));
+
+    const char* first_interned = hash::InternString(first.c_str());
+    const char* second_interned = hash::InternString(second.c_str());
+
+    EXPECT_STREQ(first.c_str(), first_interned);
+    EXPECT_STREQ(second.c_str(), second_interned);
+    EXPECT_EQ(first_interned, hash::InternString(first.c_str()));
+    EXPECT_EQ(second_interned, hash::InternString(second.c_str()));
+    EXPECT_EQ(hash::HashRegisterString(first.c_str()), hash::HashRegisterString(second.c_str()));
+}
@@ -0,0 +1,126 @@
+
+#include "Util/JobPool.h"
+#include "Math/Matrix.h"
+#include "Math/Quad.h"
+#include "Math/MathFunctions.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    // Stand in for a batch drawer, Prepare does the same kind of work, transform, cull and sort.
+    struct BenchmarkDrawer
+    {
+        struct DrawData
+        {
+            math::Matrix transform;
+            math::Quad world_bb;
+        };
+
+        std::vector<math::Matrix> local_transforms;
+        std::vector<DrawData> to_draw;
+
+        void Prepare(const math::Matrix& parent, const math::Quad& viewport)
+        {
+            to_draw.clear();
+
+            for(const math::Matrix& local : local_transforms)
+            {
+                const math::Matrix world = parent * local;
+                const math::Vector position = math::GetPosition(world);
+                const math::Quad world_bb(position, 1.0f);
+                if(math::QuadOverlaps(viewport, world_bb))
+                    to_draw.push_back({ world, world_bb });
+            }
+
+            const auto sort_on_y = [](const DrawData& first, const DrawData& second) {
+                return math::Bottom(first.world_bb) > math::Bottom(second.world_bb);
+            };
+            std::sort(to_draw.begin(), to_draw.end(), sort_on_y);
+        }
+    };
+}
+
+TEST(JobPoolTest, ParallelForVisitsEveryIndexOnce)
+{
+    mono::JobPool job_pool(3);
+    ASSERT_EQ(4u, job_pool.Threads());
+
+    std::vector<std::atomic<uint32_t>> visits(1000);
+    std::atomic<bool> valid_thread_index = true;
+
+    for(uint32_t iteration = 0; iteration < 10; ++iteration)
+    {
+        const auto func = [&](uint32_t index, uint32_t thread_index) {
+            visits[index]++;
+            if(thread_index >= job_pool.Threads())
+                valid_thread_index = false;
+        };
+        job_pool.ParallelFor(visits.size(), func);
+    }
+
+    EXPECT_TRUE(valid_thread_index);
+    for(const std::atomic<uint32_t>& count : visits)
+        EXPECT_EQ(10u, count);
+}
+
+TEST(JobPoolTest, NoWorkersRunsOnCallingThread)
+{
+    mono::JobPool job_pool(0);
+    ASSERT_EQ(1u, job_pool.Threads());
+
+    uint32_t sum = 0;
+    job_pool.ParallelFor(5, [&sum](uint32_t index, uint32_t thread_index) { sum += index + thread_index; });
+    EXPECT_EQ(10u, sum);
+}
+
+TEST(JobPoolTest, DISABLED_PrepareFrameBenchmark)
+{
+    constexpr uint32_t n_drawers = 32;
+    constexpr uint32_t n_entities = 2000;
+    constexpr uint32_t n_frames = 20;
+
+    std::vector<BenchmarkDrawer> drawers(n_drawers);
+    for(uint32_t drawer_index = 0; drawer_index < n_drawers; ++drawer_index)
+    {
+        for(uint32_t index = 0; index < n_entities; ++index)
+        {
+            math::Matrix transform;
+            math::Translate(transform, math::Vector(float(index % 100), float(index / 100 + drawer_index)));
+            drawers[drawer_index].local_transforms.push_back(transform);
+        }
+    }
+
+    const math::Quad viewport(0.0f, 0.0f, 50.0f, 30.0f);
+    const math::Matrix parent;
+
+    const auto run_frames = [&](uint32_t n_workers) {
+        mono::JobPool job_pool(n_workers);
+        const auto prepare = [&](uint32_t index, uint32_t thread_index) {
+            drawers[index].Prepare(parent, viewport);
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        for(uint32_t frame = 0; frame < n_frames; ++frame)
+            job_pool.ParallelFor(n_drawers, prepare);
+        const auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(end - start).count() / n_frames;
+    };
+
+    const uint32_t n_workers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const double single_thread_ms = run_frames(0);
+    const size_t single_thread_drawn = drawers.front().to_draw.size();
+    const double multi_thread_ms = run_frames(n_workers);
+
+    std::printf(
+        "Prepare frame, %u drawers x %u entities: 1 thread %.3f ms, %u threads %.3f ms\n",
+        n_drawers, n_entities, single_thread_ms, n_workers + 1, multi_thread_ms);
+
+    EXPECT_EQ(single_thread_drawn, drawers.front().to_draw.size());
+}
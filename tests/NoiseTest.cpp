@@ -0,0 +1,107 @@
+
+#include "Util/Noise.h"
+#include "Util/JobPool.h"
+#include "Math/Vector.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+TEST(NoiseTest, BatchMatchesScalar)
+{
+    std::vector<math::Vector> points;
+    for(int index = 0; index < 200; ++index)
+        points.emplace_back(index * 0.37f - 20.0f, index * 0.11f + 3.3f);
+
+    std::vector<float> perlin(points.size());
+    std::vector<float> fbm(points.size());
+    mono::Noise::Perlin(points.data(), points.size(), perlin.data());
+    mono::Noise::PerlinFbm(points.data(), points.size(), fbm.data());
+
+    for(size_t index = 0; index < points.size(); ++index)
+    {
+        const math::Vector& point = points[index];
+        EXPECT_FLOAT_EQ(mono::Noise::Perlin(point.x, point.y), perlin[index]);
+        EXPECT_FLOAT_EQ(mono::Noise::PerlinFbm(point.x, point.y), fbm[index]);
+    }
+}
+
+TEST(NoiseTest, GridMatchesScalar)
+{
+    mono::NoiseGrid grid;
+    grid.origin = math::Vector(-3.5f, 1.25f);
+    grid.step = math::Vector(0.1f, 0.3f);
+    grid.width = 37;
+    grid.height = 21;
+    grid.octaves = 6;
+
+    mono::JobPool job_pool(2);
+    std::vector<float> values(grid.width * grid.height);
+    mono::Noise::PerlinGrid(grid, values.data(), &job_pool);
+
+    for(uint32_t y = 0; y < grid.height; ++y)
+    {
+        for(uint32_t x = 0; x < grid.width; ++x)
+        {
+            const float noise_x = grid.origin.x + grid.step.x * float(x);
+            const float noise_y = grid.origin.y + grid.step.y * float(y);
+            EXPECT_FLOAT_EQ(mono::Noise::PerlinFbm(noise_x, noise_y), values[y * grid.width + x]);
+        }
+    }
+}
+
+TEST(NoiseTest, WrappedGridTiles)
+{
+    mono::NoiseGrid grid;
+    grid.step = math::Vector(0.125f, 0.125f);
+    grid.width = 65;
+    grid.height = 65;
+    grid.wrap = 8;
+    grid.octaves = 3;
+    grid.lacunarity = 2.0f;
+
+    std::vector<float> values(grid.width * grid.height);
+    mono::Noise::PerlinGrid(grid, values.data());
+
+    // Sample 64 is eight cells in, the same as sample 0.
+    for(uint32_t index = 0; index < grid.width; ++index)
+    {
+        EXPECT_FLOAT_EQ(values[index * grid.width], values[index * grid.width + 64]);
+        EXPECT_FLOAT_EQ(values[index], values[64 * grid.width + index]);
+    }
+}
+
+TEST(NoiseTest, DISABLED_Benchmark)
+{
+    mono::NoiseGrid grid;
+    grid.step = math::Vector(1.0f / 32.0f, 1.0f / 32.0f);
+    grid.width = 256;
+    grid.height = 256;
+    grid.octaves = 6;
+
+    std::vector<float> values(grid.width * grid.height);
+
+    const auto measure = [](const auto& generate) {
+        const auto start = std::chrono::steady_clock::now();
+        generate();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    const double scalar_ms = measure([&]() {
+        for(uint32_t y = 0; y < grid.height; ++y)
+        {
+            for(uint32_t x = 0; x < grid.width; ++x)
+                values[y * grid.width + x] = mono::Noise::PerlinFbm(grid.step.x * float(x), grid.step.y * float(y));
+        }
+    });
+    const float scalar_value = values.back();
+
+    const double grid_ms = measure([&]() {
+        mono::Noise::PerlinGrid(grid, values.data());
+    });
+
+    std::printf("256x256 fbm noise: scalar %.3f ms, grid %.3f ms\n", scalar_ms, grid_ms);
+    EXPECT_FLOAT_EQ(scalar_value, values.back());
+}
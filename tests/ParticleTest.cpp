@@ -0,0 +1,201 @@
+
+#include "Particle/ParticleSystem.h"
+#include "Rendering/Pipeline/ParticlePointPipeline.h"
+#include "Rendering/Color.h"
+#include "IUpdatable.h"
+#include "Math/Vector.h"
+#include "gtest/gtest.h"
+
+TEST(ParticleTest, PointVertexQuantization)
+{
+    static_assert(sizeof(mono::ParticlePointVertex) == 12);
+
+    const mono::Color::RGBA color(1.0f, 0.5f, 0.0f, 0.25f);
+    const mono::ParticlePointVertex vertex = mono::MakeParticlePointVertex(math::Vector(-1.0f, 0.5f), color, 64.0f, 7.0f);
+
+    EXPECT_EQ(-32767, vertex.position[0]);
+    EXPECT_NEAR(0.5f, vertex.position[1] / 32767.0f, 1.0f / 32767.0f);
+
+    EXPECT_EQ(255, vertex.color[0]);
+    EXPECT_EQ(128, vertex.color[1]);
+    EXPECT_EQ(0, vertex.color[2]);
+    EXPECT_EQ(64, vertex.color[3]);
+
+    EXPECT_NEAR(64.0f, vertex.point_size / 65535.0f * mono::PARTICLE_MAX_POINT_SIZE, 0.02f);
+
+    // Rotation wraps to one turn.
+    const float full_turn = 6.28318530718f;
+    EXPECT_NEAR(7.0f - full_turn, vertex.rotation / 65535.0f * full_turn, 0.001f);
+
+    const mono::ParticlePointVertex negative_rotation = mono::MakeParticlePointVertex(math::ZeroVec, color, 1.0f, -1.0f);
+    EXPECT_NEAR(full_turn - 1.0f, negative_rotation.rotation / 65535.0f * full_turn, 0.001f);
+    EXPECT_EQ(0, negative_rotation.position[0]);
+}
+
+TEST(ParticleTest, PoolBoundsFollowParticles)
+{
+    mono::ParticleSystem particle_system(1, 1);
+    mono::ParticlePoolComponent* pool = particle_system.AllocatePool(0, 100, mono::DefaultUpdater);
+    particle_system.AttachEmitter(0, math::Vector(10.0f, 20.0f), 1.0f, 100.0f, mono::EmitterType::BURST, mono::DefaultGenerator);
+
+    const mono::UpdateContext update_context = { 0, 0, 100, 0.1f, math::Quad(), 0.0f };
+    particle_system.Update(update_context);
+
+    ASSERT_GT(pool->count_alive, 0u);
+    EXPECT_FLOAT_EQ(32.0f, pool->max_point_size);
+
+    for(uint32_t index = 0; index < pool->count_alive; ++index)
+    {
+        const math::Vector& position = pool->position[index];
+        EXPECT_TRUE(position.x >= pool->bounds.mA.x && position.x <= pool->bounds.mB.x);
+        EXPECT_TRUE(position.y >= pool->bounds.mA.y && position.y <= pool->bounds.mB.y);
+    }
+
+    EXPECT_LE(pool->bounds.mA.x, 10.0f);
+    EXPECT_GE(pool->bounds.mB.y, 20.0f);
+}
+
+TEST(ParticleTest, InvisiblePoolSleeps)
+{
+    mono::ParticleSystem particle_system(1, 1);
+    mono::ParticlePoolComponent* pool = particle_system.AllocatePool(0, 100, mono::DefaultUpdater);
+    pool->sleep_when_not_visible = true;
+    particle_system.AttachEmitter(0, math::Vector(10.0f, 20.0f), -1.0f, 100.0f, mono::EmitterType::CONTINOUS, mono::DefaultGenerator);
+
+    const mono::UpdateContext update_context = { 0, 0, 100, 0.1f, math::Quad(), 0.0f };
+
+    particle_system.SetView(math::Quad(100.0f, 100.0f, 200.0f, 200.0f), 0.1f);
+    particle_system.Update(update_context);
+    EXPECT_FALSE(particle_system.IsPoolVisible(0));
+    EXPECT_EQ(0u, pool->count_alive);
+
+    // The emitter is kept in the bounds so the pool wakes up when it comes on screen.
+    EXPECT_FLOAT_EQ(10.0f, pool->bounds.mA.x);
+    EXPECT_FLOAT_EQ(20.0f, pool->bounds.mB.y);
+
+    particle_system.SetView(math::Quad(0.0f, 0.0f, 100.0f, 100.0f), 0.1f);
+    particle_system.Update(update_context);
+    EXPECT_TRUE(particle_system.IsPoolVisible(0));
+    EXPECT_GT(pool->count_alive, 0u);
+}
+
+TEST(ParticleTest, SleepingPoolBoundsFollowTheEmitters)
+{
+    mono::ParticleSystem particle_system(1, 1);
+    mono::ParticlePoolComponent* pool = particle_system.AllocatePool(0, 100, mono::DefaultUpdater);
+    pool->sleep_when_not_visible = true;
+    mono::ParticleEmitterComponent* emitter = particle_system.AttachEmitter(
+        0, math::Vector(10.0f, 20.0f), -1.0f, 100.0f, mono::EmitterType::CONTINOUS, mono::DefaultGenerator);
+
+    const mono::UpdateContext update_context = { 0, 0, 100, 0.1f, math::Quad(), 0.0f };
+    particle_system.SetView(math::Quad(1000.0f, 1000.0f, 1100.0f, 1100.0f), 0.1f);
+
+    // Moving the emitter while asleep does not grow the bounds over all the places it has been.
+    for(int index = 0; index < 10; ++index)
+    {
+        particle_system.SetEmitterPosition(emitter, math::Vector(10.0f + index * 10.0f, 20.0f));
+        particle_system.Update(update_context);
+    }
+
+    EXPECT_EQ(0u, pool->count_alive);
+    EXPECT_FLOAT_EQ(100.0f, pool->bounds.mA.x);
+    EXPECT_FLOAT_EQ(100.0f, pool->bounds.mB.x);
+}
+
+TEST(ParticleTest, ViewIsTakenFromTheUpdateContext)
+{
+    mono::ParticleSystem particle_system(1, 1);
+    mono::ParticlePoolComponent* pool = particle_system.AllocatePool(0, 100, mono::DefaultUpdater);
+    pool->sleep_when_not_visible = true;
+    particle_system.AttachEmitter(0, math::Vector(10.0f, 20.0f), -1.0f, 100.0f, mono::EmitterType::CONTINOUS, mono::DefaultGenerator);
+
+    // No view in the context, everything is visible.
+    mono::UpdateContext update_context = { 0, 0, 100, 0.1f, math::Quad(), 0.0f };
+    particle_system.Update(update_context);
+    EXPECT_TRUE(particle_system.IsPoolVisible(0));
+    EXPECT_GT(pool->count_alive, 0u);
+
+    update_context.viewport = math::Quad(1000.0f, 1000.0f, 1100.0f, 1100.0f);
+    update_context.world_per_pixel = 0.1f;
+    particle_system.Update(update_context);
+    EXPECT_FALSE(particle_system.IsPoolVisible(0));
+
+    update_context.viewport = math::Quad(0.0f, 0.0f, 100.0f, 100.0f);
+    particle_system.Update(update_context);
+    EXPECT_TRUE(particle_system.IsPoolVisible(0));
+}
+
+TEST(ParticleTest, BudgetCapsSpawns)
+{
+    mono::ParticleSystem particle_system(2, 2);
+    mono::ParticlePoolComponent* first_pool = particle_system.AllocatePool(0, 100, mono::DefaultUpdater);
+    mono::ParticlePoolComponent* second_pool = particle_system.AllocatePool(1, 100, mono::DefaultUpdater);
+    particle_system.AttachEmitter(0, math::ZeroVec, 1.0f, 50.0f, mono::EmitterType::BURST, mono::DefaultGenerator);
+    particle_system.AttachEmitter(1, math::ZeroVec, 1.0f, 50.0f, mono::EmitterType::BURST, mono::DefaultGenerator);
+
+    mono::ParticleBudgetConfig config;
+    config.max_alive_particles = 60;
+    config.max_spawns_per_frame = 40;
+    particle_system.GetBudget().SetConfig(config);
+
+    const mono::UpdateContext update_context = { 0, 0, 16, 0.016f, math::Quad(), 0.0f };
+    particle_system.Update(update_context);
+
+    EXPECT_EQ(40u, first_pool->count_alive);
+    EXPECT_EQ(0u, second_pool->count_alive);
+
+    const mono::ParticleSystemStats stats = particle_system.GetStats();
+    EXPECT_EQ(100u, stats.spawned_particles + stats.rejected_spawns);
+    EXPECT_EQ(40u, stats.spawned_particles);
+    EXPECT_EQ(40u, stats.simulated_particles);
+}
+
+TEST(ParticleTest, BudgetScalesEmitRateByDistance)
+{
+    mono::ParticleBudget budget(2);
+
+    mono::ParticleBudgetConfig config;
+    config.lod_near_distance = 10.0f;
+    config.lod_far_distance = 110.0f;
+    config.min_emit_scale = 0.2f;
+    budget.SetConfig(config);
+
+    // Not reported by the particle system yet.
+    EXPECT_FLOAT_EQ(1.0f, budget.EmitRateScale(0));
+
+    budget.SetView(math::Quad(-100.0f, -100.0f, 100.0f, 100.0f));
+    budget.SetPoolWorldBounds(0, math::Quad(-1.0f, -1.0f, 1.0f, 1.0f));
+    budget.SetPoolWorldBounds(1, math::Quad(160.0f, 0.0f, 162.0f, 2.0f));
+
+    EXPECT_FLOAT_EQ(1.0f, budget.EmitRateScale(0));
+    EXPECT_FLOAT_EQ(0.2f, budget.EmitRateScale(1));
+
+    // Half way between near and far, half of it on screen.
+    budget.SetPoolWorldBounds(1, math::Quad(60.0f, 0.0f, 140.0f, 2.0f));
+    EXPECT_NEAR(0.6f * 0.5f, budget.EmitRateScale(1), 0.0001f);
+}
+
+TEST(ParticleTest, BudgetScalesEmitRateFromTheUpdateContextView)
+{
+    mono::ParticleSystem particle_system(1, 1);
+    particle_system.AllocatePool(0, 1000, mono::DefaultUpdater);
+    particle_system.AttachEmitter(0, math::Vector(1000.0f, 0.0f), -1.0f, 1000.0f, mono::EmitterType::CONTINOUS, mono::DefaultGenerator);
+
+    mono::ParticleBudgetConfig config;
+    config.lod_near_distance = 10.0f;
+    config.lod_far_distance = 110.0f;
+    config.min_emit_scale = 0.2f;
+    particle_system.GetBudget().SetConfig(config);
+
+    mono::UpdateContext update_context = { 0, 0, 100, 0.1f, math::Quad(), 0.0f };
+    update_context.viewport = math::Quad(-100.0f, -100.0f, 100.0f, 100.0f);
+    update_context.world_per_pixel = 0.1f;
+
+    // The pool has no bounds on the first update, it emits at the full rate.
+    particle_system.Update(update_context);
+    EXPECT_EQ(100u, particle_system.GetStats().spawned_particles);
+
+    // Far away and off screen, down to the minimum rate.
+    particle_system.Update(update_context);
+    EXPECT_NEAR(20.0f, float(particle_system.GetStats().spawned_particles), 1.0f);
+}
@@ -0,0 +1,1080 @@
+
+#include "Physics/PhysicsSystem.h"
+#include "Physics/PhysicsSpace.h"
+#include "Physics/PhysicsDebugDrawer.h"
+#include "Physics/IBody.h"
+#include "Physics/RaycastBatch.h"
+#include "TransformSystem/TransformSystem.h"
+#include "IUpdatable.h"
+#include "Util/Random.h"
+#include "Util/JobPool.h"
+#include "Math/Matrix.h"
+#include "Math/Quad.h"
+#include "Math/MathFunctions.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t ALL_CATEGORIES = ~0u;
+
+    constexpr uint32_t N_COLUMNS = 40;
+    constexpr uint32_t N_ROWS = 50;
+    constexpr uint32_t N_BOXES = N_COLUMNS * N_ROWS;
+    constexpr uint32_t GROUND_ID = N_BOXES;
+
+    mono::PhysicsSystemInitParams MakeInitParams(bool hasty_space, uint32_t n_threads)
+    {
+        mono::PhysicsSystemInitParams init_params;
+        init_params.n_bodies = N_BOXES + 1;
+        init_params.n_polygon_shapes = N_BOXES + 1;
+        init_params.hasty_space = hasty_space;
+        init_params.n_solver_threads = n_threads;
+        init_params.fixed_time_step = 0.016f;
+        return init_params;
+    }
+
+    // Columns of boxes stacked on a kinematic ground box.
+    void CreateStackedBoxes(mono::PhysicsSystem& physics_system)
+    {
+        physics_system.GetSpace()->SetGravity(math::Vector(0.0f, -10.0f));
+
+        const mono::BodyComponent ground_params = { 0.0f, 0.0f, mono::BodyType::KINEMATIC };
+        physics_system.AllocateBody(GROUND_ID, ground_params);
+        physics_system.AddShape(GROUND_ID, mono::BoxComponent{ ALL_CATEGORIES, ALL_CATEGORIES, math::Vector(200.0f, 1.0f), math::ZeroVec, false });
+        physics_system.PositionBody(GROUND_ID, math::Vector(0.0f, -0.5f));
+
+        for(uint32_t column = 0; column < N_COLUMNS; ++column)
+        {
+            for(uint32_t row = 0; row < N_ROWS; ++row)
+            {
+                const uint32_t id = column * N_ROWS + row;
+
+                const mono::BodyComponent body_params = { 1.0f, 0.2f, mono::BodyType::DYNAMIC };
+                physics_system.AllocateBody(id, body_params);
+                physics_system.AddShape(id, mono::BoxComponent{ ALL_CATEGORIES, ALL_CATEGORIES, math::Vector(1.0f, 1.0f), math::ZeroVec, false });
+
+                const math::Vector position(column * 2.0f - N_COLUMNS, row + 0.5f);
+                physics_system.PositionBody(id, position);
+            }
+        }
+    }
+
+    std::vector<math::Vector> RunFrames(const std::vector<uint32_t>& frame_times)
+    {
+        mono::PhysicsSystemInitParams init_params;
+        init_params.n_bodies = N_BOXES + 1;
+        init_params.n_polygon_shapes = N_BOXES + 1;
+        init_params.fixed_time_step = 1.0f / 60.0f;
+        init_params.max_substeps = 8;
+
+        mono::TransformSystem transform_system(N_BOXES + 1);
+        mono::PhysicsSystem physics_system(init_params, &transform_system);
+        CreateStackedBoxes(physics_system);
+
+        mono::UpdateContext update_context = {};
+        for(uint32_t delta_ms : frame_times)
+        {
+            update_context.delta_ms = delta_ms;
+            update_context.delta_s = delta_ms / 1000.0f;
+            physics_system.Update(update_context);
+            update_context.frame_count++;
+        }
+
+        std::vector<math::Vector> positions;
+        for(uint32_t id = 0; id < N_BOXES; ++id)
+            positions.push_back(physics_system.GetBody(id)->GetPosition());
+
+        return positions;
+    }
+
+    double StepStackedBoxes(mono::PhysicsSystem& physics_system, uint32_t n_steps)
+    {
+        mono::UpdateContext update_context = {};
+        update_context.delta_ms = 16;
+        update_context.delta_s = 0.016f;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for(uint32_t index = 0; index < n_steps; ++index)
+        {
+            update_context.frame_count = index;
+            physics_system.Update(update_context);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / n_steps;
+    }
+}
+
+TEST(PhysicsTest, HastySpaceSolverThreads)
+{
+    mono::TransformSystem transform_system(1);
+
+    mono::PhysicsSystem default_system(MakeInitParams(false, 1), &transform_system);
+    EXPECT_EQ(1u, default_system.GetSpace()->GetSolverThreads());
+
+    mono::PhysicsSystem hasty_system(MakeInitParams(true, 2), &transform_system);
+    EXPECT_EQ(2u, hasty_system.GetSpace()->GetSolverThreads());
+
+    // Chipmunk runs the solver on at most two threads.
+    mono::PhysicsSystem clamped_system(MakeInitParams(true, 8), &transform_system);
+    EXPECT_EQ(2u, clamped_system.GetSpace()->GetSolverThreads());
+}
+
+TEST(PhysicsTest, DISABLED_StackedBoxesBenchmark)
+{
+    constexpr uint32_t n_steps = 30;
+
+    struct Config
+    {
+        const char* name;
+        bool hasty_space;
+        uint32_t n_threads;
+    };
+
+    const Config configs[] = {
+        { "default", false, 1 },
+        { "hasty", true, 1 },
+        { "hasty", true, 2 },
+    };
+
+    std::printf("---------------------\n");
+
+    for(const Config& config : configs)
+    {
+        mono::TransformSystem transform_system(N_BOXES + 1);
+        mono::PhysicsSystem physics_system(MakeInitParams(config.hasty_space, config.n_threads), &transform_system);
+        CreateStackedBoxes(physics_system);
+
+        const double step_ms = StepStackedBoxes(physics_system, n_steps);
+
+        // The stacks should settle on the ground and not fall through or explode.
+        const math::Vector top_position = physics_system.GetBody(N_ROWS - 1)->GetPosition();
+        EXPECT_TRUE(std::isfinite(top_position.x) && std::isfinite(top_position.y));
+        EXPECT_GT(top_position.y, 0.0f);
+
+        std::printf(
+            "%s space, %u solver threads, %u bodies: %.3f ms per step\n",
+            config.name, physics_system.GetSpace()->GetSolverThreads(), N_BOXES, step_ms);
+    }
+
+    std::printf("---------------------\n");
+}
+
+TEST(PhysicsTest, FixedStepIsIndependentOfFrameTimes)
+{
+    // 500 ms split in to frames in three different ways, 30 steps of 1/60 s and 0.2 ms left over.
+    const std::vector<uint32_t> steady_frames(50, 10);
+    const std::vector<uint32_t> hitching_frames = { 1, 2, 40, 7, 100, 3, 16, 16, 16, 33, 1, 1, 64, 50, 17, 33, 100 };
+    const std::vector<uint32_t> fast_frames(500, 1);
+
+    const std::vector<math::Vector> steady_positions = RunFrames(steady_frames);
+    const std::vector<math::Vector> hitching_positions = RunFrames(hitching_frames);
+    const std::vector<math::Vector> fast_positions = RunFrames(fast_frames);
+
+    for(uint32_t id = 0; id < N_BOXES; ++id)
+    {
+        ASSERT_EQ(steady_positions[id].x, hitching_positions[id].x);
+        ASSERT_EQ(steady_positions[id].y, hitching_positions[id].y);
+        ASSERT_EQ(steady_positions[id].x, fast_positions[id].x);
+        ASSERT_EQ(steady_positions[id].y, fast_positions[id].y);
+    }
+}
+
+TEST(PhysicsTest, TransformIsInterpolatedBetweenSteps)
+{
+    mono::PhysicsSystemInitParams init_params;
+    init_params.n_bodies = 1;
+    init_params.fixed_time_step = 0.01f;
+
+    mono::TransformSystem transform_system(1);
+    mono::PhysicsSystem physics_system(init_params, &transform_system);
+
+    const mono::BodyComponent body_params = { 1.0f, 1.0f, mono::BodyType::DYNAMIC };
+    mono::IBody* body = physics_system.AllocateBody(0, body_params);
+    physics_system.PositionBody(0, math::ZeroVec);
+    body->SetVelocity(math::Vector(100.0f, 0.0f));
+
+    mono::UpdateContext update_context = {};
+    update_context.delta_ms = 15;
+    physics_system.Update(update_context);
+
+    // One step of 10 ms, and half way to the next one.
+    EXPECT_EQ(1u, physics_system.GetStats().substeps);
+    EXPECT_FLOAT_EQ(1.0f, body->GetPosition().x);
+    EXPECT_FLOAT_EQ(0.5f, math::GetPosition(transform_system.GetTransform(0)).x);
+
+    update_context.delta_ms = 5;
+    physics_system.Update(update_context);
+
+    EXPECT_EQ(1u, physics_system.GetStats().substeps);
+    EXPECT_FLOAT_EQ(2.0f, body->GetPosition().x);
+
+    // No time left over, the transform is at the previous step.
+    EXPECT_FLOAT_EQ(1.0f, math::GetPosition(transform_system.GetTransform(0)).x);
+
+    // A hitch runs at most max_substeps steps.
+    update_context.delta_ms = 1000;
+    physics_system.Update(update_context);
+    EXPECT_EQ(init_params.max_substeps, physics_system.GetStats().substeps);
+}
+
+TEST(PhysicsTest, SleepingBodiesAreNotSynced)
+{
+    mono::PhysicsSystemInitParams init_params;
+    init_params.n_bodies = 2;
+    init_params.fixed_time_step = 0.01f;
+    init_params.sleep_time_threshold = 0.5f;
+    init_params.idle_speed_threshold = 0.1f;
+
+    mono::TransformSystem transform_system(2);
+    mono::PhysicsSystem physics_system(init_params, &transform_system);
+
+    const mono::BodyComponent body_params = { 1.0f, 1.0f, mono::BodyType::DYNAMIC };
+    mono::IBody* resting_body = physics_system.AllocateBody(0, body_params);
+    mono::IBody* moving_body = physics_system.AllocateBody(1, body_params);
+    moving_body->SetVelocity(math::Vector(1.0f, 0.0f));
+
+    mono::UpdateContext update_context = {};
+    update_context.delta_ms = 10;
+
+    physics_system.Update(update_context);
+    EXPECT_EQ(2u, physics_system.GetStats().awake_bodies);
+
+    // The resting body falls asleep after the sleep time threshold.
+    for(int index = 0; index < 100; ++index)
+        physics_system.Update(update_context);
+
+    EXPECT_EQ(1u, physics_system.GetStats().awake_bodies);
+    EXPECT_EQ(1u, physics_system.GetStats().synced_transforms);
+
+    transform_system.SetTransformState(0, mono::TransformState::NONE);
+    physics_system.Update(update_context);
+    EXPECT_EQ(mono::TransformState::NONE, transform_system.GetTransformState(0));
+
+    // Moving a sleeping body wakes it up, and the transform is synced again. The transform is interpolated
+    // from the previous step, so it moves on the second update.
+    resting_body->SetVelocity(math::Vector(0.0f, 1.0f));
+    physics_system.Update(update_context);
+    physics_system.Update(update_context);
+
+    EXPECT_EQ(2u, physics_system.GetStats().awake_bodies);
+    EXPECT_EQ(2u, physics_system.GetStats().synced_transforms);
+    EXPECT_EQ(mono::TransformState::PHYSICS, transform_system.GetTransformState(0));
+}
+
+TEST(PhysicsTest, ReleasedBodiesAreNotSynced)
+{
+    mono::PhysicsSystemInitParams init_params;
+    init_params.n_bodies = 1;
+    init_params.fixed_time_step = 0.01f;
+
+    mono::TransformSystem transform_system(1);
+    mono::PhysicsSystem physics_system(init_params, &transform_system);
+
+    const mono::BodyComponent body_params = { 1.0f, 1.0f, mono::BodyType::DYNAMIC };
+    mono::IBody* body = physics_system.AllocateBody(0, body_params);
+    body->SetVelocity(math::Vector(1.0f, 0.0f));
+
+    mono::UpdateContext update_context = {};
+    update_context.delta_ms = 10;
+    physics_system.Update(update_context);
+    EXPECT_EQ(1u, physics_system.GetStats().awake_bodies);
+
+    physics_system.ReleaseBody(0);
+    transform_system.SetTransformState(0, mono::TransformState::NONE);
+
+    // Too short for a step, the transforms are only interpolated.
+    update_context.delta_ms = 5;
+    physics_system.Update(update_context);
+
+    EXPECT_EQ(0u, physics_system.GetStats().awake_bodies);
+    EXPECT_EQ(0u, physics_system.GetStats().synced_transforms);
+    EXPECT_EQ(mono::TransformState::NONE, transform_system.GetTransformState(0));
+}
+
+namespace
+{
+    struct BroadphaseScene
+    {
+        const char* name;
+        uint32_t n_bodies;
+        float min_radius;
+        float max_radius;
+        float half_extent;
+        mono::PhysicsBroadphase expected_auto;
+    };
+
+    void CreateSwarm(mono::PhysicsSystem& physics_system, const BroadphaseScene& scene)
+    {
+        mono::RandomGenerator random;
+
+        for(uint32_t id = 0; id < scene.n_bodies; ++id)
+        {
+            const mono::BodyComponent body_params = { 1.0f, 1.0f, mono::BodyType::DYNAMIC };
+            mono::IBody* body = physics_system.AllocateBody(id, body_params);
+
+            // Positioned before the shape is added, or all shapes are first inserted at the origin.
+            const float x = random.Range(-scene.half_extent, scene.half_extent);
+            const float y = random.Range(-scene.half_extent, scene.half_extent);
+            physics_system.PositionBody(id, math::Vector(x, y));
+
+            const float radius = random.Range(scene.min_radius, scene.max_radius);
+            physics_system.AddShape(id, mono::CircleComponent{ ALL_CATEGORIES, ALL_CATEGORIES, radius, math::ZeroVec, false });
+            body->SetVelocity(math::Vector(random.Range(-5.0f, 5.0f), random.Range(-5.0f, 5.0f)));
+        }
+    }
+
+    double RunBroadphaseScene(const BroadphaseScene& scene, mono::PhysicsBroadphase broadphase, mono::PhysicsBroadphase& out_used)
+    {
+        mono::PhysicsSystemInitParams init_params;
+        init_params.n_bodies = scene.n_bodies;
+        init_params.n_circle_shapes = scene.n_bodies;
+        init_params.fixed_time_step = 0.016f;
+        init_params.broadphase = broadphase;
+        init_params.spatial_hash_cell_size = (scene.min_radius + scene.max_radius);
+        init_params.spatial_hash_cells = scene.n_bodies * 10;
+
+        mono::TransformSystem transform_system(scene.n_bodies);
+        mono::PhysicsSystem physics_system(init_params, &transform_system);
+        CreateSwarm(physics_system, scene);
+
+        const double step_ms = StepStackedBoxes(physics_system, 10);
+        out_used = physics_system.GetSpace()->GetBroadphase();
+        return step_ms;
+    }
+}
+
+TEST(PhysicsTest, DISABLED_BroadphaseBenchmark)
+{
+    const BroadphaseScene scenes[] = {
+        { "swarm", 3000, 0.4f, 0.6f, 60.0f, mono::PhysicsBroadphase::SPATIAL_HASH },
+        { "mixed sizes", 3000, 0.1f, 4.0f, 200.0f, mono::PhysicsBroadphase::BB_TREE },
+    };
+
+    std::printf("---------------------\n");
+
+    for(const BroadphaseScene& scene : scenes)
+    {
+        mono::PhysicsBroadphase used;
+        const double tree_ms = RunBroadphaseScene(scene, mono::PhysicsBroadphase::BB_TREE, used);
+        const double hash_ms = RunBroadphaseScene(scene, mono::PhysicsBroadphase::SPATIAL_HASH, used);
+        RunBroadphaseScene(scene, mono::PhysicsBroadphase::AUTO, used);
+
+        std::printf(
+            "%s, %u bodies: tree %.3f ms, spatial hash %.3f ms per step, auto picked %s\n",
+            scene.name, scene.n_bodies, tree_ms, hash_ms, (used == mono::PhysicsBroadphase::SPATIAL_HASH) ? "spatial hash" : "tree");
+
+        EXPECT_EQ(scene.expected_auto, used);
+    }
+
+    std::printf("---------------------\n");
+}
+
+TEST(PhysicsTest, BroadphaseAutoPicksFromShapeSizes)
+{
+    const BroadphaseScene scenes[] = {
+        { "swarm", 300, 0.4f, 0.6f, 20.0f, mono::PhysicsBroadphase::SPATIAL_HASH },
+        { "mixed sizes", 300, 0.1f, 4.0f, 60.0f, mono::PhysicsBroadphase::BB_TREE },
+    };
+
+    for(const BroadphaseScene& scene : scenes)
+    {
+        mono::PhysicsBroadphase used;
+        RunBroadphaseScene(scene, mono::PhysicsBroadphase::AUTO, used);
+        EXPECT_EQ(scene.expected_auto, used) << scene.name;
+    }
+}
+
+TEST(PhysicsTest, QueriesWriteIntoCallerBuffers)
+{
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 1);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+
+    const math::Quad world_bb(-10.0f, 0.0f, 10.0f, 10.0f);
+    const std::vector<mono::QueryResult> found_bodies = space->QueryBox(world_bb, ALL_CATEGORIES);
+    ASSERT_FALSE(found_bodies.empty());
+
+    mono::QueryResult results[1024];
+    const uint32_t n_found = space->QueryBox(world_bb, ALL_CATEGORIES, results, std::size(results));
+    ASSERT_EQ(found_bodies.size(), n_found);
+    for(uint32_t index = 0; index < n_found; ++index)
+        EXPECT_EQ(found_bodies[index].body, results[index].body);
+
+    // Results that do not fit are dropped.
+    EXPECT_EQ(4u, space->QueryBox(world_bb, ALL_CATEGORIES, results, 4));
+
+    uint32_t n_visited = 0;
+    space->QueryBox(world_bb, ALL_CATEGORIES, [&n_visited](const mono::QueryResult& result) {
+        n_visited++;
+    });
+    EXPECT_EQ(n_found, n_visited);
+
+    const math::Vector position(0.0f, 5.0f);
+    EXPECT_EQ(space->QueryRadius(position, 3.0f, ALL_CATEGORIES).size(), space->QueryRadius(position, 3.0f, ALL_CATEGORIES, results, std::size(results)));
+
+    const math::Vector start(-20.0f, 0.5f);
+    const math::Vector end(20.0f, 0.5f);
+    EXPECT_EQ(
+        space->QueryAllInLIne(start, end, 1.0f, ALL_CATEGORIES).size(),
+        space->QueryAllInLIne(start, end, 1.0f, ALL_CATEGORIES, results, std::size(results)));
+
+    // The nearest body that is not the ground.
+    const mono::QueryResult nearest = space->QueryNearest(math::Vector(0.0f, -0.5f), 5.0f, ALL_CATEGORIES, [](uint32_t entity_id, const math::Vector& point) {
+        return entity_id != GROUND_ID;
+    });
+    ASSERT_NE(nullptr, nearest.body);
+    EXPECT_NE(GROUND_ID, mono::PhysicsSystem::GetIdFromBody(nearest.body));
+
+    const mono::QueryFilter std_function_filter = [](uint32_t entity_id, const math::Vector& point) {
+        return entity_id != GROUND_ID;
+    };
+    EXPECT_EQ(nearest.body, space->QueryNearest(math::Vector(0.0f, -0.5f), 5.0f, ALL_CATEGORIES, std_function_filter).body);
+}
+
+TEST(PhysicsTest, DISABLED_RadiusQueryBatchBenchmark)
+{
+    constexpr uint32_t n_queries = 2000;
+    constexpr uint32_t max_results_per_query = 32;
+    constexpr float radius = 2.0f;
+
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 1);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+
+    mono::RandomGenerator random_generator(1);
+    std::vector<math::Vector> positions(n_queries);
+    std::vector<float> radii(n_queries, radius);
+    for(math::Vector& position : positions)
+    {
+        position.x = random_generator.Range(-float(N_COLUMNS), float(N_COLUMNS));
+        position.y = random_generator.Range(0.0f, float(N_ROWS));
+    }
+
+    const auto start_single = std::chrono::steady_clock::now();
+
+    std::vector<size_t> single_counts(n_queries);
+    for(uint32_t index = 0; index < n_queries; ++index)
+        single_counts[index] = space->QueryRadius(positions[index], radius, ALL_CATEGORIES).size();
+
+    const auto end_single = std::chrono::steady_clock::now();
+
+    std::vector<mono::QueryResult> results(n_queries * max_results_per_query);
+    std::vector<uint32_t> counts(n_queries);
+
+    mono::JobPool job_pool(2);
+    mono::JobPool* const job_pools[] = { nullptr, &job_pool };
+    double batch_ms[2];
+
+    for(uint32_t pool_index = 0; pool_index < 2; ++pool_index)
+    {
+        const auto start_batch = std::chrono::steady_clock::now();
+        space->QueryRadiusBatch(
+            positions.data(), radii.data(), n_queries, ALL_CATEGORIES, results.data(), max_results_per_query, counts.data(), job_pools[pool_index]);
+        const auto end_batch = std::chrono::steady_clock::now();
+        batch_ms[pool_index] = std::chrono::duration<double, std::milli>(end_batch - start_batch).count();
+
+        for(uint32_t index = 0; index < n_queries; ++index)
+            ASSERT_EQ(std::min<size_t>(single_counts[index], max_results_per_query), counts[index]);
+    }
+
+    const double single_ms = std::chrono::duration<double, std::milli>(end_single - start_single).count();
+
+    std::printf("---------------------\n");
+    std::printf(
+        "%u radius queries: %.3f ms one by one, %.3f ms batched, %.3f ms batched on %u threads\n",
+        n_queries, single_ms, batch_ms[0], batch_ms[1], job_pool.Threads());
+    std::printf("---------------------\n");
+}
+
+TEST(PhysicsTest, RadiusQueryBatchMatchesSingleQueries)
+{
+    constexpr uint32_t n_queries = 200;
+    constexpr uint32_t max_results_per_query = 4;
+
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 1);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+
+    mono::RandomGenerator random_generator(1);
+    std::vector<math::Vector> positions(n_queries);
+    std::vector<float> radii(n_queries);
+    for(uint32_t index = 0; index < n_queries; ++index)
+    {
+        positions[index].x = random_generator.Range(-float(N_COLUMNS), float(N_COLUMNS));
+        positions[index].y = random_generator.Range(0.0f, float(N_ROWS));
+        radii[index] = random_generator.Range(0.5f, 3.0f);
+    }
+
+    std::vector<mono::QueryResult> results(n_queries * max_results_per_query);
+    std::vector<uint32_t> counts(n_queries);
+
+    mono::JobPool job_pool(2);
+    mono::JobPool* const job_pools[] = { nullptr, &job_pool };
+
+    for(mono::JobPool* pool : job_pools)
+    {
+        space->QueryRadiusBatch(
+            positions.data(), radii.data(), n_queries, ALL_CATEGORIES, results.data(), max_results_per_query, counts.data(), pool);
+
+        // Results that do not fit in a query's slice are dropped.
+        for(uint32_t index = 0; index < n_queries; ++index)
+        {
+            const size_t n_single = space->QueryRadius(positions[index], radii[index], ALL_CATEGORIES).size();
+            ASSERT_EQ(std::min<size_t>(n_single, max_results_per_query), counts[index]);
+        }
+    }
+}
+
+TEST(PhysicsTest, DISABLED_RaycastBatchBenchmark)
+{
+    constexpr uint32_t n_agents = 500;
+    constexpr uint32_t n_targets = 4;
+
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 1);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+
+    // Agents looking at a few targets each, the rays that end up in the stacks hit a box.
+    mono::RandomGenerator random_generator(1);
+    mono::RaycastBatch batch;
+    batch.radius = 1.0f;
+    batch.Reserve(n_agents * n_targets);
+
+    for(uint32_t agent = 0; agent < n_agents; ++agent)
+    {
+        const math::Vector agent_position(random_generator.Range(-60.0f, 60.0f), random_generator.Range(0.0f, 80.0f));
+        for(uint32_t target = 0; target < n_targets; ++target)
+        {
+            const math::Vector target_position(random_generator.Range(-60.0f, 60.0f), random_generator.Range(0.0f, 80.0f));
+            batch.AddRay(agent_position, target_position, ALL_CATEGORIES);
+        }
+    }
+
+    const uint32_t n_rays = batch.Size();
+
+    const auto start_single = std::chrono::steady_clock::now();
+
+    std::vector<mono::IBody*> single_hits(n_rays);
+    for(uint32_t index = 0; index < n_rays; ++index)
+        single_hits[index] = space->QueryFirst(batch.starts[index], batch.ends[index], ALL_CATEGORIES).body;
+
+    const auto end_single = std::chrono::steady_clock::now();
+
+    const auto time_raycast = [&](mono::JobPool* job_pool) {
+        const auto start = std::chrono::steady_clock::now();
+        space->Raycast(batch, job_pool);
+        const auto end = std::chrono::steady_clock::now();
+
+        for(uint32_t index = 0; index < n_rays; ++index)
+            EXPECT_EQ(single_hits[index], batch.hit_bodies[index]);
+
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    mono::JobPool job_pool(2);
+
+    const double batch_ms = time_raycast(nullptr);
+    batch.SortSpatially();
+    const double sorted_ms = time_raycast(nullptr);
+    const double threaded_ms = time_raycast(&job_pool);
+
+    uint32_t n_hits = 0;
+    for(uint32_t index = 0; index < n_rays; ++index)
+    {
+        if(batch.hit_bodies[index])
+        {
+            n_hits++;
+            EXPECT_GE(batch.hit_fractions[index], 0.0f);
+            EXPECT_LE(batch.hit_fractions[index], 1.0f);
+        }
+    }
+    EXPECT_GT(n_hits, 0u);
+    EXPECT_LT(n_hits, n_rays);
+
+    const double single_ms = std::chrono::duration<double, std::milli>(end_single - start_single).count();
+
+    std::printf("---------------------\n");
+    std::printf(
+        "%u rays, %u hits: %.3f ms one by one, %.3f ms batched, %.3f ms sorted, %.3f ms sorted on %u threads\n",
+        n_rays, n_hits, single_ms, batch_ms, sorted_ms, threaded_ms, job_pool.Threads());
+    std::printf("---------------------\n");
+}
+
+TEST(PhysicsTest, RaycastBatchMatchesQueryFirst)
+{
+    constexpr uint32_t n_agents = 50;
+    constexpr uint32_t n_targets = 4;
+
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 1);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+
+    mono::RandomGenerator random_generator(1);
+    mono::RaycastBatch batch;
+    batch.radius = 1.0f;
+
+    for(uint32_t agent = 0; agent < n_agents; ++agent)
+    {
+        const math::Vector agent_position(random_generator.Range(-60.0f, 60.0f), random_generator.Range(0.0f, 80.0f));
+        for(uint32_t target = 0; target < n_targets; ++target)
+        {
+            const math::Vector target_position(random_generator.Range(-60.0f, 60.0f), random_generator.Range(0.0f, 80.0f));
+            batch.AddRay(agent_position, target_position, ALL_CATEGORIES);
+        }
+    }
+
+    const uint32_t n_rays = batch.Size();
+
+    // Sorting reorders the rays, the expected hits are looked up after each sort.
+    const auto check_hits = [&]() {
+        uint32_t n_hits = 0;
+        for(uint32_t index = 0; index < n_rays; ++index)
+        {
+            EXPECT_EQ(space->QueryFirst(batch.starts[index], batch.ends[index], ALL_CATEGORIES).body, batch.hit_bodies[index]);
+            if(batch.hit_bodies[index])
+            {
+                n_hits++;
+                EXPECT_GE(batch.hit_fractions[index], 0.0f);
+                EXPECT_LE(batch.hit_fractions[index], 1.0f);
+            }
+        }
+        return n_hits;
+    };
+
+    mono::JobPool job_pool(2);
+
+    space->Raycast(batch, nullptr);
+    const uint32_t n_hits = check_hits();
+    EXPECT_GT(n_hits, 0u);
+    EXPECT_LT(n_hits, n_rays);
+
+    batch.SortSpatially();
+    space->Raycast(batch, &job_pool);
+    EXPECT_EQ(n_hits, check_hits());
+}
+
+namespace
+{
+    class CountingCollisionHandler : public mono::ICollisionHandler
+    {
+    public:
+
+        mono::CollisionResolve OnCollideWith(
+            mono::IBody* body, const math::Vector& collision_point, const math::Vector& collision_normal, uint32_t categories) override
+        {
+            n_collisions++;
+            last_categories = categories;
+            return mono::CollisionResolve::NORMAL;
+        }
+
+        void OnSeparateFrom(mono::IBody* body) override
+        {
+            n_separations++;
+        }
+
+        uint32_t n_collisions = 0;
+        uint32_t n_separations = 0;
+        uint32_t last_categories = 0;
+    };
+}
+
+TEST(PhysicsTest, BufferedCollisionEvents)
+{
+    constexpr uint32_t GROUND_CATEGORY = 1;
+    constexpr uint32_t BOX_CATEGORY = 2;
+    constexpr uint32_t BOX_ID = 0;
+    constexpr uint32_t FLOOR_ID = 1;
+
+    mono::PhysicsSystemInitParams init_params;
+    init_params.n_bodies = 2;
+    init_params.buffer_collision_events = true;
+
+    mono::TransformSystem transform_system(2);
+    mono::PhysicsSystem physics_system(init_params, &transform_system);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+    space->SetGravity(math::Vector(0.0f, -10.0f));
+
+    const mono::BodyComponent ground_params = { 0.0f, 0.0f, mono::BodyType::KINEMATIC };
+    physics_system.AllocateBody(FLOOR_ID, ground_params);
+    physics_system.PositionBody(FLOOR_ID, math::Vector(0.0f, -0.5f));
+    physics_system.AddShape(FLOOR_ID, mono::BoxComponent{ GROUND_CATEGORY, ALL_CATEGORIES, math::Vector(20.0f, 1.0f), math::ZeroVec, false });
+
+    const mono::BodyComponent box_params = { 1.0f, 0.2f, mono::BodyType::DYNAMIC };
+    mono::IBody* box = physics_system.AllocateBody(BOX_ID, box_params);
+    physics_system.PositionBody(BOX_ID, math::Vector(0.0f, 1.0f));
+    physics_system.AddShape(BOX_ID, mono::BoxComponent{ BOX_CATEGORY, ALL_CATEGORIES, math::Vector(1.0f, 1.0f), math::ZeroVec, false });
+
+    CountingCollisionHandler handler;
+    box->AddCollisionHandler(&handler);
+
+    CountingCollisionHandler floor_handler;
+    physics_system.GetBody(FLOOR_ID)->AddCollisionHandler(&floor_handler);
+
+    mono::UpdateContext update_context = {};
+    update_context.delta_ms = 16;
+    update_context.delta_s = 0.016f;
+
+    for(uint32_t frame = 0; frame < 60 && handler.n_collisions == 0; ++frame)
+    {
+        physics_system.Update(update_context);
+        update_context.frame_count++;
+    }
+
+    ASSERT_EQ(1u, handler.n_collisions);
+    EXPECT_EQ(GROUND_CATEGORY, handler.last_categories);
+    EXPECT_EQ(1u, floor_handler.n_collisions);
+    EXPECT_EQ(BOX_CATEGORY, floor_handler.last_categories);
+
+    // One event for each body, grouped by the category of the body.
+    const std::vector<mono::CollisionEvent>& events = space->GetCollisionEvents();
+    ASSERT_EQ(2u, events.size());
+    EXPECT_EQ(GROUND_CATEGORY, events[0].category);
+    EXPECT_EQ(BOX_CATEGORY, events[1].category);
+
+    uint32_t n_box_events = 0;
+    const mono::CollisionEvent* box_events = space->GetCollisionEvents(BOX_CATEGORY, n_box_events);
+    ASSERT_EQ(1u, n_box_events);
+    EXPECT_EQ(mono::CollisionEventType::BEGIN, box_events[0].type);
+    EXPECT_EQ(BOX_ID, box_events[0].body_id);
+    EXPECT_EQ(FLOOR_ID, box_events[0].other_body_id);
+    EXPECT_EQ(GROUND_CATEGORY, box_events[0].other_category);
+
+    // The box rests on the ground, the contact does not separate.
+    for(uint32_t frame = 0; frame < 30; ++frame)
+        physics_system.Update(update_context);
+
+    EXPECT_GT(box->GetPosition().y, 0.0f);
+    EXPECT_EQ(0u, floor_handler.n_separations);
+
+    // Releasing the box outside of a step separates it right away.
+    physics_system.ReleaseBody(BOX_ID);
+    EXPECT_EQ(1u, floor_handler.n_separations);
+}
+
+namespace
+{
+    constexpr uint32_t REPLAY_COLUMNS = 8;
+    constexpr uint32_t REPLAY_ROWS = 6;
+    constexpr uint32_t REPLAY_BOXES = REPLAY_COLUMNS * REPLAY_ROWS;
+    constexpr uint32_t REPLAY_GROUND_ID = REPLAY_BOXES;
+
+    // With gravity the boxes are stacked on a kinematic ground. Without it they float, slow down and fall
+    // asleep, nothing holds them awake.
+    void CreateReplayScene(mono::PhysicsSystem& physics_system, bool gravity)
+    {
+        mono::PhysicsSpace* space = physics_system.GetSpace();
+
+        if(gravity)
+        {
+            space->SetGravity(math::Vector(0.0f, -10.0f));
+
+            const mono::BodyComponent ground_params = { 0.0f, 0.0f, mono::BodyType::KINEMATIC };
+            physics_system.AllocateBody(REPLAY_GROUND_ID, ground_params);
+            physics_system.PositionBody(REPLAY_GROUND_ID, math::Vector(0.0f, -0.5f));
+            physics_system.AddShape(
+                REPLAY_GROUND_ID, mono::BoxComponent{ ALL_CATEGORIES, ALL_CATEGORIES, math::Vector(100.0f, 1.0f), math::ZeroVec, false });
+        }
+        else
+        {
+            space->SetDamping(0.1f);
+        }
+
+        for(uint32_t column = 0; column < REPLAY_COLUMNS; ++column)
+        {
+            for(uint32_t row = 0; row < REPLAY_ROWS; ++row)
+            {
+                const uint32_t id = column * REPLAY_ROWS + row;
+
+                const mono::BodyComponent body_params = { 1.0f, 0.2f, mono::BodyType::DYNAMIC };
+                mono::IBody* body = physics_system.AllocateBody(id, body_params);
+                physics_system.PositionBody(id, math::Vector(column * 1.5f, row * 1.01f + 0.5f));
+                physics_system.AddShape(id, mono::BoxComponent{ ALL_CATEGORIES, ALL_CATEGORIES, math::Vector(1.0f, 1.0f), math::ZeroVec, false });
+
+                if(!gravity)
+                    body->SetVelocity(math::Vector((column % 2) ? -1.0f : 1.0f, 0.0f));
+            }
+        }
+
+        physics_system.CreateSpring(physics_system.GetBody(0), physics_system.GetBody(REPLAY_ROWS), 2.0f, 20.0f, 0.5f);
+        physics_system.CreateSlideJoint(
+            physics_system.GetBody(1), physics_system.GetBody(REPLAY_ROWS + 1), math::ZeroVec, math::ZeroVec, 1.0f, 3.0f);
+    }
+
+    struct ReplayFrame
+    {
+        std::vector<math::Vector> positions;
+        std::vector<math::Vector> velocities;
+        std::vector<float> angles;
+    };
+
+    // The input on a frame is an impulse on one of the boxes, every few frames.
+    std::vector<ReplayFrame> RunReplayFrames(mono::PhysicsSystem& physics_system, uint32_t first_frame, uint32_t n_frames, bool apply_inputs)
+    {
+        std::vector<ReplayFrame> frames;
+
+        mono::UpdateContext update_context = {};
+        update_context.delta_ms = 16;
+        update_context.delta_s = 0.016f;
+
+        for(uint32_t frame = first_frame; frame < first_frame + n_frames; ++frame)
+        {
+            if(apply_inputs && frame % 7 == 0)
+            {
+                mono::IBody* body = physics_system.GetBody((frame * 13) % REPLAY_BOXES);
+                body->ApplyImpulse(math::Vector(float(frame % 5) - 2.0f, 1.0f), math::Vector(0.0f, 0.1f));
+            }
+
+            update_context.frame_count = frame;
+            physics_system.Update(update_context);
+
+            ReplayFrame replay_frame;
+            for(uint32_t id = 0; id < REPLAY_BOXES; ++id)
+            {
+                const mono::IBody* body = physics_system.GetBody(id);
+                replay_frame.positions.push_back(body->GetPosition());
+                replay_frame.velocities.push_back(body->GetVelocity());
+                replay_frame.angles.push_back(body->GetAngle());
+            }
+
+            frames.push_back(replay_frame);
+        }
+
+        return frames;
+    }
+}
+
+TEST(PhysicsTest, SnapshotRestoreReplaysDeterministically)
+{
+    for(const bool gravity : { true, false })
+    {
+        mono::PhysicsSystemInitParams init_params;
+        init_params.n_bodies = REPLAY_BOXES + 1;
+        init_params.n_polygon_shapes = REPLAY_BOXES + 1;
+        init_params.fixed_time_step = 1.0f / 60.0f;
+        init_params.sleep_time_threshold = 0.5f;
+        init_params.idle_speed_threshold = 0.1f;
+
+        mono::TransformSystem transform_system(REPLAY_BOXES + 1);
+        mono::PhysicsSystem physics_system(init_params, &transform_system);
+        CreateReplayScene(physics_system, gravity);
+
+        // Let the boxes settle into contacts, and without gravity slow down and fall asleep.
+        RunReplayFrames(physics_system, 1, 180, false);
+
+        const auto count_sleeping = [&physics_system]() {
+            uint32_t n_sleeping = 0;
+            for(uint32_t id = 0; id < REPLAY_BOXES; ++id)
+                n_sleeping += physics_system.GetBody(id)->IsSleeping();
+            return n_sleeping;
+        };
+
+        const uint32_t n_sleeping = count_sleeping();
+        if(!gravity)
+        {
+            EXPECT_GT(n_sleeping, 0u);
+        }
+
+        // Taking a snapshot does not wake anything up.
+        std::vector<uint8_t> snapshot;
+        physics_system.Snapshot(snapshot);
+        EXPECT_EQ(n_sleeping, count_sleeping());
+
+        // A broken snapshot is rejected before anything is changed.
+        RunReplayFrames(physics_system, 181, 10, true);
+        const uint32_t n_sleeping_before_restore = count_sleeping();
+        const std::vector<uint8_t> truncated_snapshot(snapshot.begin(), snapshot.end() - 1);
+        EXPECT_FALSE(physics_system.Restore(truncated_snapshot));
+        EXPECT_EQ(n_sleeping_before_restore, count_sleeping());
+
+        ASSERT_TRUE(physics_system.Restore(snapshot));
+        EXPECT_EQ(n_sleeping, count_sleeping());
+        const std::vector<ReplayFrame> recorded = RunReplayFrames(physics_system, 181, 60, true);
+
+        ASSERT_TRUE(physics_system.Restore(snapshot));
+        const std::vector<ReplayFrame> replayed = RunReplayFrames(physics_system, 181, 60, true);
+
+        for(uint32_t frame = 0; frame < recorded.size(); ++frame)
+        {
+            for(uint32_t id = 0; id < REPLAY_BOXES; ++id)
+            {
+                ASSERT_EQ(recorded[frame].positions[id].x, replayed[frame].positions[id].x) << "frame " << frame << ", body " << id;
+                ASSERT_EQ(recorded[frame].positions[id].y, replayed[frame].positions[id].y) << "frame " << frame << ", body " << id;
+                ASSERT_EQ(recorded[frame].velocities[id].x, replayed[frame].velocities[id].x) << "frame " << frame << ", body " << id;
+                ASSERT_EQ(recorded[frame].velocities[id].y, replayed[frame].velocities[id].y) << "frame " << frame << ", body " << id;
+                ASSERT_EQ(recorded[frame].angles[id], replayed[frame].angles[id]) << "frame " << frame << ", body " << id;
+            }
+        }
+
+        // The boxes have to have moved, or there is nothing to compare.
+        EXPECT_NE(recorded.front().positions[0].x, recorded.back().positions[0].x);
+
+        // A snapshot only restores into the same bodies.
+        physics_system.ReleaseBody(REPLAY_BOXES - 1);
+        EXPECT_FALSE(physics_system.Restore(snapshot));
+    }
+}
+
+TEST(PhysicsTest, DISABLED_SnapshotBenchmark)
+{
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    StepStackedBoxes(physics_system, 5);
+
+    std::vector<uint8_t> snapshot;
+
+    const auto start_snapshot = std::chrono::steady_clock::now();
+    physics_system.Snapshot(snapshot);
+    const auto end_snapshot = std::chrono::steady_clock::now();
+
+    // A rollback restores and steps once per tick, the restore is measured on its own and against a step.
+    constexpr uint32_t N_TICKS = 100;
+    double restore_ms = 0.0;
+    double step_ms = 0.0;
+
+    for(uint32_t tick = 0; tick < N_TICKS; ++tick)
+    {
+        const auto start_restore = std::chrono::steady_clock::now();
+        const bool restored = physics_system.Restore(snapshot);
+        const auto end_restore = std::chrono::steady_clock::now();
+        ASSERT_TRUE(restored);
+
+        restore_ms += std::chrono::duration<double, std::milli>(end_restore - start_restore).count();
+        step_ms += StepStackedBoxes(physics_system, 1);
+    }
+
+    const double snapshot_ms = std::chrono::duration<double, std::milli>(end_snapshot - start_snapshot).count();
+
+    std::printf("---------------------\n");
+    std::printf(
+        "%u bodies, snapshot of %zu kb: %.3f ms to take, %.3f ms to restore, %.3f ms to step\n",
+        N_BOXES + 1, snapshot.size() / 1024, snapshot_ms, restore_ms / N_TICKS, step_ms / N_TICKS);
+    std::printf("---------------------\n");
+}
+
+TEST(PhysicsTest, DebugGeometryIsCulledToTheViewport)
+{
+    mono::TransformSystem transform_system(N_BOXES + 1);
+    mono::PhysicsSystem physics_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(physics_system);
+    physics_system.CreateSpring(physics_system.GetBody(0), physics_system.GetBody(1), 1.0f, 10.0f, 0.5f);
+    StepStackedBoxes(physics_system, 2);
+
+    mono::PhysicsSpace* space = physics_system.GetSpace();
+    mono::PhysicsDebugGeometry geometry;
+
+    const float pixel_size = 0.01f;
+    const math::Quad everything(-1000.0f, -1000.0f, 1000.0f, 1000.0f);
+    const math::Quad viewport(-10.0f, 0.0f, 10.0f, 10.0f);
+    const math::Quad empty_viewport(1000.0f, 1000.0f, 1010.0f, 1010.0f);
+
+    // Each box is a closed outline of four lines.
+    mono::TessellatePhysicsDebugGeometry(space, mono::PhysicsDebugComponents::DRAW_SHAPES, everything, pixel_size, geometry);
+    EXPECT_EQ((N_BOXES + 1) * 8, geometry.line_vertices.size());
+    EXPECT_EQ(geometry.line_vertices.size(), geometry.line_colors.size());
+    EXPECT_TRUE(geometry.triangle_vertices.empty());
+
+    mono::TessellatePhysicsDebugGeometry(space, mono::PhysicsDebugComponents::DRAW_SHAPES, viewport, pixel_size, geometry);
+    EXPECT_EQ(space->QueryBox(viewport, ALL_CATEGORIES).size() * 8, geometry.line_vertices.size());
+
+    // Two anchor dots and the zig zag of the spring.
+    mono::TessellatePhysicsDebugGeometry(space, mono::PhysicsDebugComponents::DRAW_CONSTRAINTS, everything, pixel_size, geometry);
+    EXPECT_EQ(12u, geometry.triangle_vertices.size());
+    EXPECT_EQ(geometry.triangle_vertices.size(), geometry.triangle_colors.size());
+    EXPECT_EQ(30u, geometry.line_vertices.size());
+
+    mono::TessellatePhysicsDebugGeometry(space, mono::PhysicsDebugComponents::DRAW_COLLISION_POINTS, everything, pixel_size, geometry);
+    EXPECT_FALSE(geometry.line_vertices.empty());
+
+    const uint32_t all_components =
+        mono::PhysicsDebugComponents::DRAW_SHAPES |
+        mono::PhysicsDebugComponents::DRAW_CONSTRAINTS |
+        mono::PhysicsDebugComponents::DRAW_COLLISION_POINTS;
+    mono::TessellatePhysicsDebugGeometry(space, all_components, empty_viewport, pixel_size, geometry);
+    EXPECT_TRUE(geometry.line_vertices.empty());
+    EXPECT_TRUE(geometry.triangle_vertices.empty());
+}
+
+TEST(PhysicsTest, ReleaseBodiesInOneGo)
+{
+    // Every other column of boxes.
+    std::vector<uint32_t> released_ids;
+    for(uint32_t column = 0; column < N_COLUMNS; column += 2)
+    {
+        for(uint32_t row = 0; row < N_ROWS; ++row)
+            released_ids.push_back(column * N_ROWS + row);
+    }
+
+    const math::Quad everything(-1000.0f, -1000.0f, 1000.0f, 1000.0f);
+    const uint32_t n_remaining = N_BOXES + 1 - released_ids.size();
+
+    mono::TransformSystem transform_system(N_BOXES + 1);
+
+    mono::PhysicsSystem one_by_one_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(one_by_one_system);
+    StepStackedBoxes(one_by_one_system, 2);
+
+    for(uint32_t body_id : released_ids)
+        one_by_one_system.ReleaseBody(body_id);
+
+    mono::PhysicsSystem batch_system(MakeInitParams(false, 1), &transform_system);
+    CreateStackedBoxes(batch_system);
+    StepStackedBoxes(batch_system, 2);
+
+    batch_system.ReleaseBodies(released_ids.data(), released_ids.size());
+
+    for(mono::PhysicsSystem* physics_system : { &one_by_one_system, &batch_system })
+    {
+        const mono::PhysicsSystemStats stats = physics_system->GetStats();
+        EXPECT_EQ(n_remaining, stats.shapes);
+        EXPECT_EQ(n_remaining, stats.polygon_shapes);
+
+        StepStackedBoxes(*physics_system, 2);
+
+        const std::vector<mono::QueryResult> found_bodies = physics_system->GetSpace()->QueryBox(everything, ALL_CATEGORIES);
+        EXPECT_EQ(n_remaining, found_bodies.size());
+        for(const mono::QueryResult& result : found_bodies)
+        {
+            const uint32_t body_id = mono::PhysicsSystem::GetIdFromBody(result.body);
+            EXPECT_FALSE(std::binary_search(released_ids.begin(), released_ids.end(), body_id));
+        }
+
+        EXPECT_LE(physics_system->GetStats().awake_bodies, n_remaining);
+    }
+
+    // The released ids and the pool data can be used again.
+    const uint32_t reused_id = released_ids.front();
+    const mono::BodyComponent body_params = { 1.0f, 0.2f, mono::BodyType::DYNAMIC };
+    batch_system.AllocateBody(reused_id, body_params);
+    batch_system.AddShape(reused_id, mono::BoxComponent{ ALL_CATEGORIES, ALL_CATEGORIES, math::Vector(1.0f, 1.0f), math::ZeroVec, false });
+    batch_system.PositionBody(reused_id, math::Vector(500.0f, 500.0f));
+    StepStackedBoxes(batch_system, 1);
+
+    EXPECT_EQ(n_remaining + 1, batch_system.GetStats().polygon_shapes);
+    EXPECT_EQ(n_remaining + 1, batch_system.GetSpace()->QueryBox(everything, ALL_CATEGORIES).size());
+}
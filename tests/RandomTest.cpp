@@ -2,6 +2,12 @@
 #include "Util/Random.h"
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
 TEST(RandomTest, ValidateRandomValueInsideRange0to1)
 {
     for(int index = 0; index < 1000; ++index)
@@ -11,3 +17,129 @@ TEST(RandomTest, ValidateRandomValueInsideRange0to1)
         EXPECT_LT(random, 1.0f);
     }
 }
+
+TEST(RandomTest, SequenceIsStableAcrossPlatforms)
+{
+    mono::RandomGenerator generator(666, 0);
+    EXPECT_EQ(0x9d3f00e4u, generator.Next());
+    EXPECT_EQ(0x40bc13a1u, generator.Next());
+    EXPECT_EQ(0x5ea90a9au, generator.Next());
+    EXPECT_EQ(0x83d1c592u, generator.Next());
+
+    mono::RandomGenerator other_stream(666, 1);
+    EXPECT_EQ(0x621c66fbu, other_stream.Next());
+}
+
+TEST(RandomTest, RangesAndFillUniform)
+{
+    mono::RandomGenerator generator;
+
+    bool seen_min = false;
+    bool seen_max = false;
+    for(int index = 0; index < 1000; ++index)
+    {
+        const int value = generator.RangeInt(-2, 2);
+        EXPECT_GE(value, -2);
+        EXPECT_LE(value, 2);
+        seen_min |= (value == -2);
+        seen_max |= (value == 2);
+    }
+
+    EXPECT_TRUE(seen_min);
+    EXPECT_TRUE(seen_max);
+
+    std::vector<float> values(1003);
+    generator.FillUniform(values.data(), values.size(), -5.0f, 5.0f);
+
+    float sum = 0.0f;
+    for(float value : values)
+    {
+        EXPECT_GT(value, -5.0f);
+        EXPECT_LT(value, 5.0f);
+        sum += value;
+    }
+
+    EXPECT_NEAR(0.0f, sum / values.size(), 0.5f);
+}
+
+TEST(RandomTest, SeedRandomRestartsThreadStream)
+{
+    mono::SeedRandom(1234);
+    const float first = mono::Random();
+    const int second = mono::RandomInt(0, 1000);
+
+    mono::SeedRandom(1234);
+    EXPECT_EQ(first, mono::Random());
+    EXPECT_EQ(second, mono::RandomInt(0, 1000));
+
+    mono::SeedRandom(mono::DEFAULT_RANDOM_SEED);
+}
+
+TEST(RandomTest, ThreadStreamIsStable)
+{
+    mono::SeedRandom(1234);
+
+    // The second thread to draw a number gets the same sequence as long as it uses the same stream.
+    std::vector<float> first_values;
+    std::vector<float> second_values;
+    const auto draw_func = [](uint64_t stream, std::vector<float>& values) {
+        mono::SetThreadRandomStream(stream);
+        for(int index = 0; index < 8; ++index)
+            values.push_back(mono::Random());
+    };
+
+    std::thread(draw_func, 3, std::ref(first_values)).join();
+    mono::Random();
+    std::thread(draw_func, 3, std::ref(second_values)).join();
+    EXPECT_EQ(first_values, second_values);
+
+    mono::RandomGenerator generator(1234, 3);
+    for(float value : first_values)
+        EXPECT_EQ(generator.Range(0.0f, 1.0f), value);
+
+    std::vector<float> other_values;
+    std::thread(draw_func, 4, std::ref(other_values)).join();
+    EXPECT_NE(first_values, other_values);
+
+    mono::SeedRandom(mono::DEFAULT_RANDOM_SEED);
+}
+
+TEST(RandomTest, DISABLED_Benchmark)
+{
+    constexpr uint32_t n_values = 1000000;
+    std::vector<float> values(n_values);
+
+    const auto measure = [](const auto& generate) {
+        const auto start = std::chrono::steady_clock::now();
+        generate();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    // What mono::Random used to do, a new distribution for each call over one shared engine.
+    std::default_random_engine engine(666);
+    const double std_ms = measure([&]() {
+        for(float& value : values)
+        {
+            std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+            value = distribution(engine);
+        }
+    });
+    const float std_value = values.back();
+
+    const double random_ms = measure([&]() {
+        for(float& value : values)
+            value = mono::Random(-1.0f, 1.0f);
+    });
+
+    const double fill_ms = measure([&]() {
+        mono::FillUniform(values.data(), values.size(), -1.0f, 1.0f);
+    });
+
+    std::printf(
+        "%u random floats: std::default_random_engine %.3f ms, mono::Random %.3f ms, mono::FillUniform %.3f ms\n",
+        n_values, std_ms, random_ms, fill_ms);
+
+    EXPECT_GE(std_value, -1.0f);
+    EXPECT_LE(std_value, 1.0f);
+}
@@ -0,0 +1,253 @@
+
+#include "Rendering/Text/TextLayoutCache.h"
+#include "Rendering/Text/TextFunctions.h"
+#include "Rendering/RenderSystem.h"
+#include "Rendering/Texture/ITextureFactory.h"
+#include "Math/MathFwd.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <string>
+#include <iterator>
+
+namespace
+{
+    constexpr int FONT_ID = 0;
+
+    // Font layout only needs the glyph metrics, the texture is never used.
+    class NoTextureFactory : public mono::ITextureFactory
+    {
+    public:
+
+        mono::ITexturePtr CreateTexture(const char* texture_name, mono::TextureSampler sampler) const override
+        {
+            return nullptr;
+        }
+        mono::ITexturePtr CreateTextureAsync(
+            const char* texture_name, mono::TextureLoadPriority priority, mono::TextureSampler sampler) const override
+        {
+            return nullptr;
+        }
+        void UploadPendingTextures() const override
+        { }
+        mono::ITexturePtr CreateTextureFromData(const byte* data, int data_length, const char* cache_name) const override
+        {
+            return nullptr;
+        }
+        mono::ITexturePtr CreateTexture(const byte* data, int width, int height, int color_components, mono::TextureSampler sampler) const override
+        {
+            return nullptr;
+        }
+        mono::ITexturePtr CreateFromNativeHandle(uint32_t native_handle) const override
+        {
+            return nullptr;
+        }
+        mono::ITexturePtr CreateDynamicTexture(int width, int height, int color_components) const override
+        {
+            return nullptr;
+        }
+        void UpdateDynamicTexture(mono::ITexture* texture, const byte* data) const override
+        { }
+    };
+
+    class TextLayoutCacheTest : public testing::Test
+    {
+    protected:
+
+        void SetUp() override
+        {
+            mono::LoadCustomTextureFactory(new NoTextureFactory);
+            mono::LoadFont(FONT_ID, MONO_SOURCE_DIR "/third_party/imgui/misc/fonts/ProggyClean.ttf", 13.0f, 0.1f);
+        }
+
+        void TearDown() override
+        {
+            mono::UnloadFonts();
+        }
+    };
+}
+
+TEST_F(TextLayoutCacheTest, SameStringSharesRun)
+{
+    mono::TextLayoutCache cache(16);
+
+    const uint32_t first_id = cache.Acquire(FONT_ID, "Hello", mono::FontCentering::DEFAULT_CENTER);
+    const uint32_t second_id = cache.Acquire(FONT_ID, "Hello", mono::FontCentering::DEFAULT_CENTER);
+    const uint32_t centered_id = cache.Acquire(FONT_ID, "Hello", mono::FontCentering::HORIZONTAL);
+
+    EXPECT_EQ(first_id, second_id);
+    EXPECT_NE(first_id, centered_id);
+    EXPECT_EQ(2u, cache.CachedRuns());
+    EXPECT_EQ(5u, cache.Run(first_id).n_glyphs);
+
+    std::vector<math::Vector> vertices(5 * 4);
+    std::vector<math::Vector> uvs(5 * 4);
+    mono::GenerateGlyphQuads(FONT_ID, "Hello", 5, mono::FontCentering::DEFAULT_CENTER, vertices.data(), uvs.data());
+
+    const mono::GlyphRun& run = cache.Run(first_id);
+    for(uint32_t index = 0; index < vertices.size(); ++index)
+    {
+        EXPECT_EQ(vertices[index], cache.Vertices()[run.vertex_offset + index]);
+        EXPECT_EQ(uvs[index], cache.UVs()[run.vertex_offset + index]);
+    }
+}
+
+TEST_F(TextLayoutCacheTest, EvictsUnreferencedRunsBeforeGrowing)
+{
+    mono::TextLayoutCache cache(8);
+
+    const uint32_t first_id = cache.Acquire(FONT_ID, "aaaa", mono::FontCentering::DEFAULT_CENTER);
+    const uint32_t second_id = cache.Acquire(FONT_ID, "bbbb", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(8u, cache.GlyphCapacity());
+
+    // Both runs are referenced, the arena has to grow.
+    const uint32_t third_id = cache.Acquire(FONT_ID, "cccc", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(16u, cache.GlyphCapacity());
+    EXPECT_EQ(3u, cache.CachedRuns());
+
+    cache.Release(first_id);
+    cache.Release(second_id);
+    cache.Acquire(FONT_ID, "dddddddd", mono::FontCentering::DEFAULT_CENTER);
+    cache.Acquire(FONT_ID, "eeee", mono::FontCentering::DEFAULT_CENTER);
+
+    // "aaaa" was the least recently used and is evicted first, then "bbbb".
+    EXPECT_EQ(16u, cache.GlyphCapacity());
+    EXPECT_EQ(3u, cache.CachedRuns());
+    EXPECT_EQ(4u, cache.Run(third_id).n_glyphs);
+}
+
+TEST_F(TextLayoutCacheTest, Utf8CharactersAreOneGlyph)
+{
+    mono::TextLayoutCache cache(16);
+
+    // "h", a with ring in two bytes, then "ll".
+    const uint32_t run_id = cache.Acquire(FONT_ID, "h\xC3\xA5ll", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(4u, cache.Run(run_id).n_glyphs);
+
+    // The byte that was not needed is given back to the arena.
+    const uint32_t second_id = cache.Acquire(FONT_ID, "abcdefghijkl", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(16u, cache.GlyphCapacity());
+    EXPECT_EQ(4u, cache.Run(second_id).vertex_offset / 4);
+}
+
+TEST_F(TextLayoutCacheTest, EmptyRunsAreRemovedOnLastRelease)
+{
+    mono::TextLayoutCache cache(16);
+
+    const uint32_t first_id = cache.Acquire(FONT_ID, "", mono::FontCentering::DEFAULT_CENTER);
+    const uint32_t second_id = cache.Acquire(FONT_ID, "", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(first_id, second_id);
+    EXPECT_EQ(1u, cache.CachedRuns());
+    EXPECT_EQ(0u, cache.Run(first_id).n_glyphs);
+
+    cache.Release(first_id);
+    EXPECT_EQ(1u, cache.CachedRuns());
+
+    cache.Release(second_id);
+    EXPECT_EQ(0u, cache.CachedRuns());
+
+    // The id is reused by the next run.
+    const uint32_t hello_id = cache.Acquire(FONT_ID, "Hello", mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(first_id, hello_id);
+    EXPECT_EQ(5u, cache.Run(hello_id).n_glyphs);
+}
+
+TEST_F(TextLayoutCacheTest, CenteredRunMatchesMeasuredSize)
+{
+    mono::TextLayoutCache cache(16);
+
+    const uint32_t run_id = cache.Acquire(FONT_ID, "Hello, world", mono::FontCentering::HORIZONTAL_VERTICAL);
+    const mono::GlyphRun& run = cache.Run(run_id);
+
+    // The quads include four pixels of distance field padding at the 32 pixel rasterization height, the font
+    // is loaded at 13 pixels and scale 0.1.
+    const float padding = 4.0f * (13.0f / 32.0f) * 0.1f;
+
+    float min_x = math::INF;
+    float max_x = -math::INF;
+    float min_y = math::INF;
+    float max_y = -math::INF;
+
+    const math::Vector* vertices = cache.Vertices() + run.vertex_offset;
+    for(uint32_t glyph = 0; glyph < run.n_glyphs; ++glyph)
+    {
+        const math::Vector* quad = vertices + glyph * 4;
+        if(quad[0].x == quad[2].x)
+            continue;
+
+        min_x = std::min(min_x, quad[0].x + padding);
+        max_x = std::max(max_x, quad[2].x - padding);
+        min_y = std::min(min_y, quad[0].y + padding);
+        max_y = std::max(max_y, quad[2].y - padding);
+    }
+
+    const math::Vector size = mono::MeasureString(FONT_ID, "Hello, world");
+    EXPECT_NEAR(size.x, max_x - min_x, 1e-4f);
+    EXPECT_NEAR(size.y, max_y - min_y, 1e-4f);
+    EXPECT_NEAR(0.0f, (min_x + max_x) / 2.0f, 1e-4f);
+    EXPECT_NEAR(0.0f, (min_y + max_y) / 2.0f, 1e-4f);
+}
+
+TEST_F(TextLayoutCacheTest, RebuildsFullAtlasAndLaysOutReferencedRunsAgain)
+{
+    const char* font_files[] = {
+        MONO_SOURCE_DIR "/third_party/imgui/misc/fonts/Roboto-Medium.ttf",
+        MONO_SOURCE_DIR "/third_party/imgui/misc/fonts/DroidSans.ttf",
+        MONO_SOURCE_DIR "/third_party/imgui/misc/fonts/Cousine-Regular.ttf",
+        MONO_SOURCE_DIR "/third_party/imgui/misc/fonts/Karla-Regular.ttf",
+    };
+
+    constexpr int LARGE_FONT_ID = 1;
+    for(int index = 0; index < int(std::size(font_files)); ++index)
+        mono::LoadFont(LARGE_FONT_ID + index, font_files[index], 13.0f, 0.1f);
+
+    // Every codepoint up to the CJK blocks in all of the fonts, more glyphs than fit in the atlas.
+    std::string many_glyphs;
+    for(uint32_t codepoint = 0x100; codepoint < 0x3000; ++codepoint)
+    {
+        if(codepoint < 0x800)
+        {
+            many_glyphs += char(0xC0 | (codepoint >> 6));
+        }
+        else
+        {
+            many_glyphs += char(0xE0 | (codepoint >> 12));
+            many_glyphs += char(0x80 | ((codepoint >> 6) & 0x3F));
+        }
+        many_glyphs += char(0x80 | (codepoint & 0x3F));
+    }
+
+    mono::TextLayoutCache cache(16);
+
+    for(int index = 0; index < int(std::size(font_files)); ++index)
+    {
+        const uint32_t many_id = cache.Acquire(LARGE_FONT_ID + index, many_glyphs.c_str(), mono::FontCentering::DEFAULT_CENTER);
+        cache.Release(many_id);
+    }
+
+    // The atlas is full, a ring is drawn as '?' until the rebuild.
+    const char* ring_text = "\xC3\xA5";
+    math::Vector vertices[4];
+    math::Vector missing_uvs[4];
+    mono::GenerateGlyphQuads(LARGE_FONT_ID, "?", 1, mono::FontCentering::DEFAULT_CENTER, vertices, missing_uvs);
+
+    const uint32_t ring_id = cache.Acquire(LARGE_FONT_ID, ring_text, mono::FontCentering::DEFAULT_CENTER);
+    EXPECT_EQ(missing_uvs[0], cache.UVs()[cache.Run(ring_id).vertex_offset]);
+    EXPECT_EQ(2u, cache.CachedRuns());
+
+    const uint32_t generation = mono::GlyphAtlasGeneration();
+    EXPECT_TRUE(mono::RebuildGlyphAtlasIfFull());
+    EXPECT_FALSE(mono::RebuildGlyphAtlasIfFull());
+    EXPECT_EQ(generation + 1, mono::GlyphAtlasGeneration());
+
+    // The unreferenced run is evicted, the ring is laid out again with its own glyph.
+    cache.Refresh();
+    EXPECT_EQ(1u, cache.CachedRuns());
+
+    math::Vector ring_uvs[4];
+    mono::GenerateGlyphQuads(LARGE_FONT_ID, ring_text, 2, mono::FontCentering::DEFAULT_CENTER, vertices, ring_uvs);
+    EXPECT_NE(missing_uvs[0], ring_uvs[0]);
+
+    const mono::GlyphRun& ring_run = cache.Run(ring_id);
+    for(uint32_t index = 0; index < 4; ++index)
+        EXPECT_EQ(ring_uvs[index], cache.UVs()[ring_run.vertex_offset + index]);
+}
@@ -0,0 +1,224 @@
+
+#include "Rendering/Texture/TextureCache.h"
+#include "stb/stb_image_write.h"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <vector>
+#include <string>
+
+TEST(TextureCacheTest, RGBImageIsExpandedAndCached)
+{
+    constexpr int width = 8;
+    constexpr int height = 4;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "mono_texture_cache_test";
+    const std::filesystem::path cache_directory = directory / "cache";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::vector<unsigned char> pixels;
+    for(int index = 0; index < width * height; ++index)
+    {
+        pixels.push_back(index);
+        pixels.push_back(10);
+        pixels.push_back(20);
+    }
+
+    const std::string filename = (directory / "rgb.png").string();
+    const std::string cache_directory_string = cache_directory.string();
+    stbi_write_png(filename.c_str(), width, height, 3, pixels.data(), width * 3);
+
+    const mono::TextureImageData decoded =
+        mono::LoadTextureImage(filename.c_str(), cache_directory_string.c_str(), mono::UNCOMPRESSED_TEXTURE_FORMATS);
+    ASSERT_TRUE(decoded.IsValid());
+    EXPECT_EQ(mono::TextureFormat::RGBA8, decoded.format);
+    EXPECT_EQ(uint32_t(width * height * 4), decoded.mip_size[0]);
+    ASSERT_FALSE(std::filesystem::is_empty(cache_directory));
+
+    const mono::TextureImageData cached =
+        mono::LoadTextureImage(filename.c_str(), cache_directory_string.c_str(), mono::UNCOMPRESSED_TEXTURE_FORMATS);
+    ASSERT_TRUE(cached.IsValid());
+    EXPECT_NE(decoded.mip_data[0], cached.mip_data[0]);
+    EXPECT_EQ(decoded.width, cached.width);
+    EXPECT_EQ(decoded.height, cached.height);
+    EXPECT_EQ(decoded.format, cached.format);
+    ASSERT_EQ(decoded.mip_size[0], cached.mip_size[0]);
+
+    const std::vector<unsigned char> decoded_pixels(decoded.mip_data[0], decoded.mip_data[0] + decoded.mip_size[0]);
+    const std::vector<unsigned char> cached_pixels(cached.mip_data[0], cached.mip_data[0] + cached.mip_size[0]);
+    EXPECT_EQ(decoded_pixels, cached_pixels);
+    EXPECT_EQ(255, cached_pixels[3]);
+
+    // Writing the source again changes its modification time, and here its size, the entry is not used.
+    pixels.resize(width * height * 3 / 2);
+    stbi_write_png(filename.c_str(), width, height / 2, 3, pixels.data(), width * 3);
+
+    const mono::TextureImageData reloaded =
+        mono::LoadTextureImage(filename.c_str(), cache_directory_string.c_str(), mono::UNCOMPRESSED_TEXTURE_FORMATS);
+    ASSERT_TRUE(reloaded.IsValid());
+    EXPECT_EQ(uint32_t(height / 2), reloaded.height);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(TextureCacheTest, UnsupportedCachedFormatIsIgnored)
+{
+    const std::filesystem::path cache_directory = std::filesystem::temp_directory_path() / "mono_texture_cache_format_test";
+    std::filesystem::remove_all(cache_directory);
+
+    const std::string cache_directory_string = cache_directory.string();
+    const unsigned char block[8] = { 0 };
+
+    mono::TextureImageData image;
+    image.width = 4;
+    image.height = 4;
+    image.format = mono::TextureFormat::BC1_RGBA;
+    image.n_mips = 1;
+    image.mip_data[0] = block;
+    image.mip_size[0] = sizeof(block);
+
+    const mono::TextureCacheKey key = { "res/textures/block.png", 1234, 5678 };
+    ASSERT_TRUE(mono::WriteTextureCache(cache_directory_string.c_str(), key, image));
+
+    const mono::TextureImageData unsupported =
+        mono::ReadTextureCache(cache_directory_string.c_str(), key, mono::UNCOMPRESSED_TEXTURE_FORMATS);
+    EXPECT_FALSE(unsupported.IsValid());
+
+    const mono::TextureImageData supported = mono::ReadTextureCache(
+        cache_directory_string.c_str(), key, mono::TextureFormatBit(mono::TextureFormat::BC1_RGBA));
+    ASSERT_TRUE(supported.IsValid());
+    EXPECT_EQ(sizeof(block), supported.mip_size[0]);
+
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST(TextureCacheTest, StaleOrInconsistentEntriesAreIgnored)
+{
+    const std::filesystem::path cache_directory = std::filesystem::temp_directory_path() / "mono_texture_cache_stale_test";
+    std::filesystem::remove_all(cache_directory);
+
+    const std::string cache_directory_string = cache_directory.string();
+    const unsigned char pixels[4 * 4 * 4] = { 0 };
+
+    mono::TextureImageData image = mono::MakeTextureImage(4, 4, 4, pixels);
+
+    const mono::TextureCacheKey key = { "res/textures/pixels.png", 1234, 5678 };
+    ASSERT_TRUE(mono::WriteTextureCache(cache_directory_string.c_str(), key, image));
+    EXPECT_TRUE(mono::ReadTextureCache(cache_directory_string.c_str(), key, mono::UNCOMPRESSED_TEXTURE_FORMATS).IsValid());
+
+    // The source has been changed since the entry was written.
+    mono::TextureCacheKey changed_key = key;
+    changed_key.source_mtime++;
+    EXPECT_FALSE(mono::ReadTextureCache(cache_directory_string.c_str(), changed_key, mono::UNCOMPRESSED_TEXTURE_FORMATS).IsValid());
+
+    changed_key = key;
+    changed_key.source_size++;
+    EXPECT_FALSE(mono::ReadTextureCache(cache_directory_string.c_str(), changed_key, mono::UNCOMPRESSED_TEXTURE_FORMATS).IsValid());
+
+    // A mip size that does not match the width and height.
+    image.width = 8;
+    ASSERT_TRUE(mono::WriteTextureCache(cache_directory_string.c_str(), key, image));
+    EXPECT_FALSE(mono::ReadTextureCache(cache_directory_string.c_str(), key, mono::UNCOMPRESSED_TEXTURE_FORMATS).IsValid());
+
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST(TextureCacheTest, GenerateMipChain)
+{
+    constexpr uint32_t width = 37;
+    constexpr uint32_t height = 10;
+
+    std::vector<unsigned char> pixels(width * height * 4);
+    for(uint32_t index = 0; index < width * height; ++index)
+    {
+        pixels[index * 4 + 0] = 100;
+        pixels[index * 4 + 1] = (index % 2) ? 0 : 200;
+        pixels[index * 4 + 2] = 30;
+        pixels[index * 4 + 3] = 255;
+    }
+
+    mono::TextureImageData image = mono::MakeTextureImage(width, height, 4, pixels.data());
+    mono::GenerateTextureMips(image);
+
+    // 37x10, 18x5, 9x2, 4x1, 2x1, 1x1
+    ASSERT_EQ(6u, image.n_mips);
+    ASSERT_NE(nullptr, image.storage);
+    EXPECT_EQ(18u * 5u * 4u, image.mip_size[1]);
+    EXPECT_EQ(4u, image.mip_size[5]);
+
+    const std::vector<unsigned char> level_zero(image.mip_data[0], image.mip_data[0] + image.mip_size[0]);
+    EXPECT_EQ(pixels, level_zero);
+
+    for(uint32_t level = 1; level < image.n_mips; ++level)
+    {
+        const unsigned char* mip_data = image.mip_data[level];
+        for(uint32_t index = 0; index < image.mip_size[level]; index += 4)
+        {
+            EXPECT_EQ(100, mip_data[index + 0]);
+            EXPECT_EQ(100, mip_data[index + 1]);
+            EXPECT_EQ(30, mip_data[index + 2]);
+            EXPECT_EQ(255, mip_data[index + 3]);
+        }
+    }
+}
+
+TEST(TextureCacheTest, MipChainMatchesScalarBoxFilter)
+{
+    // Wide enough that most of each row goes through the vectorized path, odd sizes for the clamped edges.
+    constexpr uint32_t width = 83;
+    constexpr uint32_t height = 21;
+
+    std::vector<unsigned char> pixels(width * height * 4);
+    uint32_t state = 12345;
+    for(unsigned char& value : pixels)
+    {
+        state = state * 1664525u + 1013904223u;
+        value = state >> 24;
+    }
+
+    mono::TextureImageData image = mono::MakeTextureImage(width, height, 4, pixels.data());
+    mono::GenerateTextureMips(image);
+    ASSERT_GT(image.n_mips, 1u);
+
+    std::vector<unsigned char> expected = pixels;
+    uint32_t source_width = width;
+    uint32_t source_height = height;
+
+    for(uint32_t level = 1; level < image.n_mips; ++level)
+    {
+        const uint32_t target_width = std::max(source_width / 2, 1u);
+        const uint32_t target_height = std::max(source_height / 2, 1u);
+
+        std::vector<unsigned char> target(target_width * target_height * 4);
+        for(uint32_t y = 0; y < target_height; ++y)
+        {
+            const uint32_t y0 = std::min(y * 2 + 0, source_height - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, source_height - 1);
+
+            for(uint32_t x = 0; x < target_width; ++x)
+            {
+                const uint32_t x0 = std::min(x * 2 + 0, source_width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, source_width - 1);
+
+                for(uint32_t component = 0; component < 4; ++component)
+                {
+                    const uint32_t sum =
+                        expected[(y0 * source_width + x0) * 4 + component] +
+                        expected[(y0 * source_width + x1) * 4 + component] +
+                        expected[(y1 * source_width + x0) * 4 + component] +
+                        expected[(y1 * source_width + x1) * 4 + component];
+                    target[(y * target_width + x) * 4 + component] = (sum + 2) / 4;
+                }
+            }
+        }
+
+        ASSERT_EQ(target.size(), image.mip_size[level]);
+        const std::vector<unsigned char> mip(image.mip_data[level], image.mip_data[level] + image.mip_size[level]);
+        EXPECT_EQ(target, mip) << "Mip level " << level;
+
+        expected = target;
+        source_width = target_width;
+        source_height = target_height;
+    }
+}
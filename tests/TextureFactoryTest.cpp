@@ -0,0 +1,146 @@
+
+#include "Rendering/Texture/TextureFactoryImpl.h"
+#include "Rendering/Texture/Texture.h"
+#include "Rendering/Texture/TextureCache.h"
+#include "sokol/sokol_gfx.h"
+#include "stb/stb_image_write.h"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+
+namespace
+{
+    std::filesystem::path TestImageDirectory()
+    {
+        return std::filesystem::temp_directory_path() / "mono_texture_factory_test";
+    }
+
+    class TextureFactoryTest : public testing::Test
+    {
+    protected:
+
+        // The unit tests link the dummy backend, textures can be created without a window.
+        void SetUp() override
+        {
+            sg_desc desc = {};
+            desc.image_pool_size = 512;
+            sg_setup(&desc);
+        }
+
+        void TearDown() override
+        {
+            sg_shutdown();
+            std::filesystem::remove_all(TestImageDirectory());
+        }
+    };
+}
+
+TEST_F(TextureFactoryTest, LoadManyTexturesAsync)
+{
+    ASSERT_EQ(SG_BACKEND_DUMMY, sg_query_backend());
+
+    constexpr int n_images = 300;
+    constexpr int width = 32;
+    constexpr int height = 16;
+
+    const std::filesystem::path directory = TestImageDirectory();
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::string> filenames;
+    for(int index = 0; index < n_images; ++index)
+    {
+        const std::vector<unsigned char> pixels(width * height * 4, (unsigned char)index);
+        const std::string filename = (directory / ("image_" + std::to_string(index) + ".png")).string();
+        stbi_write_png(filename.c_str(), width, height, 4, pixels.data(), width * 4);
+        filenames.push_back(filename);
+    }
+
+    // Room for ten images per upload, mips included.
+    const uint32_t image_bytes =
+        mono::LoadTextureImage(filenames.front().c_str(), nullptr, mono::UNCOMPRESSED_TEXTURE_FORMATS).Bytes();
+    const uint32_t byte_budget = image_bytes * 10;
+
+    mono::TextureFactoryImpl factory(4, byte_budget, nullptr, mono::TextureSampler::DEFAULT);
+
+    std::vector<mono::ITexturePtr> textures;
+    std::vector<bool> high_priority;
+
+    for(int index = 0; index < n_images; ++index)
+    {
+        const bool high = (index % 2) != 0;
+        const mono::TextureLoadPriority priority = high ? mono::TextureLoadPriority::HIGH : mono::TextureLoadPriority::LOW;
+        mono::ITexturePtr texture = factory.CreateTextureAsync(filenames[index].c_str(), priority, mono::TextureSampler::DEFAULT);
+
+        // The placeholder has the size of the image.
+        ASSERT_TRUE(texture != nullptr);
+        EXPECT_EQ(uint32_t(width), texture->Width());
+        EXPECT_EQ(uint32_t(height), texture->Height());
+        EXPECT_TRUE(static_cast<mono::TextureImpl*>(texture.get())->IsPending());
+
+        // Loading the same file again gives the texture that is already pending.
+        EXPECT_EQ(texture, factory.CreateTextureAsync(filenames[index].c_str(), priority, mono::TextureSampler::DEFAULT));
+
+        textures.push_back(texture);
+        high_priority.push_back(high);
+    }
+
+    const uint32_t placeholder_id = textures.front()->Id();
+
+    // Let everything decode first, the uploads are then ordered on priority alone.
+    while(factory.QueuedTextures() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const auto count_pending = [&textures, &high_priority](bool count_high) {
+        uint32_t n_pending = 0;
+        for(uint32_t index = 0; index < textures.size(); ++index)
+        {
+            if(high_priority[index] == count_high && static_cast<mono::TextureImpl*>(textures[index].get())->IsPending())
+                n_pending++;
+        }
+        return n_pending;
+    };
+
+    uint32_t n_pending_high = count_pending(true);
+    uint32_t n_pending_low = count_pending(false);
+    EXPECT_EQ(uint32_t(n_images / 2), n_pending_high);
+    EXPECT_EQ(uint32_t(n_images / 2), n_pending_low);
+
+    uint32_t n_uploads = 0;
+
+    while(n_pending_high + n_pending_low > 0)
+    {
+        factory.UploadPendingTextures();
+        n_uploads++;
+
+        const uint32_t new_pending_high = count_pending(true);
+        const uint32_t new_pending_low = count_pending(false);
+
+        // Never more than the byte budget per upload, and no low priority texture before the high ones are done.
+        const uint32_t n_resolved = (n_pending_high - new_pending_high) + (n_pending_low - new_pending_low);
+        EXPECT_LE(n_resolved * image_bytes, byte_budget);
+        EXPECT_GT(n_resolved, 0u);
+        if(new_pending_low != n_pending_low)
+        {
+            EXPECT_EQ(0u, new_pending_high);
+        }
+
+        n_pending_high = new_pending_high;
+        n_pending_low = new_pending_low;
+
+        ASSERT_LE(n_uploads, uint32_t(n_images));
+    }
+
+    EXPECT_EQ(uint32_t(n_images / 10), n_uploads);
+
+    for(const mono::ITexturePtr& texture : textures)
+    {
+        EXPECT_NE(placeholder_id, texture->Id());
+        EXPECT_EQ(uint32_t(width), texture->Width());
+        EXPECT_EQ(uint32_t(height), texture->Height());
+        EXPECT_EQ(SG_RESOURCESTATE_VALID, sg_query_image_state(static_cast<mono::TextureImpl*>(texture.get())->m_handle));
+    }
+}
@@ -0,0 +1,99 @@
+
+#include "Rendering/Texture/TextureLoader.h"
+#include "stb/stb_image_write.h"
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+
+namespace
+{
+    std::filesystem::path TestImageDirectory()
+    {
+        return std::filesystem::temp_directory_path() / "mono_texture_loader_test";
+    }
+
+    std::vector<std::string> WriteTestImages(int n_images, int width, int height)
+    {
+        const std::filesystem::path directory = TestImageDirectory();
+        std::filesystem::create_directories(directory);
+
+        std::vector<std::string> filenames;
+
+        for(int index = 0; index < n_images; ++index)
+        {
+            const std::vector<unsigned char> pixels(width * height * 4, (unsigned char)index);
+            const std::string filename = (directory / ("image_" + std::to_string(index) + ".png")).string();
+            stbi_write_png(filename.c_str(), width, height, 4, pixels.data(), width * 4);
+            filenames.push_back(filename);
+        }
+
+        return filenames;
+    }
+}
+
+TEST(TextureLoaderTest, LoadManyImagesInParallel)
+{
+    constexpr int n_images = 300;
+    constexpr int width = 32;
+    constexpr int height = 16;
+    constexpr uint32_t image_bytes = width * height * 4;
+    constexpr uint32_t byte_budget = image_bytes * 10;
+
+    const std::vector<std::string> filenames = WriteTestImages(n_images, width, height);
+
+    mono::TextureLoader loader(4, nullptr, mono::UNCOMPRESSED_TEXTURE_FORMATS);
+
+    for(int index = 0; index < n_images; ++index)
+    {
+        const mono::TextureLoadPriority priority = (index % 2) ? mono::TextureLoadPriority::HIGH : mono::TextureLoadPriority::LOW;
+        loader.Enqueue(index, filenames[index].c_str(), priority);
+    }
+
+    std::vector<bool> loaded(n_images, false);
+
+    const auto callback = [&](const mono::DecodedImage& decoded) {
+        const mono::TextureImageData& image = decoded.image;
+        ASSERT_TRUE(image.IsValid());
+        EXPECT_EQ(uint32_t(width), image.width);
+        EXPECT_EQ(uint32_t(height), image.height);
+        EXPECT_EQ(mono::TextureFormat::RGBA8, image.format);
+        EXPECT_EQ((unsigned char)decoded.id, image.mip_data[0][0]);
+        EXPECT_FALSE(loaded[decoded.id]);
+        loaded[decoded.id] = true;
+    };
+
+    while(loader.Pending() > 0)
+    {
+        const uint32_t processed_bytes = loader.ProcessDecoded(byte_budget, callback);
+        EXPECT_LE(processed_bytes, byte_budget);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for(bool image_loaded : loaded)
+        EXPECT_TRUE(image_loaded);
+
+    std::filesystem::remove_all(TestImageDirectory());
+}
+
+TEST(TextureLoaderTest, FailedDecodeHasNoImageData)
+{
+    mono::TextureLoader loader(1, nullptr, mono::UNCOMPRESSED_TEXTURE_FORMATS);
+    loader.Enqueue(7, "this_file_does_not_exist.png", mono::TextureLoadPriority::NORMAL);
+
+    bool called = false;
+    const auto callback = [&called](const mono::DecodedImage& decoded) {
+        EXPECT_EQ(7u, decoded.id);
+        EXPECT_FALSE(decoded.image.IsValid());
+        EXPECT_EQ(0u, decoded.Bytes());
+        called = true;
+    };
+
+    while(loader.Pending() > 0)
+        loader.ProcessDecoded(1024, callback);
+
+    EXPECT_TRUE(called);
+}
@@ -0,0 +1,10 @@
+// The backend is selected by the build, SOKOL_GLCORE33 for the engine and SOKOL_DUMMY_BACKEND for the unit tests.
+
+#ifdef __APPLE__
+    #define SOKOL_ASSERT(c) if(!(c)) __builtin_trap();
+#endif
+
+#define SOKOL_TRACE_HOOKS
+#define SOKOL_GFX_IMPL
+#define SOKOL_DEBUG
+#include "sokol_gfx.h"